@@ -0,0 +1,165 @@
+#pragma once
+
+#include "bench_environment.h"
+#include <fio/BufferedReader.h>
+#include <fio/BufferedWriter.h>
+#include <fio/IoBackend.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * A replay of random 4 KiB reads of a file through fio::IoBackend at the queue depths 1..64,
+ * io_uring against the thread pool, then the sequential fio::BufferedReader/BufferedWriter
+ * with and without the prefetch and the write pipeline.
+ * The file is in $BENCH_AIO_DIR (/tmp by default), put it on the disk under the test. The random reads
+ * use O_DIRECT when the file system supports it, otherwise they measure the page cache path.
+ */
+class BenchAio {
+	static constexpr size_t PAGE = 4096;
+	static constexpr unsigned DEPTH_MAX = 64;
+
+	size_t m_file_size;
+	size_t m_reads;
+	std::string m_name;
+	bool m_direct = false;
+
+public:
+
+	BenchAio(size_t file_size, size_t reads) noexcept : m_file_size(file_size), m_reads(reads) {
+		BENCH_TRACE;
+		const char* dir = getenv("BENCH_AIO_DIR");
+		m_name = std::string(dir ? dir : "/tmp") + "/bench_aio_XXXXXX";
+		const int fd = mkstemp(&m_name[0]);
+		if(fd < 0) {
+			fprintf(stderr, "Can't create a temporary file in %s\n", dir ? dir : "/tmp");
+			return;
+		}
+		close(fd);
+		if(write_file()) {
+			bench_random_reads();
+			bench_sequential();
+		}
+		remove(m_name.c_str());
+	}
+
+private:
+
+	bool write_file() noexcept {
+		fio::BufferedWriter writer(m_name);
+		if(not writer.open()) {
+			return false;
+		}
+		DiceMachine dice(1);
+		for(size_t i = 0; i < m_file_size / sizeof(uint64_t); ++i) {
+			writer.write(dice.u64());
+		}
+		return writer.close();
+	}
+
+	void bench_random_reads() noexcept {
+		int fd = open(m_name.c_str(), O_RDONLY | O_DIRECT);
+		m_direct = fd >= 0;
+		if(not m_direct) {
+			fd = open(m_name.c_str(), O_RDONLY);
+		}
+		printf("random %zu byte reads, %s\n", PAGE, m_direct ? "O_DIRECT" : "page cache");
+		void* raw = nullptr;
+		if(fd < 0 || posix_memalign(&raw, PAGE, PAGE * DEPTH_MAX)) {
+			return;
+		}
+		std::unique_ptr<uint8_t, decltype(&free)> buffers(static_cast<uint8_t*>(raw), &free);
+		DiceMachine dice(2);
+		std::vector<uint64_t> offsets(m_reads);
+		for(auto& offset : offsets) {
+			offset = (dice.u64() % (m_file_size / PAGE)) * PAGE;
+		}
+		for(bool uring : {true, false}) {
+			for(unsigned depth = 1; depth <= DEPTH_MAX; depth *= 2) {
+				auto io = fio::IoBackend::create(depth, uring);
+				const iovec iov = {buffers.get(), PAGE * depth};
+				const bool registered = io->register_buffers(&iov, 1u);
+				const std::string name = std::string(io->name()) + ", depth " + std::to_string(depth);
+				size_t errors = 0;
+				bench_run(name.c_str(), depth, m_reads, [&]() {
+					errors += replay(*io, fd, buffers.get(), registered, offsets);
+				});
+				if(errors) {
+					printf("%zu reads failed\n", errors);
+				}
+			}
+		}
+		close(fd);
+	}
+
+	/**
+	 * Keep the queue full: a completed slot gets the next offset.
+	 * @return The number of the failed reads.
+	 */
+	static size_t replay(fio::IoBackend& io, int fd, uint8_t* buffers, bool registered
+		, const std::vector<uint64_t>& offsets) noexcept {
+		fio::IoCompletion completions[DEPTH_MAX];
+		size_t next = 0, errors = 0;
+		auto queue = [&](unsigned slot) {
+			fio::IoRequest request;
+			request.fd = fd;
+			request.buf = buffers + PAGE * slot;
+			request.len = PAGE;
+			request.offset = offsets[next++];
+			request.buf_index = registered ? 0 : -1;
+			request.user_data = slot;
+			io.queue(request);
+		};
+		for(unsigned slot = 0; slot < io.depth() && next < offsets.size(); ++slot) {
+			queue(slot);
+		}
+		while(io.inflight()) {
+			const size_t count = io.wait(completions, DEPTH_MAX, 1);
+			for(size_t i = 0; i < count; ++i) {
+				errors += completions[i].result != int64_t(PAGE);
+				if(next < offsets.size()) {
+					queue(unsigned(completions[i].user_data));
+				}
+			}
+		}
+		return errors;
+	}
+
+	void bench_sequential() noexcept {
+		const size_t items = m_file_size / sizeof(uint64_t);
+		for(unsigned depth : {0u, 2u, 4u, 8u}) {
+			const std::string suffix = depth ? ", depth " + std::to_string(depth) : ", sync";
+			bench_run(("fio::BufferedReader" + suffix).c_str(), depth, items, [&]() {
+				fio::BufferedReader reader(m_name);
+				reader.set_queue_depth(depth);
+				reader.open();
+				uint64_t value, sum = 0;
+				while(reader.read(value)) {
+					sum += value;
+				}
+				bench_keep(sum);
+			});
+		}
+		const std::string copy = m_name + ".copy";
+		for(unsigned depth : {0u, 2u, 4u, 8u}) {
+			const std::string suffix = depth ? ", depth " + std::to_string(depth) : ", sync";
+			bench_run(("fio::BufferedWriter" + suffix).c_str(), depth, items, [&]() {
+				fio::BufferedWriter writer(copy);
+				writer.set_queue_depth(depth);
+				writer.open();
+				for(size_t i = 0; i < items; ++i) {
+					writer.write(uint64_t(i));
+				}
+				writer.close();
+			});
+		}
+		remove(copy.c_str());
+	}
+
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "bench_environment.h"
+#include <containers/bits/BitArray.h>
+
+#include <utility>
+#include <vector>
+
+/**
+ * Compares the per item load()/store() loops with load_range()/store_range()
+ * and the item by item fill with fill() for every width in [1:63] on 64-bit chunks.
+ * Every cell is Mitems/s.
+ */
+class BenchBitArray {
+	size_t m_items;
+	size_t m_rounds;
+	std::vector<uint64_t> m_values;
+
+public:
+
+	BenchBitArray(size_t items, size_t rounds) noexcept : m_items(items), m_rounds(rounds), m_values(items) {
+		BENCH_TRACE;
+		printf("%5s %12s %12s %12s %12s %12s %12s\n"
+			, "width", "load", "load_range", "store", "store_range", "fill(loop)", "fill");
+		bench_widths(std::make_integer_sequence<uint8_t, 64>());
+	}
+
+private:
+
+	template <uint8_t... Widths>
+	void bench_widths(std::integer_sequence<uint8_t, Widths...>) noexcept {
+		(bench_width<Widths>(), ...);
+	}
+
+	double mitems(const BenchTimer& timer) const noexcept {
+		return double(m_items * m_rounds) * 1000.0 / double(timer.ns());
+	}
+
+	template <uint8_t Width>
+	void bench_width() noexcept {
+		if constexpr (Width > 0) {
+			BitArray<Width, uint64_t> array;
+			array.allocate(m_items);
+			DiceMachine dice(Width);
+			for(auto& value : m_values) {
+				value = dice.u64() & array.value_max();
+			}
+			double result[6];
+			BenchTimer timer;
+
+			timer.start();
+			for(size_t round = 0; round < m_rounds; ++round) {
+				for(size_t i = 0; i < m_items; ++i) {
+					array.store(i, m_values[i]);
+				}
+			}
+			timer.stop();
+			result[2] = mitems(timer);
+
+			timer.start();
+			for(size_t round = 0; round < m_rounds; ++round) {
+				for(size_t i = 0; i < m_items; ++i) {
+					m_values[i] = array.load(i);
+				}
+				bench_keep(m_values[round % m_items]);
+			}
+			timer.stop();
+			result[0] = mitems(timer);
+
+			timer.start();
+			for(size_t round = 0; round < m_rounds; ++round) {
+				array.store_range(0, m_items, m_values.data());
+			}
+			timer.stop();
+			result[3] = mitems(timer);
+
+			timer.start();
+			for(size_t round = 0; round < m_rounds; ++round) {
+				array.load_range(0, m_items, m_values.data());
+				bench_keep(m_values[round % m_items]);
+			}
+			timer.stop();
+			result[1] = mitems(timer);
+
+			timer.start();
+			for(size_t round = 0; round < m_rounds; ++round) {
+				for(size_t i = 0; i < m_items; ++i) {
+					array.store(i, round);
+				}
+			}
+			timer.stop();
+			result[4] = mitems(timer);
+
+			timer.start();
+			for(size_t round = 0; round < m_rounds; ++round) {
+				array.fill(round);
+				bench_keep(array);
+			}
+			timer.stop();
+			result[5] = mitems(timer);
+
+			printf("%5u %12.1f %12.1f %12.1f %12.1f %12.1f %12.1f\n"
+				, unsigned(Width), result[0], result[1], result[2], result[3], result[4], result[5]);
+		}
+	}
+
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "bench_environment.h"
+#include <containers/bits/BitStream.h>
+#include <containers/bits/BitStreamFast.h>
+
+#include <vector>
+
+/**
+ * Decoding/encoding of the packed telemetry records: the fixed layout of fields
+ * of 3, 12, 17, 7, 29, 1 and 44 bits (113 bits per record),
+ * with BitStream and with BitStreamReader/BitStreamWriter.
+ * The varint case codes the zig-zag deltas of a slowly changing counter.
+ */
+class BenchBitStream {
+	static constexpr unsigned WIDTHS[] = {3, 12, 17, 7, 29, 1, 44};
+	static constexpr size_t FIELDS = sizeof(WIDTHS) / sizeof(WIDTHS[0]);
+
+	size_t m_records;
+	size_t m_rounds;
+	std::vector<uint64_t> m_values;
+	std::vector<uint8_t> m_buffer;
+
+public:
+
+	BenchBitStream(size_t records, size_t rounds) noexcept
+		: m_records(records)
+		, m_rounds(rounds)
+		, m_values(records * FIELDS)
+		, m_buffer(records * FIELDS * 8) {
+		DiceMachine dice(113);
+		for(size_t i = 0; i < m_values.size(); ++i) {
+			m_values[i] = dice.u64() & ~(~0ull << WIDTHS[i % FIELDS]);
+		}
+		bench_fields();
+		bench_varint();
+	}
+
+private:
+
+	void bench_fields() noexcept {
+		BENCH_TRACE;
+		BenchTimer timer;
+		const size_t records = m_records * m_rounds;
+
+		timer.start();
+		for(size_t round = 0; round < m_rounds; ++round) {
+			BitStream bs(m_buffer.data(), m_buffer.size());
+			for(size_t i = 0; i < m_values.size(); i += FIELDS) {
+				for(size_t f = 0; f < FIELDS; ++f) {
+					bs.write(m_values[i + f], BitStream::Width_t(WIDTHS[f]));
+				}
+			}
+			bench_keep(m_buffer[round]);
+		}
+		timer.stop();
+		timer.report("BitStream::write", records);
+
+		timer.start();
+		for(size_t round = 0; round < m_rounds; ++round) {
+			BitStreamWriter writer(m_buffer.data(), m_buffer.size());
+			for(size_t i = 0; i < m_values.size(); i += FIELDS) {
+				for(size_t f = 0; f < FIELDS; ++f) {
+					writer.write(m_values[i + f], WIDTHS[f]);
+				}
+			}
+			writer.finish();
+			bench_keep(m_buffer[round]);
+		}
+		timer.stop();
+		timer.report("BitStreamWriter::write", records);
+
+		uint64_t acc = 0;
+		timer.start();
+		for(size_t round = 0; round < m_rounds; ++round) {
+			BitStream bs(m_buffer.data(), m_buffer.size());
+			BitStream::Chunk_t value = 0;
+			for(size_t i = 0; i < m_values.size(); i += FIELDS) {
+				for(size_t f = 0; f < FIELDS; ++f) {
+					bs.read(value, BitStream::Width_t(WIDTHS[f]));
+					acc += value;
+				}
+			}
+			bench_keep(acc);
+		}
+		timer.stop();
+		timer.report("BitStream::read", records);
+
+		timer.start();
+		for(size_t round = 0; round < m_rounds; ++round) {
+			BitStreamReader reader(m_buffer.data(), m_buffer.size());
+			for(size_t i = 0; i < m_values.size(); i += FIELDS) {
+				for(size_t f = 0; f < FIELDS; ++f) {
+					acc += reader.read(WIDTHS[f]);
+				}
+			}
+			bench_keep(acc);
+		}
+		timer.stop();
+		timer.report("BitStreamReader::read", records);
+	}
+
+	void bench_varint() noexcept {
+		BENCH_TRACE;
+		BenchTimer timer;
+		const size_t items = m_values.size() * m_rounds;
+		DiceMachine dice(7);
+		std::vector<int64_t> deltas(m_values.size());
+		for(auto& delta : deltas) {
+			delta = int64_t(dice.u32() % 2001) - 1000;
+		}
+
+		timer.start();
+		for(size_t round = 0; round < m_rounds; ++round) {
+			BitStreamWriter writer(m_buffer.data(), m_buffer.size());
+			for(auto delta : deltas) {
+				writer.write_svarint(delta);
+			}
+			writer.finish();
+			bench_keep(m_buffer[round]);
+		}
+		timer.stop();
+		timer.report("BitStreamWriter::write_svarint", items);
+
+		int64_t acc = 0;
+		timer.start();
+		for(size_t round = 0; round < m_rounds; ++round) {
+			BitStreamReader reader(m_buffer.data(), m_buffer.size());
+			for(size_t i = 0; i < deltas.size(); ++i) {
+				acc += reader.read_svarint();
+			}
+			bench_keep(acc);
+		}
+		timer.stop();
+		timer.report("BitStreamReader::read_svarint", items);
+
+		timer.start();
+		for(size_t round = 0; round < m_rounds; ++round) {
+			BitStreamWriter writer(m_buffer.data(), m_buffer.size());
+			for(auto delta : deltas) {
+				writer.write_gamma(BitStreamWriter::zigzag(delta) + 1);
+			}
+			writer.finish();
+			bench_keep(m_buffer[round]);
+		}
+		timer.stop();
+		timer.report("BitStreamWriter::write_gamma", items);
+
+		timer.start();
+		for(size_t round = 0; round < m_rounds; ++round) {
+			BitStreamReader reader(m_buffer.data(), m_buffer.size());
+			for(size_t i = 0; i < deltas.size(); ++i) {
+				acc += reader.read_gamma();
+			}
+			bench_keep(acc);
+		}
+		timer.stop();
+		timer.report("BitStreamReader::read_gamma", items);
+	}
+
+};
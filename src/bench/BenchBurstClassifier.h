@@ -0,0 +1,157 @@
+#pragma once
+
+#include "bench_environment.h"
+#include <proto/parsers/BurstClassifier.h>
+#include <proto/parsers/MetaParser.h>
+#include <proto/parsers/HeaderParser.h>
+
+#include <vector>
+
+/**
+ * Compares the per packet cost of the protocol stack parsers on a synthetic IMIX trace:
+ * 64/576/1500 bytes frames in the 7:4:1 proportion, 10% of them are VLAN tagged,
+ * 15% are IPv6, the rest is IPv4 TCP and UDP.
+ */
+class BenchBurstClassifier {
+	static constexpr size_t BURST = 16;
+	using Packet_t = std::vector<uint8_t>;
+	using Meta_t = proto::BurstMeta<BURST>;
+
+	std::vector<Packet_t> m_packets;
+	std::vector<const uint8_t*> m_buffers;
+	std::vector<size_t> m_sizes;
+	size_t m_rounds;
+
+public:
+
+	BenchBurstClassifier(size_t packets_nb, size_t rounds) noexcept : m_rounds(rounds) {
+		make_trace(packets_nb - packets_nb % BURST);
+		bench_header_parser();
+		bench_meta_parser();
+		bench_scalar();
+		bench_classifier();
+	}
+
+private:
+
+	template <typename T>
+	static void put(Packet_t& pkt, size_t offset, const T& value) noexcept {
+		memcpy(pkt.data() + offset, &value, sizeof(value));
+	}
+
+	void make_trace(size_t packets_nb) noexcept {
+		DiceMachine dice(0xC0FFEE);
+		m_packets.resize(packets_nb);
+		for(auto& pkt : m_packets) {
+			const uint32_t imix = dice.u32() % 12u;
+			pkt.assign(imix < 7u ? 64u : (imix < 11u ? 576u : 1500u), 0);
+
+			size_t offset = 12;
+			if(dice.pass(0.1)) {
+				put(pkt, offset, htons(ETH_P_8021Q));
+				offset += 4;
+			}
+			const bool v6 = dice.pass(0.15);
+			put(pkt, offset, htons(v6 ? ETH_P_IPV6 : ETH_P_IP));
+			offset += 2;
+
+			const uint8_t l4_proto = dice.pass(0.6) ? proto::IPv4::PROTO_TCP : proto::IPv4::PROTO_UDP;
+			if(v6) {
+				pkt[offset] = 0x60;
+				put(pkt, offset + 4, htons(uint16_t(pkt.size() - offset - 40)));
+				pkt[offset + 6] = l4_proto;
+				offset += 40;
+			} else {
+				pkt[offset] = 0x45;
+				put(pkt, offset + 2, htons(uint16_t(pkt.size() - offset)));
+				pkt[offset + 9] = l4_proto;
+				put(pkt, offset + 12, dice.u32());
+				put(pkt, offset + 16, dice.u32());
+				offset += 20;
+			}
+			put(pkt, offset, uint32_t(dice.u32()));
+			if(l4_proto == proto::IPv4::PROTO_TCP) {
+				pkt[offset + 12] = 0x50;
+			} else {
+				put(pkt, offset + 4, htons(uint16_t(pkt.size() - offset)));
+			}
+		}
+		for(const auto& pkt : m_packets) {
+			m_buffers.push_back(pkt.data());
+			m_sizes.push_back(pkt.size());
+		}
+	}
+
+	void bench_header_parser() noexcept {
+		BENCH_TRACE;
+		BenchTimer timer;
+		size_t result = 0;
+		timer.start();
+		for(size_t round = 0; round < m_rounds; ++round) {
+			for(size_t i = 0; i < m_buffers.size(); ++i) {
+				proto::HeaderParser parser(m_buffers[i], m_sizes[i]);
+				while(parser.protocol() != proto::END) {
+					result += parser.protocol();
+					parser.next();
+				}
+			}
+		}
+		timer.stop();
+		bench_keep(result);
+		timer.report("HeaderParser loop", m_rounds * m_buffers.size());
+	}
+
+	void bench_meta_parser() noexcept {
+		BENCH_TRACE;
+		BenchTimer timer;
+		proto::PacketMeta metas[BURST];
+		size_t result = 0;
+		timer.start();
+		for(size_t round = 0; round < m_rounds; ++round) {
+			for(size_t i = 0; i < m_buffers.size(); i += BURST) {
+				result += proto::MetaParser<>::parse_burst(m_buffers.data() + i, m_sizes.data() + i, metas, BURST);
+			}
+		}
+		timer.stop();
+		bench_keep(result);
+		timer.report("MetaParser::parse_burst", m_rounds * m_buffers.size());
+	}
+
+	void bench_scalar() noexcept {
+		BENCH_TRACE;
+		BenchTimer timer;
+		Meta_t out;
+		size_t result = 0;
+		timer.start();
+		for(size_t round = 0; round < m_rounds; ++round) {
+			for(size_t i = 0; i < m_buffers.size(); i += BURST) {
+				proto::BurstClassifier::classify_scalar(m_buffers.data() + i, m_sizes.data() + i, BURST, out);
+				result += out.port_dst[0];
+			}
+		}
+		timer.stop();
+		bench_keep(result);
+		timer.report("BurstClassifier::classify_scalar", m_rounds * m_buffers.size());
+	}
+
+	void bench_classifier() noexcept {
+		BENCH_TRACE;
+		if(not utils::Cpu::avx2()) {
+			printf("AVX2 is not supported, classify() falls back to the scalar path\n");
+		}
+		BenchTimer timer;
+		Meta_t out;
+		size_t result = 0;
+		timer.start();
+		for(size_t round = 0; round < m_rounds; ++round) {
+			for(size_t i = 0; i < m_buffers.size(); i += BURST) {
+				proto::BurstClassifier::classify(m_buffers.data() + i, m_sizes.data() + i, BURST, out);
+				result += out.port_dst[0];
+			}
+		}
+		timer.stop();
+		bench_keep(result);
+		timer.report("BurstClassifier::classify", m_rounds * m_buffers.size());
+	}
+
+};
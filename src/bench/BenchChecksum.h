@@ -0,0 +1,88 @@
+#pragma once
+
+#include "bench_environment.h"
+#include <proto/Checksum.h>
+
+#include <arpa/inet.h>
+#include <cstring>
+#include <vector>
+
+/**
+ * The Internet checksum throughput of the kernels on the typical packet sizes,
+ * the buffer is hot in the cache.
+ * The byte loop is the RFC 1071 loop the IPv4 header checksum used before.
+ */
+class BenchChecksum {
+	std::vector<uint8_t> m_data;
+	size_t m_bytes;
+
+public:
+
+	/**
+	 * @param bytes - the amount of data to sum up per case.
+	 */
+	explicit BenchChecksum(size_t bytes) noexcept : m_data(65536 + 64), m_bytes(bytes) {
+		DiceMachine dice(1071);
+		for(auto& byte : m_data) {
+			byte = uint8_t(dice.u32());
+		}
+		for(size_t size : {20, 64, 576, 1500, 9000, 65536}) {
+			bench_size(size);
+		}
+	}
+
+private:
+
+	static uint16_t byte_loop(const uint8_t* data, size_t size) noexcept {
+		uint32_t acc = 0xFFFF;
+		for(size_t i = 0; i + 1 < size; i += 2) {
+			uint16_t word;
+			memcpy(&word, data + i, 2);
+			acc += ntohs(word);
+			if(acc > 0xFFFF) {
+				acc -= 0xFFFF;
+			}
+		}
+		return uint16_t(~acc);
+	}
+
+	template <typename Kernel>
+	void run(const char* kernel, size_t size, Kernel&& sum) noexcept {
+		const size_t rounds = m_bytes / size + 1;
+		// an odd offset to include the unaligned loads
+		const uint8_t* ptr = m_data.data() + 1;
+		BenchTimer timer;
+		uint64_t acc = 0;
+		timer.start();
+		for(size_t i = 0; i < rounds; ++i) {
+			acc += sum(ptr, size);
+			bench_keep(acc);
+		}
+		timer.stop();
+		char name[64];
+		snprintf(name, sizeof(name), "%s %zu bytes", kernel, size);
+		timer.report_bytes(name, rounds * size);
+	}
+
+	void bench_size(size_t size) noexcept {
+		BENCH_TRACE;
+		run("byte loop", size, [](const uint8_t* ptr, size_t size) {
+			return uint64_t(byte_loop(ptr, size));
+		});
+		run("Checksum::sum_scalar", size, [](const uint8_t* ptr, size_t size) {
+			return uint64_t(proto::Checksum::fold(proto::Checksum::sum_scalar(ptr, size, 0)));
+		});
+		run("Checksum::sum_sse2", size, [](const uint8_t* ptr, size_t size) {
+			return uint64_t(proto::Checksum::fold(proto::Checksum::sum_sse2(ptr, size, 0)));
+		});
+		if(utils::Cpu::avx2()) {
+			run("Checksum::sum_avx2", size, [](const uint8_t* ptr, size_t size) {
+				return uint64_t(proto::Checksum::fold(proto::Checksum::sum_avx2(ptr, size, 0)));
+			});
+		}
+		run("Checksum::sum", size, [](const uint8_t* ptr, size_t size) {
+			return uint64_t(proto::Checksum::fold(proto::Checksum::sum(ptr, size)));
+		});
+	}
+
+};
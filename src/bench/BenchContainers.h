@@ -0,0 +1,262 @@
+#pragma once
+
+#include "bench_environment.h"
+#include <containers/RangeBuffer.h>
+#include <containers/RingArrayBuffer.h>
+#include <containers/SlidingArray.h>
+#include <containers/bits/BitArray.h>
+#include <containers/bits/BitStreamFast.h>
+#include <containers/storage/Pyramid.h>
+#include <fio/BufferedWriter.h>
+#include <fio/MappedReader.h>
+#include <intrusive/DequePool.h>
+#include <intrusive/HashMap.h>
+#include <intrusive/HashQueuePool.h>
+#include <utils/SharedRegion.h>
+
+#include <cstdlib>
+#include <memory>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * The basic containers on the working sets from L1-resident to DRAM-resident
+ * (2^9, 2^14, 2^18 and 2^23 items, --quick skips the last one).
+ * Every case is bench_run() with the random operations on a full container.
+ */
+class BenchContainers {
+	using Key_t = uint32_t;
+
+	struct MapNode : public intrusive::HashMapHook<Key_t, MapNode> {
+		uint32_t value = 0;
+	};
+
+	using PoolNode_t = intrusive::HashQueuePoolNode<Key_t, uint32_t>;
+	using DequeNode_t = intrusive::DequePoolNode<uint64_t>;
+
+	static constexpr size_t OPS = size_t(1) << 16;
+
+	std::vector<uint32_t> m_random;
+
+public:
+
+	BenchContainers() noexcept : m_random(OPS) {
+		BENCH_TRACE;
+		DiceMachine dice(OPS);
+		for(auto& value : m_random) {
+			value = dice.u32();
+		}
+		bench<9>();
+		bench<14>();
+		bench<18>();
+		if(not bench_options().quick) {
+			bench<23>();
+		}
+	}
+
+private:
+
+	/**
+	 * @return A distinct key of @idx, the multiplication by an odd number is a bijection.
+	 */
+	static inline Key_t key(size_t idx) noexcept {
+		return Key_t(idx * 2654435761u);
+	}
+
+	/**
+	 * A warm restart of a full pool: save() to a file in the page cache, restore() of the same geometry
+	 * (the saved buckets) and of another one (the keys are hashed again).
+	 */
+	void bench_snapshot(const intrusive::HashQueuePool<PoolNode_t>& pool, size_t size) noexcept {
+		char name[] = "/tmp/bench_snapshot_XXXXXX";
+		const int fd = mkstemp(name);
+		if(fd < 0) {
+			return;
+		}
+		close(fd);
+		bench_run("HashQueuePool::save", size, size, [&]() {
+			fio::BufferedWriter writer(name);
+			writer.open();
+			bench_keep(pool.save(writer));
+		});
+		intrusive::HashQueuePool<PoolNode_t> same(unsigned(size), 1.0f);
+		same.allocate();
+		bench_run("HashQueuePool::restore", size, size, [&]() {
+			fio::MappedReader reader(name);
+			reader.open();
+			bench_keep(same.restore(reader));
+		});
+		intrusive::HashQueuePool<PoolNode_t> other(unsigned(size), 0.5f);
+		other.allocate();
+		bench_run("HashQueuePool::restore, rehash", size, size, [&]() {
+			fio::MappedReader reader(name);
+			reader.open();
+			bench_keep(other.restore(reader));
+		});
+		unlink(name);
+	}
+
+	/**
+	 * A restart of a full pool kept in a shared memory region: the attach of the region and the pool
+	 * (the geometry is checked, the nodes are not touched).
+	 */
+	void bench_shared(size_t size) noexcept {
+		using Pool_t = intrusive::HashQueuePool<PoolNode_t>;
+		char name[] = "/dev/shm/bench_shared_XXXXXX";
+		const int fd = mkstemp(name);
+		if(fd < 0) {
+			return;
+		}
+		close(fd);
+		const size_t bytes = size * (sizeof(PoolNode_t) + sizeof(intrusive::HashMapBucket<PoolNode_t>)) + (1u << 16u);
+		{
+			utils::SharedRegion region(name, bytes);
+			Pool_t pool(unsigned(size), 1.0f);
+			if(region.create() != 0 || pool.allocate(region) != 0) {
+				unlink(name);
+				return;
+			}
+			for(size_t i = 0; i < size; ++i) {
+				pool.push_back(key(i));
+			}
+		}
+		bench_run("HashQueuePool::attach", size, 1, [&]() {
+			utils::SharedRegion region(name, 0);
+			Pool_t pool(unsigned(size), 1.0f);
+			bench_keep(region.attach() == 0 && pool.allocate(region) == 0 && pool.find(key(size - 1)));
+		});
+		unlink(name);
+	}
+
+	template <unsigned Shift>
+	void bench() noexcept {
+		constexpr size_t size = size_t(1) << Shift;
+		uint64_t acc = 0;
+
+		{
+			std::unique_ptr<MapNode[]> nodes(new MapNode[size]);
+			intrusive::HashMap<Key_t, MapNode> map(size);
+			map.allocate();
+			for(size_t i = 0; i < size; ++i) {
+				map.link(key(i), nodes[i]);
+			}
+			bench_run("HashMap::find", size, OPS, [&]() {
+				for(auto r : m_random) {
+					acc += bool(map.find(key(r % size)));
+				}
+			});
+			map.clear();
+		}
+
+		{
+			intrusive::HashQueuePool<PoolNode_t> pool(unsigned(size), 1.0f);
+			pool.allocate();
+			for(size_t i = 0; i < size; ++i) {
+				pool.push_back(key(i));
+			}
+			bench_run("HashQueuePool::find", size, OPS, [&]() {
+				for(auto r : m_random) {
+					acc += bool(pool.find(key(r % size)));
+				}
+			});
+			size_t next = size;
+			bench_run("HashQueuePool::pop+push", size, OPS, [&]() {
+				for(size_t i = 0; i < OPS; ++i) {
+					pool.pop_front();
+					pool.push_back(key(next++));
+				}
+			});
+			bench_snapshot(pool, size);
+			bench_shared(size);
+		}
+
+		{
+			const unsigned capacity = unsigned(size);
+			intrusive::DequePool<DequeNode_t> pool(capacity);
+			pool.allocate();
+			for(size_t i = 0; i < size; ++i) {
+				pool.push_back()->value = i;
+			}
+			bench_run("DequePool::pop+push", size, OPS, [&]() {
+				for(size_t i = 0; i < OPS; ++i) {
+					acc += pool.pop_front()->value;
+					pool.push_back()->value = i;
+				}
+			});
+		}
+
+		{
+			BitArray<13, uint64_t> array;
+			array.allocate(size);
+			for(size_t i = 0; i < size; ++i) {
+				array.store(i, i & array.value_max());
+			}
+			bench_run("BitArray<13>::load", size, OPS, [&]() {
+				for(auto r : m_random) {
+					acc += array.load(r % size);
+				}
+			});
+		}
+
+		{
+			std::vector<uint8_t> buffer(size * 13 / 8 + 16);
+			BitStreamWriter writer(buffer.data(), buffer.size());
+			for(size_t i = 0; i < size; ++i) {
+				writer.write(i, 13);
+			}
+			const size_t bytes = writer.finish();
+			bench_run("BitStreamReader::read(13)", size, size, [&]() {
+				BitStreamReader reader(buffer.data(), bytes);
+				for(size_t i = 0; i < size; ++i) {
+					acc += reader.read(13);
+				}
+			});
+		}
+
+		{
+			auto array = std::make_unique<utils::SlidingArray<uint64_t, size> >(0);
+			array->initialize(0, size);
+			bench_run("SlidingArray::get", size, OPS, [&]() {
+				for(auto r : m_random) {
+					acc += array->get(r % size);
+				}
+			});
+		}
+
+		{
+			auto ring = std::make_unique<RingArrayBuffer<uint64_t, size> >(0);
+			bench_run("RingArrayBuffer::operator[]", size, OPS, [&]() {
+				for(auto r : m_random) {
+					acc += (*ring)[ring->head() + r % size]++;
+				}
+			});
+		}
+
+		{
+			RangeBuffer<uint64_t> buffer(size, 0);
+			buffer.resize(size);
+			bench_run("RangeBuffer::operator[]", size, OPS, [&]() {
+				for(auto r : m_random) {
+					acc += buffer[buffer.head_index() + r % size]++;
+				}
+			});
+		}
+
+		{
+			std::unique_ptr<uint64_t[]> storage(new uint64_t[size]);
+			storage::Pyramid<uint64_t> heap(storage.get(), size);
+			for(size_t i = 0; i < size; ++i) {
+				heap.insert(m_random[i % OPS] ^ i);
+			}
+			bench_run("Pyramid::pop+insert", size, OPS, [&]() {
+				for(auto r : m_random) {
+					heap.pop();
+					heap.insert(r);
+				}
+			});
+		}
+
+		bench_keep(acc);
+	}
+
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "bench_environment.h"
+#include <intrusive/CuckooQueuePool.h>
+#include <intrusive/HashQueuePool.h>
+
+#include <vector>
+
+/**
+ * find() of HashQueuePool (chained, std::hash) and CuckooQueuePool (keyed cuckoo) on the random keys
+ * and on the flood: the keys all falling into one HashQueuePool bucket.
+ * HashQueuePool<Stats> shows the cost of the statistics.
+ */
+class BenchCuckooQueuePool {
+	using Key_t = uint32_t;
+	using ChainedNode_t = intrusive::HashQueuePoolNode<Key_t, uint32_t>;
+	using CuckooNode_t = intrusive::CuckooQueuePoolNode<Key_t, uint32_t>;
+
+	static constexpr float LOAD_FACTOR = 0.9f;
+
+	size_t m_queries;
+
+public:
+
+	BenchCuckooQueuePool(size_t size, size_t queries) noexcept : m_queries(queries) {
+		DiceMachine dice(size);
+		std::vector<Key_t> keys(size);
+		for(auto& key : keys) {
+			key = dice.u32();
+		}
+		bench("random keys", keys);
+		// a few thousand of the colliding keys is enough to stall the chained map
+		keys.resize(size < 4096u ? size : 4096u);
+		const size_t chained_buckets = size_t(unsigned(keys.size()) / LOAD_FACTOR) + 1u;
+		for(size_t i = 0; i < keys.size(); ++i) {
+			keys[i] = Key_t(i * chained_buckets);
+		}
+		bench("flood keys", keys);
+	}
+
+private:
+
+	void bench(const char* name, const std::vector<Key_t>& keys) noexcept {
+		BENCH_TRACE;
+		printf("%s: %zu\n", name, keys.size());
+		DiceMachine dice(keys.size());
+		std::vector<Key_t> probes(m_queries);
+		for(auto& probe : probes) {
+			probe = keys[dice.u32() % keys.size()];
+		}
+		BenchTimer timer;
+
+		intrusive::HashQueuePool<ChainedNode_t> chained(unsigned(keys.size()), LOAD_FACTOR);
+		chained.allocate();
+		timer.start();
+		for(auto key : keys) {
+			chained.push_back(key);
+		}
+		timer.stop();
+		timer.report("HashQueuePool::push_back", keys.size());
+
+		intrusive::CuckooQueuePool<CuckooNode_t> cuckoo(unsigned(keys.size()), LOAD_FACTOR);
+		cuckoo.allocate();
+		timer.start();
+		for(auto key : keys) {
+			cuckoo.push_back(key);
+		}
+		timer.stop();
+		timer.report("CuckooQueuePool::push_back", keys.size());
+
+		size_t found = 0;
+		timer.start();
+		for(auto probe : probes) {
+			found += bool(chained.find(probe));
+		}
+		timer.stop();
+		bench_keep(found);
+		timer.report("HashQueuePool::find", probes.size());
+
+		intrusive::HashQueuePool<ChainedNode_t, std::hash<Key_t>, std::allocator<ChainedNode_t>
+			, std::allocator<intrusive::HashMapBucket<ChainedNode_t> >, true> counted(unsigned(keys.size()), LOAD_FACTOR);
+		counted.allocate();
+		for(auto key : keys) {
+			counted.push_back(key);
+		}
+		timer.start();
+		for(auto probe : probes) {
+			found += bool(counted.find(probe));
+		}
+		timer.stop();
+		bench_keep(found);
+		timer.report("HashQueuePool<Stats>::find", probes.size());
+
+		timer.start();
+		for(auto probe : probes) {
+			found += bool(cuckoo.find(probe));
+		}
+		timer.stop();
+		bench_keep(found);
+		timer.report("CuckooQueuePool::find", probes.size());
+		printf("evictions: %zu\n", cuckoo.evictions());
+
+		intrusive::CuckooQueuePool<CuckooNode_t, std::hash<Key_t> > plain(unsigned(keys.size()), LOAD_FACTOR);
+		plain.allocate();
+		for(auto key : keys) {
+			plain.push_back(key);
+		}
+		timer.start();
+		for(auto probe : probes) {
+			found += bool(plain.find(probe));
+		}
+		timer.stop();
+		bench_keep(found);
+		timer.report("CuckooQueuePool<std::hash>::find", probes.size());
+	}
+
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "bench_environment.h"
+#include <fio/BufferedReader.h>
+#include <fio/BufferedWriter.h>
+#include <fio/MappedReader.h>
+#include <fio/Reader.h>
+#include <fio/Writer.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+/**
+ * A state dump like file of @records records (a POD header and a short string) written and read back
+ * through the stdio fio::Writer/fio::Reader, the buffered ones and the mapped reader.
+ * The file is in the page cache, so it is the per record CPU cost of the paths.
+ */
+class BenchFio {
+
+	struct Header {
+		uint32_t id;
+		uint32_t flags;
+		uint64_t bytes;
+	};
+
+	size_t m_records;
+	std::string m_name;
+	const std::string m_value;
+
+public:
+
+	explicit BenchFio(size_t records) noexcept : m_records(records), m_value("flow 10.0.0.1:443") {
+		BENCH_TRACE;
+		char name[] = "/tmp/bench_fio_XXXXXX";
+		const int fd = mkstemp(name);
+		if(fd < 0) {
+			fprintf(stderr, "Can't create a temporary file\n");
+			return;
+		}
+		close(fd);
+		m_name = name;
+
+		bench_run("fio::Writer", 0, m_records, [this]() {
+			fio::Writer writer(m_name);
+			writer.open();
+			for(size_t i = 0; i < m_records; ++i) {
+				const Header header = make(i);
+				writer.write(header, m_value);
+			}
+		});
+		bench_run("fio::BufferedWriter", 0, m_records, [this]() {
+			fio::BufferedWriter writer(m_name);
+			writer.open();
+			for(size_t i = 0; i < m_records; ++i) {
+				const Header header = make(i);
+				writer.write(header, m_value);
+			}
+		});
+
+		bench_run("fio::Reader", 0, m_records, [this]() {
+			fio::Reader reader(m_name);
+			reader.open();
+			read_all(reader);
+		});
+		bench_run("fio::BufferedReader", 0, m_records, [this]() {
+			fio::BufferedReader reader(m_name);
+			reader.open();
+			read_all(reader);
+		});
+		bench_run("fio::MappedReader, string", 0, m_records, [this]() {
+			fio::MappedReader reader(m_name);
+			reader.open();
+			read_all(reader);
+		});
+		bench_run("fio::MappedReader, string_view", 0, m_records, [this]() {
+			fio::MappedReader reader(m_name);
+			reader.open();
+			Header header;
+			std::string_view value;
+			size_t bytes = 0;
+			while(reader.read(header, value)) {
+				bytes += header.bytes + value.size();
+			}
+			bench_keep(bytes);
+		});
+		remove(m_name.c_str());
+	}
+
+private:
+
+	static inline Header make(size_t i) noexcept {
+		return Header{uint32_t(i), uint32_t(i & 0xF), uint64_t(i) * 1500u};
+	}
+
+	template <typename Reader>
+	void read_all(Reader& reader) noexcept {
+		Header header;
+		std::string value;
+		size_t bytes = 0;
+		while(reader.read(header, value)) {
+			bytes += header.bytes + value.size();
+		}
+		bench_keep(bytes);
+	}
+
+};
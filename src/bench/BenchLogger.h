@@ -0,0 +1,67 @@
+#pragma once
+
+#include "bench_environment.h"
+#include <logger/Logger.h>
+
+#include <cstdio>
+
+/**
+ * The caller side cost of a log line: the synchronous fprintf/fflush path (the logger isn't started)
+ * against the asynchronous record to the thread ring with and without waiting for the formatting.
+ * Then the cost of a suppressed record of a rate limited site and of a record below the level.
+ * All of them write to /dev/null.
+ */
+class BenchLogger {
+	size_t m_lines;
+
+public:
+
+	explicit BenchLogger(size_t lines) noexcept : m_lines(lines) {
+		BENCH_TRACE;
+		FILE* null = fopen("/dev/null", "w");
+		if(not null) {
+			return;
+		}
+		FILE* prev = Logger::log_file;
+		Logger::log_file = null;
+		bench_run("LOG_INFO sync", 0, m_lines, [this]() {
+			log_lines();
+		});
+		auto& log = logger::AsyncLogger::instance();
+		// a ring large enough to take a repetition without drops
+		log.start(null, m_lines * 64);
+		bench_run("LOG_INFO async", 0, m_lines, [&]() {
+			log_lines();
+			log.flush();
+		});
+		// the background thread formats the previous repetitions meanwhile, a full ring drops
+		bench_run("LOG_INFO async, caller only", 0, m_lines, [&]() {
+			log_lines();
+		});
+		// a storm of a rate limited site and of a level below the threshold
+		bench_run("LOG_INFO_LIMITED suppressed", 0, m_lines, [this]() {
+			for(size_t i = 0; i < m_lines; ++i) {
+				LOG_INFO_LIMITED(10, 1000, "port %u: %s", unsigned(i & 7u), "link flap");
+			}
+		});
+		bench_run("LOG_DEBUG below the level", 0, m_lines, [this]() {
+			for(size_t i = 0; i < m_lines; ++i) {
+				LOG_DEBUG("port %u: %s", unsigned(i & 7u), "link flap");
+			}
+		});
+		log.stop();
+		printf("async: %zu records, %zu dropped, %zu suppressed\n", size_t(log.stat().records), size_t(log.stat().dropped)
+			, size_t(log.stat().suppressed));
+		Logger::log_file = prev;
+		fclose(null);
+	}
+
+private:
+
+	void log_lines() noexcept {
+		for(size_t i = 0; i < m_lines; ++i) {
+			LOG_INFO("port %u queue %zu: %s, rate %.2f Mpps", unsigned(i & 7u), i, "link flap", double(i) * 0.01);
+		}
+	}
+
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "bench_environment.h"
+#include <containers/ordered/BPlusTree.h>
+#include <containers/ordered/EytzingerArray.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+/**
+ * Random lower_bound() lookups of uint32_t keys: std::lower_bound() over a sorted vector,
+ * EytzingerArray, std::map and BPlusTree, in the cache and out of it.
+ * The inserts of the same keys into std::map and BPlusTree.
+ */
+class BenchOrdered {
+	size_t m_queries;
+
+public:
+
+	explicit BenchOrdered(size_t queries) noexcept : m_queries(queries) {
+		for(size_t size : {size_t(1) << 12, size_t(1) << 22}) {
+			bench(size);
+		}
+	}
+
+private:
+
+	void bench(size_t size) noexcept {
+		BENCH_TRACE;
+		printf("%zu keys\n", size);
+		DiceMachine dice(size);
+		std::vector<uint32_t> keys(size);
+		for(auto& key : keys) {
+			key = dice.u32();
+		}
+		std::vector<uint32_t> probes(m_queries);
+		for(auto& probe : probes) {
+			probe = dice.u32();
+		}
+		BenchTimer timer;
+
+		std::map<uint32_t, uint32_t> map;
+		timer.start();
+		for(auto key : keys) {
+			map[key] = key;
+		}
+		timer.stop();
+		timer.report("std::map insert", size);
+
+		BPlusTree<uint32_t, uint32_t> tree(uint32_t(size / 8 + 64));
+		tree.allocate();
+		timer.start();
+		for(auto key : keys) {
+			tree.insert(key, key);
+		}
+		timer.stop();
+		timer.report("BPlusTree insert", size);
+
+		std::sort(keys.begin(), keys.end());
+		keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+		EytzingerArray<uint32_t, uint32_t> array;
+		array.build(keys.data(), keys.data(), keys.size());
+
+		uint64_t acc = 0;
+		timer.start();
+		for(auto probe : probes) {
+			acc += *std::lower_bound(keys.begin(), keys.end() - 1, probe);
+		}
+		timer.stop();
+		bench_keep(acc);
+		timer.report("std::lower_bound", probes.size());
+
+		timer.start();
+		for(auto probe : probes) {
+			acc += array.lower_bound(probe);
+		}
+		timer.stop();
+		bench_keep(acc);
+		timer.report("EytzingerArray::lower_bound", probes.size());
+
+		timer.start();
+		for(auto probe : probes) {
+			auto it = map.lower_bound(probe);
+			acc += (it != map.end() ? it->second : 0);
+		}
+		timer.stop();
+		bench_keep(acc);
+		timer.report("std::map::lower_bound", probes.size());
+
+		timer.start();
+		for(auto probe : probes) {
+			auto it = tree.lower_bound(probe);
+			acc += (it.valid() ? it.value() : 0);
+		}
+		timer.stop();
+		bench_keep(acc);
+		timer.report("BPlusTree::lower_bound", probes.size());
+	}
+
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "bench_environment.h"
+#include <proto/Dumper.h>
+#include <proto/TrafficGenerator.h>
+#include <proto/parsers/HeaderParser.h>
+#include <proto/parsers/MetaParser.h>
+
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+/**
+ * The per packet cost of the parsing, dumping and pcap file paths on the fixed synthetic workloads:
+ * every TrafficProfile preset with the same seed, so the results are comparable between the builds.
+ * The Mitems/s column is the packet rate in millions of packets per second.
+ */
+class BenchPacket {
+	static constexpr uint64_t SEED = 0xC0FFEE;
+
+	size_t m_frames;
+	FILE* m_null;
+
+public:
+
+	explicit BenchPacket(size_t frames) noexcept : m_frames(frames), m_null(fopen("/dev/null", "w")) {
+		BENCH_TRACE;
+		const proto::TrafficProfile profiles[] = {
+			proto::TrafficProfile::imix(),
+			proto::TrafficProfile::vlan_stacked(),
+			proto::TrafficProfile::ipv6_only(),
+			proto::TrafficProfile::gre_tunneled(),
+			proto::TrafficProfile::fragmented(),
+		};
+		for(const auto& profile : profiles) {
+			proto::TrafficTrace trace;
+			proto::TrafficGenerator(profile, SEED).generate(trace, m_frames);
+			bench_parsers(profile.name, trace);
+			if(m_null) {
+				bench_dumper(profile.name, trace);
+			}
+			bench_pcap(profile.name, trace);
+		}
+		if(m_null) {
+			fclose(m_null);
+		}
+	}
+
+private:
+
+	static std::string name(const char* profile, const char* operation) {
+		return std::string(profile) + "/" + operation;
+	}
+
+	template <typename Parser>
+	static size_t walk(const proto::TrafficTrace& trace) noexcept {
+		size_t result = 0;
+		for(size_t i = 0; i < trace.size(); ++i) {
+			Parser parser(trace.frame(i), trace.length(i));
+			while(parser.protocol() != proto::END) {
+				result += parser.protocol();
+				parser.next();
+			}
+		}
+		return result;
+	}
+
+	void bench_parsers(const char* profile, const proto::TrafficTrace& trace) noexcept {
+		size_t result = 0;
+		bench_run(name(profile, "HeaderParser").c_str(), 0, trace.size(), [&]() {
+			result += walk<proto::HeaderParser>(trace);
+		});
+		bench_run(name(profile, "SafeHeaderParser").c_str(), 0, trace.size(), [&]() {
+			result += walk<proto::SafeHeaderParser>(trace);
+		});
+		bench_run(name(profile, "MetaParser::parse_all").c_str(), 0, trace.size(), [&]() {
+			proto::PacketMeta meta;
+			for(size_t i = 0; i < trace.size(); ++i) {
+				result += proto::MetaParser<>::parse_all(trace.frame(i), trace.length(i), meta);
+			}
+		});
+		bench_keep(result);
+	}
+
+	/**
+	 * One line per packet, as the proto-dump sample prints it, to /dev/null.
+	 */
+	void bench_dumper(const char* profile, const proto::TrafficTrace& trace) noexcept {
+		bench_run(name(profile, "Dumper::header_line").c_str(), 0, trace.size(), [&]() {
+			for(size_t i = 0; i < trace.size(); ++i) {
+				proto::HeaderParser parser(trace.frame(i), trace.length(i));
+				for(auto p = parser.protocol(); p != proto::END; p = parser.next()) {
+					dump(parser, p);
+				}
+				fputc('\n', m_null);
+			}
+		});
+	}
+
+	void dump(proto::HeaderParser& parser, proto::Protocol protocol) noexcept {
+		switch(protocol) {
+			case proto::L2_ETHERNET:
+				dump_header<proto::Ethernet::Header>(parser);
+				break;
+			case proto::L2_VLAN:
+				dump_header<proto::Vlan::Header>(parser);
+				break;
+			case proto::L3_IPv4:
+				dump_header<proto::IPv4::Header>(parser);
+				break;
+			case proto::L3_IPv6:
+				dump_header<proto::IPv6::Header>(parser);
+				break;
+			case proto::L4_TCP:
+				dump_header<proto::Tcp::Header>(parser);
+				break;
+			case proto::L4_UDP:
+				dump_header<proto::Udp::Header>(parser);
+				break;
+			case proto::L4_GRE: {
+				const proto::Gre::Header* hdr;
+				parser.assign(hdr);
+				proto::Dumper::header_short(m_null, hdr);
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
+	template <typename Hdr>
+	void dump_header(proto::HeaderParser& parser) noexcept {
+		const Hdr* hdr;
+		parser.assign(hdr);
+		proto::Dumper::header_line(m_null, hdr);
+	}
+
+	void bench_pcap(const char* profile, const proto::TrafficTrace& trace) noexcept {
+		char path[] = "/tmp/bench_packet_XXXXXX";
+		const int fd = mkstemp(path);
+		if(fd < 0) {
+			printf("Can't create a temporary file, the pcap cases are skipped\n");
+			return;
+		}
+		close(fd);
+		bool result = true;
+		bench_run(name(profile, "TrafficTrace::save_pcap").c_str(), 0, trace.size(), [&]() {
+			result &= trace.save_pcap(path);
+		});
+		proto::TrafficTrace loaded;
+		bench_run(name(profile, "TrafficTrace::load_pcap").c_str(), 0, trace.size(), [&]() {
+			result &= loaded.load_pcap(path);
+		});
+		remove(path);
+		if(not result || loaded.size() != trace.size()) {
+			printf("The pcap file round trip failed\n");
+		}
+	}
+
+};
@@ -0,0 +1,240 @@
+#pragma once
+
+#include "bench_environment.h"
+#include <cli/types/Integer.h>
+#include <cli/types/IpAddress.h>
+#include <cli/types/MacAddress.h>
+#include <tio/ViewTokenizer.h>
+#include <utils/Types.h>
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <netinet/ether.h>
+#include <string>
+#include <vector>
+
+/**
+ * The parsers of the numbers and the addresses of the rule files against the libc ones, the items are
+ * zero terminated strings packed in one buffer:
+ * strtoull() with errno and a strchr() scan (utils::Types before), std::from_chars() and the 8 digits
+ * per step utils::Types::parse_digits(), inet_pton() and ether_aton_r() against cli::IpAddress and cli::MacAddress.
+ * Then a whole rule file of "<cidr> <port> <proto>" lines in one pass.
+ */
+class BenchParse {
+	using Items_t = std::vector<std::string_view>;
+
+	size_t m_items;
+	std::string m_buffer;
+
+public:
+
+	explicit BenchParse(size_t items) noexcept : m_items(items) {
+		DiceMachine dice(50);
+		std::vector<std::string> ports;
+		std::vector<std::string> counters;
+		std::vector<std::string> ipv4;
+		std::vector<std::string> ipv6;
+		std::vector<std::string> macs;
+		std::string rules;
+		char str[128];
+		for(size_t i = 0; i < m_items; ++i) {
+			const uint32_t a = dice.u32();
+			const uint32_t b = dice.u32();
+			ports.push_back(std::to_string(a & 0xFFFFu));
+			counters.push_back(std::to_string((uint64_t(a) << 32u | b) >> (b % 24u)));
+			snprintf(str, sizeof(str), "%u.%u.%u.%u", a >> 24u, (a >> 16u) & 0xFFu, (a >> 8u) & 0xFFu, a & 0xFFu);
+			ipv4.emplace_back(str);
+			snprintf(str, sizeof(str), "2001:db8:%x:%x::%x:%x", a >> 16u, a & 0xFFFFu, b >> 16u, b & 0xFFFFu);
+			ipv6.emplace_back(str);
+			snprintf(str, sizeof(str), "%02x:%02x:%02x:%02x:%02x:%02x", a >> 24u, (a >> 16u) & 0xFFu, (a >> 8u) & 0xFFu
+				, a & 0xFFu, b >> 24u, (b >> 16u) & 0xFFu);
+			macs.emplace_back(str);
+			snprintf(str, sizeof(str), "%u.%u.%u.0/%u %u %u\n", a >> 24u, (a >> 16u) & 0xFFu, (a >> 8u) & 0xFFu
+				, 8u + b % 17u, b & 0xFFFFu, (b & 1u) ? 6u : 17u);
+			rules += str;
+		}
+		for(const auto* items : {&ports, &counters, &ipv4, &ipv6, &macs}) {
+			for(const auto& item : *items) {
+				m_buffer.append(item).push_back('\0');
+			}
+		}
+		const char* ptr = m_buffer.data();
+		bench_integers("port", pack(ptr));
+		bench_integers("counter", pack(ptr));
+		const Items_t ipv4_items = pack(ptr);
+		const Items_t ipv6_items = pack(ptr);
+		bench_addresses(ipv4_items, ipv6_items, pack(ptr));
+		bench_rules(rules);
+	}
+
+private:
+
+	/**
+	 * @return The views of the next m_items strings from @ptr, the zero terminated ones.
+	 */
+	Items_t pack(const char*& ptr) const noexcept {
+		Items_t result;
+		for(size_t i = 0; i < m_items; ++i) {
+			result.emplace_back(ptr);
+			ptr += result.back().size() + 1;
+		}
+		return result;
+	}
+
+	static bool strtoull_parse(const char* str, uint64_t& value) noexcept {
+		if(strchr(str, '-')) {
+			return false;
+		}
+		char* end;
+		errno = 0;
+		value = strtoull(str, &end, 0);
+		return str != end && errno == 0 && *end == '\0';
+	}
+
+	void bench_integers(const char* kind, const Items_t& numbers) noexcept {
+		BENCH_TRACE;
+		char name[64];
+		snprintf(name, sizeof(name), "%s strtoull", kind);
+		bench_run(name, 0, numbers.size(), [&]() {
+			uint64_t acc = 0;
+			for(const auto& number : numbers) {
+				uint64_t value = 0;
+				acc += strtoull_parse(number.data(), value) ? value : 1u;
+			}
+			bench_keep(acc);
+		});
+		snprintf(name, sizeof(name), "%s std::from_chars", kind);
+		bench_run(name, 0, numbers.size(), [&]() {
+			uint64_t acc = 0;
+			for(const auto& number : numbers) {
+				uint64_t value = 0;
+				const auto result = std::from_chars(number.data(), number.data() + number.size(), value);
+				acc += (result.ec == std::errc()) ? value : 1u;
+			}
+			bench_keep(acc);
+		});
+		snprintf(name, sizeof(name), "%s Types::parse_digits", kind);
+		bench_run(name, 0, numbers.size(), [&]() {
+			uint64_t acc = 0;
+			for(const auto& number : numbers) {
+				uint64_t value = 0;
+				acc += utils::Types::parse_digits(number, value) ? value : 1u;
+			}
+			bench_keep(acc);
+		});
+		snprintf(name, sizeof(name), "%s Types::parse_unsigned", kind);
+		bench_run(name, 0, numbers.size(), [&]() {
+			uint64_t acc = 0;
+			for(const auto& number : numbers) {
+				uint64_t value = 0;
+				acc += utils::Types::parse_unsigned(number, value) ? value : 1u;
+			}
+			bench_keep(acc);
+		});
+	}
+
+	void bench_addresses(const Items_t& ipv4, const Items_t& ipv6, const Items_t& macs) noexcept {
+		BENCH_TRACE;
+		bench_run("ipv4 inet_pton", 0, ipv4.size(), [&]() {
+			uint64_t acc = 0;
+			for(const auto& str : ipv4) {
+				in_addr addr;
+				acc += inet_pton(AF_INET, str.data(), &addr) == 1 ? addr.s_addr : 1u;
+			}
+			bench_keep(acc);
+		});
+		bench_run("ipv4 IpAddress::parse", 0, ipv4.size(), [&]() {
+			uint64_t acc = 0;
+			for(const auto& str : ipv4) {
+				cli::IpAddress::IPv4Addr_t addr;
+				acc += cli::IpAddress::parse(str, addr) ? addr : 1u;
+			}
+			bench_keep(acc);
+		});
+		bench_run("ipv6 inet_pton", 0, ipv6.size(), [&]() {
+			uint64_t acc = 0;
+			for(const auto& str : ipv6) {
+				in6_addr addr;
+				acc += inet_pton(AF_INET6, str.data(), &addr) == 1 ? addr.s6_addr[15] : 1u;
+			}
+			bench_keep(acc);
+		});
+		bench_run("ipv6 IpAddress::parse", 0, ipv6.size(), [&]() {
+			uint64_t acc = 0;
+			for(const auto& str : ipv6) {
+				cli::IpAddress::IPv6Addr_t addr;
+				acc += cli::IpAddress::parse(str, addr) ? addr.addr8[15] : 1u;
+			}
+			bench_keep(acc);
+		});
+		bench_run("mac ether_aton_r", 0, macs.size(), [&]() {
+			uint64_t acc = 0;
+			for(const auto& str : macs) {
+				ether_addr addr;
+				acc += ether_aton_r(str.data(), &addr) ? addr.ether_addr_octet[5] : 1u;
+			}
+			bench_keep(acc);
+		});
+		bench_run("mac MacAddress::parse", 0, macs.size(), [&]() {
+			uint64_t acc = 0;
+			cli::MacAddress mac;
+			for(const auto& str : macs) {
+				acc += mac.parse(str) > 0 ? mac.addr[5] : 1u;
+			}
+			bench_keep(acc);
+		});
+	}
+
+	/**
+	 * strtok_r() over a copy with inet_pton() and strtoul() against the views of tio::ViewTokenizer
+	 * with cli::IpAddress and utils::Types.
+	 */
+	void bench_rules(const std::string& rules) noexcept {
+		BENCH_TRACE;
+		const size_t lines = m_items;
+		bench_run("rules strtok_r, inet_pton, strtoul", 0, lines, [&]() {
+			std::string copy(rules);
+			uint64_t acc = 0;
+			char* line_ctx;
+			for(char* line = strtok_r(&copy[0], "\n", &line_ctx); line; line = strtok_r(nullptr, "\n", &line_ctx)) {
+				char* ctx;
+				char* cidr = strtok_r(line, " ", &ctx);
+				char* port = strtok_r(nullptr, " ", &ctx);
+				char* proto = strtok_r(nullptr, " ", &ctx);
+				char* slash = cidr ? strchr(cidr, '/') : nullptr;
+				in_addr addr;
+				if(slash && port && proto) {
+					*slash = '\0';
+					if(inet_pton(AF_INET, cidr, &addr) == 1) {
+						acc += addr.s_addr + strtoul(slash + 1, nullptr, 10) + strtoul(port, nullptr, 10)
+							+ strtoul(proto, nullptr, 10);
+					}
+				}
+			}
+			bench_keep(acc);
+		});
+		const tio::DelimiterSet newline("\n");
+		const tio::DelimiterSet space(" ");
+		bench_run("rules ViewTokenizer, IpAddress, Types", 0, lines, [&]() {
+			uint64_t acc = 0;
+			tio::ViewTokenizer<> line(rules, newline);
+			tio::ViewTokenizer<> field(std::string_view(), space);
+			while(line.next()) {
+				field.reset(line.token());
+				cli::IpAddress::IPv4Net_t net;
+				uint16_t port;
+				uint8_t proto;
+				if(field.next() && cli::IpAddress::parse(field.token(), net)
+					&& field.next() && utils::Types::parse_unsigned(field.token(), port)
+					&& field.next() && utils::Types::parse_unsigned(field.token(), proto)) {
+					acc += net.addr + net.mask + port + proto;
+				}
+			}
+			bench_keep(acc);
+		});
+	}
+
+};
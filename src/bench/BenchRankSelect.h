@@ -0,0 +1,84 @@
+#pragma once
+
+#include "bench_environment.h"
+#include <containers/bits/RankSelect.h>
+
+#include <vector>
+
+/**
+ * Random rank1()/select1()/select0() queries per second on the bitvectors
+ * which fit the cache and which don't, dense and sparse.
+ */
+class BenchRankSelect {
+	size_t m_queries;
+
+public:
+
+	explicit BenchRankSelect(size_t queries) noexcept : m_queries(queries) {
+		for(size_t bits : {size_t(1) << 16, size_t(1) << 28}) {
+			for(double density : {0.5, 0.01}) {
+				bench(bits, density);
+			}
+		}
+	}
+
+private:
+
+	void bench(size_t bits, double density) noexcept {
+		BENCH_TRACE;
+		RankSelect rs;
+		if(rs.allocate(bits) != 0) {
+			return;
+		}
+		DiceMachine dice(bits);
+		// the words are filled at once: set() per bit is too slow for 2^28 bits
+		const uint32_t threshold = uint32_t(density * 4294967295.0);
+		for(size_t w = 0; w < bits / 64; ++w) {
+			uint64_t word = 0;
+			for(size_t i = 0; i < 64; ++i) {
+				word |= uint64_t(dice.u32() < threshold) << i;
+			}
+			rs.data()[w] = word;
+		}
+		rs.build();
+		printf("%zu bits, %.1f%% set, the directory is %.1f%% of the bits\n"
+			, bits, density * 100.0, 100.0 * double(rs.directory_bytes()) / double(rs.storage_bytes()));
+
+		std::vector<size_t> args(m_queries);
+		for(auto& arg : args) {
+			arg = dice.u64() % bits;
+		}
+		BenchTimer timer;
+		size_t acc = 0;
+		timer.start();
+		for(auto arg : args) {
+			acc += rs.rank1(arg);
+		}
+		timer.stop();
+		bench_keep(acc);
+		timer.report("RankSelect::rank1", args.size());
+
+		for(auto& arg : args) {
+			arg %= rs.count();
+		}
+		timer.start();
+		for(auto arg : args) {
+			acc += rs.select1(arg);
+		}
+		timer.stop();
+		bench_keep(acc);
+		timer.report("RankSelect::select1", args.size());
+
+		for(auto& arg : args) {
+			arg %= bits - rs.count();
+		}
+		timer.start();
+		for(auto arg : args) {
+			acc += rs.select0(arg);
+		}
+		timer.stop();
+		bench_keep(acc);
+		timer.report("RankSelect::select0", args.size());
+	}
+
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "bench_environment.h"
+#include <containers/bits/RoaringBitmap.h>
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+/**
+ * intersect()/unite() of two random sets against std::set_intersection()/std::set_union()
+ * over the sorted vectors, from the sparse (array containers) to the dense (bitmap containers) sets.
+ * The rate is the input values per second.
+ */
+class BenchRoaringBitmap {
+	size_t m_values;
+	size_t m_rounds;
+
+public:
+
+	BenchRoaringBitmap(size_t values, size_t rounds) noexcept : m_values(values), m_rounds(rounds) {
+		for(uint64_t range : {1ull << 32, 1ull << 26, 1ull << 22}) {
+			bench(range);
+		}
+	}
+
+private:
+
+	void bench(uint64_t range) noexcept {
+		BENCH_TRACE;
+		DiceMachine dice(range);
+		std::vector<uint32_t> va(m_values), vb(m_values), out;
+		for(size_t i = 0; i < m_values; ++i) {
+			va[i] = uint32_t(dice.u64() % range);
+			vb[i] = uint32_t(dice.u64() % range);
+		}
+		std::sort(va.begin(), va.end());
+		std::sort(vb.begin(), vb.end());
+		RoaringBitmap a, b, result;
+		for(size_t i = 0; i < m_values; ++i) {
+			a.add(va[i]);
+			b.add(vb[i]);
+		}
+		a.run_optimize();
+		b.run_optimize();
+		printf("%zu values in [0:2^%u): %.2f bytes/value\n", m_values, unsigned(__builtin_ctzll(range))
+			, double(a.storage_bytes()) / double(m_values));
+
+		const size_t items = m_values * 2 * m_rounds;
+		BenchTimer timer;
+		timer.start();
+		for(size_t round = 0; round < m_rounds; ++round) {
+			out.clear();
+			std::set_intersection(va.begin(), va.end(), vb.begin(), vb.end(), std::back_inserter(out));
+			bench_keep(out.size());
+		}
+		timer.stop();
+		timer.report("std::set_intersection", items);
+
+		timer.start();
+		for(size_t round = 0; round < m_rounds; ++round) {
+			RoaringBitmap::intersect(a, b, result);
+			bench_keep(result);
+		}
+		timer.stop();
+		timer.report("RoaringBitmap::intersect", items);
+
+		timer.start();
+		for(size_t round = 0; round < m_rounds; ++round) {
+			out.clear();
+			std::set_union(va.begin(), va.end(), vb.begin(), vb.end(), std::back_inserter(out));
+			bench_keep(out.size());
+		}
+		timer.stop();
+		timer.report("std::set_union", items);
+
+		timer.start();
+		for(size_t round = 0; round < m_rounds; ++round) {
+			RoaringBitmap::unite(a, b, result);
+			bench_keep(result);
+		}
+		timer.stop();
+		timer.report("RoaringBitmap::unite", items);
+	}
+
+};
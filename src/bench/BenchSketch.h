@@ -0,0 +1,103 @@
+#pragma once
+
+#include "bench_environment.h"
+#include <containers/sketch/CountMinSketch.h>
+#include <containers/sketch/HyperLogLog.h>
+
+/**
+ * The update cost of the sketches and the block (vectorised) register scans
+ * against the per register loop.
+ */
+class BenchSketch {
+	size_t m_keys;
+
+public:
+
+	explicit BenchSketch(size_t keys) noexcept : m_keys(keys) {
+		bench_count_min();
+		bench_hyper_log_log();
+	}
+
+private:
+
+	void bench_count_min() noexcept {
+		BENCH_TRACE;
+		sketch::CountMinSketch<8> cms(4, 1 << 20);
+		sketch::CountMinSketch<8> other(4, 1 << 20);
+		if(cms.allocate() || other.allocate()) {
+			return;
+		}
+		BenchTimer timer;
+		timer.start();
+		for(uint64_t key = 0; key < m_keys; ++key) {
+			cms.add(key);
+		}
+		timer.stop();
+		timer.report("CountMinSketch<8>::add", m_keys);
+
+		timer.start();
+		for(uint64_t key = 0; key < m_keys; ++key) {
+			other.add_conservative(key);
+		}
+		timer.stop();
+		timer.report("CountMinSketch<8>::add_conservative", m_keys);
+
+		uint64_t sum = 0;
+		timer.start();
+		for(uint64_t key = 0; key < m_keys; ++key) {
+			sum += cms.estimate(key);
+		}
+		timer.stop();
+		bench_keep(sum);
+		timer.report("CountMinSketch<8>::estimate", m_keys);
+
+		timer.start();
+		cms.merge(other);
+		timer.stop();
+		timer.report("CountMinSketch<8>::merge (per counter)", size_t(cms.rows()) * cms.columns());
+	}
+
+	void bench_hyper_log_log() noexcept {
+		BENCH_TRACE;
+		constexpr size_t ROUNDS = 100;
+		sketch::HyperLogLog<16> hll;
+		sketch::HyperLogLog<16> other(0);
+		if(hll.allocate() || other.allocate()) {
+			return;
+		}
+		BenchTimer timer;
+		timer.start();
+		for(uint64_t key = 0; key < m_keys; ++key) {
+			hll.add(key);
+		}
+		timer.stop();
+		timer.report("HyperLogLog<16>::add", m_keys);
+		for(uint64_t key = 0; key < m_keys; key += 3) {
+			other.add(key * 7);
+		}
+
+		double sum = 0;
+		timer.start();
+		for(size_t i = 0; i < ROUNDS; ++i) {
+			sum += hll.estimate_scalar();
+		}
+		timer.stop();
+		timer.report("HyperLogLog<16>::estimate_scalar (per reg)", ROUNDS * hll.registers());
+
+		timer.start();
+		for(size_t i = 0; i < ROUNDS; ++i) {
+			sum += hll.estimate();
+		}
+		timer.stop();
+		bench_keep(sum);
+		timer.report("HyperLogLog<16>::estimate (per reg)", ROUNDS * hll.registers());
+
+		timer.start();
+		for(size_t i = 0; i < ROUNDS; ++i) {
+			hll.merge(other);
+		}
+		timer.stop();
+		timer.report("HyperLogLog<16>::merge (per reg)", ROUNDS * hll.registers());
+	}
+
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "bench_environment.h"
+#include <proto/reassembly/TcpStreamTable.h>
+#include <proto/parsers/MetaParser.h>
+#include <proto/procotols/Ethernet.h>
+
+#include <vector>
+
+/**
+ * Measures the per packet cost of TcpStreamTable with a large number of concurrent flows.
+ * Every flow gets a SYN and then in-order data segments in a round robin manner,
+ * so each packet touches a flow which is cold in the CPU caches.
+ */
+class BenchTcpStreamTable {
+
+	struct Handler;
+	using Table_t = proto::TcpStreamTable<Handler>;
+
+	struct Handler {
+		size_t bytes = 0;
+
+		inline void on_data(const proto::FiveTuple&, Table_t::Flow&, const uint8_t*, size_t size) noexcept {
+			bytes += size;
+		}
+
+		inline void on_close(const proto::FiveTuple&, Table_t::Flow&, Table_t::Close) noexcept {}
+	};
+
+	static constexpr size_t PAYLOAD = 64;
+
+	std::vector<uint8_t> m_packet;
+	proto::PacketMeta m_meta;
+	proto::Tcp::Header* m_tcp;
+
+public:
+
+	BenchTcpStreamTable(size_t flows, size_t rounds) noexcept {
+		make_packet();
+		bench(flows, rounds);
+	}
+
+private:
+
+	void make_packet() noexcept {
+		m_packet.assign(sizeof(proto::Ethernet::Header) + sizeof(proto::IPv4::Header)
+			+ sizeof(proto::Tcp::Header) + PAYLOAD, 0);
+		auto eth = reinterpret_cast<proto::Ethernet::Header*>(m_packet.data());
+		eth->h_proto = htons(ETH_P_IP);
+		auto ip = reinterpret_cast<proto::IPv4::Header*>(eth + 1);
+		ip->version = 4;
+		ip->ihl = 5;
+		ip->tot_len = htons(uint16_t(m_packet.size() - sizeof(*eth)));
+		ip->protocol = proto::IPv4::PROTO_TCP;
+		ip->saddr = htonl(0x0A000001);
+		ip->daddr = htonl(0x0A000002);
+		m_tcp = reinterpret_cast<proto::Tcp::Header*>(ip + 1);
+		m_tcp->data_offset = sizeof(proto::Tcp::Header) >> 2u;
+		m_tcp->dst = htons(80);
+		proto::MetaParser<>::parse_all(m_packet.data(), m_packet.size(), m_meta);
+	}
+
+	/**
+	 * Make the template packet a segment of the @flow flow.
+	 */
+	inline void set_flow(size_t flow, uint32_t seq, bool syn) noexcept {
+		m_meta.tuple.src.v4 = 0x0A000000u + uint32_t(flow >> 16u);
+		m_meta.tuple.port_src = uint16_t(flow);
+		m_meta.len_payload = syn ? 0 : PAYLOAD;
+		m_tcp->seq_num = htonl(seq);
+		m_tcp->flags = syn ? 0x02 : 0x10;
+	}
+
+	void bench(size_t flows, size_t rounds) noexcept {
+		BENCH_TRACE;
+		Handler handler;
+		Table_t table(handler, unsigned(flows), 1024, 1 << 16, uint64_t(-1) / 2);
+		if(table.allocate()) {
+			printf("allocation failed\n");
+			return;
+		}
+		printf("flows=%zu storage=%.1f MB\n", flows, double(table.storage_bytes()) / (1 << 20));
+
+		BenchTimer timer;
+		timer.start();
+		for(size_t flow = 0; flow < flows; ++flow) {
+			set_flow(flow, 0, true);
+			table.push(m_packet.data(), m_meta, 0);
+		}
+		timer.stop();
+		timer.report("TcpStreamTable SYN (new flow)", flows);
+
+		timer.start();
+		for(size_t round = 0; round < rounds; ++round) {
+			for(size_t flow = 0; flow < flows; ++flow) {
+				set_flow(flow, uint32_t(1 + round * PAYLOAD), false);
+				table.push(m_packet.data(), m_meta, round);
+			}
+		}
+		timer.stop();
+		bench_keep(handler.bytes);
+		timer.report("TcpStreamTable in-order data", flows * rounds);
+		table.stat().print(stdout, proto::TcpStreamTableStat());
+		printf("\n");
+	}
+
+};
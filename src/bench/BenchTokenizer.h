@@ -0,0 +1,106 @@
+#pragma once
+
+#include "bench_environment.h"
+#include <tio/StringTokenizer.h>
+#include <tio/ViewTokenizer.h>
+#include <utils/Tokenizer.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * The tokenizers on the generated log, config and request lines, all the tokens of a line are taken.
+ * utils::Tokenizer copies the line and allocates every token, tio::StringTokenizer copies a token
+ * byte by byte, tio::ViewTokenizer returns the views over the line with each delimiter set kernel.
+ */
+class BenchTokenizer {
+	size_t m_lines;
+
+public:
+
+	explicit BenchTokenizer(size_t lines) noexcept : m_lines(lines) {
+		DiceMachine dice(49);
+		std::vector<std::string> log;
+		std::vector<std::string> config;
+		std::vector<std::string> request;
+		char line[512];
+		for(size_t i = 0; i < m_lines; ++i) {
+			const uint32_t a = dice.u32();
+			const uint32_t b = dice.u32();
+			snprintf(line, sizeof(line), "2026-10-18T12:%02u:%02u.%03u INFO flow_table: %u.%u.%u.%u:%u -> 192.168.%u.%u:%u"
+				" proto=6 bytes=%u packets=%u state=established", a % 60u, b % 60u, a % 1000u, a >> 24u, (a >> 16u) & 0xFFu
+				, (a >> 8u) & 0xFFu, a & 0xFFu, b & 0xFFFFu, (b >> 16u) & 0xFFu, b >> 24u, a & 0xFFFFu, b % 100000u, a % 1000u);
+			log.emplace_back(line);
+			snprintf(line, sizeof(line), "  section_%u.option_%u = %u, value_%u\t# the default is %u", a % 100u, b % 1000u
+				, a % 100000u, b % 10u, b % 4096u);
+			config.emplace_back(line);
+			snprintf(line, sizeof(line), "GET /api/v1/flows/%08x%08x/statistics?from=1760788800&to=1760792400&fields=bytes,packets"
+				" HTTP/1.1 Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36", a, b);
+			request.emplace_back(line);
+		}
+		bench_lines("log", log, " :=");
+		bench_lines("config", config, " \t=,#");
+		bench_lines("request", request, " ");
+	}
+
+private:
+
+	void bench_lines(const char* kind, const std::vector<std::string>& lines, const char* delimiters) noexcept {
+		BENCH_TRACE;
+		size_t bytes = 0;
+		for(const auto& line : lines) {
+			bytes += line.size();
+		}
+		printf("%s lines: %zu bytes per line\n", kind, bytes / lines.size());
+		char name[64];
+		snprintf(name, sizeof(name), "%s utils::Tokenizer", kind);
+		const std::string splitter(delimiters);
+		bench_run(name, 0, lines.size(), [&]() {
+			size_t acc = 0;
+			for(const auto& line : lines) {
+				utils::Tokenizer tokenizer(line, splitter);
+				while(tokenizer.has_next()) {
+					acc += tokenizer.next().size();
+				}
+			}
+			bench_keep(acc);
+		});
+		snprintf(name, sizeof(name), "%s tio::StringTokenizer", kind);
+		bench_run(name, 0, lines.size(), [&]() {
+			size_t acc = 0;
+			for(const auto& line : lines) {
+				tio::StringTokenizer<256> tokenizer(line.c_str(), delimiters);
+				while(tokenizer.next()) {
+					acc += size_t(tokenizer.token()[0]);
+				}
+			}
+			bench_keep(acc);
+		});
+		bench_view(kind, lines, tio::DelimiterSet(delimiters, tio::DelimiterSet::KERNEL_SCALAR), "scalar");
+		if(utils::Cpu::sse42()) {
+			bench_view(kind, lines, tio::DelimiterSet(delimiters, tio::DelimiterSet::KERNEL_SSE42), "sse42");
+		}
+		if(utils::Cpu::avx2()) {
+			bench_view(kind, lines, tio::DelimiterSet(delimiters, tio::DelimiterSet::KERNEL_AVX2), "avx2");
+		}
+	}
+
+	static void bench_view(const char* kind, const std::vector<std::string>& lines, const tio::DelimiterSet& set
+		, const char* kernel) noexcept {
+		char name[64];
+		snprintf(name, sizeof(name), "%s tio::ViewTokenizer %s", kind, kernel);
+		bench_run(name, 0, lines.size(), [&]() {
+			size_t acc = 0;
+			tio::ViewTokenizer<> tokenizer(std::string_view(), set);
+			for(const auto& line : lines) {
+				tokenizer.reset(line);
+				while(tokenizer.next()) {
+					acc += tokenizer.token().size();
+				}
+			}
+			bench_keep(acc);
+		});
+	}
+
+};
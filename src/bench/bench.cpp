@@ -0,0 +1,89 @@
+#include "BenchBurstClassifier.h"
+#include "BenchTcpStreamTable.h"
+#include "BenchChecksum.h"
+#include "BenchBitArray.h"
+#include "BenchSketch.h"
+#include "BenchBitStream.h"
+#include "BenchRankSelect.h"
+#include "BenchRoaringBitmap.h"
+#include "BenchOrdered.h"
+#include "BenchCuckooQueuePool.h"
+#include "BenchContainers.h"
+#include "BenchPacket.h"
+#include "BenchLogger.h"
+#include "BenchFio.h"
+#include "BenchAio.h"
+#include "BenchTokenizer.h"
+#include "BenchParse.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+FILE* Logger::log_file = stdout;
+
+int main(int argc, char** argv) {
+
+	if(not bench_options().parse(argc, argv)) {
+		fprintf(stderr, "Usage: %s [--filter <suite>] [--reps <n>] [--warmup <n>] [--cpu <n>] [--json <file>] [--quick]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if(not bench_setup()) {
+		return EXIT_FAILURE;
+	}
+
+	if(bench_selected("burst_classifier")) {
+		BenchBurstClassifier bench_burst_classifier(1 << 14, 200);
+	}
+	if(bench_selected("tcp_stream_table")) {
+		BenchTcpStreamTable bench_tcp_stream_table(1 << 21, 4);
+	}
+	if(bench_selected("checksum")) {
+		BenchChecksum bench_checksum(1 << 28);
+	}
+	if(bench_selected("bit_array")) {
+		BenchBitArray bench_bit_array(1 << 16, 100);
+	}
+	if(bench_selected("sketch")) {
+		BenchSketch bench_sketch(1 << 22);
+	}
+	if(bench_selected("bit_stream")) {
+		BenchBitStream bench_bit_stream(1 << 16, 50);
+	}
+	if(bench_selected("rank_select")) {
+		BenchRankSelect bench_rank_select(1 << 22);
+	}
+	if(bench_selected("roaring_bitmap")) {
+		BenchRoaringBitmap bench_roaring_bitmap(1 << 20, 10);
+	}
+	if(bench_selected("ordered")) {
+		BenchOrdered bench_ordered(1 << 22);
+	}
+	if(bench_selected("cuckoo_queue_pool")) {
+		BenchCuckooQueuePool bench_cuckoo_queue_pool(1 << 20, 1 << 16);
+	}
+	if(bench_selected("containers")) {
+		BenchContainers bench_containers;
+	}
+	if(bench_selected("packet")) {
+		BenchPacket bench_packet(1 << 14);
+	}
+	if(bench_selected("logger")) {
+		BenchLogger bench_logger(1 << 14);
+	}
+	if(bench_selected("fio")) {
+		BenchFio bench_fio(1 << 20);
+	}
+	if(bench_selected("aio")) {
+		BenchAio bench_aio(bench_options().quick ? (size_t(1) << 26) : (size_t(1) << 30)
+			, bench_options().quick ? (1 << 12) : (1 << 16));
+	}
+	if(bench_selected("tokenizer")) {
+		BenchTokenizer bench_tokenizer(bench_options().quick ? (1 << 12) : (1 << 16));
+	}
+	if(bench_selected("parse")) {
+		BenchParse bench_parse(bench_options().quick ? (1 << 12) : (1 << 16));
+	}
+
+	printf("<---- the end of main() ---->\n");
+	return bench_finish() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,368 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "utils/Cpu.h"
+#include "utils/DiceMachine.h"
+
+#ifndef BENCH_TRACE
+#define BENCH_TRACE {printf("-> %s::%s()\n", typeid(*this).name(), __FUNCTION__);}
+#endif // BENCH_TRACE
+
+/**
+ * The command line options:
+ * --filter <text>  run the suites with @text in the name only;
+ * --reps <n>       the measured repetitions of a bench_run() case (5);
+ * --warmup <n>     the unmeasured repetitions before them (1);
+ * --cpu <n>        pin the process to the CPU @n;
+ * --json <file>    write all the results as a JSON array;
+ * --quick          skip the DRAM-resident sizes.
+ */
+struct BenchOptions {
+	const char* filter = nullptr;
+	const char* json = nullptr;
+	unsigned reps = 5;
+	unsigned warmup = 1;
+	int cpu = -1;
+	bool quick = false;
+	const char* suite = "";
+
+	/**
+	 * @return false - if the arguments are malformed.
+	 */
+	bool parse(int argc, char** argv) noexcept {
+		for(int i = 1; i < argc; ++i) {
+			const bool has_value = i + 1 < argc;
+			if(not strcmp(argv[i], "--quick")) {
+				quick = true;
+			} else if(has_value && not strcmp(argv[i], "--filter")) {
+				filter = argv[++i];
+			} else if(has_value && not strcmp(argv[i], "--json")) {
+				json = argv[++i];
+			} else if(has_value && not strcmp(argv[i], "--reps")) {
+				reps = unsigned(std::max(1, atoi(argv[++i])));
+			} else if(has_value && not strcmp(argv[i], "--warmup")) {
+				warmup = unsigned(std::max(0, atoi(argv[++i])));
+			} else if(has_value && not strcmp(argv[i], "--cpu")) {
+				cpu = atoi(argv[++i]);
+			} else {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+inline BenchOptions& bench_options() noexcept {
+	static BenchOptions options;
+	return options;
+}
+
+/**
+ * The hardware counters of the calling thread (user space only) read as a perf_event_open() group:
+ * the core cycles, the instructions and the last level cache misses.
+ * Not available in many VMs and containers, then only the TSC is reported.
+ */
+class BenchPerf {
+public:
+
+	enum Counter {
+		CYCLES,
+		INSTRUCTIONS,
+		CACHE_MISSES,
+		COUNTERS
+	};
+
+private:
+
+	int m_fds[COUNTERS];
+
+	static int open(uint64_t config, int group) noexcept {
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = config;
+		attr.disabled = (group == -1);
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP;
+		return int(syscall(__NR_perf_event_open, &attr, 0, -1, group, 0));
+	}
+
+public:
+
+	BenchPerf() noexcept {
+		m_fds[CYCLES] = open(PERF_COUNT_HW_CPU_CYCLES, -1);
+		m_fds[INSTRUCTIONS] = m_fds[CYCLES] < 0 ? -1 : open(PERF_COUNT_HW_INSTRUCTIONS, m_fds[CYCLES]);
+		m_fds[CACHE_MISSES] = m_fds[CYCLES] < 0 ? -1 : open(PERF_COUNT_HW_CACHE_MISSES, m_fds[CYCLES]);
+		if(m_fds[INSTRUCTIONS] < 0 || m_fds[CACHE_MISSES] < 0) {
+			close_all();
+		}
+	}
+
+	BenchPerf(const BenchPerf&) = delete;
+	BenchPerf& operator=(const BenchPerf&) = delete;
+
+	~BenchPerf() noexcept {
+		close_all();
+	}
+
+	inline bool available() const noexcept {
+		return m_fds[CYCLES] >= 0;
+	}
+
+	inline void start() noexcept {
+		if(available()) {
+			ioctl(m_fds[CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+			ioctl(m_fds[CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		}
+	}
+
+	/**
+	 * @param values - the counters since start(), zeros if not available.
+	 */
+	inline void stop(uint64_t (&values)[COUNTERS]) noexcept {
+		uint64_t buffer[1 + COUNTERS] = {};
+		if(available()) {
+			ioctl(m_fds[CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+			if(read(m_fds[CYCLES], buffer, sizeof(buffer)) != ssize_t(sizeof(buffer))) {
+				memset(buffer, 0, sizeof(buffer));
+			}
+		}
+		// the group read format: the counter number followed by the values
+		memcpy(values, buffer + 1, sizeof(values));
+	}
+
+private:
+
+	void close_all() noexcept {
+		for(int& fd : m_fds) {
+			if(fd >= 0) {
+				close(fd);
+			}
+			fd = -1;
+		}
+	}
+
+};
+
+inline BenchPerf& bench_perf() noexcept {
+	static BenchPerf perf;
+	return perf;
+}
+
+/**
+ * One measured case, all the costs are per item.
+ */
+struct BenchRecord {
+	std::string suite;
+	std::string name;
+	size_t size = 0;      // the container size or 0
+	size_t items = 0;     // the items processed by a repetition
+	unsigned reps = 1;
+	double ns = 0;        // the median
+	double ns_min = 0;
+	double tsc = 0;       // the TSC cycles of the median repetition
+	double cycles = 0;    // the core cycles, 0 without perf
+	double instructions = 0;
+	double cache_misses = 0;
+};
+
+inline std::vector<BenchRecord>& bench_records() noexcept {
+	static std::vector<BenchRecord> records;
+	return records;
+}
+
+/**
+ * @return true - if the suite is selected by --filter, it becomes the suite of the following records.
+ */
+inline bool bench_selected(const char* suite) noexcept {
+	BenchOptions& options = bench_options();
+	options.suite = suite;
+	return not options.filter || strstr(suite, options.filter);
+}
+
+/**
+ * Apply --cpu and report the measurement setup.
+ * @return false - if the pinning failed.
+ */
+inline bool bench_setup() noexcept {
+	const BenchOptions& options = bench_options();
+	if(options.cpu >= 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(options.cpu, &set);
+		if(sched_setaffinity(0, sizeof(set), &set)) {
+			fprintf(stderr, "Can't pin to the CPU %d\n", options.cpu);
+			return false;
+		}
+	}
+	printf("reps=%u warmup=%u cpu=%d perf=%s\n", options.reps, options.warmup, options.cpu
+		, bench_perf().available() ? "yes" : "no");
+	return true;
+}
+
+/**
+ * Write the records to the --json file.
+ * @return false - if the file can't be written.
+ */
+inline bool bench_finish() noexcept {
+	const char* path = bench_options().json;
+	if(not path) {
+		return true;
+	}
+	FILE* out = fopen(path, "w");
+	if(not out) {
+		fprintf(stderr, "Can't write %s\n", path);
+		return false;
+	}
+	fprintf(out, "[\n");
+	const auto& records = bench_records();
+	for(size_t i = 0; i < records.size(); ++i) {
+		const BenchRecord& r = records[i];
+		fprintf(out, "{\"suite\":\"%s\",\"name\":\"%s\",\"size\":%zu,\"items\":%zu,\"reps\":%u"
+			",\"ns\":%.3f,\"ns_min\":%.3f,\"tsc\":%.3f,\"cycles\":%.3f,\"instructions\":%.3f,\"cache_misses\":%.4f}%s\n"
+			, r.suite.c_str(), r.name.c_str(), r.size, r.items, r.reps, r.ns, r.ns_min, r.tsc
+			, r.cycles, r.instructions, r.cache_misses, i + 1 < records.size() ? "," : "");
+	}
+	fprintf(out, "]\n");
+	return fclose(out) == 0;
+}
+
+/**
+ * Prevent the compiler from optimizing out a computed value.
+ */
+template <typename T>
+inline void bench_keep(const T& value) noexcept {
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+/**
+ * Measures the wall clock time and the TSC cycles of a section.
+ */
+class BenchTimer {
+	timespec m_start;
+	uint64_t m_cycles_start = 0;
+	uint64_t m_ns = 0;
+	uint64_t m_cycles = 0;
+
+public:
+
+	inline void start() noexcept {
+		clock_gettime(CLOCK_MONOTONIC, &m_start);
+		m_cycles_start = utils::Cpu::rdtsc();
+	}
+
+	inline void stop() noexcept {
+		m_cycles = utils::Cpu::rdtsc() - m_cycles_start;
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		m_ns = uint64_t(now.tv_sec - m_start.tv_sec) * 1000000000ull + now.tv_nsec - m_start.tv_nsec;
+	}
+
+	inline uint64_t ns() const noexcept {
+		return m_ns;
+	}
+
+	inline uint64_t cycles() const noexcept {
+		return m_cycles;
+	}
+
+	/**
+	 * Print the per item cost of the last measurement.
+	 * @param name - the measured case.
+	 * @param items - the number of items processed.
+	 */
+	void report(const char* name, size_t items) const noexcept {
+		const double per_item = double(m_ns) / double(items);
+		printf("%-40s %10.2f ns/item %10.2f Mitems/s %10.2f cycles/item\n"
+			, name, per_item, 1000.0 / per_item, double(m_cycles) / double(items));
+		BenchRecord record;
+		record.suite = bench_options().suite;
+		record.name = name;
+		record.items = items;
+		record.ns = record.ns_min = per_item;
+		record.tsc = double(m_cycles) / double(items);
+		bench_records().push_back(record);
+	}
+
+	/**
+	 * Print the throughput of the last measurement.
+	 * @param name - the measured case.
+	 * @param bytes - the number of bytes processed.
+	 */
+	void report_bytes(const char* name, size_t bytes) const noexcept {
+		printf("%-40s %10.2f GB/s %10.3f cycles/byte\n"
+			, name, double(bytes) / double(m_ns), double(m_cycles) / double(bytes));
+	}
+
+};
+
+/**
+ * Run @body (processing @items items) --warmup times unmeasured and --reps times measured,
+ * print the median and the minimum per item with the median rate and keep the record for --json.
+ * The perf counters, if available, are the ones of the median repetition.
+ * @param size - the container size for the record, 0 if not applicable.
+ */
+template <typename Body>
+void bench_run(const char* name, size_t size, size_t items, Body&& body) noexcept {
+	const BenchOptions& options = bench_options();
+	for(unsigned i = 0; i < options.warmup; ++i) {
+		body();
+	}
+	struct Rep {
+		uint64_t ns;
+		uint64_t tsc;
+		uint64_t counters[BenchPerf::COUNTERS];
+	};
+	std::vector<Rep> reps(options.reps);
+	BenchTimer timer;
+	for(auto& rep : reps) {
+		bench_perf().start();
+		timer.start();
+		body();
+		timer.stop();
+		bench_perf().stop(rep.counters);
+		rep.ns = timer.ns();
+		rep.tsc = timer.cycles();
+	}
+	std::sort(reps.begin(), reps.end(), [](const Rep& a, const Rep& b) { return a.ns < b.ns; });
+	const Rep& median = reps[reps.size() / 2];
+
+	BenchRecord record;
+	record.suite = options.suite;
+	record.name = name;
+	record.size = size;
+	record.items = items;
+	record.reps = options.reps;
+	record.ns = double(median.ns) / double(items);
+	record.ns_min = double(reps.front().ns) / double(items);
+	record.tsc = double(median.tsc) / double(items);
+	record.cycles = double(median.counters[BenchPerf::CYCLES]) / double(items);
+	record.instructions = double(median.counters[BenchPerf::INSTRUCTIONS]) / double(items);
+	record.cache_misses = double(median.counters[BenchPerf::CACHE_MISSES]) / double(items);
+	if(bench_perf().available()) {
+		printf("%-32s %10zu %9.2f ns (min %9.2f) %9.2f Mitems/s %9.2f cycles %6.2f IPC %7.3f misses\n", name, size
+			, record.ns, record.ns_min, 1000.0 / record.ns, record.cycles
+			, record.cycles ? record.instructions / record.cycles : 0.0, record.cache_misses);
+	} else {
+		printf("%-32s %10zu %9.2f ns (min %9.2f) %9.2f Mitems/s %9.2f tsc\n", name, size, record.ns, record.ns_min
+			, 1000.0 / record.ns, record.tsc);
+	}
+	bench_records().push_back(record);
+}
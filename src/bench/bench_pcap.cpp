@@ -0,0 +1,83 @@
+#include "bench_environment.h"
+#include <pcapwrap/Reader.h>
+#include <pcapwrap/Writer.h>
+#include <proto/TrafficGenerator.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+/**
+ * The pcapwrap read and write paths on the synthetic traces, it needs libpcap,
+ * so it is a separate target. The parsers are measured by the "packet" suite of the bench target.
+ */
+static bool bench_pcapwrap(const proto::TrafficProfile& profile, size_t frames) {
+	proto::TrafficTrace trace;
+	proto::TrafficGenerator(profile, 0xC0FFEE).generate(trace, frames);
+
+	char path[] = "/tmp/bench_pcap_XXXXXX";
+	const int fd = mkstemp(path);
+	if(fd < 0) {
+		fprintf(stderr, "Can't create a temporary file\n");
+		return false;
+	}
+	close(fd);
+
+	const std::string prefix = std::string(profile.name) + "/";
+	bench_run((prefix + "pcapwrap::Writer").c_str(), 0, trace.size(), [&]() {
+		auto writer = pcapwrap::Writer::open(path);
+		pcapwrap::Frame frame;
+		for(size_t i = 0; i < trace.size(); ++i) {
+			frame.m_hdr.caplen = frame.m_hdr.len = uint32_t(trace.length(i));
+			frame.nanosec(trace.stamp(i));
+			frame.m_data = trace.frame(i);
+			writer.write(frame);
+		}
+	});
+
+	size_t bytes = 0;
+	bench_run((prefix + "pcapwrap::Reader").c_str(), 0, trace.size(), [&]() {
+		auto reader = pcapwrap::Reader::open(path);
+		pcapwrap::Frame frame;
+		while(reader.next(frame)) {
+			bytes += frame.m_hdr.caplen;
+		}
+	});
+	bench_keep(bytes);
+	remove(path);
+	return bytes % trace.bytes() == 0;
+}
+
+int main(int argc, char** argv) {
+
+	if(not bench_options().parse(argc, argv)) {
+		fprintf(stderr, "Usage: %s [--reps <n>] [--warmup <n>] [--cpu <n>] [--json <file>] [--quick]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if(not bench_setup()) {
+		return EXIT_FAILURE;
+	}
+
+	const size_t frames = bench_options().quick ? (1 << 14) : (1 << 18);
+	const proto::TrafficProfile profiles[] = {
+		proto::TrafficProfile::imix(),
+		proto::TrafficProfile::vlan_stacked(),
+		proto::TrafficProfile::ipv6_only(),
+		proto::TrafficProfile::gre_tunneled(),
+		proto::TrafficProfile::fragmented(),
+	};
+	bench_selected("pcapwrap");
+	bool result = true;
+	try {
+		for(const auto& profile : profiles) {
+			result &= bench_pcapwrap(profile, frames);
+		}
+	} catch(const std::exception& e) {
+		fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	printf("<---- the end of main() ---->\n");
+	return (result && bench_finish()) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,34 +1,69 @@
 #pragma once
 
+#include <cctype>
+#include <charconv>
 #include <cstdlib>
-#include <cerrno>
 #include <cstring>
+#include <string_view>
+#include <type_traits>
 
 namespace cli {
 
 class Float {
 public:
 
+	/**
+	 * The forms of strtod() without its locale and errno, by std::from_chars(): the leading spaces,
+	 * [+|-]<digits>[.<digits>][e[+|-]<digits>], the hex [+|-]0x<hex digits>[.<hex digits>][p[+|-]<digits>], inf or nan.
+	 * @return The parsed length, 0 - no number or it is out of the range of @T.
+	 */
 	template<typename T>
-	static size_t parse_offset(const char* arg, T& value) noexcept {
+	static size_t parse_offset(std::string_view arg, T& value) noexcept {
 		static_assert(std::is_floating_point<T>::value, "cli::Float::parse_offset");
 		size_t offset = 0;
-		if(arg) {
-			char* endptr;
-			const auto raw_value = std::strtod(arg, &endptr);
-			if(errno == 0) {
-				value = raw_value;
-				offset = endptr - arg;
-			}
+		while(offset < arg.size() && isspace(uint8_t(arg[offset]))) {
+			offset++;
+		}
+		bool negative = false;
+		if(offset < arg.size() && (arg[offset] == '+' || arg[offset] == '-')) {
+			negative = arg[offset] == '-';
+			offset++;
+		}
+		const char* begin = arg.data() + offset;
+		const char* end = arg.data() + arg.size();
+		// the sign is taken above, std::from_chars() would take one more
+		if(begin == end || *begin == '+' || *begin == '-') {
+			return 0;
+		}
+		T raw_value;
+		std::from_chars_result result{begin, std::errc::invalid_argument};
+		if(end - begin > 2 && begin[0] == '0' && (begin[1] == 'x' || begin[1] == 'X') && begin[2] != '+' && begin[2] != '-') {
+			result = std::from_chars(begin + 2, end, raw_value, std::chars_format::hex);
 		}
-		return offset;
+		// "0x" without the hex digits is 0 as for strtod()
+		if(result.ec == std::errc::invalid_argument) {
+			result = std::from_chars(begin, end, raw_value);
+		}
+		if(result.ec != std::errc()) {
+			return 0;
+		}
+		value = negative ? -raw_value : raw_value;
+		return size_t(result.ptr - arg.data());
+	}
+
+	template<typename T>
+	static size_t parse_offset(const char* arg, T& value) noexcept {
+		return arg ? parse_offset(std::string_view(arg), value) : 0;
+	}
+
+	template<typename T>
+	static bool parse(std::string_view arg, T& value) noexcept {
+		return not arg.empty() && parse_offset(arg, value) == arg.size();
 	}
 
 	template<typename T>
 	static bool parse(const char* arg, T& value) noexcept {
-		const auto len = strlen(arg);
-		const auto read = parse_offset(arg, value);
-		return len && read == len;
+		return arg && parse(std::string_view(arg), value);
 	}
 
 };
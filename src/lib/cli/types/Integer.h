@@ -1,70 +1,104 @@
 #pragma once
 
+#include "../../utils/Types.h"
+
+#include <charconv>
+#include <cctype>
 #include <cstdlib>
 #include <cstdint>
 #include <cstring>
+#include <limits>
+#include <string_view>
 #include <type_traits>
-#include <cstdio>
-#include <cerrno>
 
 namespace cli {
 
+/**
+ * The leading spaces, then [+|-][0x]<digits> of the base as strtoll() takes them, the decimal digits are parsed
+ * by utils::Types::parse_digits(), the other bases by std::from_chars(). An unsigned value takes no '-'.
+ */
 class Integer {
 public:
 
+	/**
+	 * @return The parsed length, 0 - no number or the value does not fit @T.
+	 */
 	template<typename T>
-	static size_t parse_offset(const char* arg, T& value, const unsigned base = 10) noexcept {
+	static size_t parse_offset(std::string_view arg, T& value, const unsigned base = 10) noexcept {
 		static_assert(std::is_integral<T>::value, "cli::Integer::parse_offset");
-		if(std::is_signed<T>::value) {
-			return parse_signed(arg, value, base);
+		using Unsigned_t = std::make_unsigned_t<T>;
+		constexpr uint64_t max = uint64_t(std::numeric_limits<T>::max());
+		if(base < 2 || base > 36) {
+			return 0;
+		}
+		size_t offset = 0;
+		while(offset < arg.size() && isspace(uint8_t(arg[offset]))) {
+			offset++;
+		}
+		bool negative = false;
+		if(offset < arg.size() && (arg[offset] == '-' || arg[offset] == '+')) {
+			negative = arg[offset] == '-';
+			if(negative && std::is_unsigned<T>::value) {
+				return 0;
+			}
+			offset++;
+		}
+		if(base == 16 && arg.size() > offset + 2 && arg[offset] == '0' && (arg[offset + 1] == 'x' || arg[offset + 1] == 'X')
+			&& isxdigit(uint8_t(arg[offset + 2]))) {
+			offset += 2;
+		}
+		uint64_t magnitude = 0;
+		size_t read;
+		if(base == 10) {
+			read = utils::Types::parse_digits(arg.substr(offset), magnitude);
 		} else {
-			return parse_unsigned(arg, value, base);
+			const char* end = arg.data() + arg.size();
+			const auto [ptr, ec] = std::from_chars(arg.data() + offset, end, magnitude, int(base));
+			read = (ec == std::errc()) ? size_t(ptr - arg.data()) - offset : 0;
+		}
+		if(read == 0 || magnitude > max + (negative ? 1u : 0u)) {
+			return 0;
 		}
+		value = T(negative ? Unsigned_t(0u - magnitude) : Unsigned_t(magnitude));
+		return offset + read;
 	}
 
+	/**
+	 * @param arg - a zero terminated string, the number ends at the first non alphanumeric char.
+	 */
 	template<typename T>
-	static bool parse(const char* arg, T& value, const unsigned base = 10) noexcept {
-		const auto len = strlen(arg);
-		return len && parse_offset(arg, value, base) == len;
+	static size_t parse_offset(const char* arg, T& value, const unsigned base = 10) noexcept {
+		return arg ? parse_offset(std::string_view(arg, token_size(arg)), value, base) : 0;
 	}
 
-private:
-
 	template<typename T>
-	static size_t parse_unsigned(const char* arg, T& value, const unsigned base = 10) noexcept {
-		constexpr T max = T(~0ull);
-		size_t offset = 0;
-		if(arg && base) {
-			char* endptr;
-			const auto raw_value = std::strtoull(arg, &endptr, base);
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wsign-compare"
-			if(raw_value <= max && errno == 0) {
-#pragma GCC diagnostic pop
-				value = raw_value;
-				offset = endptr - arg;
-			}
-		}
-		return offset;
+	static bool parse(std::string_view arg, T& value, const unsigned base = 10) noexcept {
+		return not arg.empty() && parse_offset(arg, value, base) == arg.size();
 	}
 
 	template<typename T>
-	static size_t parse_signed(const char* arg, T& value, const unsigned base = 10) noexcept {
-		constexpr T max = ~(~0ull << ((sizeof(T) << 3ull) - 1ull));
-		size_t offset = 0;
-		if(arg && base) {
-			char* endptr;
-			const auto raw_value = std::strtoll(arg, &endptr, base);
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wsign-compare"
-			if(raw_value <= max && errno == 0) {
-#pragma GCC diagnostic pop
-				value = raw_value;
-				offset = endptr - arg;
-			}
+	static bool parse(const char* arg, T& value, const unsigned base = 10) noexcept {
+		return arg && parse(std::string_view(arg), value, base);
+	}
+
+private:
+
+	/**
+	 * @return The length of the spaces, the sign and the alphanumeric chars after them, there is no strlen() for
+	 * a number in the middle of a long argument.
+	 */
+	static size_t token_size(const char* arg) noexcept {
+		size_t size = 0;
+		while(isspace(uint8_t(arg[size]))) {
+			size++;
+		}
+		size += (arg[size] == '-' || arg[size] == '+') ? 1 : 0;
+		while(isalnum(uint8_t(arg[size]))) {
+			size++;
 		}
-		return offset;
+		return size;
 	}
+
 };
 
 }; // namespace cli
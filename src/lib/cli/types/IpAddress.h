@@ -0,0 +1,249 @@
+#pragma once
+
+#include "../../proto/procotols/IPv4.h"
+#include "../../proto/procotols/IPv6.h"
+#include "../../utils/Types.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include <immintrin.h>
+
+namespace cli {
+
+/**
+ * The IPv4 (a.b.c.d) and IPv6 (RFC 4291 text forms) addresses and the networks of them (<addr>[/<prefix>]).
+ * parse_offset() takes an address at the beginning of a buffer and returns its length, 0 - no address,
+ * so a rule file is parsed in one pass without copies to zero terminated strings. parse() takes the whole string.
+ * The IPv4 address is in the host byte order as proto::IPv4::addr_host() gives it, the IPv6 one is in the network
+ * byte order as in the header.
+ */
+class IpAddress {
+public:
+	using IPv4Addr_t = proto::IPv4::Addr;
+	using IPv4Net_t = proto::IPv4::Net;
+	using IPv6Addr_t = proto::IPv6::Addr;
+
+	struct IPv6Net_t {
+		IPv6Addr_t addr;
+		unsigned prefix;
+	};
+
+	/**
+	 * 4 decimal octets of 1 to 3 digits, 0 to 255, no leading zeros (they would be octal to inet_aton()).
+	 */
+	static size_t parse_offset(std::string_view arg, IPv4Addr_t& addr) noexcept {
+		const Text<1> text(arg, false);
+		IPv4Addr_t acc = 0;
+		size_t offset = 0;
+		for(unsigned i = 0; i < 4; ++i) {
+			if(i) {
+				if(text.chars[offset] != '.') {
+					return 0;
+				}
+				offset++;
+			}
+			// the weights of the digits by the length, no branch on it
+			static constexpr unsigned weights[4][3] = {{0, 0, 0}, {1, 0, 0}, {10, 1, 0}, {100, 10, 1}};
+			const unsigned digits = text.run(offset);
+			const unsigned* weight = weights[std::min(digits, 3u)];
+			const unsigned d0 = text.values[offset];
+			const unsigned octet = d0 * weight[0] + text.values[offset + 1] * weight[1] + text.values[offset + 2] * weight[2];
+			if(digits == 0 || digits > 3 || (digits > 1 && d0 == 0) || octet > 255u) {
+				return 0;
+			}
+			acc = (acc << 8u) | octet;
+			offset += digits;
+		}
+		addr = acc;
+		return offset;
+	}
+
+	/**
+	 * Up to 8 groups of 1 to 4 hex digits, one "::" for the zero groups, an IPv4 address for the last 2 groups.
+	 */
+	static size_t parse_offset(std::string_view arg, IPv6Addr_t& addr) noexcept {
+		const Text<3> text(arg, true);
+		uint16_t groups[8];
+		unsigned count = 0;
+		int gap = -1; // the group index of "::"
+		size_t offset = 0;
+		if(text.chars[0] == ':' && text.chars[1] == ':') {
+			gap = 0;
+			offset = 2;
+		}
+		while(count < 8) {
+			const unsigned digits = text.run(offset);
+			if(digits == 0) {
+				// a group must follow a single ':'
+				if(count && gap != int(count)) {
+					return 0;
+				}
+				break;
+			}
+			if(text.chars[offset + digits] == '.') {
+				IPv4Addr_t v4;
+				const size_t read = count <= 6 ? parse_offset(arg.substr(offset), v4) : 0;
+				if(read == 0) {
+					return 0;
+				}
+				groups[count++] = uint16_t(v4 >> 16u);
+				groups[count++] = uint16_t(v4);
+				offset += read;
+				break;
+			}
+			if(digits > 4) {
+				return 0;
+			}
+			// the nibbles after the group are shifted out
+			const unsigned nibbles = (unsigned(text.values[offset]) << 12u) | (unsigned(text.values[offset + 1]) << 8u)
+				| (unsigned(text.values[offset + 2]) << 4u) | text.values[offset + 3];
+			groups[count++] = uint16_t(nibbles >> (16u - 4u * digits));
+			offset += digits;
+			if(count == 8 || text.chars[offset] != ':') {
+				break;
+			}
+			if(text.chars[offset + 1] == ':') {
+				if(gap >= 0) {
+					return 0;
+				}
+				gap = int(count);
+				offset += 2;
+			} else {
+				offset++;
+				if(text.run(offset) == 0) {
+					return 0;
+				}
+			}
+		}
+		if(gap < 0 ? count != 8 : count == 8) {
+			return 0;
+		}
+		const unsigned zeros = 8 - count;
+		for(unsigned i = 0, j = 0; i < 8; ++i) {
+			const bool zero = gap >= 0 && i >= unsigned(gap) && i < unsigned(gap) + zeros;
+			const uint16_t group = zero ? 0 : groups[j++];
+			addr.addr8[i * 2] = uint8_t(group >> 8u);
+			addr.addr8[i * 2 + 1] = uint8_t(group);
+		}
+		return offset;
+	}
+
+	/**
+	 * The address bits beyond the prefix are cleared, no prefix is /32.
+	 */
+	static size_t parse_offset(std::string_view arg, IPv4Net_t& net) noexcept {
+		IPv4Addr_t addr;
+		unsigned prefix = 32;
+		size_t offset = parse_offset(arg, addr);
+		if(offset == 0 || (offset = parse_prefix(arg, offset, 32, prefix)) == 0) {
+			return 0;
+		}
+		net.mask = prefix ? IPv4Addr_t(~0u << (32u - prefix)) : 0;
+		net.addr = addr & net.mask;
+		return offset;
+	}
+
+	/**
+	 * The address bits beyond the prefix are cleared, no prefix is /128.
+	 */
+	static size_t parse_offset(std::string_view arg, IPv6Net_t& net) noexcept {
+		unsigned prefix = 128;
+		size_t offset = parse_offset(arg, net.addr);
+		if(offset == 0 || (offset = parse_prefix(arg, offset, 128, prefix)) == 0) {
+			return 0;
+		}
+		net.prefix = prefix;
+		for(unsigned i = 0; i < 16; ++i) {
+			const unsigned bits = prefix > i * 8u ? prefix - i * 8u : 0u;
+			net.addr.addr8[i] &= bits >= 8u ? 0xFFu : uint8_t(0xFF00u >> bits);
+		}
+		return offset;
+	}
+
+	template<typename T>
+	static bool parse(std::string_view arg, T& value) noexcept {
+		T parsed;
+		if(arg.empty() || parse_offset(arg, parsed) != arg.size()) {
+			return false;
+		}
+		value = parsed;
+		return true;
+	}
+
+	template<typename T>
+	static bool parse(const char* arg, T& value) noexcept {
+		return arg && parse(std::string_view(arg), value);
+	}
+
+private:
+
+	/**
+	 * A zero padded copy of the beginning of an argument with the digits classified by SSE2 16 chars at a time,
+	 * the length of a number is a bit scan, its value is taken from the digit values with no loop over the chars.
+	 * @tparam Blocks - the 16 chars blocks, enough for the longest address and the char after it.
+	 */
+	template<size_t Blocks>
+	struct Text {
+		static constexpr size_t SIZE = Blocks * 16;
+
+		alignas(16) char chars[SIZE + 16];
+		alignas(16) uint8_t values[SIZE + 16];
+		uint64_t digits; // bit i - chars[i] is a digit
+
+		Text(std::string_view arg, bool hex) noexcept : digits(0) {
+			static_assert(SIZE < 64);
+			const __m128i zero = _mm_setzero_si128();
+			for(size_t i = 0; i < SIZE + 16; i += 16) {
+				_mm_store_si128(reinterpret_cast<__m128i*>(chars + i), zero);
+				_mm_store_si128(reinterpret_cast<__m128i*>(values + i), zero);
+			}
+			memcpy(chars, arg.data(), std::min(arg.size(), SIZE));
+			for(size_t i = 0; i < SIZE; i += 16) {
+				const __m128i block = _mm_load_si128(reinterpret_cast<const __m128i*>(chars + i));
+				// the signed compares, the chars above 0x7F are negative
+				const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('0' - 1))
+					, _mm_cmplt_epi8(block, _mm_set1_epi8('9' + 1)));
+				__m128i value = _mm_and_si128(digit, _mm_sub_epi8(block, _mm_set1_epi8('0')));
+				__m128i mask = digit;
+				if(hex) {
+					const __m128i lower = _mm_or_si128(block, _mm_set1_epi8(0x20));
+					const __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1))
+						, _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+					value = _mm_or_si128(value, _mm_and_si128(letter, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+					mask = _mm_or_si128(mask, letter);
+				}
+				_mm_store_si128(reinterpret_cast<__m128i*>(values + i), value);
+				digits |= uint64_t(uint16_t(_mm_movemask_epi8(mask))) << i;
+			}
+		}
+
+		/**
+		 * @return The number of the digits from @offset.
+		 */
+		inline unsigned run(size_t offset) const noexcept {
+			return unsigned(__builtin_ctzll(~(digits >> offset)));
+		}
+	};
+
+	/**
+	 * An optional "/<prefix>" at @offset.
+	 * @return The offset after it, 0 - a broken or too long prefix.
+	 */
+	static size_t parse_prefix(std::string_view arg, size_t offset, unsigned limit, unsigned& prefix) noexcept {
+		if(offset >= arg.size() || arg[offset] != '/') {
+			return offset;
+		}
+		offset++;
+		const size_t read = utils::Types::parse_digits(arg.substr(offset, 4), prefix);
+		if(read == 0 || read > 3 || prefix > limit) {
+			return 0;
+		}
+		return offset + read;
+	}
+
+};
+
+}; // namespace cli
@@ -3,12 +3,15 @@
 #include <cstdlib>
 #include <cstdint>
 #include <cstdio>
-#include <cctype>
+#include <cstring>
+#include <string_view>
+#include <sys/types.h>
 
 namespace cli {
 
 struct MacAddress {
 	static constexpr size_t ADDR_SIZE = 6;
+	static constexpr size_t MAX_STRING = ADDR_SIZE * 3; // the digits and the separators
 	using ADDR_TYPE = uint8_t;
 
 	ADDR_TYPE addr[ADDR_SIZE];
@@ -71,21 +74,29 @@ struct MacAddress {
 		}
 	}
 
-	ssize_t parse(const char* str) noexcept {
+	/**
+	 * 6 bytes of 1 or 2 hex digits, each one may be followed by '.', ':' or '-'.
+	 * @return The parsed length or -1.
+	 */
+	ssize_t parse(std::string_view str) noexcept {
 		size_t offset = 0;
 		for(size_t i = 0; i < ADDR_SIZE; ++i) {
-			uint64_t acc = 0;
-			size_t read = read_hex_byte(str + offset, acc);
-			if(read == 0){
+			const int high = hex(str, offset);
+			if(high < 0) {
 				return -1;
 			}
-			offset += read;
-			addr[i] = acc;
-			if(str[offset] == '.' || str[offset] == ':'){
+			const int low = hex(str, ++offset);
+			offset += (low >= 0) ? 1 : 0;
+			addr[i] = ADDR_TYPE(low >= 0 ? (high << 4) | low : high);
+			if(offset < str.size() && (str[offset] == '.' || str[offset] == ':' || str[offset] == '-')) {
 				offset++;
 			}
 		}
-		return offset;
+		return ssize_t(offset);
+	}
+
+	ssize_t parse(const char* str) noexcept {
+		return parse(std::string_view(str, strnlen(str, MAX_STRING)));
 	}
 
 	template <typename T>
@@ -99,26 +110,24 @@ struct MacAddress {
 
 private:
 
-	static size_t read_hex(const char* str, uint64_t& acc) noexcept {
-		int ch = tolower(str[0]);
-		if(isxdigit(ch)){
-			if(ch >= '0' && ch <= '9'){
-				acc <<= 4;
-				acc |= (ch - '0');
-				return 1;
-			}
-			if(ch >= 'a' && ch <= 'f'){
-				acc <<= 4;
-				acc |= ch - 'a' + 10;
-				return 1;
+	struct HexDigits {
+		int8_t values[256];
+
+		constexpr HexDigits() noexcept : values() {
+			for(int ch = 0; ch < 256; ++ch) {
+				const int lower = ch | 0x20;
+				values[ch] = int8_t((ch >= '0' && ch <= '9') ? ch - '0' : ((lower >= 'a' && lower <= 'f') ? lower - 'a' + 10 : -1));
 			}
 		}
-		return 0;
-	}
-
-	static size_t read_hex_byte(const char* str, uint64_t& acc) noexcept {
-		size_t offset = read_hex(str, acc);
-		return offset + read_hex(str + offset, acc);
+	};
+
+	/**
+	 * A table, the digits and the letters are random in the addresses and a compare would mispredict.
+	 * @return The value of the hex digit at @offset, -1 - there is none.
+	 */
+	static int hex(std::string_view str, size_t offset) noexcept {
+		static constexpr HexDigits digits;
+		return offset < str.size() ? digits.values[uint8_t(str[offset])] : -1;
 	}
 
 };
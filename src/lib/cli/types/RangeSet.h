@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Integer.h"
+#include "../../containers/bits/RoaringBitmap.h"
 
 #include <vector>
 #include <cstdint>
@@ -13,6 +14,9 @@ namespace cli {
 
 /**
  * [item[-item][,item[-item][,...]]]
+ *
+ * The items are kept in a std::set, parse(arg, bitmap) and to_bitmap() give a RoaringBitmap
+ * where a range costs 4 bytes instead of a set node per item.
  */
 struct RangeSet {
 	using ITEM_TYPE = uint32_t;
@@ -28,6 +32,53 @@ struct RangeSet {
 
 	ssize_t parse(const char* arg) noexcept {
 		items.clear();
+		return parse_ranges(arg, [this](ITEM_TYPE first, ITEM_TYPE last) {
+			for(ITEM_TYPE i = first; ; ++i) {
+				items.insert(i);
+				if(i == last) {
+					break;
+				}
+			}
+		});
+	}
+
+	/**
+	 * Parse the list straight into a bitmap, the ranges are not expanded.
+	 * @return The parsed length or -1.
+	 */
+	static ssize_t parse(const char* arg, RoaringBitmap& bitmap) noexcept {
+		bitmap.clear();
+		const ssize_t result = parse_ranges(arg, [&bitmap](ITEM_TYPE first, ITEM_TYPE last) {
+			bitmap.add_range(first, last);
+		});
+		bitmap.run_optimize();
+		return result;
+	}
+
+	/**
+	 * Build a bitmap of the items, the consecutive items become runs.
+	 */
+	void to_bitmap(RoaringBitmap& bitmap) const noexcept {
+		bitmap.clear();
+		auto it = items.begin();
+		while(it != items.end()) {
+			const ITEM_TYPE first = *it;
+			ITEM_TYPE last = first;
+			for(++it; it != items.end() && *it == last + 1u; ++it) {
+				last = *it;
+			}
+			bitmap.add_range(first, last);
+		}
+		bitmap.run_optimize();
+	}
+
+private:
+
+	/**
+	 * @param add - add(first, last) is called for every item or range.
+	 */
+	template <typename Add>
+	static ssize_t parse_ranges(const char* arg, Add&& add) noexcept {
 		enum State : unsigned {
 			WF_PAIR, WF_FIRST, WF_SECOND, WF_DELIM, END, ERR
 		};
@@ -53,14 +104,14 @@ struct RangeSet {
 					const char ch = arg[offset++];
 					switch(ch) {
 						case DELIM:
-							items.insert(item);
+							add(item, item);
 							state = WF_PAIR;
 							break;
 						case RANGE:
 							state = WF_SECOND;
 							break;
 						default:
-							items.insert(item);
+							add(item, item);
 							state = END;
 							break;
 					}
@@ -70,9 +121,7 @@ struct RangeSet {
 				case WF_SECOND: {
 					const size_t read = Integer::parse_offset(arg + offset, item_range, 10);
 					if(read && item_range >= item) {
-						for(ITEM_TYPE i = item; i <= item_range; ++i) {
-							items.insert(i);
-						}
+						add(item, item_range);
 						offset += read;
 						state = WF_DELIM;
 					} else {
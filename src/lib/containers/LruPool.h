@@ -1,7 +1,8 @@
 #pragma once
 
-#include <lib/intrusive/LinkedList.h>
-#include <lib/intrusive/HashMap.h>
+#include "../intrusive/LinkedList.h"
+#include "../intrusive/HashMap.h"
+#include "../utils/ContainerStat.h"
 
 #include <memory>
 
@@ -9,10 +10,14 @@ class TestUtilsLruPool;
 
 namespace utils {
 
+/**
+ * With Stats = true the map counts the lookups, the probes, the links and the removals, acquire() the evictions.
+ */
 template<
 	typename K,
 	typename V,
-	typename H = std::hash<K>
+	typename H = std::hash<K>,
+	bool Stats = false
 >
 class LruPool {
 
@@ -20,9 +25,8 @@ class LruPool {
 
 public:
 
-	struct Item {
-		intrusive::HashMapHook<K, Item> __ihm[1u];
-		intrusive::LinkedListHook<Item> __ill[2u];
+	struct Item : public intrusive::HashMapHook<K, Item> {
+		intrusive::LinkedListHook<Item> __ill;
 		V __value;
 		bool __is_acquired;
 
@@ -31,7 +35,7 @@ public:
 		}
 
 		const K& key() const {
-			return __ihm[0].key;
+			return this->im_key;
 		}
 
 		const V& value() const {
@@ -51,8 +55,8 @@ private:
 
 	using Allocator_t = std::allocator<Item>;
 
-	using List_t = intrusive::LinkedList<Item, 1u>;
-	using Map_t = intrusive::HashMap<K, Item, 0, 0, H>;
+	using List_t = intrusive::LinkedList<Item>;
+	using Map_t = intrusive::HashMap<K, Item, H, std::allocator<intrusive::HashMapBucket<Item> >, Stats>;
 
 	size_t _capacity;
 	Allocator_t _allocator;
@@ -60,6 +64,7 @@ private:
 	Map_t _map;
 	List_t _list_used;
 	List_t _list_freed;
+	utils::StatCounter<Stats> _counter;
 
 public:
 	using Iterator_t = typename List_t::Iterator_t;
@@ -71,11 +76,13 @@ public:
 		_storage(_allocator.allocate(_capacity)),
 		_map(size_t(capacity / load_factor) + 1u),
 		_list_used(),
-		_list_freed()
+		_list_freed(),
+		_counter()
 	{
 		for(size_t i = 0; i < _capacity; i++) {
 			_allocator.construct(_storage + i);
 		}
+		_map.allocate();
 		reset();
 	}
 
@@ -95,18 +102,19 @@ public:
 		auto it = _map.find(key);
 		if(it != _map.end()) {
 			result = it.get();
-			_list_used.remove(result);
+			_list_used.remove(*result);
 		} else {
 			if(_list_freed.size() > 0) {
 				result = _list_freed.pop_front();
 			} else {
 				result = _list_used.pop_front();
-				_map.remove(result);
+				_map.remove(*result);
+				_counter.evict();
 			}
-			_map.insert(key, result);
+			_map.link(key, *result);
 			result->__is_acquired = true;
 		}
-		_list_used.push_back(result);
+		_list_used.push_back(*result);
 		return result;
 	}
 
@@ -114,9 +122,9 @@ public:
 	 * @param value - MUST NOT BE nullptr;
 	*/
 	void release(Item* item) {
-		_map.remove(item);
-		_list_used.remove(item);
-		_list_freed.push_front(item);
+		_map.remove(*item);
+		_list_used.remove(*item);
+		_list_freed.push_front(*item);
 		item->__is_acquired = false;
 	}
 
@@ -150,7 +158,7 @@ public:
 		_list_freed.clear();
 		for(size_t i = 0; i < _capacity; i++) {
 			const auto item = _storage + i;
-			_list_freed.push_back(item);
+			_list_freed.push_back(*item);
 			item->__is_acquired = false;
 		}
 	}
@@ -167,6 +175,14 @@ public:
 		return _list_used.size();
 	}
 
+	utils::ContainerStat stat() const noexcept {
+		utils::ContainerStat result = _map.stat();
+		result.add(_counter.stat());
+		result.capacity = _capacity;
+		result.size = size();
+		return result;
+	}
+
 private:
 
 	void destroy() {
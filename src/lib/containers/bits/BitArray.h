@@ -3,9 +3,13 @@
 #include <cstdlib>
 #include <cstdint>
 #include <cassert>
+#include <type_traits>
+#include <immintrin.h>
+
+#include "../../utils/Cpu.h"
 
 /**
- * Header-only. No dependencies.
+ * Header-only. Depends on utils/Cpu.h to select the BMI2/AVX2 bulk paths at run time.
  *
  * BitArray template class implements an array of bits sized unsigned integer variables called Items.
  * Items are packed in a Chunk array with no bit gaps between them,
@@ -25,6 +29,12 @@
  *           2 |i5:1 |i5:0 |i6:2 |i6:1 |i6:0 |i7:2 |i7:1 |i7:0 |
  * 			...
  *
+ * load_range(), store_range() and fill() work on whole chunks instead of single items:
+ * - the widths which divide the chunk width never split an item, so the chunks are
+ *   unpacked with compile-time shifts;
+ * - widths up to 16 bits on 64-bit chunks unpack 8 (4) items at once with BMI2 pdep
+ *   into byte (word) lanes and widen them with AVX2;
+ * - the rest streams the chunks through a double width bit buffer.
  */
 
 template<uint8_t BitWidth, typename Chunk = uint64_t>
@@ -42,6 +52,22 @@ class BitArray {
 	static constexpr size_t ITEM_CAPACITY_MIN = 1ull;
 	static constexpr size_t ITEM_CAPACITY_MAX = (~(0ull)) / CHUNK_BIT_WIDTH;
 
+	// the chunk pattern of a filled array repeats every PERIOD_CHUNKS chunks (PERIOD_ITEMS items)
+	static constexpr size_t gcd(size_t a, size_t b) noexcept {
+		return b ? gcd(b, a % b) : a;
+	}
+	static constexpr size_t PERIOD_CHUNKS = BitWidth / gcd(BitWidth, CHUNK_BIT_WIDTH);
+	static constexpr size_t PERIOD_ITEMS = CHUNK_BIT_WIDTH / gcd(BitWidth, CHUNK_BIT_WIDTH);
+
+	// the pdep lane width: 8 items per 64 bits in bytes or 4 items in words, zero if not applicable
+	static constexpr Width_t PDEP_LANE_BITS = std::is_same_v<Chunk, uint64_t>
+		? (BitWidth <= 8 ? 8 : (BitWidth <= 16 ? 16 : 0)) : 0;
+
+	static constexpr Chunk ITEM_MASK = Chunk(~((~0ull) << BitWidth));
+
+	// the bit buffer of the streaming paths holds up to two chunks
+	using Buffer_t = std::conditional_t<(CHUNK_BIT_WIDTH <= 32), uint64_t, unsigned __int128>;
+
 	Chunk* m_chunks = nullptr;
 	size_t m_capacity = 0;
 	bool m_internal_mem = false;
@@ -150,14 +176,72 @@ public:
 		}
 	}
 
+	/**
+	 * Load @count items starting from @first item.
+	 * @param first - the first item index.
+	 * @param count - the number of items, @first + @count MUST NOT exceed capacity().
+	 * @param dst - an array of @count values to load to.
+	 */
+	void load_range(size_t first, size_t count, Chunk* dst) const noexcept {
+		assert(first + count <= m_capacity);
+		if constexpr (PDEP_LANE_BITS) {
+			if(utils::Cpu::bmi2() && utils::Cpu::avx2()) {
+				const size_t done = load_range_pdep(first, count, dst);
+				first += done;
+				count -= done;
+				dst += done;
+			}
+		}
+		if constexpr (CHUNK_BIT_WIDTH % BitWidth == 0) {
+			load_range_aligned(first, count, dst);
+		} else {
+			load_range_stream(first, count, dst);
+		}
+	}
+
+	/**
+	 * Store @count items starting from @first item.
+	 * @param first - the first item index.
+	 * @param count - the number of items, @first + @count MUST NOT exceed capacity().
+	 * @param src - an array of @count values, every value MUST be in [0:range() - 1] range.
+	 */
+	void store_range(size_t first, size_t count, const Chunk* src) noexcept {
+		assert(first + count <= m_capacity);
+		if constexpr (PDEP_LANE_BITS) {
+			if(utils::Cpu::bmi2() && utils::Cpu::avx2()) {
+				const size_t done = store_range_pext(first, count, src);
+				first += done;
+				count -= done;
+				src += done;
+			}
+		}
+		if constexpr (CHUNK_BIT_WIDTH % BitWidth == 0) {
+			store_range_aligned(first, count, src);
+		} else {
+			store_range_stream(first, count, src);
+		}
+	}
+
 	/**
 	 * Fill the array with given value @value.
+	 * The chunks repeat every BitWidth / gcd(BitWidth, CHUNK_BIT_WIDTH) chunks,
+	 * so only the first period is packed item by item.
 	 * @param value - value to fill with.
 	 */
 	void fill(Chunk value) noexcept {
-		for(size_t i = 0; i < m_capacity; ++i) {
+		const size_t chunks_nb = chunk_count();
+		if(m_capacity < PERIOD_ITEMS || chunks_nb < PERIOD_CHUNKS) {
+			for(size_t i = 0; i < m_capacity; ++i) {
+				store(i, value);
+			}
+			return;
+		}
+		for(size_t i = 0; i < PERIOD_ITEMS; ++i) {
 			store(i, value);
 		}
+		for(size_t i = PERIOD_CHUNKS; i < chunks_nb; ++i) {
+			m_chunks[i] = m_chunks[i - PERIOD_CHUNKS];
+		}
 	}
 
 	/**
@@ -222,4 +306,169 @@ private:
 		return bits_to_store;
 	}
 
+	/**
+	 * @return The number of chunks the items occupy.
+	 */
+	inline size_t chunk_count() const noexcept {
+		return (m_capacity * BitWidth + CHUNK_BIT_WIDTH - 1u) / CHUNK_BIT_WIDTH;
+	}
+
+	void load_range_aligned(size_t first, size_t count, Chunk* dst) const noexcept {
+		constexpr size_t ITEMS = CHUNK_BIT_WIDTH / BitWidth;
+		// the head and the tail items share chunks with the items out of the range
+		while(count && first % ITEMS) {
+			*dst++ = load(first++);
+			count--;
+		}
+		const Chunk* chunk = m_chunks + first / ITEMS;
+		for(; count >= ITEMS; count -= ITEMS) {
+			const Chunk value = *chunk++;
+			for(size_t i = 0; i < ITEMS; ++i) {
+				*dst++ = Chunk(value >> (CHUNK_BIT_WIDTH - BitWidth * (i + 1u))) & ITEM_MASK;
+			}
+			first += ITEMS;
+		}
+		while(count--) {
+			*dst++ = load(first++);
+		}
+	}
+
+	void store_range_aligned(size_t first, size_t count, const Chunk* src) noexcept {
+		constexpr size_t ITEMS = CHUNK_BIT_WIDTH / BitWidth;
+		while(count && first % ITEMS) {
+			store(first++, *src++);
+			count--;
+		}
+		Chunk* chunk = m_chunks + first / ITEMS;
+		for(; count >= ITEMS; count -= ITEMS) {
+			Chunk value = 0;
+			for(size_t i = 0; i < ITEMS; ++i) {
+				value = Chunk(value << BitWidth) | (*src++ & ITEM_MASK);
+			}
+			*chunk++ = value;
+			first += ITEMS;
+		}
+		while(count--) {
+			store(first++, *src++);
+		}
+	}
+
+	void load_range_stream(size_t first, size_t count, Chunk* dst) const noexcept {
+		if(not count) {
+			return;
+		}
+		const size_t bit_index = first * BitWidth;
+		const Chunk* chunk = m_chunks + bit_index / CHUNK_BIT_WIDTH;
+		// the buffer keeps @bits valid bits at its bottom, the bits above them are garbage
+		Width_t bits = Width_t(CHUNK_BIT_WIDTH - bit_index % CHUNK_BIT_WIDTH);
+		Buffer_t buffer = *chunk++;
+		while(count--) {
+			if(bits < BitWidth) {
+				buffer = (buffer << CHUNK_BIT_WIDTH) | *chunk++;
+				bits += CHUNK_BIT_WIDTH;
+			}
+			bits -= BitWidth;
+			*dst++ = Chunk(buffer >> bits) & ITEM_MASK;
+		}
+	}
+
+	void store_range_stream(size_t first, size_t count, const Chunk* src) noexcept {
+		if(not count) {
+			return;
+		}
+		const size_t bit_index = first * BitWidth;
+		Chunk* chunk = m_chunks + bit_index / CHUNK_BIT_WIDTH;
+		// start with the bits of the first chunk which precede the range
+		Width_t bits = Width_t(bit_index % CHUNK_BIT_WIDTH);
+		Buffer_t buffer = bits ? Buffer_t(*chunk >> (CHUNK_BIT_WIDTH - bits)) : 0;
+		while(count--) {
+			buffer = (buffer << BitWidth) | (*src++ & ITEM_MASK);
+			bits += BitWidth;
+			if(bits >= CHUNK_BIT_WIDTH) {
+				bits -= CHUNK_BIT_WIDTH;
+				*chunk++ = Chunk(buffer >> bits);
+			}
+		}
+		if(bits) {
+			// keep the bits of the last chunk which follow the range
+			const Chunk keep = Chunk(~Chunk(0)) >> bits;
+			*chunk = Chunk((*chunk & keep) | Chunk(buffer << (CHUNK_BIT_WIDTH - bits)));
+		}
+	}
+
+	/**
+	 * Unpack groups of 64 / PDEP_LANE_BITS items while the group fits into the array chunks.
+	 * @return The number of items loaded.
+	 */
+	__attribute__((target("bmi2,avx2")))
+	size_t load_range_pdep(size_t first, size_t count, Chunk* dst) const noexcept {
+		constexpr size_t LANES = 64u / PDEP_LANE_BITS;
+		constexpr Width_t GROUP_BITS = Width_t(LANES * BitWidth);
+		constexpr uint64_t LANE_MASK = (PDEP_LANE_BITS == 8 ? 0x0101010101010101ull : 0x0001000100010001ull) * ITEM_MASK;
+		const size_t chunks_nb = chunk_count();
+		size_t bit_index = first * BitWidth;
+		size_t done = 0;
+		// the window reads two chunks
+		for(; done + LANES <= count && bit_index / 64u + 1u < chunks_nb; done += LANES, bit_index += GROUP_BITS) {
+			const uint64_t* chunk = m_chunks + bit_index / 64u;
+			const unsigned offset = bit_index % 64u;
+			const uint64_t window = offset ? (chunk[0] << offset) | (chunk[1] >> (64u - offset)) : chunk[0];
+			uint64_t lanes = _pdep_u64(window >> (64u - GROUP_BITS), LANE_MASK);
+			// the first item is at the top, reverse the lanes
+			lanes = __builtin_bswap64(lanes);
+			if constexpr (PDEP_LANE_BITS == 8) {
+				const __m128i bytes = _mm_cvtsi64_si128(int64_t(lanes));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + done), _mm256_cvtepu8_epi64(bytes));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + done + 4u), _mm256_cvtepu8_epi64(_mm_srli_si128(bytes, 4)));
+			} else {
+				// bswap reversed the bytes inside the words as well
+				lanes = ((lanes >> 8u) & 0x00FF00FF00FF00FFull) | ((lanes & 0x00FF00FF00FF00FFull) << 8u);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + done), _mm256_cvtepu16_epi64(_mm_cvtsi64_si128(int64_t(lanes))));
+			}
+		}
+		return done;
+	}
+
+	/**
+	 * Pack groups of 64 / PDEP_LANE_BITS items while the group fits into the array chunks.
+	 * @return The number of items stored.
+	 */
+	__attribute__((target("bmi2,avx2")))
+	size_t store_range_pext(size_t first, size_t count, const Chunk* src) noexcept {
+		constexpr size_t LANES = 64u / PDEP_LANE_BITS;
+		constexpr Width_t GROUP_BITS = Width_t(LANES * BitWidth);
+		constexpr uint64_t LANE_MASK = (PDEP_LANE_BITS == 8 ? 0x0101010101010101ull : 0x0001000100010001ull) * ITEM_MASK;
+		constexpr uint64_t GROUP_MASK = GROUP_BITS == 64 ? ~0ull : ~((~0ull) >> GROUP_BITS);
+		const __m256i even_dwords = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+		const size_t chunks_nb = chunk_count();
+		size_t bit_index = first * BitWidth;
+		size_t done = 0;
+		for(; done + LANES <= count && bit_index / 64u + 1u < chunks_nb; done += LANES, bit_index += GROUP_BITS) {
+			// narrow the values to the lanes: the first item goes to the lowest lane
+			const __m256i lo = _mm256_permutevar8x32_epi32(
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + done)), even_dwords);
+			uint64_t lanes;
+			if constexpr (PDEP_LANE_BITS == 8) {
+				const __m256i hi = _mm256_permutevar8x32_epi32(
+					_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + done + 4u)), even_dwords);
+				const __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(lo), _mm256_castsi256_si128(hi));
+				lanes = uint64_t(_mm_cvtsi128_si64(_mm_packus_epi16(words, words)));
+				lanes = __builtin_bswap64(lanes);
+			} else {
+				const __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(lo), _mm256_castsi256_si128(lo));
+				lanes = __builtin_bswap64(uint64_t(_mm_cvtsi128_si64(words)));
+				lanes = ((lanes >> 8u) & 0x00FF00FF00FF00FFull) | ((lanes & 0x00FF00FF00FF00FFull) << 8u);
+			}
+			// the group bits aligned to the top
+			const uint64_t group = _pext_u64(lanes, LANE_MASK) << (64u - GROUP_BITS);
+			uint64_t* chunk = m_chunks + bit_index / 64u;
+			const unsigned offset = bit_index % 64u;
+			chunk[0] = (chunk[0] & ~(GROUP_MASK >> offset)) | (group >> offset);
+			if(offset + GROUP_BITS > 64u) {
+				chunk[1] = (chunk[1] & ~(GROUP_MASK << (64u - offset))) | (group << (64u - offset));
+			}
+		}
+		return done;
+	}
+
 };
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstdint>
+#include <cassert>
+#include <atomic>
+#include <x86intrin.h>
+
+/**
+ * Header-only. No dependencies.
+ *
+ * BitArrayAtomic template class is a concurrent view of the packed items of BitArray (MSB_FIRST layout)
+ * or BitArrayT (LSB_FIRST layout): store(), fetch_add() and compare_exchange() of an item
+ * are atomic and never corrupt the neighbouring items sharing the same chunk.
+ *
+ * An item which fits into a single chunk is updated with a CAS loop on that chunk.
+ * An item which straddles two chunks can't be updated with a single CAS, so all the operations
+ * on it (including load()) are serialized with a spin lock picked from a small striped table
+ * by the first chunk index, and each of the two chunks is still updated with a CAS loop
+ * because the other items of the chunks are changed concurrently.
+ * The widths which divide the chunk width never straddle, so they never lock.
+ *
+ * The memory may be shared with a BitArray/BitArrayT instance of the same width, chunk and layout
+ * (see allocate(buffer, buffer_bytes)) to use its bulk operations while no writer is active.
+ *
+ * Using sample (a shared counting table of 4-bit saturating counters):
+ * BitArrayAtomic<4> counters;
+ * counters.allocate(1 << 30);
+ * counters.fill(0);
+ * // any thread
+ * counters.fetch_add(hash % counters.capacity(), 1);
+ */
+
+enum class BitArrayLayout {
+	MSB_FIRST, // BitArray: the first item occupies the most significant bits of a chunk
+	LSB_FIRST  // BitArrayT: the first item occupies the least significant bits of a chunk
+};
+
+template<uint8_t BitWidth, typename Chunk = uint64_t, BitArrayLayout Layout = BitArrayLayout::MSB_FIRST>
+class BitArrayAtomic {
+
+	using Width_t = uint8_t;
+
+	static constexpr Width_t CHUNK_BYTE_WIDTH = sizeof(Chunk);
+	static constexpr Width_t CHUNK_BIT_WIDTH = CHUNK_BYTE_WIDTH << 3ull;
+	static constexpr Width_t BIT_WIDTH_MIN = 1u;
+	static constexpr Width_t BIT_WIDTH_MAX = CHUNK_BIT_WIDTH - 1u;
+	static constexpr size_t CHUNK_CAPACITY_MIN = 1ull;
+	static constexpr size_t CHUNK_CAPACITY_MAX = (~(0ull)) / CHUNK_BIT_WIDTH;
+	static constexpr size_t ITEM_CAPACITY_MIN = 1ull;
+	static constexpr size_t ITEM_CAPACITY_MAX = (~(0ull)) / CHUNK_BIT_WIDTH;
+	static constexpr bool NEVER_STRADDLE = (CHUNK_BIT_WIDTH % BitWidth) == 0;
+	static constexpr Chunk ITEM_MASK = Chunk(~((~0ull) << BitWidth));
+	static constexpr size_t LOCK_STRIPES = 64;
+
+	struct alignas(64) Lock {
+		std::atomic_flag flag = ATOMIC_FLAG_INIT;
+
+		inline void lock() noexcept {
+			while(flag.test_and_set(std::memory_order_acquire)) {
+				_mm_pause();
+			}
+		}
+
+		inline void unlock() noexcept {
+			flag.clear(std::memory_order_release);
+		}
+	};
+
+	/**
+	 * The item position: a single chunk part or two parts of adjacent chunks.
+	 */
+	struct Place {
+		Chunk* chunk;
+		Width_t shift[2];  // the LSB position of the part inside the chunk
+		Width_t bits[2];   // bits[1] == 0 if the item fits into a single chunk
+	};
+
+	Chunk* m_chunks = nullptr;
+	size_t m_capacity = 0;
+	bool m_internal_mem = false;
+	mutable Lock m_locks[LOCK_STRIPES];
+
+public:
+	BitArrayAtomic(const BitArrayAtomic&) = delete;
+	BitArrayAtomic(BitArrayAtomic&&) = delete;
+
+	BitArrayAtomic& operator=(const BitArrayAtomic&) = delete;
+	BitArrayAtomic& operator=(BitArrayAtomic&&) = delete;
+
+	BitArrayAtomic() noexcept = default;
+
+	~BitArrayAtomic() noexcept {
+		destroy();
+	}
+
+	/**
+	 * Create a BitArrayAtomic instance using an external memory space.
+	 * @param buffer - An external memory array. MUST NOT be NULL and MUST be aligned to the chunk size.
+	 * @param buffer_bytes - Size of @buffer in bytes.
+ 	*/
+	void allocate(void* buffer, const size_t buffer_bytes) noexcept {
+		static_assert(BitWidth >= BIT_WIDTH_MIN, "Template argument 'Width' must be greater than BIT_WIDTH_MIN.");
+		static_assert(BitWidth <= BIT_WIDTH_MAX, "Template argument 'Width' must be less than BIT_WIDTH_MAX.");
+		static_assert(Layout == BitArrayLayout::MSB_FIRST || sizeof(Chunk) == sizeof(uint64_t), "BitArrayT uses 64-bit chunks.");
+		const size_t chunk_capacity = buffer_bytes / CHUNK_BYTE_WIDTH;
+
+		assert(m_chunks == nullptr);
+		assert(buffer);
+		assert(reinterpret_cast<uintptr_t>(buffer) % alignof(Chunk) == 0);
+		assert(chunk_capacity >= CHUNK_CAPACITY_MIN);
+		assert(chunk_capacity <= CHUNK_CAPACITY_MAX);
+
+		m_chunks = reinterpret_cast<Chunk*>(buffer);
+		m_capacity = chunk_capacity * CHUNK_BIT_WIDTH / BitWidth;
+	}
+
+	/**
+	 * Create a BitArrayAtomic instance using its own memory space.
+	 * @param item_capacity - BitArrayAtomic size in items. MUST be greater than zero.
+	 */
+	void allocate(size_t item_capacity) noexcept {
+		static_assert(BitWidth >= BIT_WIDTH_MIN, "Template argument 'Width' must be greater than BIT_WIDTH_MIN.");
+		static_assert(BitWidth <= BIT_WIDTH_MAX, "Template argument 'Width' must be less than BIT_WIDTH_MAX.");
+		static_assert(Layout == BitArrayLayout::MSB_FIRST || sizeof(Chunk) == sizeof(uint64_t), "BitArrayT uses 64-bit chunks.");
+
+		assert(m_chunks == nullptr);
+		assert(item_capacity >= ITEM_CAPACITY_MIN);
+		assert(item_capacity <= ITEM_CAPACITY_MAX);
+
+		const size_t bit_capacity = (BitWidth * item_capacity);
+		size_t chunk_capacity = bit_capacity / CHUNK_BIT_WIDTH;
+		chunk_capacity += (bit_capacity % CHUNK_BIT_WIDTH) ? 1u : 0u;
+		m_chunks = new Chunk[chunk_capacity]();
+		assert(m_chunks);
+		m_capacity = chunk_capacity * CHUNK_BIT_WIDTH / BitWidth;
+		m_internal_mem = true;
+	}
+
+	void destroy() noexcept {
+		if(m_internal_mem && m_chunks) {
+			delete[] m_chunks;
+		}
+		m_chunks = nullptr;
+		m_capacity = 0;
+		m_internal_mem = false;
+	}
+
+	/**
+	 * @return The array capacity in items.
+	 */
+	inline size_t capacity() const noexcept {
+		return m_capacity;
+	}
+
+	/**
+	 * Fill the array with given value @value.
+	 * Not atomic: there MUST be no concurrent writers.
+	 * @param value - value to fill with.
+	 */
+	void fill(Chunk value) noexcept {
+		for(size_t i = 0; i < m_capacity; ++i) {
+			store(i, value);
+		}
+	}
+
+	/**
+	 * Load @item_index item atomically.
+	 * @param item_index - MUST be in [0:capacity() - 1] range.
+	 * @return - a loaded value in [0:range() - 1] range.
+	 */
+	Chunk load(size_t item_index) const noexcept {
+		const Place place = locate(item_index);
+		if(NEVER_STRADDLE || not place.bits[1]) {
+			return Chunk(load_chunk(place.chunk) >> place.shift[0]) & ITEM_MASK;
+		}
+		Lock& lock = stripe(place);
+		lock.lock();
+		const Chunk value = join(place, load_chunk(place.chunk), load_chunk(place.chunk + 1));
+		lock.unlock();
+		return value;
+	}
+
+	/**
+	 * Store @value to the @item_index'th index atomically.
+	 * @param item_index - MUST be in [0:capacity() - 1] range.
+	 * @param value - MUST be in [0:range() - 1] range.
+	 */
+	void store(size_t item_index, Chunk value) noexcept {
+		update(item_index, [value](Chunk) {
+			return value;
+		});
+	}
+
+	/**
+	 * Add @delta to the @item_index'th item atomically, the result saturates at value_max().
+	 * @param item_index - MUST be in [0:capacity() - 1] range.
+	 * @param delta - the value to add.
+	 * @return - the previous value.
+	 */
+	Chunk fetch_add(size_t item_index, Chunk delta) noexcept {
+		return update(item_index, [delta](Chunk value) {
+			return delta >= value_max() - value ? value_max() : Chunk(value + delta);
+		});
+	}
+
+	/**
+	 * Replace the @item_index'th item with @desired if it is equal to @expected.
+	 * @param item_index - MUST be in [0:capacity() - 1] range.
+	 * @param expected - the expected value, receives the actual value on failure.
+	 * @param desired - the new value, MUST be in [0:range() - 1] range.
+	 * @return true - if the item has been replaced.
+	 */
+	bool compare_exchange(size_t item_index, Chunk& expected, Chunk desired) noexcept {
+		const Chunk wanted = expected;
+		expected = update(item_index, [wanted, desired](Chunk value) {
+			return value == wanted ? desired : value;
+		});
+		return expected == wanted;
+	}
+
+	/**
+	 * The range limit of the item which the template can contain.
+	 */
+	static constexpr Chunk range() noexcept {
+		return Chunk(1ull << BitWidth);
+	}
+
+	/**
+	 * The maximum value that the template can contain.
+	 */
+	static constexpr Chunk value_max() noexcept {
+		return ITEM_MASK;
+	}
+
+private:
+
+	static inline Chunk load_chunk(const Chunk* chunk) noexcept {
+		return __atomic_load_n(chunk, __ATOMIC_ACQUIRE);
+	}
+
+	inline Lock& stripe(const Place& place) const noexcept {
+		return m_locks[size_t(place.chunk - m_chunks) % LOCK_STRIPES];
+	}
+
+	inline Place locate(size_t item_index) const noexcept {
+		assert(item_index < m_capacity);
+		const size_t bit_index = item_index * BitWidth;
+		const auto offset = Width_t(bit_index % CHUNK_BIT_WIDTH);
+		Place place;
+		place.chunk = m_chunks + bit_index / CHUNK_BIT_WIDTH;
+		if(NEVER_STRADDLE || offset + BitWidth <= CHUNK_BIT_WIDTH) {
+			place.bits[0] = BitWidth;
+			place.bits[1] = 0;
+			place.shift[0] = Layout == BitArrayLayout::MSB_FIRST ? Width_t(CHUNK_BIT_WIDTH - offset - BitWidth) : offset;
+			place.shift[1] = 0;
+			return place;
+		}
+		place.bits[0] = Width_t(CHUNK_BIT_WIDTH - offset);
+		place.bits[1] = Width_t(BitWidth - place.bits[0]);
+		// both layouts keep the high bits of the item in the first chunk
+		if constexpr (Layout == BitArrayLayout::MSB_FIRST) {
+			place.shift[0] = 0;
+			place.shift[1] = Width_t(CHUNK_BIT_WIDTH - place.bits[1]);
+		} else {
+			place.shift[0] = offset;
+			place.shift[1] = 0;
+		}
+		return place;
+	}
+
+	static inline Chunk part_mask(Width_t bits) noexcept {
+		return Chunk(~((~0ull) << bits));
+	}
+
+	static inline Chunk join(const Place& place, Chunk first, Chunk second) noexcept {
+		const Chunk part0 = Chunk(first >> place.shift[0]) & part_mask(place.bits[0]);
+		const Chunk part1 = Chunk(second >> place.shift[1]) & part_mask(place.bits[1]);
+		return Chunk(part0 << place.bits[1]) | part1;
+	}
+
+	/**
+	 * Replace @bits bits at @shift of the chunk with @value keeping the other bits.
+	 */
+	static inline void replace(Chunk* chunk, Width_t shift, Width_t bits, Chunk value) noexcept {
+		const Chunk mask = Chunk(part_mask(bits) << shift);
+		Chunk expected = load_chunk(chunk);
+		Chunk desired;
+		do {
+			desired = Chunk((expected & ~mask) | (Chunk(value << shift) & mask));
+		} while(not __atomic_compare_exchange_n(chunk, &expected, desired, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+	}
+
+	/**
+	 * Apply @func to the item atomically.
+	 * @param func - Chunk(Chunk old_value) returns the new value.
+	 * @return The old value.
+	 */
+	template <typename Func>
+	Chunk update(size_t item_index, Func&& func) noexcept {
+		const Place place = locate(item_index);
+		if(NEVER_STRADDLE || not place.bits[1]) {
+			const Chunk mask = Chunk(ITEM_MASK << place.shift[0]);
+			Chunk expected = load_chunk(place.chunk);
+			Chunk old_value;
+			Chunk desired;
+			do {
+				old_value = Chunk(expected >> place.shift[0]) & ITEM_MASK;
+				const Chunk new_value = func(old_value);
+				if(new_value == old_value) {
+					break;
+				}
+				desired = Chunk((expected & ~mask) | (Chunk(new_value << place.shift[0]) & mask));
+			} while(not __atomic_compare_exchange_n(place.chunk, &expected, desired, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+			return old_value;
+		}
+
+		// the item's bits are changed under the lock only, so the value is stable while it is held
+		Lock& lock = stripe(place);
+		lock.lock();
+		const Chunk old_value = join(place, load_chunk(place.chunk), load_chunk(place.chunk + 1));
+		const Chunk new_value = func(old_value) & ITEM_MASK;
+		if(new_value != old_value) {
+			replace(place.chunk, place.shift[0], place.bits[0], Chunk(new_value >> place.bits[1]));
+			replace(place.chunk + 1, place.shift[1], place.bits[1], new_value);
+		}
+		lock.unlock();
+		return old_value;
+	}
+
+};
@@ -0,0 +1,369 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Header-only. No dependencies.
+ *
+ * BitStreamReader and BitStreamWriter are the word-at-a-time counterparts of BitStream
+ * for the sequential decoding/encoding. They use the same bit format (the first bit is
+ * the most significant bit of the first byte), so the streams are interchangeable.
+ *
+ * Both keep a 64-bit buffer with the bits aligned to the top and exchange whole words
+ * with the byte array: the reader refills with an unaligned big-endian load (bswap)
+ * to at least 56 valid bits, the writer flushes the complete bytes with an unaligned
+ * big-endian store. So a field of up to 56 bits costs a shift and a mask with no per-byte
+ * branches; the byte-by-byte path is used only within the last 8 bytes of the array.
+ *
+ * Besides the fixed width fields they code:
+ * - Elias-gamma: N zero bits followed by the N + 1 bits of the value (value >= 1);
+ * - varint: LEB128 groups of 8 bits, a continuation bit followed by 7 value bits,
+ *   the least significant group first;
+ * - zig-zag: signed to unsigned mapping for the varints of small magnitude signed values.
+ *
+ * Sample of using:
+ *
+ * uint8_t buffer[64];
+ * BitStreamWriter writer(buffer, sizeof(buffer));
+ * writer.write(5, 3);
+ * writer.write_gamma(17);
+ * writer.write_svarint(-300);
+ * const size_t bytes = writer.finish();
+ *
+ * BitStreamReader reader(buffer, bytes);
+ * auto a = reader.read(3);
+ * auto b = reader.read_gamma();
+ * auto c = reader.read_svarint();
+ * assert(reader.good());
+ */
+
+class BitStreamReader {
+public:
+
+	using Chunk_t = uint64_t;
+
+	/**
+	 * The maximum field width readable with a single peek().
+	 */
+	static constexpr unsigned PEEK_MAX = 56;
+
+private:
+
+	const uint8_t* const m_begin;
+	const uint8_t* m_ptr;
+	const uint8_t* const m_end;
+	Chunk_t m_buffer = 0;
+	unsigned m_bits = 0;
+	bool m_failed = false;
+
+public:
+
+	/**
+	 * @param data - the stream to read.
+	 * @param bytes - the stream size in bytes.
+	 */
+	BitStreamReader(const uint8_t* data, size_t bytes) noexcept
+		: m_begin(data)
+		, m_ptr(data)
+		, m_end(data + bytes) {
+		refill();
+	}
+
+	/**
+	 * @return The stream size in bits.
+	 */
+	inline size_t capacity() const noexcept {
+		return size_t(m_end - m_begin) << 3u;
+	}
+
+	/**
+	 * @return How many bits have been consumed.
+	 */
+	inline size_t offset() const noexcept {
+		return (size_t(m_ptr - m_begin) << 3u) - m_bits;
+	}
+
+	/**
+	 * @return How many bits are left.
+	 */
+	inline size_t available() const noexcept {
+		return capacity() - offset();
+	}
+
+	/**
+	 * @return false - if more bits have been consumed than the stream has (the missing bits are zeros)
+	 * or a malformed code has been met.
+	 */
+	inline bool good() const noexcept {
+		return not m_failed;
+	}
+
+	/**
+	 * Top up the buffer to at least PEEK_MAX bits (if the stream has them).
+	 */
+	inline void refill() noexcept {
+		if(__builtin_expect(m_end - m_ptr >= 8, 1)) {
+			Chunk_t word;
+			memcpy(&word, m_ptr, sizeof(word));
+			// the bits below m_bits may be loaded again: they are the same bits, so OR keeps them
+			m_buffer |= __builtin_bswap64(word) >> m_bits;
+			m_ptr += (63u - m_bits) >> 3u;
+			m_bits |= 56u;
+		} else {
+			refill_tail();
+		}
+	}
+
+	/**
+	 * @param bits - the field width in [0:PEEK_MAX].
+	 * @return The next @bits bits without consuming them.
+	 */
+	inline Chunk_t peek(unsigned bits) noexcept {
+		if(m_bits < bits) {
+			refill();
+		}
+		// two shifts to keep the zero width defined
+		return (m_buffer >> 1u) >> (63u - bits);
+	}
+
+	/**
+	 * Consume @bits bits, @bits MUST NOT exceed the width peeked before.
+	 */
+	inline void skip(unsigned bits) noexcept {
+		if(__builtin_expect(bits > m_bits, 0)) {
+			m_failed = true;
+			bits = m_bits;
+		}
+		m_buffer <<= bits;
+		m_bits -= bits;
+	}
+
+	/**
+	 * @param bits - the field width in [0:64].
+	 * @return The next @bits bits.
+	 */
+	inline Chunk_t read(unsigned bits) noexcept {
+		if(__builtin_expect(bits > PEEK_MAX, 0)) {
+			const Chunk_t high = read(bits - 32u);
+			return (high << 32u) | read(32u);
+		}
+		const Chunk_t value = peek(bits);
+		skip(bits);
+		return value;
+	}
+
+	/**
+	 * @return An Elias-gamma coded value, 0 if the code is malformed.
+	 */
+	Chunk_t read_gamma() noexcept {
+		if(m_bits < PEEK_MAX) {
+			refill();
+		}
+		unsigned zeros = m_buffer ? unsigned(__builtin_clzll(m_buffer)) : 64u;
+		if(__builtin_expect(zeros * 2u + 1u <= m_bits, 1)) {
+			// the leading zeros are the high bits of the value field
+			return read(zeros * 2u + 1u);
+		}
+		// a long code: count the zeros over the refills
+		zeros = 0;
+		while(zeros < 64u && good() && peek(1) == 0) {
+			skip(1);
+			zeros++;
+		}
+		if(zeros == 64u) {
+			m_failed = true;
+			return 0;
+		}
+		return read(zeros + 1u);
+	}
+
+	/**
+	 * @return A varint coded value.
+	 */
+	Chunk_t read_varint() noexcept {
+		Chunk_t value = 0;
+		for(unsigned shift = 0; shift < 64u; shift += 7u) {
+			const Chunk_t group = read(8);
+			value |= (group & 0x7Fu) << shift;
+			if(not (group & 0x80u)) {
+				break;
+			}
+		}
+		return value;
+	}
+
+	/**
+	 * @return A zig-zag varint coded signed value.
+	 */
+	inline int64_t read_svarint() noexcept {
+		return unzigzag(read_varint());
+	}
+
+	static inline int64_t unzigzag(uint64_t value) noexcept {
+		return int64_t(value >> 1u) ^ -int64_t(value & 1u);
+	}
+
+private:
+
+	void refill_tail() noexcept {
+		while(m_bits <= 56u && m_ptr < m_end) {
+			m_buffer |= Chunk_t(*m_ptr++) << (56u - m_bits);
+			m_bits += 8u;
+		}
+	}
+
+};
+
+class BitStreamWriter {
+public:
+
+	using Chunk_t = uint64_t;
+
+	/**
+	 * The maximum field width written with a single buffer update.
+	 */
+	static constexpr unsigned PUT_MAX = 56;
+
+private:
+
+	uint8_t* const m_begin;
+	uint8_t* m_ptr;
+	uint8_t* const m_end;
+	Chunk_t m_buffer = 0;
+	unsigned m_bits = 0;
+	bool m_overflow = false;
+
+public:
+
+	/**
+	 * The writer overwrites the whole bytes: the bits following the written ones are zeroed.
+	 * @param buffer - the stream to write.
+	 * @param bytes - the stream capacity in bytes.
+	 */
+	BitStreamWriter(uint8_t* buffer, size_t bytes) noexcept
+		: m_begin(buffer)
+		, m_ptr(buffer)
+		, m_end(buffer + bytes) {}
+
+	/**
+	 * @return The stream capacity in bits.
+	 */
+	inline size_t capacity() const noexcept {
+		return size_t(m_end - m_begin) << 3u;
+	}
+
+	/**
+	 * @return How many bits have been written.
+	 */
+	inline size_t offset() const noexcept {
+		return (size_t(m_ptr - m_begin) << 3u) + m_bits;
+	}
+
+	/**
+	 * @return false - if some bits didn't fit into the stream and were dropped.
+	 */
+	inline bool good() const noexcept {
+		return not m_overflow;
+	}
+
+	/**
+	 * Write the low @bits bits of @value.
+	 * @param bits - the field width in [0:64].
+	 */
+	inline void write(Chunk_t value, unsigned bits) noexcept {
+		if(__builtin_expect(bits > PUT_MAX, 0)) {
+			write(value >> 32u, bits - 32u);
+			write(value, 32u);
+			return;
+		}
+		if(not bits) {
+			return;
+		}
+		// m_bits < 8 here, so the field fits into the buffer
+		m_buffer |= (value << (64u - bits)) >> m_bits;
+		m_bits += bits;
+		flush();
+	}
+
+	/**
+	 * Write an Elias-gamma code of @value.
+	 * @param value - MUST be greater than zero.
+	 */
+	inline void write_gamma(Chunk_t value) noexcept {
+		const unsigned width = 64u - unsigned(__builtin_clzll(value | 1u));
+		// the leading zeros are the high bits of the wider field
+		if(width * 2u - 1u <= PUT_MAX) {
+			write(value, width * 2u - 1u);
+		} else {
+			write(0, width - 1u);
+			write(value, width);
+		}
+	}
+
+	/**
+	 * Write a varint code of @value.
+	 */
+	void write_varint(Chunk_t value) noexcept {
+		while(value >= 0x80u) {
+			write((value & 0x7Fu) | 0x80u, 8u);
+			value >>= 7u;
+		}
+		write(value, 8u);
+	}
+
+	/**
+	 * Write a zig-zag varint code of @value.
+	 */
+	inline void write_svarint(int64_t value) noexcept {
+		write_varint(zigzag(value));
+	}
+
+	static inline uint64_t zigzag(int64_t value) noexcept {
+		return (uint64_t(value) << 1u) ^ uint64_t(value >> 63u);
+	}
+
+	/**
+	 * Flush the last partial byte padded with zero bits.
+	 * @return The stream size in bytes.
+	 */
+	size_t finish() noexcept {
+		if(m_bits) {
+			m_bits = (m_bits + 7u) & ~7u;
+			flush();
+		}
+		return size_t(m_ptr - m_begin);
+	}
+
+private:
+
+	inline void flush() noexcept {
+		if(__builtin_expect(m_end - m_ptr >= 8, 1)) {
+			const Chunk_t word = __builtin_bswap64(m_buffer);
+			memcpy(m_ptr, &word, sizeof(word));
+			const unsigned bytes = m_bits >> 3u;
+			m_ptr += bytes;
+			// bytes < 8, the shift is defined
+			m_buffer <<= bytes << 3u;
+			m_bits &= 7u;
+		} else {
+			flush_tail();
+		}
+	}
+
+	void flush_tail() noexcept {
+		while(m_bits >= 8u) {
+			if(m_ptr == m_end) {
+				m_overflow = true;
+				m_buffer = 0;
+				m_bits = 0;
+				return;
+			}
+			*m_ptr++ = uint8_t(m_buffer >> 56u);
+			m_buffer <<= 8u;
+			m_bits -= 8u;
+		}
+	}
+
+};
@@ -0,0 +1,363 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <immintrin.h>
+
+#include "../../utils/Cpu.h"
+
+/**
+ * Header-only.
+ *
+ * RankSelect is a static bitvector answering in constant time:
+ * - rank1(pos) - how many bits are set in [0:pos);
+ * - select1(k) - the position of the k'th set bit (counting from zero);
+ * and rank0()/select0() for the clear bits.
+ *
+ * The bits are packed LSB-first into 64-bit words: bit pos is (word[pos / 64] >> (pos % 64)) & 1.
+ * The bits are set with set() and the directory is built with build(),
+ * the queries are valid until the next modification.
+ *
+ * The directory (below 19% of the bitvector):
+ * - a 64-bit absolute rank per 2^32 bits;
+ * - a 64-bit entry per 512-bit block (12.5%): the 32-bit rank of the block relative to its 2^32 bits
+ *   and three 9-bit counts of the set bits in the block words [0:2), [0:4) and [0:6),
+ *   so rank1() is two lookups and at most two popcounts in the same cache lines;
+ * - the block of every SAMPLE'th set bit and every SAMPLE'th clear bit (6.25%),
+ *   select() searches the blocks between the two samples, the pair of the words by the counts
+ *   and the bit in the word with pdep (BMI2) or with the byte counts.
+ *
+ * POPCNT and BMI2 are selected at run time, see utils::Cpu.
+ *
+ * Using sample:
+ * RankSelect rs;
+ * if(rs.allocate(1 << 20) == 0) {
+ *     rs.set(100);
+ *     rs.set(2000);
+ *     rs.build();
+ *     rs.rank1(1000); // 1
+ *     rs.select1(1); // 2000
+ * }
+ */
+class RankSelect {
+public:
+
+	static constexpr size_t WORD_BITS = 64;
+	static constexpr size_t BLOCK_BITS = 512;
+	static constexpr size_t BLOCK_WORDS = BLOCK_BITS / WORD_BITS;
+	static constexpr size_t SUPER_SHIFT = 32;
+	static constexpr size_t SAMPLE = 1024;
+
+private:
+
+	size_t m_size = 0;
+	size_t m_ones = 0;
+	size_t m_words_nb = 0;
+	size_t m_blocks_nb = 0;
+	size_t m_supers_nb = 0;
+	size_t m_samples1_nb = 0;
+	size_t m_samples0_nb = 0;
+	std::unique_ptr<uint64_t[]> m_words;
+	std::unique_ptr<uint64_t[]> m_blocks;
+	std::unique_ptr<uint64_t[]> m_supers;
+	std::unique_ptr<uint64_t[]> m_samples1;
+	std::unique_ptr<uint64_t[]> m_samples0;
+
+public:
+
+	/**
+	 * Allocate @bits clear bits.
+	 * @return 0 on success.
+	 */
+	int allocate(size_t bits) noexcept {
+		m_size = bits;
+		m_ones = 0;
+		// a padding word and block: rank1(size()) reads them
+		m_words_nb = bits / WORD_BITS + 1;
+		m_blocks_nb = bits / BLOCK_BITS + 1;
+		m_supers_nb = (bits >> SUPER_SHIFT) + 1;
+		m_words.reset(new(std::nothrow) uint64_t[m_words_nb]());
+		m_blocks.reset(new(std::nothrow) uint64_t[m_blocks_nb]());
+		m_supers.reset(new(std::nothrow) uint64_t[m_supers_nb]());
+		m_samples1.reset();
+		m_samples0.reset();
+		m_samples1_nb = m_samples0_nb = 0;
+		if(not m_words || not m_blocks || not m_supers) {
+			m_size = 0;
+			return -1;
+		}
+		return 0;
+	}
+
+	/**
+	 * @return The bitvector size in bits.
+	 */
+	inline size_t size() const noexcept {
+		return m_size;
+	}
+
+	/**
+	 * @return The number of the set bits, valid after build().
+	 */
+	inline size_t count() const noexcept {
+		return m_ones;
+	}
+
+	/**
+	 * @return The words of the bitvector, (size() + 63) / 64 words are in use.
+	 */
+	inline uint64_t* data() noexcept {
+		return m_words.get();
+	}
+
+	inline bool get(size_t pos) const noexcept {
+		return (m_words[pos / WORD_BITS] >> (pos % WORD_BITS)) & 1u;
+	}
+
+	inline void set(size_t pos, bool value = true) noexcept {
+		const uint64_t mask = 1ull << (pos % WORD_BITS);
+		if(value) {
+			m_words[pos / WORD_BITS] |= mask;
+		} else {
+			m_words[pos / WORD_BITS] &= ~mask;
+		}
+	}
+
+	/**
+	 * Build the rank and select directory.
+	 * @return 0 on success.
+	 */
+	int build() noexcept {
+		// the bits past the end MUST NOT be counted
+		m_words[m_size / WORD_BITS] &= ~(~0ull << (m_size % WORD_BITS));
+		utils::Cpu::popcnt() ? build_ranks_popcnt() : build_ranks();
+
+		const size_t zeros = m_size - m_ones;
+		m_samples1_nb = m_ones / SAMPLE + 2;
+		m_samples0_nb = zeros / SAMPLE + 2;
+		m_samples1.reset(new(std::nothrow) uint64_t[m_samples1_nb]);
+		m_samples0.reset(new(std::nothrow) uint64_t[m_samples0_nb]);
+		if(not m_samples1 || not m_samples0) {
+			return -1;
+		}
+		size_t next1 = 0;
+		size_t next0 = 0;
+		for(size_t block = 0; block < m_blocks_nb; ++block) {
+			const size_t end1 = (block + 1 < m_blocks_nb ? block_rank1(block + 1) : m_ones);
+			const size_t end0 = (block + 1 < m_blocks_nb ? (block + 1) * BLOCK_BITS : m_size) - end1;
+			for(; next1 * SAMPLE < end1; ++next1) {
+				m_samples1[next1] = block;
+			}
+			for(; next0 * SAMPLE < end0; ++next0) {
+				m_samples0[next0] = block;
+			}
+		}
+		// the sentinels bound the search of the last samples
+		m_samples1[next1] = m_samples1[m_samples1_nb - 1] = m_blocks_nb - 1;
+		m_samples0[next0] = m_samples0[m_samples0_nb - 1] = m_blocks_nb - 1;
+		return 0;
+	}
+
+	/**
+	 * @param pos - in [0:size()].
+	 * @return The number of the set bits in [0:pos).
+	 */
+	inline size_t rank1(size_t pos) const noexcept {
+		return utils::Cpu::popcnt() ? rank1_popcnt(pos) : rank1_impl(pos);
+	}
+
+	/**
+	 * @param pos - in [0:size()].
+	 * @return The number of the clear bits in [0:pos).
+	 */
+	inline size_t rank0(size_t pos) const noexcept {
+		return pos - rank1(pos);
+	}
+
+	/**
+	 * @param k - the zero based index of the set bit.
+	 * @return The position of the bit or size() if there are no more than @k set bits.
+	 */
+	inline size_t select1(size_t k) const noexcept {
+		if(k >= m_ones) {
+			return m_size;
+		}
+		return utils::Cpu::bmi2() ? select_bmi2<true>(k) : select_impl<true, false>(k);
+	}
+
+	/**
+	 * @param k - the zero based index of the clear bit.
+	 * @return The position of the bit or size() if there are no more than @k clear bits.
+	 */
+	inline size_t select0(size_t k) const noexcept {
+		if(k >= m_size - m_ones) {
+			return m_size;
+		}
+		return utils::Cpu::bmi2() ? select_bmi2<false>(k) : select_impl<false, false>(k);
+	}
+
+	/**
+	 * @return The memory used by the directory in bytes.
+	 */
+	inline size_t directory_bytes() const noexcept {
+		return (m_blocks_nb + m_supers_nb + m_samples1_nb + m_samples0_nb) * sizeof(uint64_t);
+	}
+
+	/**
+	 * @return The memory used by the bits in bytes.
+	 */
+	inline size_t storage_bytes() const noexcept {
+		return m_words_nb * sizeof(uint64_t);
+	}
+
+	/**
+	 * The portable select in a word: the bytes by the counts, the bits of the byte one by one.
+	 * @return The position of the k'th set bit of @word, the bit MUST exist.
+	 */
+	static inline __attribute__((always_inline)) unsigned select_word(uint64_t word, size_t k) noexcept {
+		unsigned pos = 0;
+		for(;;) {
+			const unsigned ones = popcount(word & 0xFFu);
+			if(k < ones) {
+				break;
+			}
+			k -= ones;
+			word >>= 8u;
+			pos += 8u;
+		}
+		for(; k; --k) {
+			word &= word - 1u;
+		}
+		return pos + unsigned(__builtin_ctzll(word));
+	}
+
+	/**
+	 * The BMI2 select in a word: pdep deposits the k'th set bit alone.
+	 * @return The position of the k'th set bit of @word, the bit MUST exist.
+	 */
+	__attribute__((target("bmi2")))
+	static inline unsigned select_word_bmi2(uint64_t word, size_t k) noexcept {
+		return unsigned(__builtin_ctzll(_pdep_u64(1ull << k, word)));
+	}
+
+private:
+
+	static inline __attribute__((always_inline)) unsigned popcount(uint64_t word) noexcept {
+		return unsigned(__builtin_popcountll(word));
+	}
+
+	/**
+	 * @return The set bits in the block words [0:2 * pair), pair in [0:3].
+	 */
+	static inline __attribute__((always_inline)) size_t pair_rank(uint64_t entry, size_t pair) noexcept {
+		return pair ? (entry >> (SUPER_SHIFT + 9u * (pair - 1u))) & 0x1FFu : 0;
+	}
+
+	inline size_t block_rank1(size_t block) const noexcept {
+		return m_supers[(block * BLOCK_BITS) >> SUPER_SHIFT] + (m_blocks[block] & 0xFFFFFFFFu);
+	}
+
+	template <bool Bit>
+	inline size_t block_rank(size_t block) const noexcept {
+		const size_t ones = block_rank1(block);
+		return Bit ? ones : block * BLOCK_BITS - ones;
+	}
+
+	inline __attribute__((always_inline)) void build_ranks_impl() noexcept {
+		size_t ones = 0;
+		for(size_t block = 0; block < m_blocks_nb; ++block) {
+			const size_t first = block * BLOCK_BITS;
+			if((first & ((1ull << SUPER_SHIFT) - 1u)) == 0) {
+				m_supers[first >> SUPER_SHIFT] = ones;
+			}
+			uint64_t entry = ones - m_supers[first >> SUPER_SHIFT];
+			size_t in_block = 0;
+			for(size_t w = 0; w < BLOCK_WORDS; ++w) {
+				if(w && not (w & 1u)) {
+					entry |= uint64_t(in_block) << (SUPER_SHIFT + 9u * (w / 2u - 1u));
+				}
+				const size_t idx = block * BLOCK_WORDS + w;
+				in_block += idx < m_words_nb ? popcount(m_words[idx]) : 0;
+			}
+			m_blocks[block] = entry;
+			ones += in_block;
+		}
+		m_ones = ones;
+	}
+
+	void build_ranks() noexcept {
+		build_ranks_impl();
+	}
+
+	__attribute__((target("popcnt")))
+	void build_ranks_popcnt() noexcept {
+		build_ranks_impl();
+	}
+
+	inline __attribute__((always_inline)) size_t rank1_impl(size_t pos) const noexcept {
+		const size_t block = pos / BLOCK_BITS;
+		const uint64_t entry = m_blocks[block];
+		const size_t w = pos / WORD_BITS;
+		size_t rank = m_supers[pos >> SUPER_SHIFT] + (entry & 0xFFFFFFFFu) + pair_rank(entry, (w % BLOCK_WORDS) / 2u);
+		if(w & 1u) {
+			rank += popcount(m_words[w - 1u]);
+		}
+		return rank + popcount(m_words[w] & ~(~0ull << (pos % WORD_BITS)));
+	}
+
+	__attribute__((target("popcnt")))
+	size_t rank1_popcnt(size_t pos) const noexcept {
+		return rank1_impl(pos);
+	}
+
+	template <bool Bit, bool Bmi2>
+	inline __attribute__((always_inline)) size_t select_impl(size_t k) const noexcept {
+		const uint64_t* samples = Bit ? m_samples1.get() : m_samples0.get();
+		size_t lo = samples[k / SAMPLE];
+		size_t hi = samples[k / SAMPLE + 1u] + 1u;
+		// the last block in [lo:hi) which rank is not above k
+		while(hi - lo > 8u) {
+			const size_t mid = (lo + hi) / 2u;
+			if(block_rank<Bit>(mid) <= k) {
+				lo = mid;
+			} else {
+				hi = mid;
+			}
+		}
+		while(lo + 1u < hi && block_rank<Bit>(lo + 1u) <= k) {
+			++lo;
+		}
+		k -= block_rank<Bit>(lo);
+
+		const uint64_t entry = m_blocks[lo];
+		size_t pair = 0;
+		for(size_t p = 1; p < BLOCK_WORDS / 2u; ++p) {
+			const size_t ones = pair_rank(entry, p);
+			pair += (Bit ? ones : p * 2u * WORD_BITS - ones) <= k;
+		}
+		k -= Bit ? pair_rank(entry, pair) : pair * 2u * WORD_BITS - pair_rank(entry, pair);
+
+		size_t w = lo * BLOCK_WORDS + pair * 2u;
+		uint64_t word = Bit ? m_words[w] : ~m_words[w];
+		const unsigned ones = popcount(word);
+		if(k >= ones) {
+			k -= ones;
+			++w;
+			word = Bit ? m_words[w] : ~m_words[w];
+		}
+		if constexpr (Bmi2) {
+			return w * WORD_BITS + select_word_bmi2(word, k);
+		} else {
+			return w * WORD_BITS + select_word(word, k);
+		}
+	}
+
+	template <bool Bit>
+	__attribute__((target("bmi2,popcnt")))
+	size_t select_bmi2(size_t k) const noexcept {
+		return select_impl<Bit, true>(k);
+	}
+
+};
@@ -0,0 +1,1020 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <immintrin.h>
+
+#include "../../utils/Cpu.h"
+
+/**
+ * Header-only.
+ *
+ * RoaringBitmap is a compressed set of uint32_t values.
+ * The values are split by the high 16 bits into containers kept sorted by the key,
+ * every container holds the low 16 bits in the most compact of:
+ * - ARRAY: a sorted uint16_t array, up to ARRAY_MAX values (2 bytes per value);
+ * - BITMAP: 2^16 bits (8 KB), above ARRAY_MAX values;
+ * - RUN: sorted (start, length - 1) pairs (4 bytes per run), for the ranges.
+ *
+ * add_range() creates the RUN containers, add() keeps ARRAY or BITMAP,
+ * run_optimize() picks the smallest form of every container after a bulk load.
+ *
+ * intersect()/unite() work container by container: the arrays are intersected with SSE4.2 pcmpestrm
+ * (or galloping when the sizes differ a lot), the bitmaps are combined with AVX2,
+ * the runs are merged as the intervals. The SIMD kernels are selected at run time, see utils::Cpu.
+ *
+ * serialize() writes a position independent image: a Header, an Entry per container
+ * and the 8-byte aligned container payloads. RoaringView answers contains()/for_each()
+ * directly on the image, e.g. on a mmap()'ed file, deserialize() copies it back.
+ *
+ * Using sample:
+ * RoaringBitmap vlans;
+ * vlans.add_range(100, 199);
+ * vlans.add(4000);
+ * if(vlans.contains(vlan)) ...
+ * vlans.for_each([](uint32_t value) { printf("%u\n", value); });
+ */
+class RoaringBitmap {
+public:
+
+	enum Type : uint8_t {
+		ARRAY = 1,
+		BITMAP = 2,
+		RUN = 3
+	};
+
+	static constexpr uint32_t ARRAY_MAX = 4096;
+	static constexpr uint32_t BITMAP_WORDS = 1024;
+	static constexpr uint32_t RUNS_MAX = 2047;
+
+	/**
+	 * The serialised image header.
+	 */
+	struct Header {
+		static constexpr uint32_t MAGIC = 0x52424D31; // "RBM1"
+
+		uint32_t magic;
+		uint32_t containers;
+		uint64_t cardinality;
+	};
+
+	/**
+	 * The serialised container.
+	 */
+	struct Entry {
+		uint16_t key;
+		uint8_t type;
+		uint8_t reserved;
+		uint32_t cardinality;
+		uint32_t size;       // the uint16_t values of ARRAY/RUN or the uint64_t words of BITMAP
+		uint32_t offset;     // the payload offset from the header
+	};
+
+	/**
+	 * A read-only container.
+	 */
+	struct Span {
+		uint16_t key;
+		Type type;
+		uint32_t cardinality;
+		uint32_t size;
+		const void* data;
+
+		inline const uint16_t* values() const noexcept {
+			return static_cast<const uint16_t*>(data);
+		}
+
+		inline const uint64_t* words() const noexcept {
+			return static_cast<const uint64_t*>(data);
+		}
+
+		bool contains(uint16_t low) const noexcept {
+			switch(type) {
+				case ARRAY:
+					return std::binary_search(values(), values() + size, low);
+				case BITMAP:
+					return (words()[low / 64u] >> (low % 64u)) & 1u;
+				default: {
+					// the last run starting not above low
+					const uint16_t* runs = values();
+					size_t lo = 0;
+					size_t hi = size / 2u;
+					while(lo < hi) {
+						const size_t mid = (lo + hi) / 2u;
+						if(runs[mid * 2u] <= low) {
+							lo = mid + 1u;
+						} else {
+							hi = mid;
+						}
+					}
+					return lo && low - runs[(lo - 1u) * 2u] <= runs[(lo - 1u) * 2u + 1u];
+				}
+			}
+		}
+
+		template <typename Fn>
+		void for_each(Fn&& fn) const noexcept {
+			const uint32_t high = uint32_t(key) << 16u;
+			switch(type) {
+				case ARRAY:
+					for(uint32_t i = 0; i < size; ++i) {
+						fn(high | values()[i]);
+					}
+					break;
+				case BITMAP:
+					for(uint32_t w = 0; w < size; ++w) {
+						for(uint64_t word = words()[w]; word; word &= word - 1u) {
+							fn(high | (w * 64u + unsigned(__builtin_ctzll(word))));
+						}
+					}
+					break;
+				default:
+					for(uint32_t r = 0; r < size; r += 2u) {
+						const uint32_t last = uint32_t(values()[r]) + values()[r + 1u];
+						for(uint32_t low = values()[r]; low <= last; ++low) {
+							fn(high | low);
+						}
+					}
+			}
+		}
+	};
+
+private:
+
+	struct Container {
+		uint16_t key;
+		Type type;
+		uint32_t cardinality;
+		std::vector<uint16_t> values; // ARRAY values or RUN (start, length - 1) pairs
+		std::vector<uint64_t> words;  // BITMAP
+
+		Span span() const noexcept {
+			if(type == BITMAP) {
+				return {key, type, cardinality, uint32_t(words.size()), words.data()};
+			}
+			return {key, type, cardinality, uint32_t(values.size()), values.data()};
+		}
+	};
+
+	std::vector<Container> m_containers;
+
+public:
+
+	inline bool empty() const noexcept {
+		return m_containers.empty();
+	}
+
+	inline void clear() noexcept {
+		m_containers.clear();
+	}
+
+	/**
+	 * @return The number of values.
+	 */
+	uint64_t cardinality() const noexcept {
+		uint64_t result = 0;
+		for(const auto& c : m_containers) {
+			result += c.cardinality;
+		}
+		return result;
+	}
+
+	/**
+	 * @return The memory used by the containers payload in bytes.
+	 */
+	size_t storage_bytes() const noexcept {
+		size_t result = m_containers.capacity() * sizeof(Container);
+		for(const auto& c : m_containers) {
+			result += c.values.capacity() * sizeof(uint16_t) + c.words.capacity() * sizeof(uint64_t);
+		}
+		return result;
+	}
+
+	bool contains(uint32_t value) const noexcept {
+		const auto it = find(uint16_t(value >> 16u));
+		return it != m_containers.end() && it->key == (value >> 16u) && it->span().contains(uint16_t(value));
+	}
+
+	void add(uint32_t value) noexcept {
+		Container& c = obtain(uint16_t(value >> 16u));
+		const uint16_t low = uint16_t(value);
+		switch(c.type) {
+			case ARRAY: {
+				auto it = std::lower_bound(c.values.begin(), c.values.end(), low);
+				if(it == c.values.end() || *it != low) {
+					c.values.insert(it, low);
+					if(++c.cardinality > ARRAY_MAX) {
+						to_bitmap(c);
+					}
+				}
+				break;
+			}
+			case BITMAP: {
+				uint64_t& word = c.words[low / 64u];
+				const uint64_t mask = 1ull << (low % 64u);
+				c.cardinality += not (word & mask);
+				word |= mask;
+				break;
+			}
+			default:
+				run_add(c, low, low);
+		}
+	}
+
+	/**
+	 * Add the values in [first:last].
+	 */
+	void add_range(uint32_t first, uint32_t last) noexcept {
+		if(first > last) {
+			return;
+		}
+		for(uint32_t key = first >> 16u; key <= (last >> 16u); ++key) {
+			const uint16_t lo = (key == (first >> 16u) ? uint16_t(first) : 0);
+			const uint16_t hi = (key == (last >> 16u) ? uint16_t(last) : 0xFFFF);
+			auto it = find(uint16_t(key));
+			if(it == m_containers.end() || it->key != key) {
+				// a new range is a single run
+				it = m_containers.insert(it, Container{uint16_t(key), RUN, 0, {}, {}});
+			}
+			Container& c = *it;
+			switch(c.type) {
+				case ARRAY:
+					if(c.cardinality + (hi - lo + 1u) > ARRAY_MAX) {
+						to_bitmap(c);
+						bitmap_set(c, lo, hi);
+					} else {
+						array_add(c, lo, hi);
+					}
+					break;
+				case BITMAP:
+					bitmap_set(c, lo, hi);
+					break;
+				default:
+					run_add(c, lo, hi);
+			}
+		}
+	}
+
+	void remove(uint32_t value) noexcept {
+		auto it = find(uint16_t(value >> 16u));
+		if(it == m_containers.end() || it->key != (value >> 16u)) {
+			return;
+		}
+		Container& c = *it;
+		const uint16_t low = uint16_t(value);
+		if(c.type == RUN) {
+			c.cardinality > ARRAY_MAX ? to_bitmap(c) : to_array(c);
+		}
+		if(c.type == ARRAY) {
+			auto pos = std::lower_bound(c.values.begin(), c.values.end(), low);
+			if(pos != c.values.end() && *pos == low) {
+				c.values.erase(pos);
+				c.cardinality--;
+			}
+		} else {
+			uint64_t& word = c.words[low / 64u];
+			const uint64_t mask = 1ull << (low % 64u);
+			c.cardinality -= bool(word & mask);
+			word &= ~mask;
+			if(c.cardinality <= ARRAY_MAX) {
+				to_array(c);
+			}
+		}
+		if(not c.cardinality) {
+			m_containers.erase(it);
+		}
+	}
+
+	/**
+	 * Call fn(uint32_t value) for every value in the ascending order.
+	 */
+	template <typename Fn>
+	void for_each(Fn&& fn) const noexcept {
+		for(const auto& c : m_containers) {
+			c.span().for_each(fn);
+		}
+	}
+
+	/**
+	 * Convert every container to the smallest of ARRAY, BITMAP and RUN.
+	 */
+	void run_optimize() noexcept {
+		for(auto& c : m_containers) {
+			const size_t runs = count_runs(c);
+			const size_t run_bytes = runs * 2u * sizeof(uint16_t);
+			const size_t other_bytes = (c.cardinality <= ARRAY_MAX ? c.cardinality * sizeof(uint16_t) : BITMAP_WORDS * sizeof(uint64_t));
+			if(run_bytes < other_bytes && runs <= RUNS_MAX) {
+				to_runs(c);
+			} else if(c.cardinality <= ARRAY_MAX) {
+				to_array(c);
+			} else {
+				to_bitmap(c);
+			}
+			c.values.shrink_to_fit();
+			c.words.shrink_to_fit();
+		}
+	}
+
+	/**
+	 * out = a & b, @out MUST NOT be @a or @b.
+	 */
+	static void intersect(const RoaringBitmap& a, const RoaringBitmap& b, RoaringBitmap& out) noexcept {
+		out.clear();
+		auto ia = a.m_containers.begin();
+		auto ib = b.m_containers.begin();
+		while(ia != a.m_containers.end() && ib != b.m_containers.end()) {
+			if(ia->key < ib->key) {
+				++ia;
+			} else if(ib->key < ia->key) {
+				++ib;
+			} else {
+				Container c{ia->key, ARRAY, 0, {}, {}};
+				container_and(*ia, *ib, c);
+				if(c.cardinality) {
+					out.m_containers.push_back(std::move(c));
+				}
+				++ia;
+				++ib;
+			}
+		}
+	}
+
+	/**
+	 * out = a | b, @out MUST NOT be @a or @b.
+	 */
+	static void unite(const RoaringBitmap& a, const RoaringBitmap& b, RoaringBitmap& out) noexcept {
+		out.clear();
+		auto ia = a.m_containers.begin();
+		auto ib = b.m_containers.begin();
+		while(ia != a.m_containers.end() || ib != b.m_containers.end()) {
+			if(ib == b.m_containers.end() || (ia != a.m_containers.end() && ia->key < ib->key)) {
+				out.m_containers.push_back(*ia++);
+			} else if(ia == a.m_containers.end() || ib->key < ia->key) {
+				out.m_containers.push_back(*ib++);
+			} else {
+				Container c{ia->key, ARRAY, 0, {}, {}};
+				container_or(*ia, *ib, c);
+				out.m_containers.push_back(std::move(c));
+				++ia;
+				++ib;
+			}
+		}
+	}
+
+	/**
+	 * @return The serialised image size.
+	 */
+	size_t serialized_bytes() const noexcept {
+		size_t result = sizeof(Header) + m_containers.size() * sizeof(Entry);
+		for(const auto& c : m_containers) {
+			result += payload_bytes(c);
+		}
+		return result;
+	}
+
+	/**
+	 * @param buffer - at least serialized_bytes() bytes, 8-byte aligned to be used with RoaringView in place.
+	 * @return The number of bytes written or 0 if the buffer is too small.
+	 */
+	size_t serialize(void* buffer, size_t buffer_bytes) const noexcept {
+		const size_t bytes = serialized_bytes();
+		if(buffer_bytes < bytes) {
+			return 0;
+		}
+		uint8_t* dst = static_cast<uint8_t*>(buffer);
+		Header hdr;
+		hdr.magic = Header::MAGIC;
+		hdr.containers = uint32_t(m_containers.size());
+		hdr.cardinality = cardinality();
+		memcpy(dst, &hdr, sizeof(hdr));
+
+		size_t offset = sizeof(Header) + m_containers.size() * sizeof(Entry);
+		for(size_t i = 0; i < m_containers.size(); ++i) {
+			const Span span = m_containers[i].span();
+			Entry entry;
+			entry.key = span.key;
+			entry.type = span.type;
+			entry.reserved = 0;
+			entry.cardinality = span.cardinality;
+			entry.size = span.size;
+			entry.offset = uint32_t(offset);
+			memcpy(dst + sizeof(Header) + i * sizeof(Entry), &entry, sizeof(entry));
+
+			const size_t used = span.size * (span.type == BITMAP ? sizeof(uint64_t) : sizeof(uint16_t));
+			memcpy(dst + offset, span.data, used);
+			memset(dst + offset + used, 0, payload_bytes(m_containers[i]) - used);
+			offset += payload_bytes(m_containers[i]);
+		}
+		return bytes;
+	}
+
+	/**
+	 * Replace the values with a serialised image.
+	 * @return false - if the image is malformed.
+	 */
+	bool deserialize(const void* buffer, size_t buffer_bytes) noexcept;
+
+private:
+
+	static inline size_t payload_bytes(const Container& c) noexcept {
+		return c.type == BITMAP ? BITMAP_WORDS * sizeof(uint64_t) : (c.values.size() * sizeof(uint16_t) + 7u) & ~size_t(7);
+	}
+
+	std::vector<Container>::const_iterator find(uint16_t key) const noexcept {
+		return std::lower_bound(m_containers.begin(), m_containers.end(), key, [](const Container& c, uint16_t k) {
+			return c.key < k;
+		});
+	}
+
+	std::vector<Container>::iterator find(uint16_t key) noexcept {
+		return std::lower_bound(m_containers.begin(), m_containers.end(), key, [](const Container& c, uint16_t k) {
+			return c.key < k;
+		});
+	}
+
+	Container& obtain(uint16_t key) noexcept {
+		auto it = find(key);
+		if(it == m_containers.end() || it->key != key) {
+			it = m_containers.insert(it, Container{key, ARRAY, 0, {}, {}});
+		}
+		return *it;
+	}
+
+	/**
+	 * Collect the runs of a container as (start, length - 1) pairs.
+	 */
+	static void collect_runs(const Container& c, std::vector<uint16_t>& runs) noexcept {
+		runs.clear();
+		if(c.type == RUN) {
+			runs = c.values;
+			return;
+		}
+		int32_t start = -1;
+		int32_t prev = -2;
+		c.span().for_each([&](uint32_t value) {
+			const int32_t low = int32_t(value & 0xFFFFu);
+			if(low != prev + 1) {
+				if(start >= 0) {
+					runs.push_back(uint16_t(start));
+					runs.push_back(uint16_t(prev - start));
+				}
+				start = low;
+			}
+			prev = low;
+		});
+		if(start >= 0) {
+			runs.push_back(uint16_t(start));
+			runs.push_back(uint16_t(prev - start));
+		}
+	}
+
+	static size_t count_runs(const Container& c) noexcept {
+		switch(c.type) {
+			case ARRAY: {
+				size_t runs = c.values.empty() ? 0 : 1;
+				for(size_t i = 1; i < c.values.size(); ++i) {
+					runs += c.values[i] != c.values[i - 1u] + 1u;
+				}
+				return runs;
+			}
+			case BITMAP: {
+				// a run starts at a set bit which lower neighbour is clear
+				size_t runs = 0;
+				uint64_t carry = 0;
+				for(uint64_t word : c.words) {
+					runs += unsigned(__builtin_popcountll(word & ~((word << 1u) | carry)));
+					carry = word >> 63u;
+				}
+				return runs;
+			}
+			default:
+				return c.values.size() / 2u;
+		}
+	}
+
+	static void to_bitmap(Container& c) noexcept {
+		if(c.type == BITMAP) {
+			return;
+		}
+		std::vector<uint64_t> words(BITMAP_WORDS, 0);
+		c.span().for_each([&words](uint32_t value) {
+			words[(value & 0xFFFFu) / 64u] |= 1ull << (value % 64u);
+		});
+		c.words.swap(words);
+		c.values.clear();
+		c.values.shrink_to_fit();
+		c.type = BITMAP;
+	}
+
+	static void to_array(Container& c) noexcept {
+		if(c.type == ARRAY) {
+			return;
+		}
+		std::vector<uint16_t> values;
+		values.reserve(c.cardinality);
+		c.span().for_each([&values](uint32_t value) {
+			values.push_back(uint16_t(value));
+		});
+		c.values.swap(values);
+		c.words.clear();
+		c.words.shrink_to_fit();
+		c.type = ARRAY;
+	}
+
+	static void to_runs(Container& c) noexcept {
+		if(c.type == RUN) {
+			return;
+		}
+		std::vector<uint16_t> runs;
+		collect_runs(c, runs);
+		c.values.swap(runs);
+		c.words.clear();
+		c.words.shrink_to_fit();
+		c.type = RUN;
+	}
+
+	static void array_add(Container& c, uint16_t lo, uint16_t hi) noexcept {
+		auto first = std::lower_bound(c.values.begin(), c.values.end(), lo);
+		auto last = std::upper_bound(first, c.values.end(), hi);
+		const size_t present = size_t(last - first);
+		const size_t pos = size_t(first - c.values.begin());
+		c.values.erase(first, last);
+		c.values.insert(c.values.begin() + pos, size_t(hi - lo + 1u), 0);
+		for(uint32_t v = lo; v <= hi; ++v) {
+			c.values[pos + (v - lo)] = uint16_t(v);
+		}
+		c.cardinality += (hi - lo + 1u) - present;
+	}
+
+	static void bitmap_set(Container& c, uint16_t lo, uint16_t hi) noexcept {
+		const uint32_t first = lo / 64u;
+		const uint32_t last = hi / 64u;
+		for(uint32_t w = first; w <= last; ++w) {
+			uint64_t mask = ~0ull;
+			if(w == first) {
+				mask &= ~0ull << (lo % 64u);
+			}
+			if(w == last) {
+				mask &= ~0ull >> (63u - hi % 64u);
+			}
+			c.cardinality += unsigned(__builtin_popcountll(mask & ~c.words[w]));
+			c.words[w] |= mask;
+		}
+	}
+
+	/**
+	 * Merge [lo:hi] into the runs, the overlapping and the adjacent runs are joined.
+	 */
+	static void run_add(Container& c, uint16_t lo, uint16_t hi) noexcept {
+		auto& runs = c.values;
+		const size_t nb = runs.size() / 2u;
+		// the first run which end reaches lo - 1
+		size_t first = 0;
+		while(first < nb && uint32_t(runs[first * 2u]) + runs[first * 2u + 1u] + 1u < lo) {
+			++first;
+		}
+		uint32_t start = lo;
+		uint32_t end = hi;
+		size_t last = first;
+		for(; last < nb && runs[last * 2u] <= uint32_t(hi) + 1u; ++last) {
+			start = std::min<uint32_t>(start, runs[last * 2u]);
+			end = std::max<uint32_t>(end, uint32_t(runs[last * 2u]) + runs[last * 2u + 1u]);
+			c.cardinality -= runs[last * 2u + 1u] + 1u;
+		}
+		runs.erase(runs.begin() + first * 2u, runs.begin() + last * 2u);
+		const uint16_t run[] = {uint16_t(start), uint16_t(end - start)};
+		runs.insert(runs.begin() + first * 2u, run, run + 2);
+		c.cardinality += end - start + 1u;
+		if(runs.size() / 2u > RUNS_MAX) {
+			c.cardinality > ARRAY_MAX ? to_bitmap(c) : to_array(c);
+		}
+	}
+
+	/**
+	 * A RUN container as ARRAY or BITMAP, @tmp keeps the converted copy.
+	 */
+	static const Container& materialize(const Container& c, Container& tmp) noexcept {
+		if(c.type != RUN) {
+			return c;
+		}
+		tmp = c;
+		c.cardinality > ARRAY_MAX ? to_bitmap(tmp) : to_array(tmp);
+		return tmp;
+	}
+
+	static void container_and(const Container& x, const Container& y, Container& out) noexcept {
+		if(x.type == RUN && y.type == RUN) {
+			runs_and(x, y, out);
+			return;
+		}
+		Container tmp_x;
+		Container tmp_y;
+		const Container* a = &materialize(x, tmp_x);
+		const Container* b = &materialize(y, tmp_y);
+		if(a->type == BITMAP && b->type == ARRAY) {
+			std::swap(a, b);
+		}
+		if(a->type == ARRAY && b->type == ARRAY) {
+			out.type = ARRAY;
+			out.values.resize(std::min(a->values.size(), b->values.size()) + 8u);
+			out.cardinality = intersect_arrays(a->values.data(), a->values.size(), b->values.data(), b->values.size(), out.values.data());
+			out.values.resize(out.cardinality);
+		} else if(a->type == ARRAY) {
+			out.type = ARRAY;
+			for(uint16_t low : a->values) {
+				if((b->words[low / 64u] >> (low % 64u)) & 1u) {
+					out.values.push_back(low);
+				}
+			}
+			out.cardinality = uint32_t(out.values.size());
+		} else {
+			out.type = BITMAP;
+			out.words.resize(BITMAP_WORDS);
+			out.cardinality = bitmap_and(a->words.data(), b->words.data(), out.words.data());
+			if(out.cardinality <= ARRAY_MAX) {
+				to_array(out);
+			}
+		}
+	}
+
+	static void container_or(const Container& x, const Container& y, Container& out) noexcept {
+		if(x.type == RUN && y.type == RUN) {
+			out = x;
+			for(size_t r = 0; r < y.values.size() && out.type == RUN; r += 2u) {
+				run_add(out, y.values[r], uint16_t(y.values[r] + y.values[r + 1u]));
+			}
+			if(out.type == RUN) {
+				return;
+			}
+			// too many runs: fall through to the general case
+		}
+		Container tmp_x;
+		Container tmp_y;
+		const Container* a = &materialize(x, tmp_x);
+		const Container* b = &materialize(y, tmp_y);
+		if(a->type == ARRAY && b->type == BITMAP) {
+			std::swap(a, b);
+		}
+		if(a->type == ARRAY && b->type == ARRAY) {
+			out.type = ARRAY;
+			out.words.clear();
+			out.values.resize(a->values.size() + b->values.size());
+			out.values.erase(std::set_union(a->values.begin(), a->values.end(), b->values.begin(), b->values.end(), out.values.begin()), out.values.end());
+			out.cardinality = uint32_t(out.values.size());
+			if(out.cardinality > ARRAY_MAX) {
+				to_bitmap(out);
+			}
+		} else if(b->type == ARRAY) {
+			out.type = BITMAP;
+			out.values.clear();
+			out.words = a->words;
+			out.cardinality = a->cardinality;
+			for(uint16_t low : b->values) {
+				uint64_t& word = out.words[low / 64u];
+				const uint64_t mask = 1ull << (low % 64u);
+				out.cardinality += not (word & mask);
+				word |= mask;
+			}
+		} else {
+			out.type = BITMAP;
+			out.values.clear();
+			out.words.resize(BITMAP_WORDS);
+			out.cardinality = bitmap_or(a->words.data(), b->words.data(), out.words.data());
+		}
+	}
+
+	static void runs_and(const Container& x, const Container& y, Container& out) noexcept {
+		out.type = RUN;
+		out.cardinality = 0;
+		size_t i = 0;
+		size_t j = 0;
+		while(i < x.values.size() && j < y.values.size()) {
+			const uint32_t x_end = uint32_t(x.values[i]) + x.values[i + 1u];
+			const uint32_t y_end = uint32_t(y.values[j]) + y.values[j + 1u];
+			const uint32_t start = std::max(x.values[i], y.values[j]);
+			const uint32_t end = std::min(x_end, y_end);
+			if(start <= end) {
+				out.values.push_back(uint16_t(start));
+				out.values.push_back(uint16_t(end - start));
+				out.cardinality += end - start + 1u;
+			}
+			if(x_end < y_end) {
+				i += 2u;
+			} else {
+				j += 2u;
+			}
+		}
+	}
+
+public:
+
+	/**
+	 * The sorted arrays intersection, @out MUST have min(na, nb) + 8 values of space.
+	 * @return The intersection size.
+	 */
+	static size_t intersect_arrays(const uint16_t* a, size_t na, const uint16_t* b, size_t nb, uint16_t* out) noexcept {
+		if(na > nb) {
+			std::swap(a, b);
+			std::swap(na, nb);
+		}
+		if(na * 64u < nb) {
+			return intersect_galloping(a, na, b, nb, out);
+		}
+		if(utils::Cpu::sse42()) {
+			return intersect_sse42(a, na, b, nb, out);
+		}
+		return intersect_scalar(a, na, b, nb, out);
+	}
+
+	static size_t intersect_scalar(const uint16_t* a, size_t na, const uint16_t* b, size_t nb, uint16_t* out) noexcept {
+		size_t i = 0;
+		size_t j = 0;
+		size_t count = 0;
+		while(i < na && j < nb) {
+			if(a[i] < b[j]) {
+				++i;
+			} else if(b[j] < a[i]) {
+				++j;
+			} else {
+				out[count++] = a[i];
+				++i;
+				++j;
+			}
+		}
+		return count;
+	}
+
+	/**
+	 * Every value of the small array is searched exponentially and then binary in the large one.
+	 */
+	static size_t intersect_galloping(const uint16_t* small, size_t ns, const uint16_t* large, size_t nl, uint16_t* out) noexcept {
+		size_t count = 0;
+		size_t base = 0;
+		for(size_t i = 0; i < ns && base < nl; ++i) {
+			const uint16_t value = small[i];
+			size_t step = 1;
+			while(base + step < nl && large[base + step] < value) {
+				step <<= 1u;
+			}
+			const uint16_t* pos = std::lower_bound(large + base + step / 2u, large + std::min(base + step + 1u, nl), value);
+			base = size_t(pos - large);
+			if(base < nl && large[base] == value) {
+				out[count++] = value;
+			}
+		}
+		return count;
+	}
+
+	/**
+	 * The pcmpestrm intersection of 8 by 8 values, the matches are packed with pshufb.
+	 */
+	__attribute__((target("sse4.2,popcnt")))
+	static size_t intersect_sse42(const uint16_t* a, size_t na, const uint16_t* b, size_t nb, uint16_t* out) noexcept {
+		constexpr int MODE = _SIDD_UWORD_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK;
+		const size_t end_a = na & ~size_t(7);
+		const size_t end_b = nb & ~size_t(7);
+		size_t i = 0;
+		size_t j = 0;
+		size_t count = 0;
+		if(end_a && end_b) {
+			__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+			__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+			for(;;) {
+				// the bit k is set if a[i + k] is in b[j:j + 8)
+				const int found = _mm_extract_epi32(_mm_cmpestrm(vb, 8, va, 8, MODE), 0);
+				const __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(shuffle_table().mask[found]));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + count), _mm_shuffle_epi8(va, shuffle));
+				count += unsigned(_mm_popcnt_u32(unsigned(found)));
+				const uint16_t max_a = a[i + 7u];
+				const uint16_t max_b = b[j + 7u];
+				if(max_a <= max_b) {
+					i += 8u;
+					if(i == end_a) {
+						break;
+					}
+					va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+				}
+				if(max_b <= max_a) {
+					j += 8u;
+					if(j == end_b) {
+						break;
+					}
+					vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+				}
+			}
+		}
+		return count + intersect_scalar(a + i, na - i, b + j, nb - j, out + count);
+	}
+
+	/**
+	 * out = a & b over BITMAP_WORDS words.
+	 * @return The number of the set bits in @out.
+	 */
+	static uint32_t bitmap_and(const uint64_t* a, const uint64_t* b, uint64_t* out) noexcept {
+		if(utils::Cpu::avx2()) {
+			return bitmap_and_avx2(a, b, out);
+		}
+		uint32_t result = 0;
+		for(uint32_t w = 0; w < BITMAP_WORDS; ++w) {
+			out[w] = a[w] & b[w];
+			result += unsigned(__builtin_popcountll(out[w]));
+		}
+		return result;
+	}
+
+	/**
+	 * out = a | b over BITMAP_WORDS words.
+	 * @return The number of the set bits in @out.
+	 */
+	static uint32_t bitmap_or(const uint64_t* a, const uint64_t* b, uint64_t* out) noexcept {
+		if(utils::Cpu::avx2()) {
+			return bitmap_or_avx2(a, b, out);
+		}
+		uint32_t result = 0;
+		for(uint32_t w = 0; w < BITMAP_WORDS; ++w) {
+			out[w] = a[w] | b[w];
+			result += unsigned(__builtin_popcountll(out[w]));
+		}
+		return result;
+	}
+
+	__attribute__((target("avx2,popcnt")))
+	static uint32_t bitmap_and_avx2(const uint64_t* a, const uint64_t* b, uint64_t* out) noexcept {
+		uint64_t result = 0;
+		for(uint32_t w = 0; w < BITMAP_WORDS; w += 4u) {
+			const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + w));
+			const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + w));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + w), _mm256_and_si256(va, vb));
+			result += _mm_popcnt_u64(out[w]) + _mm_popcnt_u64(out[w + 1u]) + _mm_popcnt_u64(out[w + 2u]) + _mm_popcnt_u64(out[w + 3u]);
+		}
+		return uint32_t(result);
+	}
+
+	__attribute__((target("avx2,popcnt")))
+	static uint32_t bitmap_or_avx2(const uint64_t* a, const uint64_t* b, uint64_t* out) noexcept {
+		uint64_t result = 0;
+		for(uint32_t w = 0; w < BITMAP_WORDS; w += 4u) {
+			const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + w));
+			const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + w));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + w), _mm256_or_si256(va, vb));
+			result += _mm_popcnt_u64(out[w]) + _mm_popcnt_u64(out[w + 1u]) + _mm_popcnt_u64(out[w + 2u]) + _mm_popcnt_u64(out[w + 3u]);
+		}
+		return uint32_t(result);
+	}
+
+private:
+
+	/**
+	 * pshufb masks packing the 16-bit lanes selected by an 8-bit mask to the front.
+	 */
+	struct ShuffleTable {
+		uint8_t mask[256][16];
+
+		constexpr ShuffleTable() noexcept : mask() {
+			for(unsigned found = 0; found < 256u; ++found) {
+				unsigned k = 0;
+				for(unsigned lane = 0; lane < 8u; ++lane) {
+					if((found >> lane) & 1u) {
+						mask[found][k * 2u] = uint8_t(lane * 2u);
+						mask[found][k * 2u + 1u] = uint8_t(lane * 2u + 1u);
+						++k;
+					}
+				}
+				for(; k < 8u; ++k) {
+					mask[found][k * 2u] = mask[found][k * 2u + 1u] = 0xFF;
+				}
+			}
+		}
+	};
+
+	static inline const ShuffleTable& shuffle_table() noexcept {
+		static constexpr ShuffleTable table;
+		return table;
+	}
+
+	friend class RoaringView;
+};
+
+/**
+ * A read-only RoaringBitmap over a serialised image, the image is not copied.
+ * The image MUST be 8-byte aligned and outlive the view.
+ *
+ * Using sample:
+ * RoaringView view;
+ * if(view.attach(mmap_ptr, mmap_bytes) == 0 && view.contains(ip)) ...
+ */
+class RoaringView {
+	using Header = RoaringBitmap::Header;
+	using Entry = RoaringBitmap::Entry;
+
+	const uint8_t* m_image = nullptr;
+	const Entry* m_entries = nullptr;
+	uint32_t m_containers = 0;
+	uint64_t m_cardinality = 0;
+
+public:
+
+	/**
+	 * Validate the image and use it.
+	 * @return 0 on success.
+	 */
+	int attach(const void* image, size_t bytes) noexcept {
+		m_image = nullptr;
+		m_containers = 0;
+		m_cardinality = 0;
+		if(bytes < sizeof(Header) || (reinterpret_cast<uintptr_t>(image) & 7u)) {
+			return -1;
+		}
+		auto hdr = static_cast<const Header*>(image);
+		if(hdr->magic != Header::MAGIC || hdr->containers > 65536u
+			|| bytes < sizeof(Header) + size_t(hdr->containers) * sizeof(Entry)) {
+			return -1;
+		}
+		auto entries = reinterpret_cast<const Entry*>(hdr + 1);
+		uint64_t cardinality = 0;
+		for(uint32_t i = 0; i < hdr->containers; ++i) {
+			const Entry& e = entries[i];
+			const size_t unit = (e.type == RoaringBitmap::BITMAP ? sizeof(uint64_t) : sizeof(uint16_t));
+			const bool valid_size = (e.type == RoaringBitmap::ARRAY && e.size == e.cardinality && e.size <= RoaringBitmap::ARRAY_MAX)
+				|| (e.type == RoaringBitmap::BITMAP && e.size == RoaringBitmap::BITMAP_WORDS)
+				|| (e.type == RoaringBitmap::RUN && not (e.size & 1u) && e.size <= 65536u * 2u);
+			if(not valid_size || (e.offset & 7u) || size_t(e.offset) + e.size * unit > bytes
+				|| (i && entries[i - 1].key >= e.key)) {
+				return -1;
+			}
+			cardinality += e.cardinality;
+		}
+		if(cardinality != hdr->cardinality) {
+			return -1;
+		}
+		m_image = static_cast<const uint8_t*>(image);
+		m_entries = entries;
+		m_containers = hdr->containers;
+		m_cardinality = cardinality;
+		return 0;
+	}
+
+	inline uint64_t cardinality() const noexcept {
+		return m_cardinality;
+	}
+
+	inline uint32_t containers() const noexcept {
+		return m_containers;
+	}
+
+	/**
+	 * @param idx - in [0:containers()).
+	 */
+	inline RoaringBitmap::Span span(uint32_t idx) const noexcept {
+		const Entry& e = m_entries[idx];
+		return {e.key, RoaringBitmap::Type(e.type), e.cardinality, e.size, m_image + e.offset};
+	}
+
+	bool contains(uint32_t value) const noexcept {
+		const uint16_t key = uint16_t(value >> 16u);
+		uint32_t lo = 0;
+		uint32_t hi = m_containers;
+		while(lo < hi) {
+			const uint32_t mid = (lo + hi) / 2u;
+			if(m_entries[mid].key < key) {
+				lo = mid + 1u;
+			} else {
+				hi = mid;
+			}
+		}
+		return lo < m_containers && m_entries[lo].key == key && span(lo).contains(uint16_t(value));
+	}
+
+	template <typename Fn>
+	void for_each(Fn&& fn) const noexcept {
+		for(uint32_t i = 0; i < m_containers; ++i) {
+			span(i).for_each(fn);
+		}
+	}
+
+};
+
+inline bool RoaringBitmap::deserialize(const void* buffer, size_t buffer_bytes) noexcept {
+	RoaringView view;
+	if(view.attach(buffer, buffer_bytes) != 0) {
+		return false;
+	}
+	m_containers.clear();
+	m_containers.resize(view.containers());
+	for(uint32_t i = 0; i < view.containers(); ++i) {
+		const Span span = view.span(i);
+		Container& c = m_containers[i];
+		c.key = span.key;
+		c.type = span.type;
+		c.cardinality = span.cardinality;
+		if(span.type == BITMAP) {
+			c.words.assign(span.words(), span.words() + span.size);
+		} else {
+			c.values.assign(span.values(), span.values() + span.size);
+		}
+	}
+	return true;
+}
@@ -324,60 +324,60 @@ private:
 		auto it = m_pool.push_back();
 		assert(it != m_pool.end());
 		it->value = value;
-		assert(it->il_linked);
+		assert(it->__ill.linked);
 	}
 
 	void push_front_one(const Value_t& value) noexcept {
 		auto it = m_pool.push_front();
 		assert(it != m_pool.end());
 		it->value = value;
-		assert(it->il_linked);
+		assert(it->__ill.linked);
 	}
 
 	void peek_front_one(const Value_t& value) noexcept {
 		auto it = m_pool.begin();
 		assert(it != m_pool.end());
 		it->value = value;
-		assert(it->il_linked);
+		assert(it->__ill.linked);
 	}
 
 	void peek_back_one(const Value_t& value) noexcept {
 		auto it = m_pool.rbegin();
 		assert(it != m_pool.rend());
 		it->value = value;
-		assert(it->il_linked);
+		assert(it->__ill.linked);
 	}
 
 	void pop_front_one(const Value_t& value) noexcept {
 		auto it = m_pool.pop_front();
 		assert(it != m_pool.end());
 		it->value = value;
-		assert(it->il_linked);
+		assert(it->__ill.linked);
 	}
 
 	void pop_back_one(const Value_t& value) noexcept {
 		auto it = m_pool.pop_back();
 		assert(it != m_pool.end());
 		it->value = value;
-		assert(it->il_linked);
+		assert(it->__ill.linked);
 	}
 
 	void remove_front_one(const Value_t& value) noexcept {
 		auto it = m_pool.begin();
 		assert(it != m_pool.end());
 		it->value = value;
-		assert(it->il_linked);
+		assert(it->__ill.linked);
 		m_pool.remove(it);
-		assert(it->il_linked);
+		assert(it->__ill.linked);
 	}
 
 	void remove_back_one(const Value_t& value) noexcept {
 		auto it = m_pool.rbegin();
 		assert(it != m_pool.rend());
 		it->value = value;
-		assert(it->il_linked);
+		assert(it->__ill.linked);
 		m_pool.remove(it);
-		assert(it->il_linked);
+		assert(it->__ill.linked);
 	}
 
 	void oversize_one() noexcept {
@@ -389,7 +389,7 @@ private:
 
 	void test_sanity() {
 		for(unsigned i = 0; i < m_capacity; i++) {
-			assert(m_pool.m_storage[i].il_linked);
+			assert(m_pool.m_storage[i].__ill.linked);
 		}
 	}
 
@@ -297,7 +297,7 @@ private:
 		assert(it != m_pool.end());
 		assert(it->value == value);
 		assert(it->im_key == key);
-		assert(it->il_linked);
+		assert(it->__ill.linked);
 		assert(it->im_linked);
 	}
 
@@ -308,7 +308,7 @@ private:
 			assert(it->im_key == key);
 			assert(it->im_linked);
 			if(it->value == value) {
-				assert(it->il_linked);
+				assert(it->__ill.linked);
 				assert(it->im_linked);
 				return;
 			}
@@ -327,9 +327,9 @@ private:
 		assert(it != m_pool.end());
 		assert(it->value == value);
 		assert(it->im_key == key);
-		assert(it->il_linked);
+		assert(it->__ill.linked);
 		m_pool.remove(it);
-		assert(it->il_linked);
+		assert(it->__ill.linked);
 		assert(not it->im_linked);
 		it = m_pool.find(key);
 		assert(it == m_pool.end());
@@ -342,10 +342,10 @@ private:
 			assert(it->im_key == key);
 			assert(it->im_linked);
 			if(it->value == value) {
-				assert(it->il_linked);
+				assert(it->__ill.linked);
 				assert(it->im_linked);
 				m_pool.remove(it);
-				assert(it->il_linked);
+				assert(it->__ill.linked);
 				assert(not it->im_linked);
 				return;
 			}
@@ -356,7 +356,7 @@ private:
 	void test_sanity() {
 		for(Key_t i = 0; i < m_capacity; i++) {
 			assert(not m_pool.m_storage[i].im_linked);
-			assert(m_pool.m_storage[i].il_linked);
+			assert(m_pool.m_storage[i].__ill.linked);
 		}
 	}
 
@@ -0,0 +1,463 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+/**
+ * Header-only.
+ *
+ * BPlusTree is an ordered map with the nodes of NodeBytes bytes (4 cache lines by default)
+ * taken from two pools preallocated by allocate(), like the intrusive pools do:
+ * no allocation happens on insert() and insert() fails when a pool is exhausted.
+ *
+ * The inner nodes keep the separators and the 32-bit pool indexes of the children,
+ * the leaves keep the keys and the values and are linked in both directions for the range scans.
+ * A child i of an inner node holds the keys in [keys[i - 1]:keys[i]).
+ *
+ * erase() doesn't merge the underfull nodes: a node goes back to the pool when it becomes empty
+ * and the root shrinks when it has a single child. That keeps erase() cheap and the tree valid,
+ * the price is a lower fill factor after the massive removals.
+ *
+ * Key and Value MUST be trivially copyable.
+ *
+ * Using sample:
+ * BPlusTree<uint64_t, uint32_t> index(1 << 16);
+ * if(index.allocate() == 0) {
+ *     index.insert(ts, record);
+ *     for(auto it = index.lower_bound(ts_from); it.valid() && it.key() < ts_to; it.next()) ...
+ * }
+ */
+template <typename Key, typename Value, size_t NodeBytes = 256>
+class BPlusTree {
+	static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value
+		, "The keys and the values are moved as the plain memory.");
+
+	using Index_t = uint32_t;
+
+	static constexpr Index_t NIL = ~Index_t(0);
+	static constexpr uint32_t DEPTH_MAX = 32;
+
+public:
+
+	static constexpr uint32_t INNER_KEYS = (NodeBytes - 2 * sizeof(uint32_t)) / (sizeof(Key) + sizeof(Index_t));
+	static constexpr uint32_t LEAF_KEYS = (NodeBytes - 4 * sizeof(uint32_t)) / (sizeof(Key) + sizeof(Value));
+
+	static_assert(INNER_KEYS >= 4 && LEAF_KEYS >= 4, "The node is too small for the key and the value.");
+
+private:
+
+	struct alignas(64) Inner {
+		uint32_t count;
+		Key keys[INNER_KEYS];
+		Index_t children[INNER_KEYS + 1];
+	};
+
+	struct alignas(64) Leaf {
+		uint32_t count;
+		Index_t next;
+		Index_t prev;
+		Key keys[LEAF_KEYS];
+		Value values[LEAF_KEYS];
+	};
+
+	const uint32_t m_leaf_capacity;
+	const uint32_t m_inner_capacity;
+	std::unique_ptr<Leaf[]> m_leaves;
+	std::unique_ptr<Inner[]> m_inners;
+	Index_t m_free_leaf = NIL;
+	Index_t m_free_inner = NIL;
+	uint32_t m_leaves_free = 0;
+	uint32_t m_inners_free = 0;
+	Index_t m_root = NIL;
+	uint32_t m_height = 0;
+	size_t m_size = 0;
+
+public:
+
+	/**
+	 * A position in the leaves.
+	 */
+	class Iterator {
+		friend class BPlusTree;
+
+		const BPlusTree* m_tree;
+		Index_t m_leaf;
+		uint32_t m_pos;
+
+		Iterator(const BPlusTree* tree, Index_t leaf, uint32_t pos) noexcept : m_tree(tree), m_leaf(leaf), m_pos(pos) {
+			skip_end();
+		}
+
+		inline void skip_end() noexcept {
+			if(m_leaf != NIL && m_pos >= m_tree->m_leaves[m_leaf].count) {
+				m_leaf = m_tree->m_leaves[m_leaf].next;
+				m_pos = 0;
+			}
+		}
+
+	public:
+
+		inline bool valid() const noexcept {
+			return m_leaf != NIL;
+		}
+
+		inline const Key& key() const noexcept {
+			return m_tree->m_leaves[m_leaf].keys[m_pos];
+		}
+
+		inline const Value& value() const noexcept {
+			return m_tree->m_leaves[m_leaf].values[m_pos];
+		}
+
+		inline void next() noexcept {
+			++m_pos;
+			skip_end();
+		}
+	};
+
+	/**
+	 * @param leaf_capacity - the leaf pool size, holds up to leaf_capacity * LEAF_KEYS / 2 keys for sure.
+	 * @param inner_capacity - the inner node pool size, 0 for a quarter of @leaf_capacity.
+	 */
+	explicit BPlusTree(uint32_t leaf_capacity, uint32_t inner_capacity = 0) noexcept
+		: m_leaf_capacity(leaf_capacity)
+		, m_inner_capacity(inner_capacity ? inner_capacity : leaf_capacity / 4u + DEPTH_MAX) {}
+
+	BPlusTree(const BPlusTree&) = delete;
+	BPlusTree& operator=(const BPlusTree&) = delete;
+
+	/**
+	 * Allocate the node pools.
+	 * @return 0 on success.
+	 */
+	int allocate() noexcept {
+		if(m_leaves || not m_leaf_capacity) {
+			return -1;
+		}
+		m_leaves.reset(new(std::nothrow) Leaf[m_leaf_capacity]);
+		m_inners.reset(new(std::nothrow) Inner[m_inner_capacity]);
+		if(not m_leaves || not m_inners) {
+			m_leaves.reset();
+			m_inners.reset();
+			return -1;
+		}
+		clear();
+		return 0;
+	}
+
+	/**
+	 * Return all the nodes to the pools.
+	 */
+	void clear() noexcept {
+		m_free_leaf = m_free_inner = NIL;
+		m_leaves_free = m_inners_free = 0;
+		for(Index_t i = m_leaf_capacity; i-- > 0;) {
+			free_leaf(i);
+		}
+		for(Index_t i = m_inner_capacity; i-- > 0;) {
+			free_inner(i);
+		}
+		m_root = alloc_leaf();
+		m_height = 0;
+		m_size = 0;
+	}
+
+	inline size_t size() const noexcept {
+		return m_size;
+	}
+
+	/**
+	 * @return The number of the inner levels.
+	 */
+	inline uint32_t height() const noexcept {
+		return m_height;
+	}
+
+	/**
+	 * @return The memory used by the nodes in bytes.
+	 */
+	inline size_t used_bytes() const noexcept {
+		return size_t(m_leaf_capacity - m_leaves_free) * sizeof(Leaf) + size_t(m_inner_capacity - m_inners_free) * sizeof(Inner);
+	}
+
+	/**
+	 * @return The value of @key or nullptr.
+	 */
+	const Value* find(const Key& key) const noexcept {
+		const Leaf& leaf = m_leaves[descend(key)];
+		const uint32_t pos = lower_index(leaf.keys, leaf.count, key);
+		return (pos < leaf.count && not (key < leaf.keys[pos])) ? &leaf.values[pos] : nullptr;
+	}
+
+	inline Value* find(const Key& key) noexcept {
+		return const_cast<Value*>(static_cast<const BPlusTree*>(this)->find(key));
+	}
+
+	/**
+	 * @return The first key not less than @key.
+	 */
+	Iterator lower_bound(const Key& key) const noexcept {
+		const Index_t idx = descend(key);
+		const Leaf& leaf = m_leaves[idx];
+		return Iterator(this, idx, lower_index(leaf.keys, leaf.count, key));
+	}
+
+	Iterator begin() const noexcept {
+		Index_t node = m_root;
+		for(uint32_t level = 0; level < m_height; ++level) {
+			node = m_inners[node].children[0];
+		}
+		return Iterator(this, node, 0);
+	}
+
+	/**
+	 * Insert @key or replace its value.
+	 * @return false - if the node pools are exhausted, the tree is not changed.
+	 */
+	bool insert(const Key& key, const Value& value) noexcept {
+		Index_t path[DEPTH_MAX];
+		uint32_t slots[DEPTH_MAX];
+		const Index_t idx = descend(key, path, slots);
+		Leaf& leaf = m_leaves[idx];
+		const uint32_t pos = lower_index(leaf.keys, leaf.count, key);
+		if(pos < leaf.count && not (key < leaf.keys[pos])) {
+			leaf.values[pos] = value;
+			return true;
+		}
+		if(leaf.count < LEAF_KEYS) {
+			leaf_insert(leaf, pos, key, value);
+			++m_size;
+			return true;
+		}
+		// the worst case splits the leaf, every inner node and adds a root
+		if(not m_leaves_free || m_inners_free < m_height + 1u || m_height + 1u >= DEPTH_MAX) {
+			return false;
+		}
+
+		const Index_t right_idx = alloc_leaf();
+		Leaf& right = m_leaves[right_idx];
+		const uint32_t half = (LEAF_KEYS + 1u) / 2u;
+		right.count = leaf.count - half;
+		std::copy(leaf.keys + half, leaf.keys + leaf.count, right.keys);
+		std::copy(leaf.values + half, leaf.values + leaf.count, right.values);
+		leaf.count = half;
+		right.next = leaf.next;
+		right.prev = idx;
+		if(leaf.next != NIL) {
+			m_leaves[leaf.next].prev = right_idx;
+		}
+		leaf.next = right_idx;
+		if(pos < half) {
+			leaf_insert(leaf, pos, key, value);
+		} else {
+			leaf_insert(right, pos - half, key, value);
+		}
+		++m_size;
+
+		Key separator = right.keys[0];
+		Index_t child = right_idx;
+		for(uint32_t level = m_height; level-- > 0;) {
+			Inner& node = m_inners[path[level]];
+			const uint32_t slot = slots[level];
+			if(node.count < INNER_KEYS) {
+				inner_insert(node, slot, separator, child);
+				return true;
+			}
+			// split the node as if it had INNER_KEYS + 1 keys, the middle key goes up
+			Key keys[INNER_KEYS + 1];
+			Index_t children[INNER_KEYS + 2];
+			std::copy(node.keys, node.keys + slot, keys);
+			keys[slot] = separator;
+			std::copy(node.keys + slot, node.keys + node.count, keys + slot + 1);
+			std::copy(node.children, node.children + slot + 1, children);
+			children[slot + 1] = child;
+			std::copy(node.children + slot + 1, node.children + node.count + 1, children + slot + 2);
+
+			const uint32_t mid = (INNER_KEYS + 1u) / 2u;
+			const Index_t sibling_idx = alloc_inner();
+			Inner& sibling = m_inners[sibling_idx];
+			node.count = mid;
+			std::copy(keys, keys + mid, node.keys);
+			std::copy(children, children + mid + 1, node.children);
+			sibling.count = INNER_KEYS - mid;
+			std::copy(keys + mid + 1, keys + INNER_KEYS + 1, sibling.keys);
+			std::copy(children + mid + 1, children + INNER_KEYS + 2, sibling.children);
+			separator = keys[mid];
+			child = sibling_idx;
+		}
+
+		const Index_t root_idx = alloc_inner();
+		Inner& root = m_inners[root_idx];
+		root.count = 1;
+		root.keys[0] = separator;
+		root.children[0] = m_root;
+		root.children[1] = child;
+		m_root = root_idx;
+		++m_height;
+		return true;
+	}
+
+	/**
+	 * @return true - if @key has been removed.
+	 */
+	bool erase(const Key& key) noexcept {
+		Index_t path[DEPTH_MAX];
+		uint32_t slots[DEPTH_MAX];
+		const Index_t idx = descend(key, path, slots);
+		Leaf& leaf = m_leaves[idx];
+		const uint32_t pos = lower_index(leaf.keys, leaf.count, key);
+		if(pos >= leaf.count || key < leaf.keys[pos]) {
+			return false;
+		}
+		std::copy(leaf.keys + pos + 1, leaf.keys + leaf.count, leaf.keys + pos);
+		std::copy(leaf.values + pos + 1, leaf.values + leaf.count, leaf.values + pos);
+		--leaf.count;
+		--m_size;
+		if(leaf.count || not m_height) {
+			return true;
+		}
+
+		// the empty leaf leaves the list and its parents
+		if(leaf.prev != NIL) {
+			m_leaves[leaf.prev].next = leaf.next;
+		}
+		if(leaf.next != NIL) {
+			m_leaves[leaf.next].prev = leaf.prev;
+		}
+		free_leaf(idx);
+		uint32_t level = m_height;
+		while(level-- > 0) {
+			Inner& node = m_inners[path[level]];
+			if(not node.count) {
+				// the only child is gone
+				free_inner(path[level]);
+				continue;
+			}
+			const uint32_t slot = slots[level];
+			const uint32_t key_pos = slot ? slot - 1u : 0;
+			std::copy(node.keys + key_pos + 1, node.keys + node.count, node.keys + key_pos);
+			std::copy(node.children + slot + 1, node.children + node.count + 1, node.children + slot);
+			--node.count;
+			break;
+		}
+		if(level == ~uint32_t(0)) {
+			// every ancestor is gone, so is every key
+			m_root = alloc_leaf();
+			m_height = 0;
+			return true;
+		}
+		while(m_height && not m_inners[m_root].count) {
+			const Index_t old = m_root;
+			m_root = m_inners[old].children[0];
+			free_inner(old);
+			--m_height;
+		}
+		return true;
+	}
+
+private:
+
+	/**
+	 * The branchless binary search: the halving compiles to cmov, a node is a few cache lines.
+	 */
+	static inline uint32_t lower_index(const Key* keys, uint32_t count, const Key& key) noexcept {
+		if(not count) {
+			return 0;
+		}
+		const Key* base = keys;
+		while(count > 1u) {
+			const uint32_t half = count / 2u;
+			base = (base[half] < key) ? base + half : base;
+			count -= half;
+		}
+		return uint32_t(base - keys) + (*base < key);
+	}
+
+	static inline uint32_t upper_index(const Key* keys, uint32_t count, const Key& key) noexcept {
+		if(not count) {
+			return 0;
+		}
+		const Key* base = keys;
+		while(count > 1u) {
+			const uint32_t half = count / 2u;
+			base = (key < base[half]) ? base : base + half;
+			count -= half;
+		}
+		return uint32_t(base - keys) + not (key < *base);
+	}
+
+	Index_t descend(const Key& key) const noexcept {
+		Index_t node = m_root;
+		for(uint32_t level = 0; level < m_height; ++level) {
+			const Inner& inner = m_inners[node];
+			node = inner.children[upper_index(inner.keys, inner.count, key)];
+		}
+		return node;
+	}
+
+	Index_t descend(const Key& key, Index_t* path, uint32_t* slots) const noexcept {
+		Index_t node = m_root;
+		for(uint32_t level = 0; level < m_height; ++level) {
+			const Inner& inner = m_inners[node];
+			path[level] = node;
+			slots[level] = upper_index(inner.keys, inner.count, key);
+			node = inner.children[slots[level]];
+		}
+		return node;
+	}
+
+	static inline void leaf_insert(Leaf& leaf, uint32_t pos, const Key& key, const Value& value) noexcept {
+		std::copy_backward(leaf.keys + pos, leaf.keys + leaf.count, leaf.keys + leaf.count + 1);
+		std::copy_backward(leaf.values + pos, leaf.values + leaf.count, leaf.values + leaf.count + 1);
+		leaf.keys[pos] = key;
+		leaf.values[pos] = value;
+		++leaf.count;
+	}
+
+	/**
+	 * Insert @separator at @slot and @child right to it.
+	 */
+	static inline void inner_insert(Inner& node, uint32_t slot, const Key& separator, Index_t child) noexcept {
+		std::copy_backward(node.keys + slot, node.keys + node.count, node.keys + node.count + 1);
+		std::copy_backward(node.children + slot + 1, node.children + node.count + 1, node.children + node.count + 2);
+		node.keys[slot] = separator;
+		node.children[slot + 1] = child;
+		++node.count;
+	}
+
+	Index_t alloc_leaf() noexcept {
+		const Index_t idx = m_free_leaf;
+		Leaf& leaf = m_leaves[idx];
+		m_free_leaf = leaf.next;
+		--m_leaves_free;
+		leaf.count = 0;
+		leaf.next = leaf.prev = NIL;
+		return idx;
+	}
+
+	void free_leaf(Index_t idx) noexcept {
+		m_leaves[idx].next = m_free_leaf;
+		m_free_leaf = idx;
+		++m_leaves_free;
+	}
+
+	Index_t alloc_inner() noexcept {
+		const Index_t idx = m_free_inner;
+		Inner& inner = m_inners[idx];
+		m_free_inner = inner.children[0];
+		--m_inners_free;
+		inner.count = 0;
+		return idx;
+	}
+
+	void free_inner(Index_t idx) noexcept {
+		m_inners[idx].children[0] = m_free_inner;
+		m_free_inner = idx;
+		++m_inners_free;
+	}
+
+};
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Header-only.
+ *
+ * EytzingerArray is a static sorted map built once from the sorted keys.
+ * The keys are stored in the BFS order of the implicit binary search tree (Eytzinger layout):
+ * the node k has the children 2k and 2k + 1, the root is 1.
+ * The search is a branchless descent k = 2k + (key[k] < x), the top of the tree stays in the cache
+ * and the nodes 4 levels ahead (one cache line of the descendants) are prefetched,
+ * so the lookups don't wait on the memory as much as std::lower_bound() does.
+ *
+ * A position is the node index in [1:size()], 0 is the end.
+ * next()/prev() walk the positions in the key order.
+ *
+ * Using sample (the port ranges, the value is the range end):
+ * EytzingerArray<uint16_t, uint16_t> ranges;
+ * ranges.build(firsts, lasts, n);
+ * const size_t pos = ranges.floor(port);
+ * if(pos && port <= ranges.value(pos)) ...
+ */
+template <typename Key, typename Value>
+class EytzingerArray {
+	static_assert(std::is_trivially_copyable<Key>::value, "The keys are copied as the plain memory.");
+
+	static constexpr size_t CACHE_LINE = 64;
+	static constexpr size_t STRIDE = (sizeof(Key) < CACHE_LINE ? CACHE_LINE / sizeof(Key) : 1);
+
+	struct Free {
+		void operator()(Key* ptr) const noexcept {
+			free(ptr);
+		}
+	};
+
+	size_t m_size = 0;
+	std::unique_ptr<Key, Free> m_keys;
+	std::vector<Value> m_values;
+
+public:
+
+	/**
+	 * Build the array from the sorted keys.
+	 * @param keys - @size keys in the ascending order.
+	 * @param values - @size values of the keys.
+	 * @return 0 on success.
+	 */
+	int build(const Key* keys, const Value* values, size_t size) noexcept {
+		// the descendants of a node share a cache line when the array is aligned
+		const size_t bytes = ((size + 1) * sizeof(Key) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+		m_keys.reset(static_cast<Key*>(aligned_alloc(CACHE_LINE, bytes)));
+		if(not m_keys) {
+			m_size = 0;
+			return -1;
+		}
+		m_size = size;
+		m_values.resize(size + 1);
+		size_t idx = 0;
+		fill(keys, values, idx, 1);
+		return 0;
+	}
+
+	inline size_t size() const noexcept {
+		return m_size;
+	}
+
+	inline const Key& key(size_t pos) const noexcept {
+		return m_keys.get()[pos];
+	}
+
+	inline const Value& value(size_t pos) const noexcept {
+		return m_values[pos];
+	}
+
+	/**
+	 * @return The position of the first key not less than @key or 0.
+	 */
+	size_t lower_bound(const Key& key) const noexcept {
+		const Key* keys = m_keys.get();
+		size_t k = 1;
+		while(k <= m_size) {
+			__builtin_prefetch(keys + k * STRIDE);
+			k = 2 * k + (keys[k] < key);
+		}
+		// drop the right turns made after the last left one
+		return k >> __builtin_ffsll(~k);
+	}
+
+	/**
+	 * @return The position of the first key greater than @key or 0.
+	 */
+	size_t upper_bound(const Key& key) const noexcept {
+		const Key* keys = m_keys.get();
+		size_t k = 1;
+		while(k <= m_size) {
+			__builtin_prefetch(keys + k * STRIDE);
+			k = 2 * k + not (key < keys[k]);
+		}
+		return k >> __builtin_ffsll(~k);
+	}
+
+	/**
+	 * @return The position of the last key not greater than @key or 0.
+	 */
+	inline size_t floor(const Key& key) const noexcept {
+		return prev(upper_bound(key));
+	}
+
+	/**
+	 * @return The value of @key or nullptr.
+	 */
+	inline const Value* find(const Key& key) const noexcept {
+		const size_t pos = lower_bound(key);
+		return (pos && not (key < m_keys.get()[pos])) ? &m_values[pos] : nullptr;
+	}
+
+	/**
+	 * @return The position of the smallest key or 0.
+	 */
+	size_t first() const noexcept {
+		if(not m_size) {
+			return 0;
+		}
+		size_t k = 1;
+		while(2 * k <= m_size) {
+			k = 2 * k;
+		}
+		return k;
+	}
+
+	/**
+	 * @return The position following @pos in the key order or 0.
+	 */
+	size_t next(size_t pos) const noexcept {
+		if(2 * pos + 1 <= m_size) {
+			pos = 2 * pos + 1;
+			while(2 * pos <= m_size) {
+				pos = 2 * pos;
+			}
+			return pos;
+		}
+		// up while coming from the right
+		return pos >> __builtin_ffsll(~pos);
+	}
+
+	/**
+	 * @return The position preceding @pos in the key order, the last one for 0, or 0.
+	 */
+	size_t prev(size_t pos) const noexcept {
+		if(not pos) {
+			if(not m_size) {
+				return 0;
+			}
+			pos = 1;
+			while(2 * pos + 1 <= m_size) {
+				pos = 2 * pos + 1;
+			}
+			return pos;
+		}
+		if(2 * pos <= m_size) {
+			pos = 2 * pos;
+			while(2 * pos + 1 <= m_size) {
+				pos = 2 * pos + 1;
+			}
+			return pos;
+		}
+		// up while coming from the left
+		return pos >> __builtin_ffsll(pos);
+	}
+
+	/**
+	 * @return The memory used in bytes.
+	 */
+	inline size_t storage_bytes() const noexcept {
+		return (m_size + 1) * (sizeof(Key) + sizeof(Value));
+	}
+
+private:
+
+	void fill(const Key* keys, const Value* values, size_t& idx, size_t k) noexcept {
+		if(k <= m_size) {
+			fill(keys, values, idx, 2 * k);
+			m_keys.get()[k] = keys[idx];
+			m_values[k] = values[idx];
+			++idx;
+			fill(keys, values, idx, 2 * k + 1);
+		}
+	}
+
+};
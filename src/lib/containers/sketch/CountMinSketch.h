@@ -0,0 +1,266 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include "Sketch.h"
+#include "../bits/BitArray.h"
+
+namespace sketch {
+
+/**
+ * Count-min sketch with BitWidth-bit saturating counters packed in a BitArray.
+ *
+ * The sketch keeps @rows rows of @columns counters, a key updates one counter in every row.
+ * The row positions are derived from a single 64-bit key hash with the double hashing
+ * h1 + row * h2, so the caller hashes the key once (e.g. FiveTuple::Hash or hash64()).
+ * The estimate is the minimum over the rows: it never underestimates until a counter saturates,
+ * and overestimates by at most total() * e / columns with probability 1 - e^-rows.
+ *
+ * add_conservative() is the conservative update: only the counters equal to the minimum grow,
+ * which lowers the overestimation of the light keys a lot.
+ *
+ * The sketches of the same shape and seed are mergeable: merge() adds the counters with saturation,
+ * serialize()/deserialize() move the sketch between the processes or the hosts.
+ *
+ * Using sample:
+ * sketch::CountMinSketch<8> cms(4, 1 << 16);
+ * if(cms.allocate() == 0) {
+ *     cms.add_conservative(sketch::hash64(key));
+ *     auto count = cms.estimate(sketch::hash64(key));
+ * }
+ */
+template <uint8_t BitWidth>
+class CountMinSketch {
+	static_assert(BitWidth >= 1 && BitWidth <= 32, "The counter width must be in [1:32].");
+
+	using Array_t = BitArray<BitWidth, uint64_t>;
+
+	static constexpr uint32_t ROWS_MAX = 16;
+
+	const uint32_t m_rows;
+	const uint32_t m_columns;
+	const uint64_t m_seed;
+	uint64_t m_total = 0;
+	size_t m_chunks_nb = 0;
+	std::unique_ptr<uint64_t[]> m_chunks;
+	Array_t m_counters;
+
+public:
+
+	/**
+	 * @param rows - the depth, MUST be in [1:16].
+	 * @param columns - the width, MUST be a power of two.
+	 * @param seed - the hash seed, only the sketches with the same seed are mergeable.
+	 */
+	CountMinSketch(uint32_t rows, uint32_t columns, uint64_t seed = 0) noexcept
+		: m_rows(rows)
+		, m_columns(columns)
+		, m_seed(seed) {
+		assert(rows >= 1 && rows <= ROWS_MAX);
+		assert(columns && (columns & (columns - 1u)) == 0);
+	}
+
+	/**
+	 * Allocate the counters and set them to zero.
+	 * @return 0 on success.
+	 */
+	int allocate() noexcept {
+		const size_t items = size_t(m_rows) * m_columns;
+		m_chunks_nb = (items * BitWidth + 63u) / 64u;
+		m_chunks.reset(new(std::nothrow) uint64_t[m_chunks_nb]());
+		if(not m_chunks) {
+			return -1;
+		}
+		m_counters.allocate(m_chunks.get(), m_chunks_nb * sizeof(uint64_t));
+		return 0;
+	}
+
+	/**
+	 * Add @count to the key counters.
+	 * @param hash - the key hash.
+	 */
+	void add(uint64_t hash, uint64_t count = 1) noexcept {
+		m_total += count;
+		size_t index[ROWS_MAX];
+		positions(hash, index);
+		for(uint32_t row = 0; row < m_rows; ++row) {
+			const uint64_t value = m_counters.load(index[row]);
+			m_counters.store(index[row], saturate(value, count));
+		}
+	}
+
+	/**
+	 * Conservative update: raise the key counters to the new estimate only.
+	 * @param hash - the key hash.
+	 */
+	void add_conservative(uint64_t hash, uint64_t count = 1) noexcept {
+		m_total += count;
+		size_t index[ROWS_MAX];
+		uint64_t values[ROWS_MAX];
+		positions(hash, index);
+		uint64_t minimum = Array_t::value_max();
+		for(uint32_t row = 0; row < m_rows; ++row) {
+			values[row] = m_counters.load(index[row]);
+			minimum = values[row] < minimum ? values[row] : minimum;
+		}
+		const uint64_t target = saturate(minimum, count);
+		for(uint32_t row = 0; row < m_rows; ++row) {
+			if(values[row] < target) {
+				m_counters.store(index[row], target);
+			}
+		}
+	}
+
+	/**
+	 * @param hash - the key hash.
+	 * @return The key count estimate.
+	 */
+	uint64_t estimate(uint64_t hash) const noexcept {
+		size_t index[ROWS_MAX];
+		positions(hash, index);
+		uint64_t result = Array_t::value_max();
+		for(uint32_t row = 0; row < m_rows; ++row) {
+			const uint64_t value = m_counters.load(index[row]);
+			result = value < result ? value : result;
+		}
+		return result;
+	}
+
+	/**
+	 * Add the counters of @other to this sketch with saturation.
+	 * @return false - if the sketches are of different shapes or seeds.
+	 */
+	bool merge(const CountMinSketch& other) noexcept {
+		if(not compatible(other.m_rows, other.m_columns, other.m_seed)) {
+			return false;
+		}
+		uint64_t dst[BLOCK];
+		uint64_t src[BLOCK];
+		const size_t items = size_t(m_rows) * m_columns;
+		for(size_t first = 0; first < items; first += BLOCK) {
+			const size_t nb = items - first < BLOCK ? items - first : BLOCK;
+			m_counters.load_range(first, nb, dst);
+			other.m_counters.load_range(first, nb, src);
+			add_saturate(dst, src, nb, Array_t::value_max());
+			m_counters.store_range(first, nb, dst);
+		}
+		m_total += other.m_total;
+		return true;
+	}
+
+	/**
+	 * Reset the counters.
+	 */
+	void clear() noexcept {
+		memset(m_chunks.get(), 0, m_chunks_nb * sizeof(uint64_t));
+		m_total = 0;
+	}
+
+	/**
+	 * @return The serialised sketch size.
+	 */
+	inline size_t serialized_bytes() const noexcept {
+		return sizeof(Header) + m_chunks_nb * sizeof(uint64_t);
+	}
+
+	/**
+	 * @param buffer - at least serialized_bytes() bytes.
+	 * @return The number of bytes written or 0 if the buffer is too small.
+	 */
+	size_t serialize(void* buffer, size_t buffer_bytes) const noexcept {
+		if(buffer_bytes < serialized_bytes()) {
+			return 0;
+		}
+		Header hdr;
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.magic = Header::MAGIC;
+		hdr.kind = Header::COUNT_MIN;
+		hdr.bit_width = BitWidth;
+		hdr.rows = m_rows;
+		hdr.columns = m_columns;
+		hdr.seed = m_seed;
+		hdr.total = m_total;
+		hdr.bytes = m_chunks_nb * sizeof(uint64_t);
+		memcpy(buffer, &hdr, sizeof(hdr));
+		memcpy(static_cast<uint8_t*>(buffer) + sizeof(hdr), m_chunks.get(), hdr.bytes);
+		return serialized_bytes();
+	}
+
+	/**
+	 * Replace the counters with a serialised sketch of the same shape and seed.
+	 * @return false - if the data is malformed or incompatible.
+	 */
+	bool deserialize(const void* data, size_t size) noexcept {
+		Header hdr;
+		if(size < sizeof(hdr)) {
+			return false;
+		}
+		memcpy(&hdr, data, sizeof(hdr));
+		if(
+			hdr.magic != Header::MAGIC
+			|| hdr.kind != Header::COUNT_MIN
+			|| hdr.bit_width != BitWidth
+			|| not compatible(hdr.rows, hdr.columns, hdr.seed)
+			|| hdr.bytes != m_chunks_nb * sizeof(uint64_t)
+			|| size < serialized_bytes()
+			) {
+			return false;
+		}
+		memcpy(m_chunks.get(), static_cast<const uint8_t*>(data) + sizeof(hdr), hdr.bytes);
+		m_total = hdr.total;
+		return true;
+	}
+
+	/**
+	 * @return The sum of all the counts added.
+	 */
+	inline uint64_t total() const noexcept {
+		return m_total;
+	}
+
+	inline uint32_t rows() const noexcept {
+		return m_rows;
+	}
+
+	inline uint32_t columns() const noexcept {
+		return m_columns;
+	}
+
+	/**
+	 * @return The memory used by the counters.
+	 */
+	inline size_t storage_bytes() const noexcept {
+		return m_chunks_nb * sizeof(uint64_t);
+	}
+
+	static constexpr uint64_t value_max() noexcept {
+		return Array_t::value_max();
+	}
+
+private:
+
+	inline bool compatible(uint32_t rows, uint32_t columns, uint64_t seed) const noexcept {
+		return rows == m_rows && columns == m_columns && seed == m_seed;
+	}
+
+	static inline uint64_t saturate(uint64_t value, uint64_t count) noexcept {
+		return count >= Array_t::value_max() - value ? Array_t::value_max() : value + count;
+	}
+
+	inline void positions(uint64_t hash, size_t* index) const noexcept {
+		const uint64_t h1 = hash64(hash ^ m_seed);
+		// an odd step visits every column of the power of two row
+		const uint64_t h2 = hash64(h1) | 1u;
+		const uint64_t mask = m_columns - 1u;
+		for(uint32_t row = 0; row < m_rows; ++row) {
+			index[row] = size_t(row) * m_columns + ((h1 + row * h2) & mask);
+		}
+	}
+
+};
+
+}; // namespace sketch
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+
+#include "../../utils/Cpu.h"
+
+namespace sketch {
+
+/**
+ * The common part of the sketches: the key hash mixer, the serialisation header
+ * and the register block kernels.
+ *
+ * The registers are unpacked from BitArray by blocks of BLOCK items (see BitArray::load_range()),
+ * processed as 64-bit lanes and packed back, so the kernels work on plain uint64_t arrays.
+ */
+
+/**
+ * The 64-bit finalizer of MurmurHash3: spreads any 64-bit key (a counter, an address, a hash
+ * of a weak hash function) over all the bits.
+ */
+static inline uint64_t hash64(uint64_t key) noexcept {
+	key ^= key >> 33u;
+	key *= 0xFF51AFD7ED558CCDull;
+	key ^= key >> 33u;
+	key *= 0xC4CEB9FE1A85EC53ull;
+	key ^= key >> 33u;
+	return key;
+}
+
+/**
+ * The serialisation header, followed by the packed register chunks.
+ * All the fields and the chunks are in the host byte order.
+ */
+struct Header {
+	static constexpr uint32_t MAGIC = 0x534B5431; // "SKT1"
+
+	enum Kind : uint8_t {
+		COUNT_MIN = 1,
+		HYPER_LOG_LOG = 2
+	};
+
+	uint32_t magic;
+	uint8_t kind;
+	uint8_t bit_width;   // the register width
+	uint16_t reserved;
+	uint32_t rows;       // the count-min depth or 1
+	uint32_t columns;    // the count-min width or the HLL register number
+	uint64_t seed;
+	uint64_t total;      // the count-min total count or 0
+	uint64_t bytes;      // the chunks size following the header
+};
+
+static constexpr size_t BLOCK = 512;
+
+/**
+ * dst[i] = min(dst[i] + src[i], max), the values MUST be below 2^62.
+ */
+__attribute__((target("avx2")))
+static inline void add_saturate_avx2(uint64_t* dst, const uint64_t* src, size_t nb, uint64_t max) noexcept {
+	const __m256i limit = _mm256_set1_epi64x(int64_t(max));
+	size_t i = 0;
+	for(; i + 4u <= nb; i += 4u) {
+		const __m256i sum = _mm256_add_epi64(
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i))
+			, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+		const __m256i over = _mm256_cmpgt_epi64(sum, limit);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_blendv_epi8(sum, limit, over));
+	}
+	for(; i < nb; ++i) {
+		const uint64_t sum = dst[i] + src[i];
+		dst[i] = sum > max ? max : sum;
+	}
+}
+
+static inline void add_saturate(uint64_t* dst, const uint64_t* src, size_t nb, uint64_t max) noexcept {
+	if(utils::Cpu::avx2()) {
+		add_saturate_avx2(dst, src, nb, max);
+		return;
+	}
+	for(size_t i = 0; i < nb; ++i) {
+		const uint64_t sum = dst[i] + src[i];
+		dst[i] = sum > max ? max : sum;
+	}
+}
+
+/**
+ * dst[i] = max(dst[i], src[i]), the values MUST be below 2^31.
+ */
+__attribute__((target("avx2")))
+static inline void merge_max_avx2(uint64_t* dst, const uint64_t* src, size_t nb) noexcept {
+	size_t i = 0;
+	for(; i + 4u <= nb; i += 4u) {
+		// the high halves are zero, so the 32-bit max is the 64-bit max
+		const __m256i result = _mm256_max_epu32(
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i))
+			, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), result);
+	}
+	for(; i < nb; ++i) {
+		dst[i] = dst[i] < src[i] ? src[i] : dst[i];
+	}
+}
+
+static inline void merge_max(uint64_t* dst, const uint64_t* src, size_t nb) noexcept {
+	if(utils::Cpu::avx2()) {
+		merge_max_avx2(dst, src, nb);
+		return;
+	}
+	for(size_t i = 0; i < nb; ++i) {
+		dst[i] = dst[i] < src[i] ? src[i] : dst[i];
+	}
+}
+
+/**
+ * The HLL harmonic sum: sum of 2^-src[i] and the number of zero registers.
+ * The values MUST be below 64.
+ */
+__attribute__((target("avx2")))
+static inline double inverse_pow2_sum_avx2(const uint64_t* src, size_t nb, size_t& zeros) noexcept {
+	// 2^-r is a double with the exponent field 1023 - r and zero mantissa
+	const __m256i bias = _mm256_set1_epi64x(1023);
+	const __m256i zero = _mm256_setzero_si256();
+	__m256d sum = _mm256_setzero_pd();
+	__m256i zero_nb = _mm256_setzero_si256();
+	size_t i = 0;
+	for(; i + 4u <= nb; i += 4u) {
+		const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+		sum = _mm256_add_pd(sum, _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_sub_epi64(bias, value), 52)));
+		// the comparison gives -1 for zeros
+		zero_nb = _mm256_sub_epi64(zero_nb, _mm256_cmpeq_epi64(value, zero));
+	}
+	alignas(32) double sums[4];
+	alignas(32) uint64_t zero_lanes[4];
+	_mm256_store_pd(sums, sum);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(zero_lanes), zero_nb);
+	double result = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+	zeros += zero_lanes[0] + zero_lanes[1] + zero_lanes[2] + zero_lanes[3];
+	for(; i < nb; ++i) {
+		result += 1.0 / double(1ull << src[i]);
+		zeros += src[i] ? 0u : 1u;
+	}
+	return result;
+}
+
+static inline double inverse_pow2_sum(const uint64_t* src, size_t nb, size_t& zeros) noexcept {
+	if(utils::Cpu::avx2()) {
+		return inverse_pow2_sum_avx2(src, nb, zeros);
+	}
+	double result = 0;
+	for(size_t i = 0; i < nb; ++i) {
+		result += 1.0 / double(1ull << src[i]);
+		zeros += src[i] ? 0u : 1u;
+	}
+	return result;
+}
+
+}; // namespace sketch
@@ -12,7 +12,12 @@
 
 namespace storage {
 
-class IpTable {
+/**
+ * With Stats = true the lookups, the pool operations and the evictions are counted,
+ * see stat_addr() and stat_net() (the probes of a network lookup are the networks compared).
+ */
+template<bool Stats = false>
+class IpTableT {
 	friend class TestIpTable;
 
 public:
@@ -28,30 +33,62 @@ private:
 		NodeAddr_t,
 		std::hash<IPv4Addr_t>,
 		dpdk::Allocator<NodeAddr_t>,
-		dpdk::Allocator<intrusive::HashMapBucket<NodeAddr_t> >
+		dpdk::Allocator<intrusive::HashMapBucket<NodeAddr_t> >,
+		Stats
 	>;
 
 	using NodeNet_t = intrusive::DequePoolNode<IPv4Network_t>;
 	using PoolNet_t = intrusive::DequePool<
 		NodeNet_t,
-		dpdk::Allocator<NodeNet_t>
+		dpdk::Allocator<NodeNet_t>,
+		Stats
 	>;
 
 	using Iterator_t = typename PoolNet_t::Iterator_t;
 
 	PoolAddr_t m_pool_addr;
 	PoolNet_t m_pool_net;
+	utils::StatCounter<Stats> m_counter_addr;
+	mutable utils::StatCounter<Stats> m_counter_net;
 
 public:
 
-	IpTable(unsigned capacity_addr, float load_factor, unsigned capacity_net) noexcept
+	IpTableT(unsigned capacity_addr, float load_factor, unsigned capacity_net) noexcept
 		: m_pool_addr(capacity_addr, load_factor)
-		, m_pool_net(capacity_net) {};
+		, m_pool_net(capacity_net)
+		, m_counter_addr()
+		, m_counter_net() {};
 
 	int allocate() noexcept {
 		return m_pool_addr.allocate() || m_pool_net.allocate();
 	}
 
+	/**
+	 * Keep the table in a shared memory region, an attached one is the table of the previous process,
+	 * see intrusive::HashQueuePool::allocate(utils::SharedRegion&).
+	 * @return 0 - on success, -1 - the region does not hold a valid table.
+	 */
+	int allocate(utils::SharedRegion& region) noexcept {
+		return (m_pool_addr.allocate(region) == 0 && m_pool_net.allocate(region) == 0) ? 0 : -1;
+	}
+
+	/**
+	 * Publish the changes of a table in a shared region.
+	 */
+	inline void commit() noexcept {
+		m_pool_addr.commit();
+		m_pool_net.commit();
+	}
+
+	/**
+	 * Take the table published by the writer for a reader table in a read only region, the writer must be
+	 * quiescent while find() walks it, see intrusive::HashQueuePool::refresh().
+	 * @return false - if the writer is in the middle of a change.
+	 */
+	bool refresh() noexcept {
+		return m_pool_addr.refresh() && m_pool_net.refresh();
+	}
+
 	/**
 	* @param addr - an IP address.
 	* @return true if the table contains addr.
@@ -73,13 +110,20 @@ public:
 	* @return true if the table contains addr as a network address range.
 	*/
 	inline bool find_in_nets(IPv4Addr_t addr) const noexcept {
+		const uint64_t start = m_counter_net.sample_start();
+		uint64_t probes = 0;
+		bool result = false;
 		for(auto it = m_pool_net.cbegin(); it != m_pool_net.cend(); ++it){
+			probes++;
 			IPv4Addr_t network = addr & it->value.mask;
 			if(network == it->value.network){
-				return true;
+				result = true;
+				break;
 			}
 		}
-		return false;
+		m_counter_net.lookup(result, probes);
+		m_counter_net.sample_stop(start);
+		return result;
 	}
 
 	/**
@@ -88,6 +132,7 @@ public:
 	inline void append_addr(IPv4Addr_t addr) noexcept {
 		if(not m_pool_addr.available()) {
 			m_pool_addr.pop_front();
+			m_counter_addr.evict();
 		}
 		m_pool_addr.push_back(addr);
 	}
@@ -99,6 +144,7 @@ public:
 	inline void append_net(IPv4Addr_t net, IPv4Addr_t mask) noexcept {
 		if(not m_pool_net.available()) {
 			m_pool_net.pop_front();
+			m_counter_net.evict();
 		}
 		auto it = m_pool_net.push_back();
 		if(it){
@@ -158,6 +204,41 @@ public:
 		return m_pool_addr.storage_bytes() + m_pool_net.storage_bytes();
 	}
 
+	/**
+	 * Write the addresses and the networks to a fio writer for a warm restart, see HashQueuePool::save().
+	 */
+	template<typename W>
+	bool save(W& writer) const {
+		return m_pool_addr.save(writer) && m_pool_net.save(writer);
+	}
+
+	/**
+	 * Replace the table with a snapshot of save().
+	 * @return false - on a broken snapshot, the networks are kept if the addresses have failed.
+	 */
+	template<typename R>
+	bool restore(R& reader) {
+		return m_pool_addr.restore(reader) && m_pool_net.restore(reader);
+	}
+
+	/**
+	 * @return The statistics snapshot of the individual addresses.
+	 */
+	utils::ContainerStat stat_addr() const noexcept {
+		utils::ContainerStat result = m_pool_addr.stat();
+		result.add(m_counter_addr.stat());
+		return result;
+	}
+
+	/**
+	 * @return The statistics snapshot of the networks.
+	 */
+	utils::ContainerStat stat_net() const noexcept {
+		utils::ContainerStat result = m_pool_net.stat();
+		result.add(m_counter_net.stat());
+		return result;
+	}
+
 	static IPv4Addr_t as_host_addr(unsigned b0, unsigned b1, unsigned b2, unsigned b3) noexcept {
 		IPv4Addr_t addr = 0;
 		addr |= b0 & 0xFF;
@@ -180,6 +261,8 @@ public:
 
 };
 
+using IpTable = IpTableT<>;
+
 }; // namespace storage
 
 #endif /* IPTABLE_H */
@@ -14,9 +14,8 @@
 namespace storage {
 
 template<typename K>
-struct RateLimiterNode
-	: public intrusive::LinkedListHook<RateLimiterNode<K> >, intrusive::HashMapHook<K, RateLimiterNode<K> > {
-	template<typename Tmp1, typename Tmp2>
+struct RateLimiterNode : public intrusive::HashMapHook<K, RateLimiterNode<K> > {
+	template<typename Tmp1, typename Tmp2, bool Tmp3>
 	friend
 	class RateLimiter;
 
@@ -24,6 +23,7 @@ private:
 	uint64_t time;
 public:
 	using Key_t = K;
+	intrusive::LinkedListHook<RateLimiterNode<K> > __ill;
 
 	RateLimiterNode() = default;
 
@@ -35,20 +35,25 @@ public:
 
 };
 
+/**
+ * With Stats = true the verdicts, the pool operations and the evictions are counted, see load().
+ */
 template<
 	typename Node_t,
-	typename H = std::hash<typename Node_t::Key_t>
+	typename H = std::hash<typename Node_t::Key_t>,
+	bool Stats = false
 >
 class RateLimiter {
 	friend class TestRateLimiter;
 
-	using Pool_t = intrusive::HashQueuePool<Node_t, H, dpdk::Allocator<Node_t>, dpdk::Allocator<intrusive::HashMapBucket<Node_t> > >;
+	using Pool_t = intrusive::HashQueuePool<Node_t, H, dpdk::Allocator<Node_t>, dpdk::Allocator<intrusive::HashMapBucket<Node_t> >, Stats>;
 	Pool_t m_pool;
 	const size_t m_capacity;
 	uint64_t m_period;
 
 	std::time_t m_push_time;
 	RateLimiterStat m_stat;
+	utils::StatCounter<Stats> m_counter;
 
 public:
 
@@ -59,7 +64,8 @@ public:
 		: m_pool(capacity, load_factor)
 		, m_capacity(capacity)
 		, m_push_time(0)
-		, m_stat() {}
+		, m_stat()
+		, m_counter() {}
 
 	void set_period(uint64_t period) noexcept {
 		m_period = period;
@@ -69,6 +75,22 @@ public:
 		return m_pool.allocate();
 	}
 
+	/**
+	 * Keep the limiter in a shared memory region, an attached one is the limiter of the previous process,
+	 * see intrusive::HashQueuePool::allocate(utils::SharedRegion&). The last passes are kept as TSC values,
+	 * after a reboot has reset the TSC every key passes once, use save() for a DAX region then.
+	 */
+	int allocate(utils::SharedRegion& region) noexcept {
+		return m_pool.allocate(region);
+	}
+
+	/**
+	 * Publish the changes of a limiter in a shared region, e.g. after each burst.
+	 */
+	inline void commit() noexcept {
+		m_pool.commit();
+	}
+
 	bool check(const Key_t& key) noexcept {
 		bool result = true;
 		uint64_t current = rte_rdtsc();
@@ -84,10 +106,14 @@ public:
 		} else {
 			if(not m_pool.available()) {
 				m_pool.pop_front();
+				m_counter.evict();
 			}
 			it = m_pool.push_back(key);
 			it->time = current;
 		}
+		if constexpr (Stats) {
+			(result ? m_stat.passed : m_stat.limited)++;
+		}
 		return result;
 	}
 
@@ -111,10 +137,40 @@ public:
 		return m_pool.end();
 	}
 
+	/**
+	 * Write the limiter to a fio writer for a warm restart: the keys and the TSC ages of the last passes
+	 * in the LRU order, see HashQueuePool::save(). The ages keep the periods right after a reboot
+	 * has reset the TSC.
+	 */
+	template<typename W>
+	bool save(W& writer) const {
+		const uint64_t current = rte_rdtsc();
+		return m_pool.save(writer, [current](W& out, const Node_t& node) {
+			const uint64_t age = current - node.time;
+			return out.write(age);
+		});
+	}
+
+	/**
+	 * Replace the limiter with a snapshot of save(), the downtime does not count to the periods.
+	 */
+	template<typename R>
+	bool restore(R& reader) {
+		const uint64_t current = rte_rdtsc();
+		return m_pool.restore(reader, [current](R& in, Node_t& node) {
+			uint64_t age;
+			const bool result = in.read(age);
+			node.time = age < current ? current - age : 0;
+			return result;
+		});
+	}
+
 	void load(RateLimiterStat& stat) const noexcept {
 		stat = m_stat;
 		stat.size = m_pool.size();
 		stat.capacity = m_capacity;
+		stat.pool = m_pool.stat();
+		stat.pool.add(m_counter.stat());
 	}
 
 	inline size_t storage_bytes() noexcept {
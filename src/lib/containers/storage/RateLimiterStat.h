@@ -5,21 +5,26 @@
 #include <cstdio>
 #include <cstdint>
 
+#include "utils/ContainerStat.h"
+
 namespace storage {
 
 struct RateLimiterStat {
 	size_t capacity;
 	size_t size;
+	uint64_t passed = 0; // the counters are filled with Stats = true only
+	uint64_t limited = 0;
+	utils::ContainerStat pool;
 
 	static void print_field(FILE* out, const char* name, uint64_t value, uint64_t value_prev) noexcept {
-		fprintf(out, "%s=%zu(%zu) ", name, value, value - value_prev);
+		fprintf(out, "%s=%zu(%zu) ", name, size_t(value), size_t(value - value_prev));
 	}
 
-	void print(FILE* out, const RateLimiterStat&) const noexcept {
-		float load_factor = (static_cast<float>(size) / capacity) * 100.0f;
-		fprintf(out, "[TQ] ");
-		fprintf(out, "%zu/%zu (%.2f%%) ", size, capacity, load_factor);
-		//        print_field(out, "put_col", put_collision, prev.put_collision);
+	void print(FILE* out, const RateLimiterStat& prev) const noexcept {
+		fprintf(out, "[RL] ");
+		print_field(out, "pass", passed, prev.passed);
+		print_field(out, "limit", limited, prev.limited);
+		pool.print(out, prev.pool);
 	}
 };
 
@@ -5,6 +5,7 @@
 #include "intrusive/HashQueuePool.h"
 #include "../dpdk/Allocator.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdio>
 #include <ctime>
@@ -12,9 +13,8 @@
 namespace storage {
 
 template<typename K, typename V>
-struct TimedQueueNode
-	: public intrusive::LinkedListHook<TimedQueueNode<K, V> >, intrusive::HashMapHook<K, TimedQueueNode<K, V> > {
-	template<typename Tmp1, typename Tmp2>
+struct TimedQueueNode : public intrusive::HashMapHook<K, TimedQueueNode<K, V> > {
+	template<typename Tmp1, typename Tmp2, bool Tmp3>
 	friend
 	class TimedQueue;
 
@@ -22,6 +22,7 @@ private:
 	std::time_t time;
 public:
 	using Key_t = K;
+	intrusive::LinkedListHook<TimedQueueNode<K, V> > __ill;
 	V value;
 
 	TimedQueueNode() : value() {}
@@ -38,9 +39,8 @@ public:
 };
 
 template<typename K>
-struct TimedQueueEmptyNode
-	: public intrusive::LinkedListHook<TimedQueueEmptyNode<K> >, intrusive::HashMapHook<K, TimedQueueEmptyNode<K> > {
-	template<typename Tmp1, typename Tmp2>
+struct TimedQueueEmptyNode : public intrusive::HashMapHook<K, TimedQueueEmptyNode<K> > {
+	template<typename Tmp1, typename Tmp2, bool Tmp3>
 	friend
 	class TimedQueue;
 
@@ -48,6 +48,7 @@ private:
 	std::time_t time;
 public:
 	using Key_t = K;
+	intrusive::LinkedListHook<TimedQueueEmptyNode<K> > __ill;
 
 	TimedQueueEmptyNode() = default;
 
@@ -59,18 +60,23 @@ public:
 
 };
 
+/**
+ * With Stats = true the pool operations and the expiries are counted, see load().
+ */
 template<
 	typename Node_t,
-	typename H = std::hash<typename Node_t::Key_t>
+	typename H = std::hash<typename Node_t::Key_t>,
+	bool Stats = false
 >
 class TimedQueue {
 	friend class TestTimedQueue;
 
-	using Pool_t = intrusive::HashQueuePool<Node_t, H, dpdk::Allocator<Node_t>, dpdk::Allocator<intrusive::HashMapBucket<Node_t> > >;
+	using Pool_t = intrusive::HashQueuePool<Node_t, H, dpdk::Allocator<Node_t>, dpdk::Allocator<intrusive::HashMapBucket<Node_t> >, Stats>;
 	Pool_t m_pool;
 	const size_t m_capacity;
 	std::time_t m_push_time;
 	TimedQueueStat m_stat;
+	utils::StatCounter<Stats> m_counter;
 
 public:
 
@@ -81,12 +87,28 @@ public:
 		: m_pool(capacity, load_factor)
 		, m_capacity(capacity)
 		, m_push_time(0)
-		, m_stat() {}
+		, m_stat()
+		, m_counter() {}
 
 	int allocate() noexcept {
 		return m_pool.allocate();
 	}
 
+	/**
+	 * Keep the queue in a shared memory region, an attached one is the queue of the previous process,
+	 * see intrusive::HashQueuePool::allocate(utils::SharedRegion&).
+	 */
+	int allocate(utils::SharedRegion& region) noexcept {
+		return m_pool.allocate(region);
+	}
+
+	/**
+	 * Publish the changes of a queue in a shared region, e.g. after each burst.
+	 */
+	inline void commit() noexcept {
+		m_pool.commit();
+	}
+
 	Iterator_t push_back(const Key_t& key) noexcept {
 		std::time_t time = std::time(nullptr);
 		assert(time >= m_push_time); // TODO: 
@@ -105,6 +127,7 @@ public:
 			std::time_t now = std::time(nullptr);
 			if(std::difftime(now, it->time) >= sec) {
 				m_pool.remove(it);
+				m_counter.expire();
 				result = it;
 			}
 		}
@@ -141,10 +164,39 @@ public:
 		return m_pool.capacity() * sizeof(Node_t);
 	}
 
+	/**
+	 * Write the queue to a fio writer for a warm restart: the keys, the push times and the values
+	 * in the queue order, see HashQueuePool::save().
+	 */
+	template<typename W>
+	bool save(W& writer) const {
+		return m_pool.save(writer, [](W& out, const Node_t& node) {
+			return out.write(node.time) && intrusive::PoolSnapshotValue<Node_t>::save(out, node);
+		});
+	}
+
+	/**
+	 * Replace the queue with a snapshot of save(), the entries keep their push times,
+	 * so the ones older than the timeout expire with the next pop_front().
+	 */
+	template<typename R>
+	bool restore(R& reader) {
+		std::time_t push_time = 0;
+		const bool result = m_pool.restore(reader, [&push_time](R& in, Node_t& node) {
+			const bool done = in.read(node.time) && intrusive::PoolSnapshotValue<Node_t>::restore(in, node);
+			push_time = std::max(push_time, node.time);
+			return done;
+		});
+		m_push_time = result ? push_time : 0;
+		return result;
+	}
+
 	void load(TimedQueueStat& stat) const noexcept {
 		stat = m_stat;
 		stat.size = m_pool.size();
 		stat.capacity = m_capacity;
+		stat.pool = m_pool.stat();
+		stat.pool.add(m_counter.stat());
 	}
 
 	inline Iterator_t end() noexcept {
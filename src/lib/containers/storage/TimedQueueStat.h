@@ -5,21 +5,22 @@
 #include <cstdio>
 #include <cstdint>
 
+#include "utils/ContainerStat.h"
+
 namespace storage {
 
 struct TimedQueueStat {
 	size_t capacity;
 	size_t size;
+	utils::ContainerStat pool; // the counters are filled with Stats = true only
 
 	static void print_field(FILE* out, const char* name, uint64_t value, uint64_t value_prev) noexcept {
-		fprintf(out, "%s=%zu(%zu) ", name, value, value - value_prev);
+		fprintf(out, "%s=%zu(%zu) ", name, size_t(value), size_t(value - value_prev));
 	}
 
-	void print(FILE* out, const TimedQueueStat&) const noexcept {
-		float load_factor = (static_cast<float>(size) / capacity) * 100.0f;
+	void print(FILE* out, const TimedQueueStat& prev) const noexcept {
 		fprintf(out, "[TQ] ");
-		fprintf(out, "%zu/%zu (%.2f%%) ", size, capacity, load_factor);
-		//        print_field(out, "put_col", put_collision, prev.put_collision);
+		pool.print(out, prev.pool);
 	}
 };
 
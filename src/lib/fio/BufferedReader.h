@@ -0,0 +1,311 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "IoBackend.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fio {
+
+/**
+ * The fio::Reader interface over a large block buffer filled with the plain read(2):
+ * a string is found with memchr() and appended at once, a POD value is a memcpy() from the buffer.
+ *
+ * With set_queue_depth() the file is prefetched: the reads of the next blocks are in flight in
+ * a fio::IoBackend (io_uring with the registered blocks or the thread pool) while the current one is parsed,
+ * a consumed block is queued again for the next unread offset.
+ */
+class BufferedReader {
+public:
+	static constexpr size_t BUFFER_SIZE_DEFAULT = 1u << 20u;
+
+private:
+	std::string _name;
+	int _fd;
+	std::unique_ptr<uint8_t[]> _buffer;
+	size_t _buffer_size;
+	size_t _pos;
+	size_t _end;
+	const uint8_t* _data; // the current block
+	unsigned _depth;
+	bool _failed;
+
+	struct Prefetch {
+		static constexpr int64_t PENDING = INT64_MIN;
+
+		std::unique_ptr<uint8_t[]> blocks; // destroyed after the backend waits for the requests in flight
+		std::unique_ptr<IoBackend> io;
+		std::vector<int64_t> results;
+		bool registered = false;
+		bool eof = false;
+		unsigned next = 0; // the block to consume next
+		unsigned current = 0; // the consumed one
+		bool consuming = false;
+		uint64_t offset = 0; // of the next block to read
+	};
+
+	std::unique_ptr<Prefetch> _prefetch;
+
+public:
+
+	explicit BufferedReader(std::string name, size_t buffer_size = BUFFER_SIZE_DEFAULT) noexcept
+		: _name(std::move(name)), _fd(-1), _buffer(), _buffer_size(buffer_size), _pos(0), _end(0), _data(nullptr)
+		, _depth(0), _failed(false), _prefetch() {}
+
+	BufferedReader(const BufferedReader&) = delete;
+	BufferedReader& operator=(const BufferedReader&) = delete;
+
+	BufferedReader(BufferedReader&& rvalue) noexcept
+		: _name(std::move(rvalue._name)), _fd(rvalue._fd), _buffer(std::move(rvalue._buffer))
+		, _buffer_size(rvalue._buffer_size), _pos(rvalue._pos), _end(rvalue._end), _data(rvalue._data)
+		, _depth(rvalue._depth), _failed(rvalue._failed), _prefetch(std::move(rvalue._prefetch)) {
+		rvalue.clear();
+	}
+
+	BufferedReader& operator=(BufferedReader&& rvalue) noexcept {
+		if(this != &rvalue) {
+			close();
+			_name = std::move(rvalue._name);
+			_fd = rvalue._fd;
+			_buffer = std::move(rvalue._buffer);
+			_buffer_size = rvalue._buffer_size;
+			_pos = rvalue._pos;
+			_end = rvalue._end;
+			_data = rvalue._data;
+			_depth = rvalue._depth;
+			_failed = rvalue._failed;
+			_prefetch = std::move(rvalue._prefetch);
+			rvalue.clear();
+		}
+		return *this;
+	}
+
+	~BufferedReader() noexcept {
+		close();
+	}
+
+	/**
+	 * Prefetch the files opened after the call with @depth blocks in flight, 0 - the synchronous reads.
+	 */
+	void set_queue_depth(unsigned depth) noexcept {
+		_depth = depth;
+	}
+
+	bool open() {
+		close();
+		_fd = ::open(_name.c_str(), O_RDONLY | O_CLOEXEC);
+		if(_fd < 0) {
+			return false;
+		}
+		posix_fadvise(_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+		_pos = _end = 0;
+		_failed = false;
+		if(_depth) {
+			open_prefetch();
+		} else {
+			if(not _buffer) {
+				_buffer.reset(new uint8_t[_buffer_size]);
+			}
+			_data = _buffer.get();
+		}
+		return true;
+	}
+
+	/**
+	 * @return true - if a read of the file has failed, a false read() is an error then, not the end of the input.
+	 */
+	inline bool failed() const noexcept {
+		return _failed;
+	}
+
+	void close() noexcept {
+		_prefetch.reset();
+		if(_fd >= 0) {
+			::close(_fd);
+			_fd = -1;
+		}
+	}
+
+	/**
+	 * Read a string up to @term, the terminator is consumed.
+	 * @return false - if the input is over before @term.
+	 */
+	bool read(std::string& value, const char term = 0) noexcept {
+		value.resize(0);
+		while(true) {
+			const uint8_t* begin = _data + _pos;
+			const size_t len = _end - _pos;
+			const void* found = memchr(begin, term, len);
+			if(found) {
+				const size_t part = static_cast<const uint8_t*>(found) - begin;
+				value.append(reinterpret_cast<const char*>(begin), part);
+				_pos += part + 1;
+				return true;
+			}
+			value.append(reinterpret_cast<const char*>(begin), len);
+			_pos = _end;
+			if(not fill()) {
+				return false;
+			}
+		}
+	}
+
+	template<typename V, std::enable_if_t<std::is_pod_v<V>, int> = 0>
+	bool read(V& value) noexcept {
+		return read_impl(&value, sizeof(value));
+	}
+
+	template<typename V, typename... Args>
+	bool read(V& value, Args&... args) noexcept {
+		return read(value) && read(args...);
+	}
+
+	/**
+	 * Read @count values to @values, see BufferedWriter::write_span().
+	 */
+	template<typename V, std::enable_if_t<std::is_pod_v<V>, int> = 0>
+	bool read_span(V* values, size_t count) noexcept {
+		if(count > SIZE_MAX / sizeof(V)) {
+			return false;
+		}
+		return read_impl(values, sizeof(V) * count);
+	}
+
+private:
+
+	bool read_impl(void* buf, size_t buf_nb) noexcept {
+		uint8_t* dst = static_cast<uint8_t*>(buf);
+		while(buf_nb) {
+			if(_pos == _end && buf_nb >= _buffer_size && not _prefetch) {
+				// a large span bypasses the buffer
+				const ssize_t done = ::read(_fd, dst, buf_nb);
+				if(done < 0 && errno == EINTR) {
+					continue;
+				}
+				if(done <= 0) {
+					_failed |= done < 0;
+					return false;
+				}
+				dst += done;
+				buf_nb -= size_t(done);
+				continue;
+			}
+			if(_pos == _end && not fill()) {
+				return false;
+			}
+			const size_t part = std::min(buf_nb, _end - _pos);
+			memcpy(dst, _data + _pos, part);
+			_pos += part;
+			dst += part;
+			buf_nb -= part;
+		}
+		return true;
+	}
+
+	/**
+	 * Read the next block, the buffer is consumed.
+	 * @return false - if the input is over or on an error.
+	 */
+	bool fill() noexcept {
+		if(_prefetch) {
+			return fill_prefetched();
+		}
+		ssize_t done;
+		do {
+			done = ::read(_fd, _buffer.get(), _buffer_size);
+		} while(done < 0 && errno == EINTR);
+		_pos = 0;
+		_end = done > 0 ? size_t(done) : 0;
+		_failed |= done < 0;
+		return done > 0;
+	}
+
+	void open_prefetch() {
+		_prefetch.reset(new Prefetch());
+		Prefetch& prefetch = *_prefetch;
+		prefetch.blocks.reset(new uint8_t[_buffer_size * _depth]);
+		prefetch.io = IoBackend::create(_depth);
+		prefetch.results.assign(_depth, Prefetch::PENDING);
+		std::vector<iovec> iov(_depth);
+		for(unsigned i = 0; i < _depth; ++i) {
+			iov[i] = {prefetch.blocks.get() + _buffer_size * i, _buffer_size};
+		}
+		prefetch.registered = prefetch.io->register_buffers(iov.data(), _depth);
+		for(unsigned i = 0; i < _depth; ++i) {
+			queue_block(i);
+		}
+		prefetch.io->submit();
+		_data = prefetch.blocks.get();
+	}
+
+	void queue_block(unsigned block) noexcept {
+		Prefetch& prefetch = *_prefetch;
+		if(prefetch.eof) {
+			prefetch.results[block] = 0;
+			return;
+		}
+		IoRequest request;
+		request.fd = _fd;
+		request.buf = prefetch.blocks.get() + _buffer_size * block;
+		request.len = uint32_t(_buffer_size);
+		request.offset = prefetch.offset;
+		request.buf_index = prefetch.registered ? int(block) : -1;
+		request.user_data = block;
+		prefetch.io->queue(request);
+		prefetch.results[block] = Prefetch::PENDING;
+		prefetch.offset += _buffer_size;
+	}
+
+	/**
+	 * Queue the consumed block again and switch to the next one.
+	 */
+	bool fill_prefetched() noexcept {
+		Prefetch& prefetch = *_prefetch;
+		if(prefetch.consuming) {
+			queue_block(prefetch.current);
+			prefetch.io->submit();
+		}
+		const unsigned block = prefetch.next;
+		IoCompletion completions[64];
+		while(prefetch.results[block] == Prefetch::PENDING) {
+			const size_t count = prefetch.io->wait(completions, std::min(size_t(_depth), size_t(64)), 1);
+			if(not count) {
+				prefetch.results[block] = -EIO;
+			}
+			for(size_t i = 0; i < count; ++i) {
+				prefetch.results[completions[i].user_data] = completions[i].result;
+			}
+		}
+		prefetch.current = block;
+		prefetch.consuming = true;
+		prefetch.next = (block + 1) % _depth;
+		const int64_t result = prefetch.results[block];
+		// a short read of a regular file is the end of it, an error ends the reads too
+		prefetch.eof |= result < int64_t(_buffer_size);
+		_failed |= result < 0;
+		_data = prefetch.blocks.get() + _buffer_size * block;
+		_pos = 0;
+		_end = result > 0 ? size_t(result) : 0;
+		return result > 0;
+	}
+
+	void clear() noexcept {
+		_name.clear();
+		_fd = -1;
+		_pos = _end = 0;
+		_data = nullptr;
+		_failed = false;
+	}
+
+};
+
+}; // namespace fio
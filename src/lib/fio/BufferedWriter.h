@@ -0,0 +1,384 @@
+#pragma once
+
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "IoBackend.h"
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace fio {
+
+/**
+ * The fio::Writer format written through a large block buffer with the plain write(2): a write(args...)
+ * which fits the buffer is a few memcpy() calls, the one which doesn't is a single writev(2) of the buffered
+ * bytes and the arguments. The file is read back by fio::Reader, fio::BufferedReader or fio::MappedReader.
+ *
+ * With set_queue_depth() the writes are pipelined: a full buffer block is handed to a fio::IoBackend
+ * (io_uring with the registered blocks or the thread pool) and the writing goes on to the next block,
+ * the writer waits only when all the blocks are in flight.
+ */
+class BufferedWriter {
+public:
+	static constexpr size_t BUFFER_SIZE_DEFAULT = 1u << 20u;
+
+private:
+	std::string _name;
+	int _fd;
+	std::unique_ptr<uint8_t[]> _buffer;
+	size_t _buffer_size;
+	size_t _pos;
+	uint64_t _written;
+	uint8_t* _data; // the current block
+	unsigned _depth;
+
+	struct Pipeline {
+		std::unique_ptr<uint8_t[]> blocks; // destroyed after the backend waits for the requests in flight
+		std::unique_ptr<IoBackend> io;
+		std::vector<uint32_t> lens;
+		std::vector<bool> busy;
+		bool registered = false;
+		unsigned current = 0;
+		uint64_t offset = 0; // of the current block
+		bool failed = false;
+	};
+
+	std::unique_ptr<Pipeline> _pipeline;
+
+public:
+
+	explicit BufferedWriter(std::string name, size_t buffer_size = BUFFER_SIZE_DEFAULT) noexcept
+		: _name(std::move(name)), _fd(-1), _buffer(), _buffer_size(buffer_size), _pos(0), _written(0), _data(nullptr)
+		, _depth(0), _pipeline() {}
+
+	BufferedWriter(const BufferedWriter&) = delete;
+	BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+	BufferedWriter(BufferedWriter&& rvalue) noexcept
+		: _name(std::move(rvalue._name)), _fd(rvalue._fd), _buffer(std::move(rvalue._buffer))
+		, _buffer_size(rvalue._buffer_size), _pos(rvalue._pos), _written(rvalue._written), _data(rvalue._data)
+		, _depth(rvalue._depth), _pipeline(std::move(rvalue._pipeline)) {
+		rvalue.clear();
+	}
+
+	BufferedWriter& operator=(BufferedWriter&& rvalue) noexcept {
+		if(this != &rvalue) {
+			close();
+			_name = std::move(rvalue._name);
+			_fd = rvalue._fd;
+			_buffer = std::move(rvalue._buffer);
+			_buffer_size = rvalue._buffer_size;
+			_pos = rvalue._pos;
+			_written = rvalue._written;
+			_data = rvalue._data;
+			_depth = rvalue._depth;
+			_pipeline = std::move(rvalue._pipeline);
+			rvalue.clear();
+		}
+		return *this;
+	}
+
+	~BufferedWriter() noexcept {
+		close();
+	}
+
+	/**
+	 * Pipeline the writes of the files opened after the call through @depth blocks, 0 - the synchronous writes.
+	 */
+	void set_queue_depth(unsigned depth) noexcept {
+		_depth = depth;
+	}
+
+	bool open() {
+		close();
+		_fd = ::open(_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if(_fd < 0) {
+			return false;
+		}
+		_pos = 0;
+		_written = 0;
+		if(_depth) {
+			open_pipeline();
+		} else {
+			if(not _buffer) {
+				_buffer.reset(new uint8_t[_buffer_size]);
+			}
+			_data = _buffer.get();
+		}
+		return true;
+	}
+
+	/**
+	 * Flush the buffer and close the file.
+	 * @return false - if the buffered bytes can't be written.
+	 */
+	bool close() noexcept {
+		bool result = true;
+		if(_fd >= 0) {
+			result = flush();
+			_pipeline.reset();
+			::close(_fd);
+			_fd = -1;
+		}
+		return result;
+	}
+
+	/**
+	 * Write the buffered bytes to the file, with the pipeline wait for all the writes.
+	 */
+	bool flush() noexcept {
+		if(_pipeline) {
+			submit_block();
+			while(_pipeline->io->inflight()) {
+				reap(1);
+			}
+			return not _pipeline->failed;
+		}
+		iovec iov = {_data, _pos};
+		return write_iov(&iov, 1u, _pos);
+	}
+
+	bool write(const std::string& value, const char term = 0) noexcept {
+		return write(std::string_view(value), term);
+	}
+
+	bool write(const std::string_view& value, const char term = 0) noexcept {
+		iovec iov[] = {{}, {const_cast<char*>(value.data()), value.size()}, {const_cast<char*>(&term), 1u}};
+		return append(iov, 3u, value.size() + 1);
+	}
+
+	template<typename V, std::enable_if_t<std::is_pod_v<V>, int> = 0>
+	bool write(const V& value) noexcept {
+		if(_pos + sizeof(value) <= _buffer_size) {
+			put(&value, sizeof(value));
+			return true;
+		}
+		iovec iov[] = {{}, {const_cast<V*>(&value), sizeof(value)}};
+		return append(iov, 2u, sizeof(value));
+	}
+
+	/**
+	 * The arguments are written as one piece: copied to the buffer or written with a single writev(2)
+	 * (copied through the blocks with the pipeline).
+	 * As with fio::Writer if the last two arguments are a string and a char, the char terminates the string.
+	 */
+	template<typename V, typename... Args>
+	bool write(const V& value, const Args&... args) noexcept {
+		constexpr size_t iov_max = 2 * (1 + sizeof...(Args)) + 1;
+		static_assert(iov_max <= IOV_MAX, "fio::BufferedWriter: too many arguments");
+		iovec iov[iov_max];
+		unsigned iov_count = 1;
+		size_t size = 0;
+		add_iov(iov, iov_count, size, value, args...);
+		return append(iov, iov_count, size);
+	}
+
+	/**
+	 * Write @count values of @values without the count, see MappedReader::read_span().
+	 */
+	template<typename V, std::enable_if_t<std::is_pod_v<V>, int> = 0>
+	bool write_span(const V* values, size_t count) noexcept {
+		iovec iov[] = {{}, {const_cast<V*>(values), sizeof(V) * count}};
+		return append(iov, 2u, sizeof(V) * count);
+	}
+
+	/**
+	 * Write zero bytes up to the @alignment boundary of the file offset, so a following span
+	 * is read by MappedReader::read_span() without a copy.
+	 */
+	bool align(size_t alignment) noexcept {
+		static const uint8_t zeros[64] = {};
+		const size_t padding = (alignment - _written % alignment) % alignment;
+		return padding <= sizeof(zeros) && write_span(zeros, padding);
+	}
+
+	/**
+	 * @return The number of the written bytes including the buffered ones.
+	 */
+	uint64_t offset() const noexcept {
+		return _written;
+	}
+
+private:
+
+	template<typename First = void, typename...>
+	static constexpr bool first_is_char() noexcept {
+		return std::is_same_v<First, char>;
+	}
+
+	static inline void add_iov(iovec*, unsigned&, size_t&) noexcept {}
+
+	/**
+	 * Add the arguments to @iov and their size to @size, the same way the write() overloads encode them.
+	 */
+	template<typename V, typename... Args>
+	static inline void add_iov(iovec* iov, unsigned& iov_count, size_t& size, const V& value, const Args&... args) noexcept {
+		if constexpr (std::is_same_v<V, std::string> || std::is_same_v<V, std::string_view>) {
+			static const char zero = 0;
+			iov[iov_count++] = {const_cast<char*>(value.data()), value.size()};
+			size += value.size();
+			if constexpr (sizeof...(Args) == 1 && first_is_char<Args...>()) {
+				add_term(iov, iov_count, size, args...);
+			} else {
+				add_term(iov, iov_count, size, zero, args...);
+			}
+		} else {
+			static_assert(std::is_pod_v<V>, "fio::BufferedWriter: the argument type is not supported");
+			iov[iov_count++] = {const_cast<V*>(&value), sizeof(value)};
+			size += sizeof(value);
+			add_iov(iov, iov_count, size, args...);
+		}
+	}
+
+	template<typename... Args>
+	static inline void add_term(iovec* iov, unsigned& iov_count, size_t& size, const char& term, const Args&... args) noexcept {
+		iov[iov_count++] = {const_cast<char*>(&term), 1u};
+		size += 1;
+		add_iov(iov, iov_count, size, args...);
+	}
+
+	inline void put(const void* data, size_t size) noexcept {
+		memcpy(_data + _pos, data, size);
+		_pos += size;
+		_written += size;
+	}
+
+	/**
+	 * Write @iov, the first entry is reserved for the buffered bytes.
+	 * @param size - the size of the entries except the first one.
+	 */
+	bool append(iovec* iov, unsigned iov_count, size_t size) noexcept {
+		if(_pos + size <= _buffer_size) {
+			for(unsigned i = 1; i < iov_count; ++i) {
+				put(iov[i].iov_base, iov[i].iov_len);
+			}
+			return true;
+		}
+		if(_pipeline) {
+			for(unsigned i = 1; i < iov_count; ++i) {
+				const uint8_t* data = static_cast<const uint8_t*>(iov[i].iov_base);
+				size_t len = iov[i].iov_len;
+				while(len) {
+					const size_t part = std::min(len, _buffer_size - _pos);
+					put(data, part);
+					data += part;
+					len -= part;
+					if(_pos == _buffer_size) {
+						submit_block();
+					}
+				}
+			}
+			return not _pipeline->failed;
+		}
+		iov[0] = {_data, _pos};
+		return write_iov(iov, iov_count, _pos + size);
+	}
+
+	void open_pipeline() {
+		_pipeline.reset(new Pipeline());
+		_pipeline->blocks.reset(new uint8_t[_buffer_size * _depth]);
+		_pipeline->io = IoBackend::create(_depth);
+		_pipeline->lens.assign(_depth, 0);
+		_pipeline->busy.assign(_depth, false);
+		std::vector<iovec> iov(_depth);
+		for(unsigned i = 0; i < _depth; ++i) {
+			iov[i] = {_pipeline->blocks.get() + _buffer_size * i, _buffer_size};
+		}
+		_pipeline->registered = _pipeline->io->register_buffers(iov.data(), _depth);
+		_data = _pipeline->blocks.get();
+	}
+
+	/**
+	 * Hand the current block to the backend and go on to the next free one.
+	 */
+	void submit_block() noexcept {
+		Pipeline& pipeline = *_pipeline;
+		if(not _pos) {
+			return;
+		}
+		IoRequest request;
+		request.fd = _fd;
+		request.write = true;
+		request.buf = _data;
+		request.len = uint32_t(_pos);
+		request.offset = pipeline.offset;
+		request.buf_index = pipeline.registered ? int(pipeline.current) : -1;
+		request.user_data = pipeline.current;
+		pipeline.io->queue(request);
+		pipeline.io->submit();
+		pipeline.busy[pipeline.current] = true;
+		pipeline.lens[pipeline.current] = uint32_t(_pos);
+		pipeline.offset += _pos;
+		_pos = 0;
+		pipeline.current = (pipeline.current + 1) % _depth;
+		while(pipeline.busy[pipeline.current]) {
+			reap(1);
+		}
+		_data = pipeline.blocks.get() + _buffer_size * pipeline.current;
+	}
+
+	void reap(size_t min) noexcept {
+		Pipeline& pipeline = *_pipeline;
+		IoCompletion completions[64];
+		const size_t count = pipeline.io->wait(completions, std::min(size_t(_depth), size_t(64)), min);
+		for(size_t i = 0; i < count; ++i) {
+			const IoCompletion& completion = completions[i];
+			pipeline.busy[completion.user_data] = false;
+			// a short write of a regular file is an error (ENOSPC)
+			pipeline.failed |= completion.result != int64_t(pipeline.lens[completion.user_data]);
+		}
+	}
+
+	/**
+	 * Write @iov (the buffer first) completely, it retries the partial writes.
+	 * @param size - the total size, the buffered bytes are counted as written already.
+	 */
+	bool write_iov(iovec* iov, unsigned iov_count, size_t size) noexcept {
+		_written += size - _pos;
+		size_t left = size;
+		while(left) {
+			const ssize_t done = ::writev(_fd, iov, int(iov_count));
+			if(done < 0) {
+				if(errno == EINTR) {
+					continue;
+				}
+				_pos = 0;
+				return false;
+			}
+			left -= size_t(done);
+			// skip the written entries
+			size_t skip = size_t(done);
+			while(iov_count && skip >= iov->iov_len) {
+				skip -= iov->iov_len;
+				++iov;
+				--iov_count;
+			}
+			if(iov_count) {
+				iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + skip;
+				iov->iov_len -= skip;
+			}
+		}
+		_pos = 0;
+		return true;
+	}
+
+	void clear() noexcept {
+		_name.clear();
+		_fd = -1;
+		_pos = 0;
+		_written = 0;
+		_data = nullptr;
+	}
+
+};
+
+}; // namespace fio
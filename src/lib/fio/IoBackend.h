@@ -0,0 +1,435 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace fio {
+
+/**
+ * A positional read or write of @len bytes at @offset of @fd.
+ */
+struct IoRequest {
+	int fd = -1;
+	bool write = false;
+	void* buf = nullptr;
+	uint32_t len = 0;
+	uint64_t offset = 0;
+	int buf_index = -1; // the registered buffer of @buf or -1
+	uint64_t user_data = 0;
+};
+
+struct IoCompletion {
+	uint64_t user_data;
+	int64_t result; // the transferred bytes or -errno
+};
+
+/**
+ * An asynchronous positional I/O queue: queue() the requests, submit() them in one batch and wait()
+ * for the completions, they come in any order. At most depth() requests are in flight.
+ * create() makes the io_uring backend and falls back to the thread pool when io_uring is unavailable
+ * (an old kernel, a kernel without IORING_OP_READ/WRITE, a seccomp filter).
+ * A backend is used by one thread.
+ */
+class IoBackend {
+protected:
+	const unsigned m_depth;
+	unsigned m_inflight = 0; // queued and submitted, not reaped
+
+	explicit IoBackend(unsigned depth) noexcept : m_depth(std::max(depth, 1u)) {}
+
+public:
+
+	IoBackend(const IoBackend&) = delete;
+	IoBackend& operator=(const IoBackend&) = delete;
+
+	virtual ~IoBackend() noexcept = default;
+
+	/**
+	 * @param uring - false forces the thread pool.
+	 */
+	static std::unique_ptr<IoBackend> create(unsigned depth, bool uring = true);
+
+	virtual const char* name() const noexcept = 0;
+
+	/**
+	 * Register @count buffers for the IoRequest::buf_index requests.
+	 * @return false - if the buffers can't be registered, the requests go without buf_index then.
+	 */
+	virtual bool register_buffers(const iovec* buffers, unsigned count) noexcept = 0;
+
+	/**
+	 * @return false - if depth() requests are in flight already.
+	 */
+	virtual bool queue(const IoRequest& request) noexcept = 0;
+
+	/**
+	 * Start the queued requests.
+	 */
+	virtual void submit() noexcept = 0;
+
+	/**
+	 * Submit the queued requests and wait for at least @min completions (fewer if fewer are in flight).
+	 * @return The number of the completions stored to @out, up to @max.
+	 */
+	virtual size_t wait(IoCompletion* out, size_t max, size_t min) noexcept = 0;
+
+	inline unsigned depth() const noexcept {
+		return m_depth;
+	}
+
+	inline unsigned inflight() const noexcept {
+		return m_inflight;
+	}
+
+};
+
+/**
+ * io_uring with the raw system calls, no liburing.
+ */
+class IoUring final : public IoBackend {
+	int m_fd = -1;
+	io_uring_params m_params;
+	void* m_sq_ring = MAP_FAILED;
+	size_t m_sq_ring_size = 0;
+	void* m_cq_ring = MAP_FAILED;
+	size_t m_cq_ring_size = 0;
+	io_uring_sqe* m_sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+	size_t m_sqes_size = 0;
+
+	unsigned* m_sq_tail = nullptr;
+	unsigned m_sq_mask = 0;
+	unsigned* m_sq_array = nullptr;
+	unsigned* m_cq_head = nullptr;
+	unsigned* m_cq_tail = nullptr;
+	unsigned m_cq_mask = 0;
+	io_uring_cqe* m_cqes = nullptr;
+
+	unsigned m_tail = 0; // the local SQ tail
+	unsigned m_queued = 0; // not submitted yet
+
+public:
+
+	explicit IoUring(unsigned depth) noexcept : IoBackend(depth) {
+		memset(&m_params, 0, sizeof(m_params));
+		m_fd = int(syscall(__NR_io_uring_setup, m_depth, &m_params));
+		if(m_fd < 0) {
+			return;
+		}
+		m_sq_ring_size = m_params.sq_off.array + m_params.sq_entries * sizeof(unsigned);
+		m_cq_ring_size = m_params.cq_off.cqes + m_params.cq_entries * sizeof(io_uring_cqe);
+		const bool single = m_params.features & IORING_FEAT_SINGLE_MMAP;
+		if(single) {
+			m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+		}
+		m_sq_ring = mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd
+			, IORING_OFF_SQ_RING);
+		m_cq_ring = single ? m_sq_ring : mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE
+			, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+		m_sqes_size = m_params.sq_entries * sizeof(io_uring_sqe);
+		m_sqes = static_cast<io_uring_sqe*>(mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE
+			, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES));
+		if(m_sq_ring == MAP_FAILED || m_cq_ring == MAP_FAILED || m_sqes == MAP_FAILED || not probe()) {
+			release();
+			return;
+		}
+		uint8_t* sq = static_cast<uint8_t*>(m_sq_ring);
+		uint8_t* cq = static_cast<uint8_t*>(m_cq_ring);
+		m_sq_tail = reinterpret_cast<unsigned*>(sq + m_params.sq_off.tail);
+		m_sq_mask = *reinterpret_cast<unsigned*>(sq + m_params.sq_off.ring_mask);
+		m_sq_array = reinterpret_cast<unsigned*>(sq + m_params.sq_off.array);
+		m_cq_head = reinterpret_cast<unsigned*>(cq + m_params.cq_off.head);
+		m_cq_tail = reinterpret_cast<unsigned*>(cq + m_params.cq_off.tail);
+		m_cq_mask = *reinterpret_cast<unsigned*>(cq + m_params.cq_off.ring_mask);
+		m_cqes = reinterpret_cast<io_uring_cqe*>(cq + m_params.cq_off.cqes);
+		m_tail = *m_sq_tail;
+	}
+
+	~IoUring() noexcept override {
+		// the kernel may write to the buffers of the requests in flight
+		IoCompletion completions[64];
+		while(m_fd >= 0 && m_inflight) {
+			if(not wait(completions, 64, 1)) {
+				break;
+			}
+		}
+		release();
+	}
+
+	/**
+	 * @return false - if the ring can't be created.
+	 */
+	inline bool valid() const noexcept {
+		return m_fd >= 0;
+	}
+
+	const char* name() const noexcept override {
+		return "io_uring";
+	}
+
+	bool register_buffers(const iovec* buffers, unsigned count) noexcept override {
+		return syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_BUFFERS, buffers, count) == 0;
+	}
+
+	bool queue(const IoRequest& request) noexcept override {
+		if(m_inflight >= m_depth || m_inflight >= m_params.sq_entries) {
+			return false;
+		}
+		const unsigned index = m_tail & m_sq_mask;
+		io_uring_sqe& sqe = m_sqes[index];
+		memset(&sqe, 0, sizeof(sqe));
+		const bool fixed = request.buf_index >= 0;
+		sqe.opcode = request.write ? (fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE)
+			: (fixed ? IORING_OP_READ_FIXED : IORING_OP_READ);
+		sqe.fd = request.fd;
+		sqe.addr = uint64_t(uintptr_t(request.buf));
+		sqe.len = request.len;
+		sqe.off = request.offset;
+		sqe.buf_index = fixed ? uint16_t(request.buf_index) : 0;
+		sqe.user_data = request.user_data;
+		m_sq_array[index] = index;
+		m_tail++;
+		m_queued++;
+		m_inflight++;
+		return true;
+	}
+
+	void submit() noexcept override {
+		enter(0, 0);
+	}
+
+	size_t wait(IoCompletion* out, size_t max, size_t min) noexcept override {
+		min = std::min({min, max, size_t(m_inflight)});
+		size_t result = reap(out, max);
+		if(result >= min && not m_queued) {
+			return result;
+		}
+		do {
+			if(enter(unsigned(min > result ? min - result : 0), result < min ? IORING_ENTER_GETEVENTS : 0) < 0) {
+				break;
+			}
+			result += reap(out + result, max - result);
+		} while(result < min);
+		return result;
+	}
+
+private:
+
+	/**
+	 * A ring is set up since 5.1, but IORING_OP_READ and IORING_OP_WRITE come with 5.6 (as the probe itself),
+	 * the requests of an older kernel complete with -EINVAL.
+	 * @return true - if all the opcodes of queue() are supported.
+	 */
+	bool probe() const noexcept {
+		constexpr unsigned OPS = 256;
+		alignas(io_uring_probe) uint8_t buffer[sizeof(io_uring_probe) + OPS * sizeof(io_uring_probe_op)] = {};
+		io_uring_probe* result = reinterpret_cast<io_uring_probe*>(buffer);
+		if(syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PROBE, result, OPS) != 0) {
+			return false;
+		}
+		for(const unsigned op : {IORING_OP_READ, IORING_OP_WRITE, IORING_OP_READ_FIXED, IORING_OP_WRITE_FIXED}) {
+			if(op >= result->ops_len || not (result->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Publish the queued entries and call io_uring_enter().
+	 */
+	int enter(unsigned min_complete, unsigned flags) noexcept {
+		__atomic_store_n(m_sq_tail, m_tail, __ATOMIC_RELEASE);
+		while(true) {
+			const int done = int(syscall(__NR_io_uring_enter, m_fd, m_queued, min_complete, flags, nullptr, 0));
+			if(done >= 0) {
+				m_queued -= std::min(unsigned(done), m_queued);
+				return done;
+			}
+			if(errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+				return -1;
+			}
+			if(errno != EINTR) {
+				// the completion queue is full, let the caller reap
+				return 0;
+			}
+		}
+	}
+
+	size_t reap(IoCompletion* out, size_t max) noexcept {
+		unsigned head = *m_cq_head;
+		const unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+		size_t result = 0;
+		while(head != tail && result < max) {
+			const io_uring_cqe& cqe = m_cqes[head & m_cq_mask];
+			out[result++] = {cqe.user_data, int64_t(cqe.res)};
+			head++;
+		}
+		__atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+		m_inflight -= unsigned(result);
+		return result;
+	}
+
+	void release() noexcept {
+		if(m_sqes != MAP_FAILED) {
+			munmap(m_sqes, m_sqes_size);
+			m_sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+		}
+		if(m_cq_ring != MAP_FAILED && m_cq_ring != m_sq_ring) {
+			munmap(m_cq_ring, m_cq_ring_size);
+		}
+		m_cq_ring = MAP_FAILED;
+		if(m_sq_ring != MAP_FAILED) {
+			munmap(m_sq_ring, m_sq_ring_size);
+			m_sq_ring = MAP_FAILED;
+		}
+		if(m_fd >= 0) {
+			close(m_fd);
+			m_fd = -1;
+		}
+	}
+
+};
+
+/**
+ * The fallback: the worker threads run pread(2)/pwrite(2), the registered buffers are ignored.
+ */
+class IoThreadPool final : public IoBackend {
+	static constexpr unsigned THREADS_MAX = 64;
+
+	std::vector<IoRequest> m_batch; // queued, not submitted
+	std::mutex m_lock;
+	std::condition_variable m_work_cond;
+	std::condition_variable m_done_cond;
+	std::deque<IoRequest> m_work;
+	std::deque<IoCompletion> m_done;
+	bool m_stop = false;
+	std::vector<std::thread> m_threads;
+
+public:
+
+	/**
+	 * @param threads - 0 for a thread per a request in flight up to THREADS_MAX, the threads block in the I/O,
+	 * not on the CPU.
+	 */
+	explicit IoThreadPool(unsigned depth, unsigned threads = 0) : IoBackend(depth) {
+		if(not threads) {
+			threads = std::min(m_depth, THREADS_MAX);
+		}
+		for(unsigned i = 0; i < threads; ++i) {
+			m_threads.emplace_back([this]() {
+				run();
+			});
+		}
+	}
+
+	~IoThreadPool() noexcept override {
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			m_stop = true;
+		}
+		m_work_cond.notify_all();
+		for(auto& thread : m_threads) {
+			thread.join();
+		}
+	}
+
+	const char* name() const noexcept override {
+		return "thread pool";
+	}
+
+	bool register_buffers(const iovec*, unsigned) noexcept override {
+		return true;
+	}
+
+	bool queue(const IoRequest& request) noexcept override {
+		if(m_inflight >= m_depth) {
+			return false;
+		}
+		m_batch.push_back(request);
+		m_inflight++;
+		return true;
+	}
+
+	void submit() noexcept override {
+		if(m_batch.empty()) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			m_work.insert(m_work.end(), m_batch.begin(), m_batch.end());
+		}
+		m_batch.clear();
+		m_work_cond.notify_all();
+	}
+
+	size_t wait(IoCompletion* out, size_t max, size_t min) noexcept override {
+		submit();
+		min = std::min({min, max, size_t(m_inflight)});
+		std::unique_lock<std::mutex> guard(m_lock);
+		m_done_cond.wait(guard, [&]() {
+			return m_done.size() >= min;
+		});
+		size_t result = 0;
+		while(result < max && not m_done.empty()) {
+			out[result++] = m_done.front();
+			m_done.pop_front();
+		}
+		m_inflight -= unsigned(result);
+		return result;
+	}
+
+private:
+
+	void run() noexcept {
+		std::unique_lock<std::mutex> guard(m_lock);
+		while(true) {
+			m_work_cond.wait(guard, [this]() {
+				return m_stop || not m_work.empty();
+			});
+			if(m_work.empty()) {
+				return; // stopped
+			}
+			const IoRequest request = m_work.front();
+			m_work.pop_front();
+			guard.unlock();
+
+			ssize_t done;
+			do {
+				done = request.write ? pwrite(request.fd, request.buf, request.len, off_t(request.offset))
+					: pread(request.fd, request.buf, request.len, off_t(request.offset));
+			} while(done < 0 && errno == EINTR);
+			const IoCompletion completion = {request.user_data, done < 0 ? -int64_t(errno) : int64_t(done)};
+
+			guard.lock();
+			m_done.push_back(completion);
+			m_done_cond.notify_all();
+		}
+	}
+
+};
+
+inline std::unique_ptr<IoBackend> IoBackend::create(unsigned depth, bool uring) {
+	if(uring) {
+		std::unique_ptr<IoUring> result(new IoUring(depth));
+		if(result->valid()) {
+			return result;
+		}
+	}
+	return std::unique_ptr<IoBackend>(new IoThreadPool(depth));
+}
+
+}; // namespace fio
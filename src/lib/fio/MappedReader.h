@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fio {
+
+/**
+ * The fio::Reader interface over the whole file mapped to the memory. Besides the copying reads,
+ * the strings are returned as std::string_view and the POD arrays as pointers to the mapping,
+ * they are valid until close().
+ */
+class MappedReader {
+
+	std::string _name;
+	const uint8_t* _data;
+	size_t _size;
+	size_t _pos;
+
+public:
+
+	MappedReader(std::string name) noexcept : _name(std::move(name)), _data(nullptr), _size(0), _pos(0) {}
+
+	MappedReader(const MappedReader&) = delete;
+	MappedReader& operator=(const MappedReader&) = delete;
+
+	MappedReader(MappedReader&& rvalue) noexcept
+		: _name(std::move(rvalue._name)), _data(rvalue._data), _size(rvalue._size), _pos(rvalue._pos) {
+		rvalue.clear();
+	}
+
+	MappedReader& operator=(MappedReader&& rvalue) noexcept {
+		if(this != &rvalue) {
+			close();
+			_name = std::move(rvalue._name);
+			_data = rvalue._data;
+			_size = rvalue._size;
+			_pos = rvalue._pos;
+			rvalue.clear();
+		}
+		return *this;
+	}
+
+	~MappedReader() noexcept {
+		close();
+	}
+
+	bool open() {
+		close();
+		const int fd = ::open(_name.c_str(), O_RDONLY | O_CLOEXEC);
+		if(fd < 0) {
+			return false;
+		}
+		struct stat info;
+		bool result = fstat(fd, &info) == 0;
+		_size = result ? size_t(info.st_size) : 0;
+		if(result && _size) {
+			void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+			result = data != MAP_FAILED;
+			if(result) {
+				madvise(data, _size, MADV_SEQUENTIAL);
+				_data = static_cast<const uint8_t*>(data);
+			} else {
+				_size = 0;
+			}
+		}
+		::close(fd);
+		_pos = 0;
+		return result;
+	}
+
+	void close() noexcept {
+		if(_data) {
+			munmap(const_cast<uint8_t*>(_data), _size);
+			_data = nullptr;
+		}
+		_size = _pos = 0;
+	}
+
+	/**
+	 * Read a string up to @term without a copy, the terminator is consumed.
+	 * @return false - if the input is over before @term.
+	 */
+	bool read(std::string_view& value, const char term = 0) noexcept {
+		const void* found = _pos < _size ? memchr(_data + _pos, term, _size - _pos) : nullptr;
+		if(not found) {
+			value = std::string_view(reinterpret_cast<const char*>(_data + _pos), _size - _pos);
+			_pos = _size;
+			return false;
+		}
+		const size_t len = static_cast<const uint8_t*>(found) - (_data + _pos);
+		value = std::string_view(reinterpret_cast<const char*>(_data + _pos), len);
+		_pos += len + 1;
+		return true;
+	}
+
+	bool read(std::string& value, const char term = 0) noexcept {
+		std::string_view view;
+		const bool result = read(view, term);
+		value.assign(view.data(), view.size());
+		return result;
+	}
+
+	template<typename V, std::enable_if_t<std::is_pod_v<V>, int> = 0>
+	bool read(V& value) noexcept {
+		if(_size - _pos < sizeof(value)) {
+			return false;
+		}
+		memcpy(&value, _data + _pos, sizeof(value));
+		_pos += sizeof(value);
+		return true;
+	}
+
+	template<typename V, typename... Args>
+	bool read(V& value, Args&... args) noexcept {
+		return read(value) && read(args...);
+	}
+
+	/**
+	 * Point @values to @count values in the mapping without a copy, see BufferedWriter::write_span().
+	 * @return false - if the input is over or the values are not aligned for V (see BufferedWriter::align()),
+	 * the position is not moved then.
+	 */
+	template<typename V, std::enable_if_t<std::is_pod_v<V>, int> = 0>
+	bool read_span(const V*& values, size_t count) noexcept {
+		// no multiplication, a count read from a broken file would wrap it
+		if(count > (_size - _pos) / sizeof(V) || (count && (_pos % alignof(V)) != 0)) {
+			return false;
+		}
+		values = reinterpret_cast<const V*>(_data + _pos);
+		_pos += sizeof(V) * count;
+		return true;
+	}
+
+	/**
+	 * Skip @size bytes, e.g. the padding of BufferedWriter::align().
+	 */
+	bool skip(size_t size) noexcept {
+		if(_size - _pos < size) {
+			return false;
+		}
+		_pos += size;
+		return true;
+	}
+
+	size_t offset() const noexcept {
+		return _pos;
+	}
+
+	size_t size() const noexcept {
+		return _size;
+	}
+
+private:
+
+	void clear() noexcept {
+		_name.clear();
+		_data = nullptr;
+		_size = _pos = 0;
+	}
+
+};
+
+}; // namespace fio
@@ -0,0 +1,527 @@
+#pragma once
+
+#include "LinkedList.h"
+#include "../utils/ContainerStat.h"
+#include "../utils/Cpu.h"
+#include "../utils/SipHash.h"
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace intrusive {
+
+template<typename K>
+struct CuckooHook {
+	K ic_key;
+	uint32_t ic_slot;     // bucket * WAYS + way
+	uint64_t ic_stamp;    // the last push_back()/move_back() time for the eviction
+
+	CuckooHook() noexcept : ic_key(), ic_slot(0), ic_stamp(0) {}
+
+	CuckooHook(const CuckooHook&) = delete;
+	CuckooHook& operator=(const CuckooHook&) = delete;
+
+	CuckooHook(CuckooHook&&) = delete;
+	CuckooHook& operator=(CuckooHook&&) = delete;
+};
+
+template<typename K>
+struct CuckooQueuePoolEmptyNode : public intrusive::CuckooHook<K> {
+	using Key_t = K;
+	intrusive::LinkedListHook<CuckooQueuePoolEmptyNode<K> > __ill;
+
+	CuckooQueuePoolEmptyNode() noexcept = default;
+
+	CuckooQueuePoolEmptyNode(const CuckooQueuePoolEmptyNode&) = delete;
+	CuckooQueuePoolEmptyNode& operator=(const CuckooQueuePoolEmptyNode&) = delete;
+
+	CuckooQueuePoolEmptyNode(CuckooQueuePoolEmptyNode&&) = delete;
+	CuckooQueuePoolEmptyNode& operator=(CuckooQueuePoolEmptyNode&&) = delete;
+
+};
+
+template<typename K, typename V>
+struct CuckooQueuePoolNode : public intrusive::CuckooHook<K> {
+	using Key_t = K;
+	using Value_t = V;
+	intrusive::LinkedListHook<CuckooQueuePoolNode<K, V> > __ill;
+	V value;
+
+	CuckooQueuePoolNode() : value() {}
+
+	CuckooQueuePoolNode(const CuckooQueuePoolNode&) = delete;
+	CuckooQueuePoolNode& operator=(const CuckooQueuePoolNode&) = delete;
+
+	CuckooQueuePoolNode(CuckooQueuePoolNode&&) = delete;
+	CuckooQueuePoolNode& operator=(CuckooQueuePoolNode&&) = delete;
+
+	bool operator==(const CuckooQueuePoolNode& data) const noexcept {
+		return value == data.value;
+	}
+};
+
+/**
+ * A bucket of the cuckoo table: 4 ways of a 16-bit key tag and a node index, half a cache line.
+ * The tag 0 marks a free way.
+ */
+struct alignas(32) CuckooBucket {
+	static constexpr uint32_t WAYS = 4;
+
+	uint16_t tags[WAYS];
+	uint32_t nodes[WAYS];
+
+	CuckooBucket() noexcept : tags(), nodes() {}
+};
+
+/**
+ * The drop-in replacement of HashQueuePool with the bounded worst case.
+ *
+ * The keys are indexed by a bucketized cuckoo hash table: a key lives in one of two 4-way buckets,
+ * the primary one is chosen by the low hash bits, the alternate one is the primary one XOR a hash
+ * of the 16-bit key tag, so a tag alone is enough to move an item to its other bucket.
+ * find() reads two buckets and compares the node keys only on the tag match, whatever the key set is.
+ *
+ * The hash is keyed by a per-pool random seed: with the default hasher (SipHash-1-3 over the key bytes)
+ * the bucket of a key can't be predicted, so the traffic can't be crafted to overload the table.
+ * A hasher constructible from two uint64_t keys gets the pool keys, any other one (e.g. std::hash)
+ * is only post-mixed with the keys, which doesn't help if its own outputs collide.
+ *
+ * push_back() looks for a free way with a breadth-first search of the cuckoo moves (at most MOVES_MAX
+ * buckets are visited). If there is none, the least recently pushed/moved node of the two buckets
+ * of the key is evicted like pop_front() would do (see evictions()). With the load factor up to 0.9
+ * that practically never happens.
+ *
+ * Node_t MUST have the hook CuckooHook<Key_t>, LinkedListHook __ill and Key_t.
+ * The keys are compared with operator==.
+ * With Stats = true the operations are counted like HashQueuePool does, the probes are the buckets read.
+ */
+template<
+	typename Node_t,
+	typename H = utils::SipHasher<typename Node_t::Key_t>,
+	typename SA = std::allocator<Node_t>,
+	typename BA = std::allocator<CuckooBucket>,
+	bool Stats = false
+>
+class CuckooQueuePool {
+	friend class TestCuckooQueuePool;
+
+	using Key_t = typename Node_t::Key_t;
+	using List_t = intrusive::LinkedList<Node_t>;
+	using Bucket_t = CuckooBucket;
+
+	static constexpr uint32_t WAYS = Bucket_t::WAYS;
+	static constexpr uint32_t MOVES_MAX = 128;
+	static constexpr bool KEYED = std::is_constructible<H, uint64_t, uint64_t>::value;
+
+	struct Step {
+		uint32_t bucket;
+		int32_t parent;   // the step the node came from, -1 for the key buckets
+		uint32_t way;     // the way of the node in the parent bucket
+		uint32_t node;
+	};
+
+	const size_t m_capacity;
+	const uint32_t m_bucket_mask;
+	const uint64_t m_k0;
+	const uint64_t m_k1;
+	H m_hasher;
+	Node_t* m_storage;
+	Bucket_t* m_buckets;
+	List_t m_list_cached;
+	List_t m_list_freed;
+	uint64_t m_clock;
+	size_t m_evictions;
+	SA m_allocator;
+	BA m_bucket_allocator;
+	mutable utils::StatCounter<Stats> m_counter;
+
+public:
+	using Iterator_t = typename List_t::Iterator_t;
+	using ConstIterator_t = typename List_t::ConstIterator_t;
+
+	/**
+	 * @param capacity - the node number.
+	 * @param load_factor - the ratio of the nodes to the table ways, at most 0.95 is sensible.
+	 * @param seed - the hash key, 0 for a random one.
+	 */
+	CuckooQueuePool(unsigned capacity, float load_factor, uint64_t seed = 0) noexcept
+		: m_capacity(capacity)
+		, m_bucket_mask(bucket_number(capacity, load_factor) - 1u)
+		, m_k0(mix(seed ? seed : random_seed()))
+		, m_k1(mix(m_k0 ^ 0x9E3779B97F4A7C15ull))
+		, m_hasher(make_hasher(m_k0, m_k1))
+		, m_storage(nullptr)
+		, m_buckets(nullptr)
+		, m_list_cached()
+		, m_list_freed()
+		, m_clock(0)
+		, m_evictions(0)
+		, m_allocator()
+		, m_bucket_allocator()
+		, m_counter() {}
+
+	CuckooQueuePool(const CuckooQueuePool&) = delete;
+	CuckooQueuePool& operator=(const CuckooQueuePool&) = delete;
+
+	CuckooQueuePool(CuckooQueuePool&& rv) = delete;
+	CuckooQueuePool& operator=(CuckooQueuePool&&) = delete;
+
+	virtual ~CuckooQueuePool() noexcept {
+		destroy();
+	}
+
+	/**
+	 * Allocate the node storage and the table.
+	 * @return 0 - if the storage has been allocated successfully.
+	 */
+	int allocate() noexcept {
+		if(m_storage || m_capacity > UINT32_MAX)
+			return -1;
+
+		m_storage = m_allocator.allocate(m_capacity);
+		if(m_storage == nullptr)
+			return -1;
+		for(size_t i = 0; i < m_capacity; i++) {
+			new(m_storage + i) Node_t();
+			m_list_freed.push_back(m_storage[i]);
+		}
+
+		m_buckets = m_bucket_allocator.allocate(buckets());
+		if(m_buckets == nullptr) {
+			destroy();
+			return -1;
+		}
+		for(size_t i = 0; i < buckets(); i++) {
+			new(m_buckets + i) Bucket_t();
+		}
+		return 0;
+	}
+
+	inline Iterator_t end() noexcept {
+		return Iterator_t();
+	}
+
+	inline ConstIterator_t cend() const noexcept {
+		return ConstIterator_t();
+	}
+
+	/**
+	 * Link a free node with @key at the back of the queue.
+	 * The key MUST NOT be in the pool.
+	 * @return The node or end() if there is no free node.
+	 */
+	Iterator_t push_back(const Key_t& key) noexcept {
+		Node_t* freed = nullptr;
+		if(available()) {
+			const uint64_t hash = hash_of(key);
+			const uint16_t tag = tag_of(hash);
+			const uint32_t first = uint32_t(hash) & m_bucket_mask;
+			freed = m_list_freed.pop_back();
+			freed->ic_key = key;
+			freed->ic_stamp = ++m_clock;
+			m_list_cached.push_back(*freed);
+			const uint32_t node = uint32_t(freed - m_storage);
+			if(not place(first, tag, node)) {
+				evict(first, tag, node);
+			}
+			m_counter.insert();
+		} else {
+			m_counter.fail();
+		}
+		return Iterator_t(freed);
+	}
+
+	inline Iterator_t peek_front() noexcept {
+		Iterator_t result;
+		if(size()) {
+			result = Iterator_t(m_list_cached.begin().get());
+		}
+		return result;
+	}
+
+	inline Iterator_t pop_front() noexcept {
+		Node_t* result = nullptr;
+		if(size()) {
+			result = m_list_cached.pop_front();
+			m_list_freed.push_back(*result);
+			unlink(*result);
+			m_counter.remove();
+		}
+		return Iterator_t(result);
+	}
+
+	inline ConstIterator_t find(const Key_t& key) const noexcept {
+		return ConstIterator_t(lookup(key));
+	}
+
+	inline Iterator_t find(const Key_t& key) noexcept {
+		return Iterator_t(lookup(key));
+	}
+
+	inline void move_back(Iterator_t it) noexcept {
+		it->ic_stamp = ++m_clock;
+		m_list_cached.remove(*it);
+		m_list_cached.push_back(*it);
+	}
+
+	inline void remove(Iterator_t it) noexcept {
+		unlink(*it);
+		m_list_cached.remove(*it);
+		m_list_freed.push_back(*it);
+		m_counter.remove();
+	}
+
+	void reset() noexcept {
+		m_list_cached.clear();
+		m_list_freed.clear();
+		for(size_t i = 0; i < m_capacity; i++) {
+			m_list_freed.push_back(m_storage[i]);
+		}
+		for(size_t i = 0; i < buckets(); i++) {
+			new(m_buckets + i) Bucket_t();
+		}
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_capacity;
+	}
+
+	inline size_t size() const noexcept {
+		return m_list_cached.size();
+	}
+
+	inline size_t available() const noexcept {
+		return m_list_freed.size();
+	}
+
+	inline size_t buckets() const noexcept {
+		return size_t(m_bucket_mask) + 1u;
+	}
+
+	/**
+	 * @return How many nodes have been evicted by push_back() because the table had no room for a key.
+	 */
+	inline size_t evictions() const noexcept {
+		return m_evictions;
+	}
+
+	inline size_t storage_bytes() const noexcept {
+		return m_capacity * sizeof(Node_t) + buckets() * sizeof(Bucket_t);
+	}
+
+	/**
+	 * @return The statistics snapshot, the evictions are the ones made by push_back().
+	 */
+	utils::ContainerStat stat() const noexcept {
+		utils::ContainerStat result = m_counter.stat();
+		result.capacity = m_capacity;
+		result.size = size();
+		return result;
+	}
+
+	inline void reset_stat() noexcept {
+		m_counter.reset();
+	}
+
+private:
+
+	static uint32_t bucket_number(size_t capacity, float load_factor) noexcept {
+		const size_t ways = size_t(double(capacity) / double(load_factor > 0.0f ? load_factor : 1.0f)) + 1u;
+		size_t result = 2;
+		while(result * WAYS < ways) {
+			result <<= 1u;
+		}
+		return uint32_t(result);
+	}
+
+	static inline uint64_t mix(uint64_t x) noexcept {
+		// the splitmix64 finalizer
+		x ^= x >> 30u;
+		x *= 0xBF58476D1CE4E5B9ull;
+		x ^= x >> 27u;
+		x *= 0x94D049BB133111EBull;
+		x ^= x >> 31u;
+		return x;
+	}
+
+	static uint64_t random_seed() noexcept {
+		static uint64_t counter = 0;
+		return utils::Cpu::rdtsc() ^ (uint64_t(uintptr_t(&counter)) << 16u) ^ ++counter;
+	}
+
+	static H make_hasher(uint64_t k0, uint64_t k1) noexcept {
+		if constexpr (KEYED) {
+			return H(k0, k1);
+		} else {
+			return H();
+		}
+	}
+
+	inline uint64_t hash_of(const Key_t& key) const noexcept {
+		if constexpr (KEYED) {
+			return uint64_t(m_hasher(key));
+		} else {
+			return mix(uint64_t(m_hasher(key)) ^ m_k0) ^ m_k1;
+		}
+	}
+
+	static inline uint16_t tag_of(uint64_t hash) noexcept {
+		const uint16_t tag = uint16_t(hash >> 48u);
+		return tag ? tag : 1u;
+	}
+
+	inline uint32_t alternate(uint32_t bucket, uint16_t tag) const noexcept {
+		// an involution: the alternate bucket of the alternate bucket is the original one
+		return (bucket ^ (uint32_t(tag) * 0x5BD1E995u)) & m_bucket_mask;
+	}
+
+	/**
+	 * @return The high bits of the ways holding @tag (SWAR over the 4 tags, exact per lane).
+	 */
+	static inline uint64_t match(const Bucket_t& bucket, uint16_t tag) noexcept {
+		constexpr uint64_t LOW = 0x7FFF7FFF7FFF7FFFull;
+		uint64_t tags;
+		memcpy(&tags, bucket.tags, sizeof(tags));
+		const uint64_t x = tags ^ (uint64_t(tag) * 0x0001000100010001ull);
+		return ~(((x & LOW) + LOW) | x) & ~LOW;
+	}
+
+	Node_t* lookup(const Key_t& key) const noexcept {
+		const uint64_t hash = hash_of(key);
+		const uint16_t tag = tag_of(hash);
+		const uint32_t first = uint32_t(hash) & m_bucket_mask;
+		const uint32_t second = alternate(first, tag);
+		__builtin_prefetch(m_buckets + second);
+		const uint64_t start = m_counter.sample_start();
+		uint64_t probes = 0;
+		for(uint32_t bucket : {first, second}) {
+			const Bucket_t& b = m_buckets[bucket];
+			probes++;
+			for(uint64_t ways = match(b, tag); ways; ways &= ways - 1u) {
+				const uint32_t node = b.nodes[unsigned(__builtin_ctzll(ways)) >> 4u];
+				if(m_storage[node].ic_key == key) {
+					m_counter.lookup(true, probes);
+					m_counter.sample_stop(start);
+					return m_storage + node;
+				}
+			}
+		}
+		m_counter.lookup(false, probes);
+		m_counter.sample_stop(start);
+		return nullptr;
+	}
+
+	inline void put(uint32_t bucket, uint32_t way, uint16_t tag, uint32_t node) noexcept {
+		m_buckets[bucket].tags[way] = tag;
+		m_buckets[bucket].nodes[way] = node;
+		m_storage[node].ic_slot = bucket * WAYS + way;
+	}
+
+	inline void unlink(const Node_t& node) noexcept {
+		m_buckets[node.ic_slot / WAYS].tags[node.ic_slot % WAYS] = 0;
+	}
+
+	/**
+	 * Find a free way by the breadth-first search of the moves and shift the nodes along the path.
+	 * @return false - if no free way has been found in MOVES_MAX buckets.
+	 */
+	bool place(uint32_t first, uint16_t tag, uint32_t node) noexcept {
+		Step steps[MOVES_MAX];
+		uint32_t nb = 0;
+		steps[nb++] = Step{first, -1, 0, 0};
+		const uint32_t second = alternate(first, tag);
+		if(second != first) {
+			steps[nb++] = Step{second, -1, 0, 0};
+		}
+		for(uint32_t head = 0; head < nb; ++head) {
+			const Bucket_t& b = m_buckets[steps[head].bucket];
+			for(uint32_t way = 0; way < WAYS; ++way) {
+				if(not b.tags[way]) {
+					return shift(steps, head, way, tag, node);
+				}
+			}
+			for(uint32_t way = 0; way < WAYS && nb < MOVES_MAX; ++way) {
+				steps[nb++] = Step{alternate(steps[head].bucket, b.tags[way]), int32_t(head), way, b.nodes[way]};
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Move the nodes from the free way back to the key bucket, the last move first,
+	 * so every move goes to a free way and the table stays valid at any point.
+	 */
+	bool shift(const Step* steps, uint32_t step, uint32_t way, uint16_t tag, uint32_t node) noexcept {
+		while(steps[step].parent >= 0) {
+			const Step& from = steps[steps[step].parent];
+			const Bucket_t& b = m_buckets[from.bucket];
+			const uint32_t from_way = steps[step].way;
+			// a path visiting a bucket twice may have changed the way already
+			if(m_buckets[steps[step].bucket].tags[way] || not b.tags[from_way] || b.nodes[from_way] != steps[step].node) {
+				return false;
+			}
+			put(steps[step].bucket, way, b.tags[from_way], b.nodes[from_way]);
+			m_buckets[from.bucket].tags[from_way] = 0;
+			step = uint32_t(steps[step].parent);
+			way = from_way;
+		}
+		if(m_buckets[steps[step].bucket].tags[way]) {
+			return false;
+		}
+		put(steps[step].bucket, way, tag, node);
+		return true;
+	}
+
+	/**
+	 * Replace the least recently used node of the key buckets with @node.
+	 */
+	void evict(uint32_t first, uint16_t tag, uint32_t node) noexcept {
+		uint32_t victim_bucket = first;
+		uint32_t victim_way = 0;
+		uint64_t oldest = UINT64_MAX;
+		for(uint32_t bucket : {first, alternate(first, tag)}) {
+			const Bucket_t& b = m_buckets[bucket];
+			for(uint32_t way = 0; way < WAYS; ++way) {
+				if(not b.tags[way]) {
+					// freed by a failed shift
+					put(bucket, way, tag, node);
+					return;
+				}
+				if(m_storage[b.nodes[way]].ic_stamp < oldest) {
+					oldest = m_storage[b.nodes[way]].ic_stamp;
+					victim_bucket = bucket;
+					victim_way = way;
+				}
+			}
+		}
+		Node_t& victim = m_storage[m_buckets[victim_bucket].nodes[victim_way]];
+		m_list_cached.remove(victim);
+		m_list_freed.push_back(victim);
+		put(victim_bucket, victim_way, tag, node);
+		++m_evictions;
+		m_counter.evict();
+	}
+
+	void destroy() noexcept {
+		if(m_storage) {
+			m_list_freed.clear();
+			m_list_cached.clear();
+			for(size_t i = 0; i < m_capacity; i++) {
+				m_storage[i].~Node_t();
+			}
+			m_allocator.deallocate(m_storage, m_capacity);
+			m_storage = nullptr;
+		}
+		if(m_buckets) {
+			m_bucket_allocator.deallocate(m_buckets, buckets());
+			m_buckets = nullptr;
+		}
+	}
+
+};
+
+}; // namespace intrusive
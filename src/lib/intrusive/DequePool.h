@@ -1,16 +1,25 @@
 #ifndef INTRUSIVEPOOL_DEQUEDPOOL_H
 #define INTRUSIVEPOOL_DEQUEDPOOL_H
 
-#include "../../../intrusive/LinkedList.h"
-#include "../../../intrusive/HashMap.h"
+#include "LinkedList.h"
+#include "HashMap.h"
+#include "PoolShared.h"
+#include "PoolSnapshot.h"
+#include "../utils/SharedRegion.h"
 
 #include <bits/allocator.h>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#include <immintrin.h>
 
 namespace intrusive {
 
 template<typename T>
-struct DequePoolNode : public intrusive::LinkedListHook<DequePoolNode<T> > {
+struct DequePoolNode {
 	using Value_t = T;
+	intrusive::LinkedListHook<DequePoolNode<T> > __ill;
 	T value;
 
 	DequePoolNode() : value() {}
@@ -28,19 +37,26 @@ struct DequePoolNode : public intrusive::LinkedListHook<DequePoolNode<T> > {
 
 template<
 	typename Node_t,
-	typename SA = std::allocator<Node_t>
+	typename SA = std::allocator<Node_t>,
+	bool Stats = false
 >
 class DequePool {
 	friend class TestDequePool;
 
 	using Value_t = typename Node_t::Value_t;
 	using List_t = intrusive::LinkedList<Node_t>;
+	using Shared_t = PoolSharedState<Node_t>;
+
+	static constexpr unsigned READ_RETRIES = 64;
 
 	const size_t m_capacity;
 	Node_t* m_storage;
 	List_t m_list_cached;
 	List_t m_list_freed;
 	SA m_allocator;
+	utils::StatCounter<Stats> m_counter;
+	Shared_t* m_shared;
+	bool m_dirty;
 
 public:
 	using Iterator_t = typename List_t::Iterator_t;
@@ -49,7 +65,8 @@ public:
 	using ConstReverseIterator_t = typename List_t::ConstReverseIterator_t;
 
 	DequePool(unsigned capacity) noexcept
-		: m_capacity(capacity), m_storage(nullptr), m_list_cached(), m_list_freed(), m_allocator() {}
+		: m_capacity(capacity), m_storage(nullptr), m_list_cached(), m_list_freed(), m_allocator(), m_counter()
+		, m_shared(nullptr), m_dirty(false) {}
 
 	DequePool(const DequePool&) = delete;
 	DequePool& operator=(const DequePool&) = delete;
@@ -81,6 +98,114 @@ public:
 		return 0;
 	}
 
+	/**
+	 * Place the node storage and the published state in @region instead of the allocator,
+	 * see HashQueuePool::allocate(utils::SharedRegion&).
+	 * @return 0 - on success, -1 - the region is over, it holds another pool or the last writer has died
+	 * in the middle of a change.
+	 */
+	int allocate(utils::SharedRegion& region) noexcept {
+		if(m_storage)
+			return -1;
+
+		Shared_t* shared = static_cast<Shared_t*>(region.allocate(sizeof(Shared_t), alignof(Shared_t)));
+		Node_t* storage = static_cast<Node_t*>(region.allocate(sizeof(Node_t) * m_capacity, alignof(Node_t)));
+		if(shared == nullptr || storage == nullptr)
+			return -1;
+
+		if(region.created()) {
+			new (shared) Shared_t;
+			shared->init(0, m_capacity, 0, storage, nullptr);
+			for(size_t i = 0; i < m_capacity; i++) {
+				new (storage + i) Node_t();
+			}
+			m_list_freed.assign(storage, m_capacity);
+			m_dirty = true;
+		} else {
+			uint64_t elements = 0;
+			if(not shared->fits(0, m_capacity, 0, storage, nullptr)
+				|| not shared->load(m_list_cached, m_list_freed, elements)) {
+				m_list_cached.drop();
+				m_list_freed.drop();
+				return -1;
+			}
+		}
+		m_storage = storage;
+		m_shared = shared;
+		commit();
+		return 0;
+	}
+
+	/**
+	 * Publish the state of a pool in a shared region, see HashQueuePool::commit().
+	 */
+	inline void commit() noexcept {
+		if(m_dirty) {
+			m_shared->commit(m_list_cached, m_list_freed, 0);
+			m_dirty = false;
+		}
+	}
+
+	/**
+	 * Take the state published by the writer for a reader pool. The list is walked by the iterators with
+	 * no synchronization, so the writer must be quiescent until the walks end.
+	 * @return false - if the writer is in the middle of a change, the pool keeps its previous state then.
+	 */
+	bool refresh() noexcept {
+		List_t cached;
+		List_t freed;
+		uint64_t elements = 0;
+		const bool result = m_shared && m_shared->load(cached, freed, elements);
+		if(result) {
+			m_list_cached.adopt(cached.head(), cached.tail(), cached.size());
+			m_list_freed.adopt(freed.head(), freed.tail(), freed.size());
+		}
+		cached.drop();
+		freed.drop();
+		return result;
+	}
+
+	/**
+	 * Copy the value of the front node published by a live writer, for a reader pool,
+	 * see HashQueuePool::read().
+	 * @return 1 - copied, 0 - the pool is empty, -1 - the writer has been in a change during all the reads.
+	 */
+	int read_front(Value_t& value, unsigned retries = READ_RETRIES) const noexcept {
+		static_assert(std::is_trivially_copyable<Value_t>::value, "the value is copied while the writer may change it");
+		if(m_shared == nullptr) {
+			if(size()) {
+				value = m_list_cached.cbegin()->value;
+			}
+			return size() ? 1 : 0;
+		}
+		for(unsigned i = 0; i < retries; i++) {
+			const uint64_t start = m_shared->read_begin();
+			if(start & 1u) {
+				_mm_pause();
+				continue;
+			}
+			const Node_t* node = m_shared->cached_head;
+			alignas(Value_t) uint8_t copy[sizeof(Value_t)];
+			if(node) {
+				memcpy(copy, &node->value, sizeof(Value_t));
+			}
+			if(m_shared->read_end(start)) {
+				if(node) {
+					memcpy(&value, copy, sizeof(Value_t));
+				}
+				return node ? 1 : 0;
+			}
+		}
+		return -1;
+	}
+
+	/**
+	 * @return The generation of a pool in a shared region, see PoolSharedState.
+	 */
+	inline uint64_t generation() const noexcept {
+		return m_shared ? m_shared->generation.load(std::memory_order_acquire) : 0;
+	}
+
 	inline Iterator_t begin() noexcept {
 		return m_list_cached.begin();
 	}
@@ -116,8 +241,12 @@ public:
 	inline Iterator_t push_front() noexcept {
 		Node_t* result = nullptr;
 		if(available()) {
+			touch();
 			result = m_list_freed.pop_back();
 			m_list_cached.push_front(*result);
+			m_counter.insert();
+		} else {
+			m_counter.fail();
 		}
 		return Iterator_t(result);
 	}
@@ -125,8 +254,12 @@ public:
 	inline Iterator_t push_back() noexcept {
 		Node_t* result = nullptr;
 		if(available()) {
+			touch();
 			result = m_list_freed.pop_back();
 			m_list_cached.push_back(*result);
+			m_counter.insert();
+		} else {
+			m_counter.fail();
 		}
 		return Iterator_t(result);
 	}
@@ -134,8 +267,10 @@ public:
 	inline Iterator_t pop_front() noexcept {
 		Node_t* result = nullptr;
 		if(size()) {
+			touch();
 			result = m_list_cached.pop_front();
 			m_list_freed.push_back(*result);
+			m_counter.remove();
 		}
 		return Iterator_t(result);
 	}
@@ -143,23 +278,30 @@ public:
 	inline Iterator_t pop_back() noexcept {
 		Node_t* result = nullptr;
 		if(size()) {
+			touch();
 			result = m_list_cached.pop_back();
 			m_list_freed.push_back(*result);
+			m_counter.remove();
 		}
 		return Iterator_t(result);
 	}
 
 	inline void remove(Iterator_t it) noexcept {
+		touch();
 		m_list_cached.remove(*it);
 		m_list_freed.push_back(*it);
+		m_counter.remove();
 	}
 
 	inline void remove(ReverseIterator_t it) noexcept {
+		touch();
 		m_list_cached.remove(*it);
 		m_list_freed.push_back(*it);
+		m_counter.remove();
 	}
 
 	void reset() noexcept {
+		touch();
 		m_list_cached.clear();
 		// TODO: wtf?
 		for(unsigned i = 0; i < m_capacity; i++) {
@@ -167,6 +309,74 @@ public:
 		}
 	}
 
+	/**
+	 * Write the cached nodes to a fio writer from the front to the back: PoolSnapshotHeader,
+	 * then the payload of each node.
+	 * @param payload - bool(W&, const Node_t&) writes a node, the value by default.
+	 * @return false - on a write error or if the pool is not allocated.
+	 */
+	template<typename W, typename F>
+	bool save(W& writer, F&& payload) const {
+		if(m_storage == nullptr) {
+			return false;
+		}
+		PoolSnapshotHeader header = {};
+		header.magic = PoolSnapshotHeader::MAGIC;
+		header.version = PoolSnapshotHeader::VERSION;
+		header.node_size = sizeof(Node_t);
+		header.count = size();
+		bool result = writer.write(header);
+		for(auto it = m_list_cached.cbegin(); result && it != m_list_cached.cend(); ++it) {
+			result = payload(writer, *it);
+		}
+		return result;
+	}
+
+	template<typename W>
+	bool save(W& writer) const {
+		return save(writer, [](W& out, const Node_t& node) {
+			return PoolSnapshotValue<Node_t>::save(out, node);
+		});
+	}
+
+	/**
+	 * Replace the content with a snapshot of save(), the nodes are filled in the storage order and
+	 * both lists are linked with one pass over the storage.
+	 * @param payload - bool(R&, Node_t&) reads a node, the value by default.
+	 * @return false - if the snapshot is not of this node type, does not fit to the capacity or is truncated,
+	 * the pool is empty then.
+	 */
+	template<typename R, typename F>
+	bool restore(R& reader, F&& payload) {
+		if(m_storage == nullptr) {
+			return false;
+		}
+		touch();
+		// all the hooks are rewritten below in the storage order, the old links are not walked
+		m_list_cached.drop();
+		m_list_freed.drop();
+		PoolSnapshotHeader header;
+		bool result = reader.read(header) && header.fits(0, sizeof(Node_t), m_capacity);
+		const size_t count = result ? size_t(header.count) : 0;
+		for(size_t i = 0; result && i < count; i++) {
+			result = payload(reader, m_storage[i]);
+		}
+		if(result) {
+			m_list_cached.assign(m_storage, count);
+			m_list_freed.assign(m_storage + count, m_capacity - count);
+		} else {
+			m_list_freed.assign(m_storage, m_capacity);
+		}
+		return result;
+	}
+
+	template<typename R>
+	bool restore(R& reader) {
+		return restore(reader, [](R& in, Node_t& node) {
+			return PoolSnapshotValue<Node_t>::restore(in, node);
+		});
+	}
+
 	inline size_t capacity() const noexcept {
 		return m_capacity;
 	}
@@ -179,9 +389,41 @@ public:
 		return m_list_freed.size();
 	}
 
+	/**
+	 * @return The statistics snapshot: the pushes, the pops/removals and the refused pushes.
+	 */
+	utils::ContainerStat stat() const noexcept {
+		utils::ContainerStat result = m_counter.stat();
+		result.capacity = m_capacity;
+		result.size = size();
+		return result;
+	}
+
+	inline void reset_stat() noexcept {
+		m_counter.reset();
+	}
+
 private:
 
+	/**
+	 * Make the generation of a pool in a shared region odd before the first change after a commit().
+	 */
+	inline void touch() noexcept {
+		if(m_shared && not m_dirty) {
+			m_shared->begin();
+			m_dirty = true;
+		}
+	}
+
 	void destroy() noexcept {
+		if(m_shared) {
+			// the nodes stay in the region for the next attach
+			commit();
+			m_list_freed.drop();
+			m_list_cached.drop();
+			m_shared = nullptr;
+			m_storage = nullptr;
+		}
 		if(m_storage) {
 			m_list_freed.clear();
 			m_list_cached.clear();
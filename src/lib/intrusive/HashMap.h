@@ -1,6 +1,8 @@
 #ifndef INTRUSIVE_HASHMAP_H
 #define INTRUSIVE_HASHMAP_H
 
+#include "../utils/ContainerStat.h"
+
 #include <memory>
 #include <cassert>
 
@@ -38,9 +40,17 @@ struct HashMapBucket {
 /**
  * An unordered hash map implemented in an intrusive way.
  * Can hold many items for one key.
+ * With Stats = true the lookups (the chain lengths, the sampled latency), the links and the removals
+ * are counted, see stat().
  */
 
-template<typename K, typename MapNode, typename H = std::hash<K>, typename A = std::allocator<HashMapBucket<MapNode> > >
+template<
+	typename K,
+	typename MapNode,
+	typename H = std::hash<K>,
+	typename A = std::allocator<HashMapBucket<MapNode> >,
+	bool Stats = false
+>
 class HashMap {
 public:
 	using Bucket_t = HashMapBucket<MapNode>;
@@ -51,6 +61,8 @@ private:
 	size_t elements;
 	H hasher;
 	A allocator;
+	mutable utils::StatCounter<Stats> counter;
+	bool external; // the buckets are placed by the owner
 
 	template<typename N>
 	struct Iterator {
@@ -131,7 +143,8 @@ public:
 	using ConstIterator_t = Iterator<const MapNode>;
 
 	HashMap(size_t bucket_list_size) noexcept :
-		bucket_list(nullptr), bucket_list_size(bucket_list_size), elements(0), hasher(), allocator() {}
+		bucket_list(nullptr), bucket_list_size(bucket_list_size), elements(0), hasher(), allocator(), counter()
+		, external(false) {}
 
 	HashMap(const HashMap&) = delete;
 	HashMap& operator=(const HashMap&) = delete;
@@ -141,7 +154,9 @@ public:
 		, bucket_list_size(rv.bucket_list_size)
 		, elements(rv.elements)
 		, hasher(rv.hasher)
-		, allocator(rv.allocator) {
+		, allocator(rv.allocator)
+		, counter(rv.counter)
+		, external(rv.external) {
 		rv.bucket_list = nullptr;
 		rv.destroy();
 	}
@@ -154,6 +169,8 @@ public:
 			elements = rv.elements;
 			allocator = rv.allocator;
 			hasher = rv.hasher;
+			counter = rv.counter;
+			external = rv.external;
 			rv.clean_state();
 		}
 		return *this;
@@ -184,6 +201,30 @@ public:
 		return bucket_list != nullptr;
 	}
 
+	/**
+	 * Use the buckets placed by the owner, e.g. in a shared memory region, instead of allocate().
+	 * The map neither constructs nor frees them and does not unlink the nodes at the destruction.
+	 * @param buckets - buckets() constructed buckets.
+	 * @param elements - the number of the nodes linked in them.
+	 * @return true - if the map has no buckets before.
+	 */
+	bool attach(Bucket_t* buckets, size_t elements) noexcept {
+		if(bucket_list)
+			return false;
+
+		bucket_list = buckets;
+		this->elements = elements;
+		external = true;
+		return true;
+	}
+
+	/**
+	 * Take the number of the nodes linked in the attached buckets by another process, see attach().
+	 */
+	inline void attach_size(size_t elements) noexcept {
+		this->elements = elements;
+	}
+
 	/**
 	 * Unlink all the objects the map contains.
 	 */
@@ -194,6 +235,19 @@ public:
 		}
 	}
 
+	/**
+	 * Forget all the objects without unlinking them, their hooks are left as they are.
+	 * It is for an owner which rewrites the hooks of all its nodes anyway, e.g. a bulk rebuild,
+	 * so the nodes are not touched in the chain order.
+	 */
+	void drop() noexcept {
+		for(size_t i = 0; i < bucket_list_size; i++) {
+			bucket_list[i].head = nullptr;
+			bucket_list[i].size = 0;
+		}
+		elements = 0;
+	}
+
 	/**
 	 * Link a key with a node.
 	 * The node must not be linked.
@@ -205,17 +259,42 @@ public:
 		check_free(node); // TODO: debug
 		size_t bucket_id = hasher(key) % bucket_list_size;
 		link_front(bucket_id, key, node);
+		counter.insert();
 		return Iterator_t(&node);
 	}
 
+	/**
+	 * Link a key with a node in a known bucket, the key is not hashed.
+	 * It is for a rebuild of the map with the same bucket number and hasher, e.g. from a snapshot.
+	 * The node must not be linked.
+	 * @param bucket_id - bucket(key).
+	 */
+	Iterator_t link_bucket(size_t bucket_id, const K& key, MapNode& node) noexcept {
+		check_free(node);
+		assert(bucket_id < bucket_list_size);
+		link_front(bucket_id, key, node);
+		counter.insert();
+		return Iterator_t(&node);
+	}
+
+	/**
+	 * @return The bucket of the key.
+	 */
+	inline size_t bucket(const K& key) const noexcept {
+		return hasher(key) % bucket_list_size;
+	}
+
 	/**
 	 * Find the first node which is linked to the key.
 	 * @param key
 	 * @return 
 	 */
 	ConstIterator_t find(const K& key) const noexcept {
+		const uint64_t start = counter.sample_start();
 		size_t bucket_id = hasher(key) % bucket_list_size;
-		return ConstIterator_t(find(bucket_id, key));
+		const MapNode* result = find(bucket_id, key);
+		counter.sample_stop(start);
+		return ConstIterator_t(result);
 	}
 
 	/**
@@ -224,8 +303,11 @@ public:
 	 * @return 
 	 */
 	Iterator_t find(const K& key) noexcept {
+		const uint64_t start = counter.sample_start();
 		size_t bucket_id = hasher(key) % bucket_list_size;
-		return Iterator_t(find(bucket_id, key));
+		MapNode* result = find(bucket_id, key);
+		counter.sample_stop(start);
+		return Iterator_t(result);
 	}
 
 	/**
@@ -243,6 +325,7 @@ public:
 			MapNode* prev = find_prev(bucket_id, &node);
 			unlink_next(bucket_id, *prev);
 		}
+		counter.remove();
 	}
 
 	/**
@@ -269,6 +352,20 @@ public:
 		return bucket_list_size;
 	}
 
+	/**
+	 * @return The statistics snapshot, the capacity is the bucket number.
+	 */
+	utils::ContainerStat stat() const noexcept {
+		utils::ContainerStat result = counter.stat();
+		result.capacity = bucket_list_size;
+		result.size = elements;
+		return result;
+	}
+
+	inline void reset_stat() noexcept {
+		counter.reset();
+	}
+
 	inline Iterator_t begin(size_t bucket) noexcept {
 		return Iterator_t(bucket_list[bucket].head, bucket);
 	}
@@ -288,7 +385,7 @@ public:
 private:
 
 	void destroy() noexcept {
-		if(bucket_list) {
+		if(bucket_list && not external) {
 			clear();
 			for(size_t i = 0; i < bucket_list_size; i++) {
 				allocator.destroy(bucket_list + i);
@@ -336,24 +433,17 @@ private:
 		elements--;
 	}
 
-	inline MapNode* find(size_t bucket_id, const K& key) noexcept {
-		MapNode* cur = bucket_list[bucket_id].head;
-		while(cur) {
-			if(cur->im_key == key)
-				break;
-			cur = cur->im_next;
-		}
-		return cur;
-	}
-
-	inline const MapNode* find(size_t bucket_id, const K& key) const noexcept {
+	inline MapNode* find(size_t bucket_id, const K& key) const noexcept {
 		MapNode* cur = bucket_list[bucket_id].head;
+		uint64_t probes = 0;
 		while(cur) {
+			probes++;
 			if(cur->im_key == key) {
 				break;
 			}
 			cur = cur->im_next;
 		}
+		counter.lookup(cur != nullptr, probes);
 		return cur;
 	}
 
@@ -374,6 +464,7 @@ private:
 		bucket_list = nullptr;
 		bucket_list_size = 0;
 		elements = 0;
+		external = false;
 	}
 
 };
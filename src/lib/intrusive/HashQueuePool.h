@@ -1,18 +1,27 @@
 #ifndef INTRUSIVEPOOL_HASHQUEUEPOOL_H
 #define INTRUSIVEPOOL_HASHQUEUEPOOL_H
 
-#include "../../../intrusive/LinkedList.h"
-#include "../../../intrusive/HashMap.h"
+#include "LinkedList.h"
+#include "HashMap.h"
+#include "PoolShared.h"
+#include "PoolSnapshot.h"
+#include "../utils/SharedRegion.h"
 
 #include <bits/allocator.h>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include <immintrin.h>
 
 namespace intrusive {
 
 template<typename K>
-struct HashQueuePoolEmptyNode
-	: public intrusive::LinkedListHook<HashQueuePoolEmptyNode<K> >,
-	  intrusive::HashMapHook<K, HashQueuePoolEmptyNode<K> > {
+struct HashQueuePoolEmptyNode : public intrusive::HashMapHook<K, HashQueuePoolEmptyNode<K> > {
 	using Key_t = K;
+	intrusive::LinkedListHook<HashQueuePoolEmptyNode<K> > __ill;
 
 	HashQueuePoolEmptyNode() noexcept = default;
 
@@ -25,10 +34,10 @@ struct HashQueuePoolEmptyNode
 };
 
 template<typename K, typename V>
-struct HashQueuePoolNode
-	: public intrusive::LinkedListHook<HashQueuePoolNode<K, V> >, intrusive::HashMapHook<K, HashQueuePoolNode<K, V> > {
+struct HashQueuePoolNode : public intrusive::HashMapHook<K, HashQueuePoolNode<K, V> > {
 	using Key_t = K;
 	using Value_t = V;
+	intrusive::LinkedListHook<HashQueuePoolNode<K, V> > __ill;
 	V value;
 
 	HashQueuePoolNode() : value() {}
@@ -48,15 +57,19 @@ template<
 	typename Node_t,
 	typename H = std::hash<typename Node_t::Key_t>,
 	typename SA = std::allocator<Node_t>,
-	typename BA = std::allocator<intrusive::HashMapBucket<Node_t> >
+	typename BA = std::allocator<intrusive::HashMapBucket<Node_t> >,
+	bool Stats = false
 >
 class HashQueuePool {
 	friend class TestHashQueuePool;
 
 	using Key_t = typename Node_t::Key_t;
 	using List_t = intrusive::LinkedList<Node_t>;
-	using Map_t = intrusive::HashMap<Key_t, Node_t, H, BA>;
+	using Map_t = intrusive::HashMap<Key_t, Node_t, H, BA, Stats>;
 	using Bucket_t = typename Map_t::Bucket_t;
+	using Shared_t = PoolSharedState<Node_t, Bucket_t>;
+
+	static constexpr unsigned READ_RETRIES = 64;
 
 	const size_t m_capacity;
 	Node_t* m_storage;
@@ -64,6 +77,9 @@ class HashQueuePool {
 	List_t m_list_cached;
 	List_t m_list_freed;
 	SA m_allocator;
+	utils::StatCounter<Stats> m_counter;
+	Shared_t* m_shared;
+	bool m_dirty;
 
 public:
 	using Iterator_t = typename Map_t::Iterator_t;
@@ -75,7 +91,10 @@ public:
 		, m_map((capacity / load_factor) + 1)
 		, m_list_cached()
 		, m_list_freed()
-		, m_allocator() {}
+		, m_allocator()
+		, m_counter()
+		, m_shared(nullptr)
+		, m_dirty(false) {}
 
 	HashQueuePool(const HashQueuePool&) = delete;
 	HashQueuePool& operator=(const HashQueuePool&) = delete;
@@ -112,6 +131,133 @@ public:
 		return 0;
 	}
 
+	/**
+	 * Place the node storage, the buckets and the published state in @region instead of the allocators.
+	 * A created region gets an empty pool. An attached one gives back the pool of the creator with its keys,
+	 * values and LRU order without a pass over the nodes, if the geometry, the addresses and the node type
+	 * are the same and the generation is even. Only one writer may be attached at a time, a read only region
+	 * gives a reader pool: read() while the writer runs, find(), peek_front() and refresh() while it is quiescent.
+	 * @return 0 - on success, -1 - the region is over, it holds another pool or the last writer has died
+	 * in the middle of a change (create the region again, e.g. restore() a snapshot then).
+	 */
+	int allocate(utils::SharedRegion& region) noexcept {
+		if(m_storage)
+			return -1;
+
+		Shared_t* shared = static_cast<Shared_t*>(region.allocate(sizeof(Shared_t), alignof(Shared_t)));
+		Node_t* storage = static_cast<Node_t*>(region.allocate(sizeof(Node_t) * m_capacity, alignof(Node_t)));
+		Bucket_t* buckets = static_cast<Bucket_t*>(region.allocate(sizeof(Bucket_t) * m_map.buckets(), alignof(Bucket_t)));
+		if(shared == nullptr || storage == nullptr || buckets == nullptr)
+			return -1;
+
+		if(region.created()) {
+			new (shared) Shared_t;
+			shared->init(sizeof(Key_t), m_capacity, m_map.buckets(), storage, buckets);
+			for(size_t i = 0; i < m_capacity; i++) {
+				new (storage + i) Node_t();
+			}
+			for(size_t i = 0; i < m_map.buckets(); i++) {
+				new (buckets + i) Bucket_t();
+			}
+			m_map.attach(buckets, 0);
+			m_list_freed.assign(storage, m_capacity);
+			m_dirty = true;
+		} else {
+			uint64_t elements = 0;
+			if(not shared->fits(sizeof(Key_t), m_capacity, m_map.buckets(), storage, buckets)
+				|| not shared->load(m_list_cached, m_list_freed, elements)) {
+				m_list_cached.drop();
+				m_list_freed.drop();
+				return -1;
+			}
+			m_map.attach(buckets, elements);
+		}
+		m_storage = storage;
+		m_shared = shared;
+		commit();
+		return 0;
+	}
+
+	/**
+	 * Publish the state of a pool in a shared region, the generation becomes even: a restarted writer or
+	 * a reader attached after the call gets the pool as it is now. It is cheap enough for every burst of changes.
+	 */
+	inline void commit() noexcept {
+		if(m_dirty) {
+			m_shared->commit(m_list_cached, m_list_freed, m_map.size());
+			m_dirty = false;
+		}
+	}
+
+	/**
+	 * Take the state published by the writer for a reader pool. The lists and the chains are walked by
+	 * find() and peek_front() with no synchronization, so the writer must be quiescent until the walks end.
+	 * @return false - if the writer is in the middle of a change, the pool keeps its previous state then.
+	 */
+	bool refresh() noexcept {
+		List_t cached;
+		List_t freed;
+		uint64_t elements = 0;
+		const bool result = m_shared && m_shared->load(cached, freed, elements);
+		if(result) {
+			m_list_cached.adopt(cached.head(), cached.tail(), cached.size());
+			m_list_freed.adopt(freed.head(), freed.tail(), freed.size());
+			m_map.attach_size(elements);
+		}
+		cached.drop();
+		freed.drop();
+		return result;
+	}
+
+	/**
+	 * Copy the value of @key from a pool changed by a live writer, for a reader pool. The chain is walked
+	 * and the value copied without a lock, the read is repeated if the generation has changed meanwhile.
+	 * @param retries - the reads before giving up on a busy writer.
+	 * @return 1 - found, 0 - no such key, -1 - the writer has been in a change during all the reads.
+	 */
+	template<typename V>
+	int read(const Key_t& key, V& value, unsigned retries = READ_RETRIES) const noexcept {
+		static_assert(std::is_trivially_copyable<V>::value, "the value is copied while the writer may change it");
+		if(m_shared == nullptr) {
+			const ConstIterator_t it = find(key);
+			if(it) {
+				value = it->value;
+			}
+			return it ? 1 : 0;
+		}
+		for(unsigned i = 0; i < retries; i++) {
+			const uint64_t start = m_shared->read_begin();
+			if(start & 1u) {
+				_mm_pause();
+				continue;
+			}
+			// a chain relinked by the writer may loop, the walk is bounded by the nodes
+			const Node_t* node = m_map.cbegin(m_map.bucket(key)).get();
+			for(size_t steps = 0; node && steps < m_capacity && not (node->im_key == key); steps++) {
+				node = node->im_next;
+			}
+			const bool found = node && node->im_key == key;
+			alignas(V) uint8_t copy[sizeof(V)];
+			if(found) {
+				memcpy(copy, &node->value, sizeof(V));
+			}
+			if(m_shared->read_end(start)) {
+				if(found) {
+					memcpy(&value, copy, sizeof(V));
+				}
+				return found ? 1 : 0;
+			}
+		}
+		return -1;
+	}
+
+	/**
+	 * @return The generation of a pool in a shared region, see PoolSharedState.
+	 */
+	inline uint64_t generation() const noexcept {
+		return m_shared ? m_shared->generation.load(std::memory_order_acquire) : 0;
+	}
+
 	inline Iterator_t end() noexcept {
 		return m_map.end();
 	}
@@ -123,9 +269,12 @@ public:
 	Iterator_t push_back(const Key_t& key) noexcept {
 		Node_t* freed = nullptr;
 		if(available()) {
+			touch();
 			freed = m_list_freed.pop_back();
 			m_list_cached.push_back(*freed);
 			m_map.link(key, *freed);
+		} else {
+			m_counter.fail();
 		}
 		return Iterator_t(freed);
 	}
@@ -141,6 +290,7 @@ public:
 	inline Iterator_t pop_front() noexcept {
 		Node_t* result = nullptr;
 		if(size()) {
+			touch();
 			result = m_list_cached.pop_front();
 			m_list_freed.push_back(*result);
 			m_map.remove(*result);
@@ -157,17 +307,20 @@ public:
 	}
 
 	inline void move_back(Iterator_t it) noexcept {
+		touch();
 		m_list_cached.remove(*it);
 		m_list_cached.push_back(*it);
 	}
 
 	inline void remove(Iterator_t it) noexcept {
+		touch();
 		m_map.remove(*it);
 		m_list_cached.remove(*it);
 		m_list_freed.push_back(*it);
 	}
 
 	void reset() noexcept {
+		touch();
 		m_map.clear();
 		m_list_cached.clear();
 		m_list_freed.clear();
@@ -188,13 +341,161 @@ public:
 		return m_list_freed.size();
 	}
 
+	/**
+	 * Write the cached nodes to a fio writer in the LRU order: PoolSnapshotHeader, then the key,
+	 * the uint32_t bucket and the payload of each node.
+	 * @param payload - bool(W&, const Node_t&) writes the rest of a node, the value by default.
+	 * @return false - on a write error, if the pool is not allocated or with more than 2^32 buckets.
+	 */
+	template<typename W, typename F>
+	bool save(W& writer, F&& payload) const {
+		if(m_storage == nullptr || m_map.buckets() > UINT32_MAX) {
+			return false;
+		}
+		// the buckets of the nodes come from the chains, the keys are not hashed
+		std::vector<uint32_t> buckets(m_capacity);
+		for(size_t i = 0; i < m_map.buckets(); i++) {
+			for(auto it = m_map.cbegin(i); it != m_map.cend(); ++it) {
+				buckets[it.get() - m_storage] = uint32_t(i);
+			}
+		}
+		PoolSnapshotHeader header = {};
+		header.magic = PoolSnapshotHeader::MAGIC;
+		header.version = PoolSnapshotHeader::VERSION;
+		header.key_size = sizeof(Key_t);
+		header.node_size = sizeof(Node_t);
+		header.count = size();
+		header.buckets = m_map.buckets();
+		bool result = writer.write(header);
+		for(auto it = m_list_cached.cbegin(); result && it != m_list_cached.cend(); ++it) {
+			const uint32_t bucket = buckets[it.get() - m_storage];
+			result = writer.write(it->im_key, bucket) && payload(writer, *it);
+		}
+		return result;
+	}
+
+	template<typename W>
+	bool save(W& writer) const {
+		return save(writer, [](W& out, const Node_t& node) {
+			return PoolSnapshotValue<Node_t>::save(out, node);
+		});
+	}
+
+	/**
+	 * Replace the content with a snapshot of save(). The nodes are filled in the storage order and
+	 * both lists are linked with one pass over the storage. If the bucket number is the same and the first
+	 * key is in its saved bucket (the same hasher), the saved buckets are linked without hashing,
+	 * otherwise the keys are hashed again. The chains get the nodes in the LRU order, so the lookup order
+	 * of the same keys is the push order unless move_back() has reordered them.
+	 * @param payload - bool(R&, Node_t&) reads the rest of a node, the value by default.
+	 * @return false - if the snapshot is not of this node type, does not fit to the capacity or is truncated,
+	 * the pool is empty then.
+	 */
+	template<typename R, typename F>
+	bool restore(R& reader, F&& payload) {
+		if(m_storage == nullptr) {
+			return false;
+		}
+		touch();
+		// all the hooks are rewritten below in the storage order, the old links are not walked
+		m_map.drop();
+		m_list_cached.drop();
+		m_list_freed.drop();
+		PoolSnapshotHeader header;
+		bool result = reader.read(header) && header.fits(sizeof(Key_t), sizeof(Node_t), m_capacity);
+		const size_t count = result ? size_t(header.count) : 0;
+		bool rehash = header.buckets != m_map.buckets();
+		for(size_t i = 0; result && i < count; i++) {
+			Node_t& node = m_storage[i];
+			node.im_linked = false; // a stale hook of the dropped map
+			Key_t key;
+			uint32_t bucket;
+			result = reader.read(key, bucket) && payload(reader, node);
+			if(not result) {
+				break;
+			}
+			if(i == 0) {
+				rehash |= m_map.bucket(key) != bucket;
+			}
+			if(rehash) {
+				m_map.link(key, node);
+			} else if(bucket < m_map.buckets()) {
+				m_map.link_bucket(bucket, key, node);
+			} else {
+				result = false;
+			}
+		}
+		if(result) {
+			m_list_cached.assign(m_storage, count);
+			m_list_freed.assign(m_storage + count, m_capacity - count);
+			unlink_map_hooks(count);
+		} else {
+			m_map.drop();
+			m_list_freed.assign(m_storage, m_capacity);
+			unlink_map_hooks(0);
+		}
+		return result;
+	}
+
+	template<typename R>
+	bool restore(R& reader) {
+		return restore(reader, [](R& in, Node_t& node) {
+			return PoolSnapshotValue<Node_t>::restore(in, node);
+		});
+	}
+
 	inline size_t storage_bytes() noexcept {
 		return m_capacity * sizeof(Node_t) + m_map.buckets() * sizeof(Bucket_t);
 	}
 
+	/**
+	 * @return The statistics snapshot: the map lookups, links and removals and the refused push_back().
+	 * The evictions and the expiries are counted by the owners, they know why a node is popped.
+	 */
+	utils::ContainerStat stat() const noexcept {
+		utils::ContainerStat result = m_map.stat();
+		result.add(m_counter.stat());
+		result.capacity = m_capacity;
+		result.size = size();
+		return result;
+	}
+
+	inline void reset_stat() noexcept {
+		m_map.reset_stat();
+		m_counter.reset();
+	}
+
 private:
 
+	/**
+	 * Mark the map hooks of the nodes from @from to the end of the storage as free after HashMap::drop().
+	 */
+	void unlink_map_hooks(size_t from) noexcept {
+		for(size_t i = from; i < m_capacity; i++) {
+			m_storage[i].im_next = nullptr;
+			m_storage[i].im_linked = false;
+		}
+	}
+
+	/**
+	 * Make the generation of a pool in a shared region odd before the first change after a commit().
+	 */
+	inline void touch() noexcept {
+		if(m_shared && not m_dirty) {
+			m_shared->begin();
+			m_dirty = true;
+		}
+	}
+
 	void destroy() noexcept {
+		if(m_shared) {
+			// the nodes stay in the region for the next attach
+			commit();
+			m_list_freed.drop();
+			m_list_cached.drop();
+			m_shared = nullptr;
+			m_storage = nullptr;
+		}
 		if(m_storage) {
 			m_list_freed.clear();
 			m_list_cached.clear();
@@ -174,6 +174,39 @@ public:
 		}
 	}
 
+	/**
+	 * Link @count nodes of an array in the array order with one pass over it.
+	 * The list must be empty and the nodes must not be linked.
+	 */
+	void assign(ListNode* nodes, size_t count) noexcept {
+		assert(_size == 0);
+		for(size_t i = 0; i < count; i++) {
+			nodes[i].__ill.prev = i ? nodes + i - 1 : nullptr;
+			nodes[i].__ill.next = i + 1 < count ? nodes + i + 1 : nullptr;
+			nodes[i].__ill.linked = true;
+		}
+		_head = count ? nodes : nullptr;
+		_tail = count ? nodes + count - 1 : nullptr;
+		_size = count;
+	}
+
+	/**
+	 * Forget all the nodes without unlinking them, see HashMap::drop().
+	 */
+	void drop() noexcept {
+		make_empty();
+	}
+
+	/**
+	 * Take the nodes linked by another list object, e.g. the published heads of a list in a shared memory region.
+	 * The current nodes are forgotten as drop() does.
+	 */
+	void adopt(ListNode* head, ListNode* tail, size_t size) noexcept {
+		_head = head;
+		_tail = tail;
+		_size = size;
+	}
+
 	ListNode* pop_front() noexcept {
 		if(_head != _tail) {
 			return unlink_head();
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace intrusive {
+
+/**
+ * The state of a pool placed in a utils::SharedRegion next to its nodes: the geometry and the addresses
+ * to validate an attach, the list and the map heads published by commit() and the generation.
+ *
+ * The generation is odd from the first change after a commit() up to the next commit(). An odd generation
+ * at an attach means the writer has died in the middle of a change, the links may be broken.
+ * A reader of a live pool compares the generation before and after a copy of the heads, see refresh(),
+ * or of a value, see HashQueuePool::read(): read_begin() and read_end() around the plain reads.
+ */
+template<typename Node_t, typename Bucket_t = void>
+struct PoolSharedState {
+	static constexpr uint32_t MAGIC = 0x4C4F4F50; // "POOL"
+	static constexpr uint32_t VERSION = 1;
+
+	uint32_t magic;
+	uint32_t version;
+	uint32_t key_size;   // 0 - a pool without keys
+	uint32_t node_size;
+	uint64_t capacity;
+	uint64_t buckets;    // 0 - a pool without a map
+	Node_t* storage;
+	Bucket_t* bucket_list;
+	Node_t* cached_head;
+	Node_t* cached_tail;
+	uint64_t cached_size;
+	Node_t* freed_head;
+	Node_t* freed_tail;
+	uint64_t freed_size;
+	uint64_t elements;   // of the map
+	std::atomic<uint64_t> generation;
+
+	/**
+	 * Start the state of a new pool, the generation is odd until the first commit.
+	 */
+	void init(uint32_t key_size, uint64_t capacity, uint64_t buckets, Node_t* storage, Bucket_t* bucket_list) noexcept {
+		this->magic = MAGIC;
+		this->version = VERSION;
+		this->key_size = key_size;
+		this->node_size = sizeof(Node_t);
+		this->capacity = capacity;
+		this->buckets = buckets;
+		this->storage = storage;
+		this->bucket_list = bucket_list;
+		cached_head = cached_tail = freed_head = freed_tail = nullptr;
+		cached_size = freed_size = elements = 0;
+		generation.store(1, std::memory_order_release);
+	}
+
+	/**
+	 * @return true - if the state is of a pool of this geometry at these addresses.
+	 */
+	bool fits(uint32_t key_size, uint64_t capacity, uint64_t buckets, const Node_t* storage,
+		const Bucket_t* bucket_list) const noexcept {
+		return magic == MAGIC && version == VERSION && this->key_size == key_size && node_size == sizeof(Node_t)
+			&& this->capacity == capacity && this->buckets == buckets && this->storage == storage
+			&& this->bucket_list == bucket_list;
+	}
+
+	inline bool consistent() const noexcept {
+		return (generation.load(std::memory_order_acquire) & 1u) == 0;
+	}
+
+	/**
+	 * Make the generation odd before the first change after a commit.
+	 */
+	inline void begin() noexcept {
+		generation.fetch_add(1, std::memory_order_relaxed);
+		// the changes of the nodes must not be stored before the odd generation
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+	}
+
+	/**
+	 * Publish the heads of the lists and make the generation even.
+	 */
+	template<typename List>
+	void commit(List& cached, List& freed, uint64_t elements) noexcept {
+		cached_head = cached.head();
+		cached_tail = cached.tail();
+		cached_size = cached.size();
+		freed_head = freed.head();
+		freed_tail = freed.tail();
+		freed_size = freed.size();
+		this->elements = elements;
+		generation.store((generation.load(std::memory_order_relaxed) + 1) & ~uint64_t(1), std::memory_order_release);
+	}
+
+	/**
+	 * Copy the published heads to the lists if they are consistent.
+	 * @return false - if the generation is odd or changes during the copy.
+	 */
+	template<typename List>
+	bool load(List& cached, List& freed, uint64_t& elements) const noexcept {
+		const uint64_t start = read_begin();
+		if(start & 1u) {
+			return false;
+		}
+		cached.adopt(cached_head, cached_tail, cached_size);
+		freed.adopt(freed_head, freed_tail, freed_size);
+		elements = this->elements;
+		return read_end(start);
+	}
+
+	/**
+	 * @return The generation before the reads of the state and the nodes, odd - the writer is in a change.
+	 */
+	inline uint64_t read_begin() const noexcept {
+		return generation.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * @return true - if the reads since read_begin() have seen no change of the writer.
+	 */
+	inline bool read_end(uint64_t start) const noexcept {
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return (start & 1u) == 0 && generation.load(std::memory_order_relaxed) == start;
+	}
+};
+
+}; // namespace intrusive
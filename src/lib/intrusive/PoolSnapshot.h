@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace intrusive {
+
+/**
+ * The header of a pool snapshot, see HashQueuePool::save() and DequePool::save().
+ * The key and the node sizes are a cheap check that the snapshot is of the same node type.
+ */
+struct PoolSnapshotHeader {
+	static constexpr uint32_t MAGIC = 0x4C4F4F50; // "POOL"
+	static constexpr uint32_t VERSION = 1;
+
+	uint32_t magic;
+	uint32_t version;
+	uint32_t key_size;   // 0 - a pool without keys
+	uint32_t node_size;
+	uint64_t count;      // of the records
+	uint64_t buckets;    // of the saved map, 0 - a pool without a map
+
+	/**
+	 * @return true - if a pool of @node_size nodes with @key_size keys and @capacity nodes can load the snapshot.
+	 */
+	bool fits(uint32_t key_size, uint32_t node_size, size_t capacity) const noexcept {
+		return magic == MAGIC && version == VERSION && this->key_size == key_size && this->node_size == node_size
+			&& count <= capacity;
+	}
+};
+
+/**
+ * The default payload of a snapshot record: the node value if the node has one, nothing for the empty nodes.
+ * The value must be a POD type, it is written as it is by a fio writer.
+ */
+template<typename N, typename = void>
+struct PoolSnapshotValue {
+	template<typename W>
+	static bool save(W&, const N&) noexcept {
+		return true;
+	}
+
+	template<typename R>
+	static bool restore(R&, N&) noexcept {
+		return true;
+	}
+};
+
+template<typename N>
+struct PoolSnapshotValue<N, std::void_t<decltype(std::declval<N&>().value)> > {
+	template<typename W>
+	static bool save(W& writer, const N& node) noexcept {
+		return writer.write(node.value);
+	}
+
+	template<typename R>
+	static bool restore(R& reader, N& node) noexcept {
+		return reader.read(node.value);
+	}
+};
+
+}; // namespace intrusive
@@ -0,0 +1,1054 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "../utils/ChunkedFile.h"
+#include "../utils/Cpu.h"
+
+namespace logger {
+
+/**
+ * The severity, the values are the LOG_LEVEL_* of Logger.h used for the compile time filtering.
+ */
+enum Level : uint8_t {
+	LEVEL_TRACE,
+	LEVEL_DEBUG,
+	LEVEL_INFO,
+	LEVEL_WARN,
+	LEVEL_CRITICAL,
+};
+
+inline const char* level_name(Level level) noexcept {
+	switch(level) {
+		case LEVEL_TRACE:
+			return "trace";
+		case LEVEL_DEBUG:
+			return "debug";
+		case LEVEL_INFO:
+			return "info";
+		case LEVEL_WARN:
+			return "warn";
+		case LEVEL_CRITICAL:
+			return "critical";
+	}
+	return "?";
+}
+
+/**
+ * The runtime threshold, the records below it are skipped by the LOG_* macros before
+ * the arguments are evaluated. LEVEL_INFO by default.
+ */
+class LogLevel {
+	static inline std::atomic<Level> s_level{LEVEL_INFO};
+
+public:
+
+	static inline void set(Level level) noexcept {
+		s_level.store(level, std::memory_order_relaxed);
+	}
+
+	static inline Level get() noexcept {
+		return s_level.load(std::memory_order_relaxed);
+	}
+
+	static inline bool enabled(Level level) noexcept {
+		return level >= s_level.load(std::memory_order_relaxed);
+	}
+};
+
+/**
+ * The type of a recorded argument, the integers are widened to 32 or 64 bits.
+ */
+enum ArgType : uint8_t {
+	ARG_I32,
+	ARG_U32,
+	ARG_I64,
+	ARG_U64,
+	ARG_F64,
+	ARG_PTR,
+	ARG_STR, // a copy of the string: the 16-bit length followed by the bytes
+};
+
+/**
+ * A log call site. The first record of the site registers it, the following records
+ * refer to it by the id instead of carrying the format string, the function, the file and the line.
+ * A site MUST have the static storage duration (see LOG_INFO).
+ */
+struct LogSite {
+	static constexpr unsigned ARGS_MAX = 16;
+
+	const Level level;
+	const char* const function;
+	const char* const file;
+	const int line;
+	std::atomic<uint32_t> id{0};
+	// filled by the registration
+	const char* format = nullptr;
+	uint8_t types[ARGS_MAX] = {};
+	unsigned args = 0;
+
+	LogSite(Level site_level, const char* site_function, const char* site_file, int site_line) noexcept
+		: level(site_level), function(site_function), file(site_file), line(site_line) {}
+};
+
+/**
+ * A rate limited call site: at most @burst records per @period_ms milliseconds pass, the others
+ * are counted as suppressed. The same check as storage::RateLimiter does per key, with the call site
+ * as the key, so there is no pool to look up. The first record passed after the suppressed ones
+ * is preceded by the "N similar records suppressed" summary of the site.
+ * A limit MUST have the static storage duration (see LOG_INFO_LIMITED).
+ */
+class LogLimit {
+	const uint64_t m_period_ns;
+	const uint64_t m_burst;
+	std::atomic<uint64_t> m_window{0}; // the start of the current period
+	std::atomic<uint64_t> m_passed{0}; // in the current period
+	std::atomic<uint64_t> m_pending{0}; // suppressed and not reported yet
+	std::atomic<uint64_t> m_suppressed{0}; // in total
+	std::atomic<bool> m_registered{false};
+
+public:
+	LogSite site;
+	LogSite summary;
+
+	LogLimit(Level level, const char* function, const char* file, int line, unsigned burst, unsigned period_ms) noexcept
+		: m_period_ns(uint64_t(period_ms) * 1000000u)
+		, m_burst(burst)
+		, site(level, function, file, line)
+		, summary(level, function, file, line) {}
+
+	/**
+	 * @param pending - the number of the records suppressed since the last passed one.
+	 * @return false - if the record is suppressed.
+	 */
+	bool pass(uint64_t& pending) noexcept {
+		const uint64_t now = coarse_ns();
+		uint64_t window = m_window.load(std::memory_order_relaxed);
+		if(now - window >= m_period_ns && m_window.compare_exchange_strong(window, now, std::memory_order_relaxed)) {
+			m_passed.store(0, std::memory_order_relaxed);
+		}
+		// the load keeps the cache line shared during a storm
+		if(m_passed.load(std::memory_order_relaxed) < m_burst
+			&& m_passed.fetch_add(1, std::memory_order_relaxed) < m_burst) {
+			pending = m_pending.exchange(0, std::memory_order_relaxed);
+			return true;
+		}
+		m_pending.fetch_add(1, std::memory_order_relaxed);
+		m_suppressed.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	/**
+	 * @return The suppressed records not reported yet, resets the count.
+	 */
+	inline uint64_t take_pending() noexcept {
+		return m_pending.exchange(0, std::memory_order_relaxed);
+	}
+
+	inline uint64_t suppressed() const noexcept {
+		return m_suppressed.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @return true - only for the first call.
+	 */
+	inline bool register_once() noexcept {
+		return not m_registered.load(std::memory_order_relaxed) && not m_registered.exchange(true);
+	}
+
+private:
+
+	static inline uint64_t coarse_ns() noexcept {
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+		return uint64_t(now.tv_sec) * 1000000000u + uint64_t(now.tv_nsec);
+	}
+
+};
+
+/**
+ * The raw argument encoding of the records.
+ */
+class LogArgs {
+public:
+	static constexpr size_t STRING_MAX = 256; // the longer strings are truncated
+
+	template <typename T>
+	static constexpr ArgType type() noexcept {
+		using V = std::decay_t<T>;
+		if constexpr (std::is_same_v<V, std::string> || std::is_same_v<V, std::string_view>
+			|| std::is_same_v<V, char*> || std::is_same_v<V, const char*>) {
+			return ARG_STR;
+		} else if constexpr (std::is_pointer_v<V> || std::is_null_pointer_v<V>) {
+			return ARG_PTR;
+		} else if constexpr (std::is_floating_point_v<V>) {
+			return ARG_F64;
+		} else if constexpr (std::is_enum_v<V>) {
+			return type<std::underlying_type_t<V> >();
+		} else {
+			static_assert(std::is_integral_v<V>, "logger: the argument type is not supported");
+			if constexpr (sizeof(V) <= sizeof(uint32_t)) {
+				return std::is_signed_v<V> || sizeof(V) < sizeof(uint32_t) ? ARG_I32 : ARG_U32;
+			} else {
+				return std::is_signed_v<V> ? ARG_I64 : ARG_U64;
+			}
+		}
+	}
+
+	/**
+	 * @return The encoded size of @value.
+	 */
+	template <typename T>
+	static inline size_t size(const T& value) noexcept {
+		constexpr ArgType arg_type = type<T>();
+		if constexpr (arg_type == ARG_STR) {
+			return sizeof(uint16_t) + length(value);
+		} else if constexpr (arg_type == ARG_I32 || arg_type == ARG_U32) {
+			return sizeof(uint32_t);
+		} else {
+			return sizeof(uint64_t);
+		}
+	}
+
+	/**
+	 * Encode @value to @ptr.
+	 * @return The position after the value.
+	 */
+	template <typename T>
+	static inline uint8_t* put(uint8_t* ptr, const T& value) noexcept {
+		constexpr ArgType arg_type = type<T>();
+		if constexpr (arg_type == ARG_STR) {
+			const uint16_t len = uint16_t(length(value));
+			memcpy(ptr, &len, sizeof(len));
+			memcpy(ptr + sizeof(len), data(value), len);
+			return ptr + sizeof(len) + len;
+		} else if constexpr (arg_type == ARG_PTR) {
+			const uint64_t raw = uint64_t(uintptr_t(value));
+			memcpy(ptr, &raw, sizeof(raw));
+			return ptr + sizeof(raw);
+		} else if constexpr (arg_type == ARG_F64) {
+			const double raw = double(value);
+			memcpy(ptr, &raw, sizeof(raw));
+			return ptr + sizeof(raw);
+		} else if constexpr (arg_type == ARG_I32 || arg_type == ARG_U32) {
+			const uint32_t raw = uint32_t(value);
+			memcpy(ptr, &raw, sizeof(raw));
+			return ptr + sizeof(raw);
+		} else {
+			const uint64_t raw = uint64_t(value);
+			memcpy(ptr, &raw, sizeof(raw));
+			return ptr + sizeof(raw);
+		}
+	}
+
+	/**
+	 * Print the printf-like @format with the encoded arguments.
+	 * A conversion is applied to its argument with the length modifier of the recorded type,
+	 * a conversion not matching the type is replaced with the default one of the type,
+	 * the '*' width and precision and %n are not supported.
+	 * @return The message length, it is truncated to @size - 1.
+	 */
+	static size_t format(char* out, size_t size, const char* format, const uint8_t* types, unsigned count
+		, const uint8_t* args) noexcept {
+		if(not size) {
+			return 0;
+		}
+		size_t pos = 0;
+		unsigned idx = 0;
+		while(*format && pos + 1 < size) {
+			if(*format != '%') {
+				out[pos++] = *format++;
+				continue;
+			}
+			if(format[1] == '%') {
+				out[pos++] = '%';
+				format += 2;
+				continue;
+			}
+			// %[flags][width][.precision][length]conversion
+			const char* spec_end = format + 1 + strspn(format + 1, "-+ #0123456789.");
+			const char* conversion = spec_end + strspn(spec_end, "hljztL");
+			if(not *conversion || idx >= count || *conversion == 'n' || *conversion == '*') {
+				// print the rest as it is
+				const size_t rest = std::min(strlen(format), size - 1 - pos);
+				memcpy(out + pos, format, rest);
+				pos += rest;
+				break;
+			}
+			if(spec_end == format + 1 && print_plain(out, size, pos, *conversion, ArgType(types[idx]), args)) {
+				idx++;
+				format = conversion + 1;
+				continue;
+			}
+			char spec[32];
+			const size_t spec_len = std::min(size_t(spec_end - format), sizeof(spec) - 4);
+			memcpy(spec, format, spec_len);
+			args = print_arg(out + pos, size - pos, spec, spec_len, *conversion, ArgType(types[idx++]), args, pos);
+			format = conversion + 1;
+		}
+		out[pos] = 0;
+		return pos;
+	}
+
+	/**
+	 * Append @len bytes of @str to @out at @pos, the result is truncated to @size - 1 bytes.
+	 */
+	static inline void append(char* out, size_t size, size_t& pos, const char* str, size_t len) noexcept {
+		len = std::min(len, size - 1 - pos);
+		memcpy(out + pos, str, len);
+		pos += len;
+	}
+
+	/**
+	 * Append @value in decimal with at least @digits digits.
+	 */
+	static inline void append_uint(char* out, size_t size, size_t& pos, uint64_t value, unsigned digits = 1) noexcept {
+		char buffer[24];
+		char* const end = buffer + sizeof(buffer);
+		char* ptr = end;
+		do {
+			*--ptr = char('0' + value % 10u);
+			value /= 10u;
+		} while(value || end - ptr < digits);
+		append(out, size, pos, ptr, end - ptr);
+	}
+
+private:
+
+	/**
+	 * The snprintf() free path of the plain %d, %u and %s conversions.
+	 * @return false - if the conversion needs snprintf(), @args is not moved.
+	 */
+	static inline bool print_plain(char* out, size_t size, size_t& pos, char conversion, ArgType type
+		, const uint8_t*& args) noexcept {
+		switch(type) {
+			case ARG_STR:
+				if(conversion == 's') {
+					const uint16_t len = load<uint16_t>(args);
+					append(out, size, pos, reinterpret_cast<const char*>(args), len);
+					args += len;
+					return true;
+				}
+				return false;
+			case ARG_U32:
+			case ARG_U64:
+				if(conversion == 'u' || conversion == 'd') {
+					append_uint(out, size, pos, type == ARG_U32 ? load<uint32_t>(args) : load<uint64_t>(args));
+					return true;
+				}
+				return false;
+			case ARG_I32:
+			case ARG_I64:
+				if(conversion == 'd' || conversion == 'i') {
+					const int64_t value = type == ARG_I32 ? int64_t(int32_t(load<uint32_t>(args))) : int64_t(load<uint64_t>(args));
+					if(value < 0) {
+						append(out, size, pos, "-", 1);
+					}
+					append_uint(out, size, pos, value < 0 ? 0 - uint64_t(value) : uint64_t(value));
+					return true;
+				}
+				return false;
+			default:
+				return false;
+		}
+	}
+
+	static inline size_t length(const std::string& value) noexcept {
+		return std::min(value.size(), STRING_MAX);
+	}
+
+	static inline size_t length(std::string_view value) noexcept {
+		return std::min(value.size(), STRING_MAX);
+	}
+
+	static inline size_t length(const char* value) noexcept {
+		return value ? strnlen(value, STRING_MAX) : 0;
+	}
+
+	static inline const char* data(const std::string& value) noexcept {
+		return value.data();
+	}
+
+	static inline const char* data(std::string_view value) noexcept {
+		return value.data();
+	}
+
+	static inline const char* data(const char* value) noexcept {
+		return value;
+	}
+
+	template <typename T>
+	static inline T load(const uint8_t*& args) noexcept {
+		T value;
+		memcpy(&value, args, sizeof(value));
+		args += sizeof(value);
+		return value;
+	}
+
+	/**
+	 * Print one argument with the @spec prefix (the flags, the width and the precision).
+	 * @return The position of the next argument.
+	 */
+	static const uint8_t* print_arg(char* out, size_t size, char* spec, size_t spec_len, char conversion
+		, ArgType type, const uint8_t* args, size_t& pos) noexcept {
+		const bool integer = strchr("diouxXc", conversion);
+		const bool floating = strchr("fFeEgGaA", conversion);
+		int printed = 0;
+		switch(type) {
+			case ARG_I32:
+			case ARG_U32:
+				spec[spec_len++] = integer ? conversion : (type == ARG_I32 ? 'd' : 'u');
+				spec[spec_len] = 0;
+				printed = snprintf(out, size, spec, load<uint32_t>(args));
+				break;
+			case ARG_I64:
+			case ARG_U64:
+				spec[spec_len++] = 'l';
+				spec[spec_len++] = 'l';
+				spec[spec_len++] = integer && conversion != 'c' ? conversion : (type == ARG_I64 ? 'd' : 'u');
+				spec[spec_len] = 0;
+				printed = snprintf(out, size, spec, load<unsigned long long>(args));
+				break;
+			case ARG_F64:
+				spec[spec_len++] = floating ? conversion : 'g';
+				spec[spec_len] = 0;
+				printed = snprintf(out, size, spec, load<double>(args));
+				break;
+			case ARG_PTR:
+				spec[spec_len++] = 'p';
+				spec[spec_len] = 0;
+				printed = snprintf(out, size, spec, reinterpret_cast<void*>(uintptr_t(load<uint64_t>(args))));
+				break;
+			case ARG_STR: {
+				const uint16_t len = load<uint16_t>(args);
+				char value[STRING_MAX + 1];
+				memcpy(value, args, len);
+				value[len] = 0;
+				args += len;
+				spec[spec_len++] = 's';
+				spec[spec_len] = 0;
+				printed = snprintf(out, size, spec, value);
+				break;
+			}
+		}
+		if(printed > 0) {
+			pos += std::min(size_t(printed), size - 1);
+		}
+		return args;
+	}
+
+};
+
+/**
+ * A single producer single consumer ring of variable length records.
+ * The producer never blocks: a record which doesn't fit is dropped and counted.
+ * A record is a Header followed by the payload, aligned to 8 bytes. A record never wraps around,
+ * the tail of the buffer is skipped with a padding record (site 0) instead, or without one when
+ * the tail is shorter than a Header: both sides wrap there implicitly.
+ */
+class LogRing {
+public:
+	struct Header {
+		uint32_t size; // including the header
+		uint32_t site; // 0 for the padding
+		uint64_t tsc;
+	};
+
+private:
+	static constexpr size_t ALIGN = 8;
+
+	const size_t m_capacity;
+	std::unique_ptr<uint8_t[]> m_buffer;
+	alignas(64) std::atomic<uint64_t> m_head{0}; // written by the producer
+	alignas(64) std::atomic<uint64_t> m_tail{0}; // written by the consumer
+	alignas(64) std::atomic<uint64_t> m_dropped{0};
+	std::atomic<bool> m_orphan{false};
+
+public:
+
+	/**
+	 * @param bytes - rounded up to a power of two.
+	 */
+	explicit LogRing(size_t bytes) : m_capacity(round_up(bytes)), m_buffer(new uint8_t[m_capacity]) {}
+
+	inline size_t capacity() const noexcept {
+		return m_capacity;
+	}
+
+	/**
+	 * Producer side.
+	 * @param payload - the payload size in bytes.
+	 * @param fill - void(uint8_t* payload), writes the payload.
+	 * @return false - if the record has been dropped.
+	 */
+	template <typename Fill>
+	inline bool push(uint32_t site, uint64_t tsc, size_t payload, Fill&& fill) noexcept {
+		const size_t size = (sizeof(Header) + payload + ALIGN - 1) & ~(ALIGN - 1);
+		uint64_t head = m_head.load(std::memory_order_relaxed);
+		const uint64_t tail = m_tail.load(std::memory_order_acquire);
+		const size_t pos = head & (m_capacity - 1);
+		const size_t contiguous = m_capacity - pos;
+		const size_t need = size + (contiguous < size ? contiguous : 0);
+		if(size > m_capacity / 2 || m_capacity - (head - tail) < need) {
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		if(contiguous < size) {
+			if(contiguous >= sizeof(Header)) {
+				const Header padding = {uint32_t(contiguous), 0, 0};
+				memcpy(m_buffer.get() + pos, &padding, sizeof(padding));
+			}
+			head += contiguous;
+		}
+		uint8_t* record = m_buffer.get() + (head & (m_capacity - 1));
+		const Header hdr = {uint32_t(size), site, tsc};
+		memcpy(record, &hdr, sizeof(hdr));
+		fill(record + sizeof(hdr));
+		m_head.store(head + size, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Consumer side: pass all the available records to @read and release them.
+	 * @param read - void(const Header& hdr, const uint8_t* payload).
+	 * @return The number of the records read.
+	 */
+	template <typename Read>
+	size_t pop_all(Read&& read) noexcept {
+		const uint64_t head = m_head.load(std::memory_order_acquire);
+		uint64_t tail = m_tail.load(std::memory_order_relaxed);
+		size_t result = 0;
+		while(tail != head) {
+			const size_t pos = tail & (m_capacity - 1);
+			if(m_capacity - pos < sizeof(Header)) {
+				tail += m_capacity - pos;
+				continue;
+			}
+			const uint8_t* record = m_buffer.get() + pos;
+			Header hdr;
+			memcpy(&hdr, record, sizeof(hdr));
+			if(hdr.site) {
+				read(hdr, record + sizeof(hdr));
+				result++;
+			}
+			tail += hdr.size;
+		}
+		m_tail.store(tail, std::memory_order_release);
+		return result;
+	}
+
+	inline bool empty() const noexcept {
+		return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+	}
+
+	inline uint64_t dropped() const noexcept {
+		return m_dropped.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * The producer thread has finished, the consumer frees the ring once it is drained.
+	 */
+	inline void abandon() noexcept {
+		m_orphan.store(true, std::memory_order_release);
+	}
+
+	inline bool abandoned() const noexcept {
+		return m_orphan.load(std::memory_order_acquire);
+	}
+
+private:
+
+	static size_t round_up(size_t bytes) noexcept {
+		size_t result = 4096;
+		while(result < bytes) {
+			result <<= 1u;
+		}
+		return result;
+	}
+
+};
+
+struct LogStat {
+	uint64_t records = 0; // written to the output
+	uint64_t dropped = 0; // lost because of a full ring
+	uint64_t suppressed = 0; // by the rate limited sites
+	size_t sites = 0;
+	size_t rings = 0;
+};
+
+/**
+ * An asynchronous logger: the logging threads encode the records (the call site id, the TSC timestamp
+ * and the raw arguments) into their own lock-free rings, a background thread formats them and writes
+ * them to a FILE or to a utils::ChunkedFile. So a log call on a hot path costs a few tens of nanoseconds
+ * and never takes the stdio lock or waits for the disk.
+ * A full ring drops the record and counts it, the consumer reports the number of the lost records.
+ * The records of a thread keep their order, the records of the different threads may interleave.
+ *
+ * Until start() (or after stop()) the records are formatted and written synchronously
+ * to the fallback FILE passed by the caller, as the former LOG_* macros did.
+ *
+ * Using sample:
+ * utils::ChunkedFile file("/var/log/app", "app_", "log");
+ * logger::AsyncLogger::instance().start(file);
+ * logger::AsyncLogger::install_crash_handler();
+ * LOG_INFO("port %u is up, %zu queues", port, queues);
+ */
+class AsyncLogger {
+public:
+	static constexpr size_t RING_BYTES_DEFAULT = 1u << 16u;
+	static constexpr size_t LINE_BYTES = 2048;
+
+private:
+	static constexpr long IDLE_SLEEP_NS = 1000000;
+
+	/**
+	 * The formatted date of the last second, localtime_r() is slow.
+	 */
+	struct DateCache {
+		time_t sec = -1;
+		size_t len = 0;
+		char text[32];
+	};
+
+	struct ThreadRing {
+		LogRing* ring = nullptr;
+
+		~ThreadRing() {
+			if(ring) {
+				ring->abandon();
+			}
+		}
+	};
+
+	std::mutex m_sites_lock;
+	std::vector<const LogSite*> m_sites;
+	std::vector<LogLimit*> m_limits;
+
+	std::mutex m_rings_lock;
+	std::vector<std::unique_ptr<LogRing> > m_rings;
+	uint64_t m_dropped_freed = 0; // the drops of the freed rings
+
+	std::mutex m_drain_lock;
+	std::thread m_thread;
+	std::atomic<bool> m_running{false};
+	std::atomic<bool> m_stop{false};
+	FILE* m_out = nullptr;
+	utils::ChunkedFile* m_chunked = nullptr;
+	size_t m_ring_bytes = RING_BYTES_DEFAULT;
+	std::atomic<uint64_t> m_records{0};
+	uint64_t m_dropped_reported = 0;
+	DateCache m_date;
+
+	// the TSC to the wall clock conversion
+	uint64_t m_tsc_base = 0;
+	uint64_t m_ns_base = 0;
+	double m_ns_per_tick = 1.0;
+
+	AsyncLogger() noexcept = default;
+
+public:
+
+	AsyncLogger(const AsyncLogger&) = delete;
+	AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+	~AsyncLogger() {
+		stop();
+	}
+
+	static AsyncLogger& instance() noexcept {
+		static AsyncLogger logger;
+		return logger;
+	}
+
+	/**
+	 * Start the background thread writing to @out.
+	 * @param ring_bytes - the ring size of a logging thread, applies to the rings created after the call.
+	 * @return false - if the logger is already running.
+	 */
+	bool start(FILE* out, size_t ring_bytes = RING_BYTES_DEFAULT) {
+		return start(out, nullptr, ring_bytes);
+	}
+
+	/**
+	 * Start the background thread writing to @file, it is opened if needed and rotated by the thread.
+	 * @return false - if the logger is already running or the file can't be opened.
+	 */
+	bool start(utils::ChunkedFile& file, size_t ring_bytes = RING_BYTES_DEFAULT) {
+		if(not file.get() && file.open()) {
+			return false;
+		}
+		return start(file.get(), &file, ring_bytes);
+	}
+
+	/**
+	 * Write all the pending records and stop the background thread.
+	 */
+	void stop() {
+		if(not m_running.load(std::memory_order_acquire)) {
+			return;
+		}
+		m_stop.store(true, std::memory_order_release);
+		m_thread.join();
+		report_suppressed();
+		drain();
+		m_running.store(false, std::memory_order_release);
+	}
+
+	inline bool running() const noexcept {
+		return m_running.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Write all the pending records synchronously, from any thread.
+	 */
+	void flush() noexcept {
+		if(running()) {
+			report_suppressed();
+			drain();
+		}
+	}
+
+	/**
+	 * Flush the records on SIGSEGV, SIGBUS, SIGFPE, SIGILL and SIGABRT, then let the signal kill the process.
+	 * It is the best effort: the handler only try-locks, allocates nothing and writes nothing
+	 * if the background thread is draining or a thread has crashed holding a lock of the logger.
+	 */
+	static void install_crash_handler() noexcept {
+		struct sigaction action;
+		memset(&action, 0, sizeof(action));
+		action.sa_handler = crash_handler;
+		action.sa_flags = SA_RESETHAND;
+		sigemptyset(&action.sa_mask);
+		for(int sig : {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT}) {
+			sigaction(sig, &action, nullptr);
+		}
+	}
+
+	LogStat stat() noexcept {
+		LogStat result;
+		result.records = m_records.load(std::memory_order_relaxed);
+		{
+			std::lock_guard<std::mutex> guard(m_sites_lock);
+			result.sites = m_sites.size();
+			for(const LogLimit* limit : m_limits) {
+				result.suppressed += limit->suppressed();
+			}
+		}
+		std::lock_guard<std::mutex> guard(m_rings_lock);
+		result.rings = m_rings.size();
+		result.dropped = dropped_locked();
+		return result;
+	}
+
+	/**
+	 * Record a message of @site.
+	 * @param fallback - the output while the logger is not running.
+	 * @param format - the printf-like format, the same for all the calls of the site.
+	 */
+	template <typename... Args>
+	void write(FILE* fallback, LogSite& site, const char* format, const Args&... args) noexcept {
+		static_assert(sizeof...(Args) <= LogSite::ARGS_MAX, "logger: too many arguments");
+		uint32_t id = site.id.load(std::memory_order_acquire);
+		if(__builtin_expect(id == 0, 0)) {
+			static constexpr std::array<uint8_t, sizeof...(Args)> types = {uint8_t(LogArgs::type<Args>())...};
+			id = register_site(site, format, types.data(), unsigned(types.size()));
+		}
+		const size_t payload = (size_t(0) + ... + LogArgs::size(args));
+		auto fill = [&](uint8_t* ptr) {
+			((ptr = LogArgs::put(ptr, args)), ...);
+		};
+		const uint64_t tsc = utils::Cpu::rdtsc();
+		if(__builtin_expect(running(), 1)) {
+			thread_ring().push(id, tsc, payload, fill);
+			return;
+		}
+		if(fallback) {
+			static thread_local DateCache date;
+			std::unique_ptr<uint8_t[]> buffer(new uint8_t[payload + 1]);
+			fill(buffer.get());
+			char line[LINE_BYTES];
+			const size_t len = format_line(line, sizeof(line), date, site, realtime_ns(), buffer.get());
+			fwrite(line, len, 1u, fallback);
+			fflush(fallback);
+		}
+	}
+
+	/**
+	 * Record a message of the rate limited site @limit.
+	 */
+	template <typename... Args>
+	void write(FILE* fallback, LogLimit& limit, const char* format, const Args&... args) noexcept {
+		if(__builtin_expect(limit.register_once(), 0)) {
+			std::lock_guard<std::mutex> guard(m_sites_lock);
+			m_limits.push_back(&limit);
+		}
+		uint64_t pending = 0;
+		if(not limit.pass(pending)) {
+			return;
+		}
+		if(pending) {
+			write(fallback, limit.summary, SUMMARY_FORMAT, pending);
+		}
+		write(fallback, limit.site, format, args...);
+	}
+
+private:
+	static constexpr const char* SUMMARY_FORMAT = "%lu similar records suppressed";
+
+	/**
+	 * Write the summaries of the suppressed records not followed by a passed one yet.
+	 */
+	void report_suppressed() noexcept {
+		std::vector<LogLimit*> limits;
+		{
+			std::lock_guard<std::mutex> guard(m_sites_lock);
+			limits = m_limits;
+		}
+		for(LogLimit* limit : limits) {
+			const uint64_t pending = limit->take_pending();
+			if(pending) {
+				write(nullptr, limit->summary, SUMMARY_FORMAT, pending);
+			}
+		}
+	}
+
+	bool start(FILE* out, utils::ChunkedFile* chunked, size_t ring_bytes) {
+		if(running() || not out) {
+			return false;
+		}
+		calibrate();
+		m_out = out;
+		m_chunked = chunked;
+		m_ring_bytes = ring_bytes;
+		m_stop.store(false, std::memory_order_release);
+		m_running.store(true, std::memory_order_release);
+		m_thread = std::thread([this]() {
+			run();
+		});
+		return true;
+	}
+
+	static void crash_handler(int sig) {
+		AsyncLogger& logger = instance();
+		if(logger.running()) {
+			logger.drain_crashed();
+		}
+		// SA_RESETHAND has restored the default action, the signal is blocked in the handler
+		// and kills the process on return
+		raise(sig);
+	}
+
+	LogRing& thread_ring() {
+		static thread_local ThreadRing holder;
+		if(__builtin_expect(not holder.ring, 0)) {
+			std::unique_ptr<LogRing> ring(new LogRing(m_ring_bytes));
+			holder.ring = ring.get();
+			std::lock_guard<std::mutex> guard(m_rings_lock);
+			m_rings.push_back(std::move(ring));
+		}
+		return *holder.ring;
+	}
+
+	uint32_t register_site(LogSite& site, const char* format, const uint8_t* types, unsigned count) {
+		std::lock_guard<std::mutex> guard(m_sites_lock);
+		uint32_t id = site.id.load(std::memory_order_relaxed);
+		if(not id) {
+			site.format = format;
+			site.args = count;
+			memcpy(site.types, types, count);
+			m_sites.push_back(&site);
+			id = uint32_t(m_sites.size());
+			site.id.store(id, std::memory_order_release);
+		}
+		return id;
+	}
+
+	const LogSite* site(uint32_t id) noexcept {
+		std::lock_guard<std::mutex> guard(m_sites_lock);
+		return m_sites[id - 1];
+	}
+
+	void run() {
+		const timespec idle = {0, IDLE_SLEEP_NS};
+		while(not m_stop.load(std::memory_order_acquire)) {
+			if(not drain()) {
+				nanosleep(&idle, nullptr);
+			}
+		}
+	}
+
+	size_t drain() {
+		std::lock_guard<std::mutex> guard(m_drain_lock);
+		return drain_locked();
+	}
+
+	size_t drain_locked() noexcept {
+		std::vector<LogRing*> rings;
+		{
+			std::lock_guard<std::mutex> guard(m_rings_lock);
+			for(const auto& ring : m_rings) {
+				rings.push_back(ring.get());
+			}
+		}
+		if(m_chunked) {
+			m_chunked->update();
+			m_out = m_chunked->get();
+		}
+		size_t result = 0;
+		for(LogRing* ring : rings) {
+			result += write_records(*ring, [this](uint32_t id) {
+				return site(id);
+			});
+		}
+		m_records.fetch_add(result, std::memory_order_relaxed);
+
+		uint64_t dropped = 0;
+		{
+			std::lock_guard<std::mutex> guard(m_rings_lock);
+			free_abandoned_locked();
+			dropped = dropped_locked();
+		}
+		if(dropped != m_dropped_reported && m_out) {
+			fprintf(m_out, "[logger] %zu records dropped, %zu in total\n", size_t(dropped - m_dropped_reported)
+				, size_t(dropped));
+			m_dropped_reported = dropped;
+		}
+		if(result && m_out) {
+			fflush(m_out);
+		}
+		return result;
+	}
+
+	/**
+	 * drain_locked() of the crash handler: no lock is waited for, the rings and the sites are read in place
+	 * with no allocation, the file is not rotated and the abandoned rings are not freed.
+	 */
+	void drain_crashed() noexcept {
+		std::unique_lock<std::mutex> drain(m_drain_lock, std::try_to_lock);
+		std::unique_lock<std::mutex> rings(m_rings_lock, std::try_to_lock);
+		std::unique_lock<std::mutex> sites(m_sites_lock, std::try_to_lock);
+		if(not drain.owns_lock() || not rings.owns_lock() || not sites.owns_lock()) {
+			return;
+		}
+		size_t result = 0;
+		for(const auto& ring : m_rings) {
+			result += write_records(*ring, [this](uint32_t id) {
+				return m_sites[id - 1];
+			});
+		}
+		m_records.fetch_add(result, std::memory_order_relaxed);
+		if(result && m_out) {
+			fflush(m_out);
+		}
+	}
+
+	/**
+	 * Format and write the records of @ring, the caller holds m_drain_lock.
+	 * @param site - const LogSite*(uint32_t id).
+	 * @return The number of the records.
+	 */
+	template <typename Site>
+	size_t write_records(LogRing& ring, Site&& site) noexcept {
+		char line[LINE_BYTES];
+		return ring.pop_all([&](const LogRing::Header& hdr, const uint8_t* payload) {
+			const size_t len = format_line(line, sizeof(line), m_date, *site(hdr.site), to_ns(hdr.tsc), payload);
+			if(m_out) {
+				fwrite(line, len, 1u, m_out);
+			}
+		});
+	}
+
+	void free_abandoned_locked() noexcept {
+		for(size_t i = 0; i < m_rings.size();) {
+			if(m_rings[i]->abandoned() && m_rings[i]->empty()) {
+				m_dropped_freed += m_rings[i]->dropped();
+				m_rings[i] = std::move(m_rings.back());
+				m_rings.pop_back();
+			} else {
+				++i;
+			}
+		}
+	}
+
+	uint64_t dropped_locked() const noexcept {
+		uint64_t result = m_dropped_freed;
+		for(const auto& ring : m_rings) {
+			result += ring->dropped();
+		}
+		return result;
+	}
+
+	/**
+	 * "2026-01-31 23:59:59.123456789 [info] function() file:line message\n"
+	 */
+	static size_t format_line(char* line, size_t size, DateCache& date, const LogSite& site, uint64_t ns
+		, const uint8_t* payload) noexcept {
+		const time_t sec = time_t(ns / 1000000000u);
+		if(sec != date.sec) {
+			struct tm local_time;
+			localtime_r(&sec, &local_time);
+			date.len = strftime(date.text, sizeof(date.text), "%Y-%m-%d %H:%M:%S", &local_time);
+			date.sec = sec;
+		}
+		size_t pos = std::min(date.len, size - 1);
+		memcpy(line, date.text, pos);
+		// ".%09u [%s] %s() %s:%d "
+		LogArgs::append(line, size, pos, ".", 1);
+		LogArgs::append_uint(line, size, pos, ns % 1000000000u, 9);
+		LogArgs::append(line, size, pos, " [", 2);
+		const char* level = level_name(site.level);
+		LogArgs::append(line, size, pos, level, strlen(level));
+		LogArgs::append(line, size, pos, "] ", 2);
+		LogArgs::append(line, size, pos, site.function, strlen(site.function));
+		LogArgs::append(line, size, pos, "() ", 3);
+		LogArgs::append(line, size, pos, site.file, strlen(site.file));
+		LogArgs::append(line, size, pos, ":", 1);
+		LogArgs::append_uint(line, size, pos, unsigned(site.line));
+		LogArgs::append(line, size, pos, " ", 1);
+		// keep a byte for the new line
+		pos += LogArgs::format(line + pos, size - pos - 1, site.format, site.types, site.args, payload);
+		line[pos++] = '\n';
+		return pos;
+	}
+
+	static uint64_t realtime_ns() noexcept {
+		timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		return uint64_t(now.tv_sec) * 1000000000u + uint64_t(now.tv_nsec);
+	}
+
+	/**
+	 * Measure the TSC frequency against the wall clock over 10 ms.
+	 */
+	void calibrate() noexcept {
+		const uint64_t tsc_first = utils::Cpu::rdtsc();
+		const uint64_t ns_first = realtime_ns();
+		const timespec pause = {0, 10000000};
+		nanosleep(&pause, nullptr);
+		m_tsc_base = utils::Cpu::rdtsc();
+		m_ns_base = realtime_ns();
+		m_ns_per_tick = double(m_ns_base - ns_first) / double(m_tsc_base - tsc_first);
+	}
+
+	inline uint64_t to_ns(uint64_t tsc) const noexcept {
+		return m_ns_base + uint64_t(int64_t(double(int64_t(tsc - m_tsc_base)) * m_ns_per_tick));
+	}
+
+};
+
+}; // namespace logger
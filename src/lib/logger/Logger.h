@@ -3,13 +3,15 @@
 
 #include <stdio.h>
 
+#include "AsyncLogger.h"
+
 /*
  * size_t x = ...;
  * ssize_t y = ...;
  * printf("%zu\n", x);  // prints as unsigned decimal
  * printf("%zx\n", x);  // prints as hex
- * printf("%zd\n", y);  // prints as signed decimal 
- * 
+ * printf("%zd\n", y);  // prints as signed decimal
+ *
  **/
 
 #define LOGC(...) {fprintf(Logger::log_file, __VA_ARGS__);}
@@ -17,20 +19,91 @@
 
 #define LOG_RAW(...) {fprintf(Logger::log_file, __VA_ARGS__); fprintf(Logger::log_file, "\n");fflush(Logger::log_file);}
 
-#define LOG_INFO(...) { \
-    fprintf(Logger::log_file, "[info] %s() %s:%d ", __FUNCTION__, __FILE__, __LINE__); \
-    fprintf(Logger::log_file, __VA_ARGS__);\
-    fprintf(Logger::log_file, "\n");\
-    fflush(Logger::log_file); \
+/*
+ * The compile time threshold: the LOG_* macros of the lower levels are compiled out,
+ * the format is still checked. Define LOG_COMPILED_LEVEL before the include or with -D.
+ */
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARN 3
+#define LOG_LEVEL_CRITICAL 4
+
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL LOG_LEVEL_TRACE
+#endif
+
+static_assert(LOG_LEVEL_TRACE == logger::LEVEL_TRACE && LOG_LEVEL_CRITICAL == logger::LEVEL_CRITICAL
+	, "Logger: LOG_LEVEL_* mismatch logger::Level");
+
+/*
+ * LOG_TRACE/LOG_DEBUG/LOG_INFO/LOG_WARN/LOG_CRITICAL record the call site id, the timestamp and the raw arguments
+ * to the logging thread ring of logger::AsyncLogger, the background thread formats them.
+ * The format MUST be a string literal, it is checked as a printf format at compile time.
+ * While the async logger is not started the line is written to Logger::log_file synchronously.
+ */
+#define LOG_AT(level, ...) { \
+    static_cast<void>(sizeof(printf("" __VA_ARGS__))); \
+    if(logger::LogLevel::enabled(level)) { \
+        static logger::LogSite log_site_(level, __FUNCTION__, __FILE__, __LINE__); \
+        logger::AsyncLogger::instance().write(Logger::log_file, log_site_, __VA_ARGS__); \
+    } \
 }
 
-#define LOG_CRITICAL(...) { \
-    fprintf(Logger::log_file, "[critical] %s() %s:%d ", __FUNCTION__, __FILE__, __LINE__); \
-    fprintf(Logger::log_file, __VA_ARGS__);\
-    fprintf(Logger::log_file, "\n");\
-    fflush(Logger::log_file); \
+/*
+ * LOG_*_LIMITED(burst, period_ms, format, ...) pass at most @burst records of the call site
+ * per @period_ms milliseconds, the suppressed ones are counted and summarized, see logger::LogLimit.
+ */
+#define LOG_LIMITED_AT(level, burst, period_ms, ...) { \
+    static_cast<void>(sizeof(printf("" __VA_ARGS__))); \
+    if(logger::LogLevel::enabled(level)) { \
+        static logger::LogLimit log_limit_(level, __FUNCTION__, __FILE__, __LINE__, burst, period_ms); \
+        logger::AsyncLogger::instance().write(Logger::log_file, log_limit_, __VA_ARGS__); \
+    } \
 }
 
+#define LOG_COMPILED_OUT(...) {static_cast<void>(sizeof(printf("" __VA_ARGS__)));}
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_TRACE
+#define LOG_TRACE(...) LOG_AT(logger::LEVEL_TRACE, __VA_ARGS__)
+#define LOG_TRACE_LIMITED(burst, period_ms, ...) LOG_LIMITED_AT(logger::LEVEL_TRACE, burst, period_ms, __VA_ARGS__)
+#else
+#define LOG_TRACE(...) LOG_COMPILED_OUT(__VA_ARGS__)
+#define LOG_TRACE_LIMITED(burst, period_ms, ...) LOG_COMPILED_OUT(__VA_ARGS__)
+#endif
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_AT(logger::LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_DEBUG_LIMITED(burst, period_ms, ...) LOG_LIMITED_AT(logger::LEVEL_DEBUG, burst, period_ms, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) LOG_COMPILED_OUT(__VA_ARGS__)
+#define LOG_DEBUG_LIMITED(burst, period_ms, ...) LOG_COMPILED_OUT(__VA_ARGS__)
+#endif
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_AT(logger::LEVEL_INFO, __VA_ARGS__)
+#define LOG_INFO_LIMITED(burst, period_ms, ...) LOG_LIMITED_AT(logger::LEVEL_INFO, burst, period_ms, __VA_ARGS__)
+#else
+#define LOG_INFO(...) LOG_COMPILED_OUT(__VA_ARGS__)
+#define LOG_INFO_LIMITED(burst, period_ms, ...) LOG_COMPILED_OUT(__VA_ARGS__)
+#endif
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) LOG_AT(logger::LEVEL_WARN, __VA_ARGS__)
+#define LOG_WARN_LIMITED(burst, period_ms, ...) LOG_LIMITED_AT(logger::LEVEL_WARN, burst, period_ms, __VA_ARGS__)
+#else
+#define LOG_WARN(...) LOG_COMPILED_OUT(__VA_ARGS__)
+#define LOG_WARN_LIMITED(burst, period_ms, ...) LOG_COMPILED_OUT(__VA_ARGS__)
+#endif
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_CRITICAL
+#define LOG_CRITICAL(...) LOG_AT(logger::LEVEL_CRITICAL, __VA_ARGS__)
+#define LOG_CRITICAL_LIMITED(burst, period_ms, ...) LOG_LIMITED_AT(logger::LEVEL_CRITICAL, burst, period_ms, __VA_ARGS__)
+#else
+#define LOG_CRITICAL(...) LOG_COMPILED_OUT(__VA_ARGS__)
+#define LOG_CRITICAL_LIMITED(burst, period_ms, ...) LOG_COMPILED_OUT(__VA_ARGS__)
+#endif
+
 class Logger {
 public:
 	static FILE* log_file;
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <arpa/inet.h>
+#include <immintrin.h>
+
+#include "../utils/Cpu.h"
+
+namespace proto {
+
+/**
+ * The Internet checksum (RFC 1071) primitives.
+ *
+ * The one's complement sum is byte order independent, so the data is summed up
+ * as it is in memory and the result can be stored to a header as is, without ntohs/htons.
+ * A partial sum is kept in a 64-bit accumulator, so sums of different buffers can be added
+ * together as long as every buffer but the last one has an even length.
+ *
+ * Using sample:
+ * uint64_t acc = Checksum::pseudo_v4(ip->saddr, ip->daddr, IPPROTO_UDP, udp_len);
+ * udp->check = 0;
+ * udp->check = Checksum::finish(Checksum::sum(udp, udp_len, acc));
+ */
+class Checksum {
+public:
+
+	/**
+	 * @param data - the data to sum up.
+	 * @param size - the data length in bytes.
+	 * @param initial - a partial sum to add to.
+	 * @return The partial sum.
+	 */
+	static inline uint64_t sum(const void* data, size_t size, uint64_t initial = 0) noexcept {
+		if(size >= 128 && utils::Cpu::avx2()) {
+			return sum_avx2(data, size, initial);
+		} else if(size >= 64) {
+			return sum_sse2(data, size, initial);
+		}
+		return sum_scalar(data, size, initial);
+	}
+
+	/**
+	 * Fold a partial sum to 16 bits.
+	 */
+	static inline uint16_t fold(uint64_t acc) noexcept {
+		acc = (acc & 0xFFFFFFFFu) + (acc >> 32u);
+		acc = (acc & 0xFFFFFFFFu) + (acc >> 32u);
+		acc = (acc & 0xFFFFu) + (acc >> 16u);
+		acc = (acc & 0xFFFFu) + (acc >> 16u);
+		return uint16_t(acc);
+	}
+
+	/**
+	 * @return The checksum field value for a partial sum.
+	 */
+	static inline uint16_t finish(uint64_t acc) noexcept {
+		return uint16_t(~fold(acc));
+	}
+
+	/**
+	 * @return true - if the partial sum of data containing its checksum field is valid.
+	 */
+	static inline bool valid(uint64_t acc) noexcept {
+		return fold(acc) == 0xFFFFu;
+	}
+
+	/**
+	 * The IPv4 pseudo-header partial sum.
+	 * @param src - the source address in network byte order.
+	 * @param dst - the destination address in network byte order.
+	 * @param proto - the IP protocol.
+	 * @param size - the L4 length including the L4 header.
+	 */
+	static inline uint64_t pseudo_v4(uint32_t src, uint32_t dst, uint8_t proto, uint16_t size) noexcept {
+		return uint64_t(src) + dst + htons(proto) + htons(size);
+	}
+
+	/**
+	 * The IPv6 pseudo-header partial sum.
+	 * @param src - the 16 bytes of the source address.
+	 * @param dst - the 16 bytes of the destination address.
+	 * @param proto - the upper-layer protocol.
+	 * @param size - the upper-layer packet length.
+	 */
+	static inline uint64_t pseudo_v6(const void* src, const void* dst, uint8_t proto, uint32_t size) noexcept {
+		uint64_t acc = sum_scalar(src, 16, 0);
+		acc = sum_scalar(dst, 16, acc);
+		return acc + htonl(size) + htonl(proto);
+	}
+
+	/**
+	 * RFC 1624 incremental update of a checksum when a 16-bit word changes.
+	 * All the values are as they are in memory.
+	 * @param check - the old checksum field value.
+	 * @param old_value - the old word.
+	 * @param new_value - the new word.
+	 * @return The new checksum field value.
+	 */
+	static inline uint16_t adjust(uint16_t check, uint16_t old_value, uint16_t new_value) noexcept {
+		// HC' = ~(~HC + ~m + m')
+		const uint64_t acc = uint64_t(uint16_t(~check)) + uint16_t(~old_value) + new_value;
+		return finish(acc);
+	}
+
+	/**
+	 * RFC 1624 incremental update of a checksum when a 32-bit word changes.
+	 */
+	static inline uint16_t adjust32(uint16_t check, uint32_t old_value, uint32_t new_value) noexcept {
+		const uint64_t acc = uint64_t(uint16_t(~check))
+			+ uint16_t(~old_value) + uint16_t(~(old_value >> 16u))
+			+ uint16_t(new_value) + uint16_t(new_value >> 16u);
+		return finish(acc);
+	}
+
+	/**
+	 * RFC 1624 incremental update of a checksum when an even-sized memory area changes.
+	 * @param check - the old checksum field value.
+	 * @param old_data - the old data.
+	 * @param new_data - the new data.
+	 * @param size - the length in bytes, MUST be even.
+	 */
+	static inline uint16_t adjust(uint16_t check, const void* old_data, const void* new_data, size_t size) noexcept {
+		// the sum of ~m over the words is ~sum(m) in one's complement arithmetic
+		const uint16_t old_sum = fold(sum(old_data, size));
+		const uint64_t acc = uint64_t(uint16_t(~check)) + uint16_t(~old_sum) + sum(new_data, size);
+		return finish(acc);
+	}
+
+	// kernels
+
+	static uint64_t sum_scalar(const void* data, size_t size, uint64_t acc) noexcept {
+		auto ptr = reinterpret_cast<const uint8_t*>(data);
+		while(size >= 8u) {
+			uint64_t word;
+			memcpy(&word, ptr, sizeof(word));
+			acc += (word & 0xFFFFFFFFu) + (word >> 32u);
+			ptr += 8u;
+			size -= 8u;
+		}
+		return sum_tail(ptr, size, acc);
+	}
+
+	static uint64_t sum_sse2(const void* data, size_t size, uint64_t acc) noexcept {
+		auto ptr = reinterpret_cast<const uint8_t*>(data);
+		const __m128i zero = _mm_setzero_si128();
+		__m128i acc0 = _mm_setzero_si128();
+		__m128i acc1 = _mm_setzero_si128();
+		while(size >= 32u) {
+			const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+			const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + 16u));
+			acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v0, zero));
+			acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v0, zero));
+			acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v1, zero));
+			acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v1, zero));
+			ptr += 32u;
+			size -= 32u;
+		}
+		alignas(16) uint64_t lanes[2];
+		_mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_add_epi64(acc0, acc1));
+		acc += fold_lane(lanes[0]) + fold_lane(lanes[1]);
+		return sum_scalar(ptr, size, acc);
+	}
+
+	__attribute__((target("avx2")))
+	static uint64_t sum_avx2(const void* data, size_t size, uint64_t acc) noexcept {
+		auto ptr = reinterpret_cast<const uint8_t*>(data);
+		const __m256i zero = _mm256_setzero_si256();
+		__m256i acc0 = _mm256_setzero_si256();
+		__m256i acc1 = _mm256_setzero_si256();
+		__m256i acc2 = _mm256_setzero_si256();
+		__m256i acc3 = _mm256_setzero_si256();
+		while(size >= 64u) {
+			const __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+			const __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr + 32u));
+			acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v0, zero));
+			acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v0, zero));
+			acc2 = _mm256_add_epi64(acc2, _mm256_unpacklo_epi32(v1, zero));
+			acc3 = _mm256_add_epi64(acc3, _mm256_unpackhi_epi32(v1, zero));
+			ptr += 64u;
+			size -= 64u;
+		}
+		const __m256i total = _mm256_add_epi64(_mm256_add_epi64(acc0, acc1), _mm256_add_epi64(acc2, acc3));
+		alignas(32) uint64_t lanes[4];
+		_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), total);
+		acc += fold_lane(lanes[0]) + fold_lane(lanes[1]) + fold_lane(lanes[2]) + fold_lane(lanes[3]);
+		return sum_scalar(ptr, size, acc);
+	}
+
+private:
+
+	// a lane holds a sum of 32-bit words, fold it to 33 bits to avoid the accumulator overflow
+	static inline uint64_t fold_lane(uint64_t lane) noexcept {
+		return (lane & 0xFFFFFFFFu) + (lane >> 32u);
+	}
+
+	static inline uint64_t sum_tail(const uint8_t* ptr, size_t size, uint64_t acc) noexcept {
+		if(size >= 4u) {
+			uint32_t word;
+			memcpy(&word, ptr, sizeof(word));
+			acc += word;
+			ptr += 4u;
+			size -= 4u;
+		}
+		if(size >= 2u) {
+			uint16_t word;
+			memcpy(&word, ptr, sizeof(word));
+			acc += word;
+			ptr += 2u;
+			size -= 2u;
+		}
+		if(size) {
+			// the odd byte is the first byte of a zero padded word
+			uint16_t word = 0;
+			memcpy(&word, ptr, 1u);
+			acc += word;
+		}
+		return acc;
+	}
+
+};
+
+}; // namespace proto
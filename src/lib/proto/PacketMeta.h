@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+
+#include "proto.h"
+#include "procotols/IPv4.h"
+#include "procotols/IPv6.h"
+
+namespace proto {
+
+/**
+ * A flow key. All the fields are in host byte order except IPv6 addresses,
+ * which are kept as they are on the wire (an IPv6 address has no host representation).
+ * The unused bytes are always zeroed, so the key can be compared and hashed as a plain memory block.
+ */
+struct FiveTuple {
+
+	union Addr {
+		IPv4::Addr v4;
+		IPv6::Addr v6;
+	} __attribute__ ((__packed__));
+
+	Addr src;
+	Addr dst;
+	uint16_t port_src;
+	uint16_t port_dst;
+	uint8_t proto; // IP protocol number
+	uint8_t version; // 4, 6 or 0 if there is no L3 header
+	uint16_t reserved;
+
+	FiveTuple() noexcept {
+		clear();
+	}
+
+	inline void clear() noexcept {
+		memset(static_cast<void*>(this), 0, sizeof(*this));
+	}
+
+	bool operator==(const FiveTuple& rv) const noexcept {
+		return memcmp(this, &rv, sizeof(*this)) == 0;
+	}
+
+	bool operator!=(const FiveTuple& rv) const noexcept {
+		return not operator==(rv);
+	}
+
+	/**
+	 * @return The same tuple seen from the opposite direction.
+	 */
+	FiveTuple reverse() const noexcept {
+		FiveTuple result(*this);
+		result.src = dst;
+		result.dst = src;
+		result.port_src = port_dst;
+		result.port_dst = port_src;
+		return result;
+	}
+
+	/**
+	 * A tuple is canonical if its source endpoint is not greater than its destination endpoint.
+	 * Both directions of a connection have the same canonical tuple.
+	 * @return true - if the tuple is canonical.
+	 */
+	bool canonical() const noexcept {
+		const int cmp = memcmp(&src, &dst, sizeof(Addr));
+		return cmp < 0 || (cmp == 0 && port_src <= port_dst);
+	}
+
+	struct Hash {
+		inline size_t operator()(const FiveTuple& key) const noexcept {
+			uint64_t words[sizeof(FiveTuple) / sizeof(uint64_t)];
+			memcpy(words, &key, sizeof(words));
+			uint64_t result = 0x9E3779B97F4A7C15ull;
+			for(const auto word : words) {
+				result ^= word;
+				result *= 0xFF51AFD7ED558CCDull;
+				result ^= result >> 32u;
+			}
+			return size_t(result);
+		}
+	};
+
+};
+
+static_assert(sizeof(FiveTuple) == 40, "proto::FiveTuple");
+
+/**
+ * A compact descriptor of a parsed packet. It fits in one cache line.
+ * Offsets are in bytes from the beginning of the frame. An offset is valid only if
+ * the corresponding protocol is not Protocol::END.
+ *
+ *  |--Ethernet--|--VLAN--|--VLAN--|--IPv4--|--UDP--|----payload----|
+ *  |            |        |        |        |       |
+ * off_l2    off_vlan[0] [1]     off_l3   off_l4  off_payload
+ */
+struct alignas(64) PacketMeta {
+	static constexpr uint8_t VLAN_DEPTH_MAX = 2;
+
+	// flags
+	static constexpr uint8_t FLAG_FRAGMENT = 0x01; // the packet is an IPv4 fragment, there is no L4 view
+	static constexpr uint8_t FLAG_TRUNCATED = 0x02; // the parsing stopped at a header that doesn't fit in the frame
+	static constexpr uint8_t FLAG_VLAN_OVERFLOW = 0x04; // the packet has more VLAN tags than VLAN_DEPTH_MAX
+
+	FiveTuple tuple;
+	uint16_t off_l2;
+	uint16_t off_vlan[VLAN_DEPTH_MAX];
+	uint16_t off_l3;
+	uint16_t off_l4;
+	uint16_t off_payload;
+	uint16_t len_payload;
+	uint16_t vlan_id[VLAN_DEPTH_MAX];
+	uint8_t vlan_nb;
+	Protocol proto_l2;
+	Protocol proto_l3;
+	Protocol proto_l4;
+	uint8_t flags;
+
+	PacketMeta() noexcept {
+		clear();
+	}
+
+	inline void clear() noexcept {
+		memset(static_cast<void*>(this), 0, sizeof(*this));
+		proto_l2 = Protocol::END;
+		proto_l3 = Protocol::END;
+		proto_l4 = Protocol::END;
+	}
+
+	inline bool fragment() const noexcept {
+		return flags & FLAG_FRAGMENT;
+	}
+
+	inline bool truncated() const noexcept {
+		return flags & FLAG_TRUNCATED;
+	}
+
+	/**
+	 * Assign a header pointer using an offset of the descriptor.
+	 * @param frame_begin - the same buffer the descriptor has been filled with.
+	 * @param offset - one of the off_* fields.
+	 * @param hdr - a pointer to assign.
+	 */
+	template <typename Ptr, typename Hdr>
+	static inline void assign(const Ptr* frame_begin, uint16_t offset, const Hdr*& hdr) noexcept {
+		hdr = reinterpret_cast<const Hdr*>(reinterpret_cast<const uint8_t*>(frame_begin) + offset);
+	}
+
+};
+
+static_assert(sizeof(PacketMeta) == 64, "proto::PacketMeta must fit in a cache line");
+
+}; // namespace proto
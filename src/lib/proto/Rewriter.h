@@ -0,0 +1,285 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+#include "Checksum.h"
+#include "mframe/MFrame.h"
+#include "procotols/IPv4.h"
+#include "procotols/IPv6.h"
+#include "procotols/Tcp.h"
+#include "procotols/Udp.h"
+
+namespace proto {
+
+/**
+ * Checksum aware header rewriting for anonymisers and NAT replay.
+ *
+ * Every method takes a frame which head points to the IPv4 or IPv6 header,
+ * the L4 header is expected right after the L3 header (no IPv6 extension headers).
+ * The frame is not moved.
+ * The fields are rewritten with RFC 1624 incremental updates, so the checksums stay valid
+ * (or stay broken) without summing up the payload.
+ *
+ * Using sample:
+ * RwMFrame frame(pkt + off_l3, size - off_l3);
+ * Rewriter::ipv4_src(frame, htonl(0x0A000001));
+ * Rewriter::port_src(frame, htons(1234));
+ */
+class Rewriter {
+public:
+
+	/**
+	 * Recompute the IPv4 header checksum and the TCP/UDP checksum from scratch.
+	 * @return true - if the frame is IPv4/IPv6 with TCP or UDP.
+	 */
+	static bool update_checksums(RwMFrame& frame) noexcept {
+		Layout layout;
+		if(not locate(frame, layout)) {
+			return false;
+		}
+		if(layout.ipv4) {
+			IPv4::update_checksum(reinterpret_cast<IPv4::Header*>(frame.head()));
+		}
+		if(not layout.l4_size) {
+			return layout.ipv4;
+		}
+		uint8_t* l4 = frame.head() + layout.off_l4;
+		if(layout.proto == IPv4::PROTO_TCP) {
+			Tcp::update_checksum(reinterpret_cast<Tcp::Header*>(l4), layout.l4_size, layout.pseudo);
+		} else {
+			Udp::update_checksum(reinterpret_cast<Udp::Header*>(l4), layout.l4_size, layout.pseudo);
+		}
+		return true;
+	}
+
+	/**
+	 * Verify the IPv4 header checksum and the TCP/UDP checksum.
+	 * A zero UDP checksum over IPv4 means "no checksum" and is valid.
+	 * @return true - if all the checksums present are valid.
+	 */
+	template <typename MFrame>
+	static bool verify_checksums(const MFrame& frame) noexcept {
+		Layout layout;
+		if(not locate(frame, layout)) {
+			return false;
+		}
+		if(layout.ipv4 && not IPv4::verify_checksum(reinterpret_cast<const IPv4::Header*>(frame.head()))) {
+			return false;
+		}
+		if(not layout.l4_size) {
+			return layout.ipv4;
+		}
+		const uint8_t* l4 = frame.head() + layout.off_l4;
+		if(layout.proto == IPv4::PROTO_TCP) {
+			return Tcp::verify_checksum(reinterpret_cast<const Tcp::Header*>(l4), layout.l4_size, layout.pseudo);
+		}
+		auto udp = reinterpret_cast<const Udp::Header*>(l4);
+		if(layout.ipv4 && udp->check == 0) {
+			return true;
+		}
+		return Udp::verify_checksum(udp, layout.l4_size, layout.pseudo);
+	}
+
+	/**
+	 * Rewrite the IPv4 source address.
+	 * @param addr - the address in network byte order.
+	 */
+	static inline bool ipv4_src(RwMFrame& frame, IPv4::Addr addr) noexcept {
+		return ipv4_addr(frame, offsetof(IPv4::Header, saddr), addr);
+	}
+
+	/**
+	 * Rewrite the IPv4 destination address.
+	 * @param addr - the address in network byte order.
+	 */
+	static inline bool ipv4_dst(RwMFrame& frame, IPv4::Addr addr) noexcept {
+		return ipv4_addr(frame, offsetof(IPv4::Header, daddr), addr);
+	}
+
+	/**
+	 * Rewrite the IPv6 source address.
+	 */
+	static inline bool ipv6_src(RwMFrame& frame, const IPv6::Addr& addr) noexcept {
+		return ipv6_addr(frame, offsetof(IPv6::Header, src), addr);
+	}
+
+	/**
+	 * Rewrite the IPv6 destination address.
+	 */
+	static inline bool ipv6_dst(RwMFrame& frame, const IPv6::Addr& addr) noexcept {
+		return ipv6_addr(frame, offsetof(IPv6::Header, dst), addr);
+	}
+
+	/**
+	 * Rewrite the TCP/UDP source port.
+	 * @param port - the port in network byte order.
+	 */
+	static inline bool port_src(RwMFrame& frame, uint16_t port) noexcept {
+		return l4_port(frame, 0, port);
+	}
+
+	/**
+	 * Rewrite the TCP/UDP destination port.
+	 * @param port - the port in network byte order.
+	 */
+	static inline bool port_dst(RwMFrame& frame, uint16_t port) noexcept {
+		return l4_port(frame, 2, port);
+	}
+
+private:
+
+	struct Layout {
+		bool ipv4;
+		uint8_t proto;
+		uint16_t off_l4;
+		uint32_t l4_size; // zero if there is no TCP/UDP header
+		uint64_t pseudo;
+	};
+
+	template <typename MFrame>
+	static bool locate(const MFrame& frame, Layout& layout) noexcept {
+		layout.l4_size = 0;
+		if(frame.available(sizeof(IPv4::Header)) && (frame.head()[0] >> 4u) == 4u) {
+			auto hdr = reinterpret_cast<const IPv4::Header*>(frame.head());
+			const uint16_t len_hdr = IPv4::hdr_len(hdr);
+			const uint16_t len_pkt = IPv4::pkt_len(hdr);
+			if(len_hdr < sizeof(IPv4::Header) || len_pkt < len_hdr || not frame.available(len_pkt)) {
+				return false;
+			}
+			layout.ipv4 = true;
+			layout.proto = hdr->protocol;
+			layout.off_l4 = len_hdr;
+			// only a complete datagram has the whole L4 payload to sum up
+			if(not IPv4::fragmented(hdr) && has_l4(layout.proto, len_pkt - len_hdr)) {
+				layout.l4_size = len_pkt - len_hdr;
+				layout.pseudo = IPv4::pseudo_sum(hdr);
+			}
+			return true;
+		}
+		if(frame.available(sizeof(IPv6::Header)) && (frame.head()[0] >> 4u) == 6u) {
+			auto hdr = reinterpret_cast<const IPv6::Header*>(frame.head());
+			const uint32_t len_payload = ntohs(hdr->payload_len);
+			if(not frame.available(sizeof(IPv6::Header) + len_payload) || not has_l4(hdr->next_header, len_payload)) {
+				return false;
+			}
+			layout.ipv4 = false;
+			layout.proto = hdr->next_header;
+			layout.off_l4 = sizeof(IPv6::Header);
+			layout.l4_size = len_payload;
+			layout.pseudo = IPv6::pseudo_sum(hdr);
+			return true;
+		}
+		return false;
+	}
+
+	static inline bool has_l4(uint8_t proto, size_t size) noexcept {
+		return (proto == IPv4::PROTO_TCP && size >= sizeof(Tcp::Header))
+			|| (proto == IPv4::PROTO_UDP && size >= sizeof(Udp::Header));
+	}
+
+	/**
+	 * @param proto - the L4 protocol of the packet.
+	 * @return The TCP/UDP header which checksum depends on the addresses or nullptr.
+	 */
+	static uint8_t* l4_header(RwMFrame& frame, uint8_t& proto) noexcept {
+		size_t off_l4;
+		if(frame.available(sizeof(IPv4::Header)) && (frame.head()[0] >> 4u) == 4u) {
+			auto hdr = reinterpret_cast<const IPv4::Header*>(frame.head());
+			// only the first fragment carries the L4 header
+			if(IPv4::offset(hdr)) {
+				return nullptr;
+			}
+			proto = hdr->protocol;
+			off_l4 = IPv4::hdr_len(hdr);
+		} else if(frame.available(sizeof(IPv6::Header)) && (frame.head()[0] >> 4u) == 6u) {
+			proto = reinterpret_cast<const IPv6::Header*>(frame.head())->next_header;
+			off_l4 = sizeof(IPv6::Header);
+		} else {
+			return nullptr;
+		}
+		if(
+			(proto == IPv4::PROTO_TCP && frame.available(off_l4 + sizeof(Tcp::Header)))
+			|| (proto == IPv4::PROTO_UDP && frame.available(off_l4 + sizeof(Udp::Header)))
+			) {
+			return frame.head() + off_l4;
+		}
+		return nullptr;
+	}
+
+	static inline uint8_t* check_field(uint8_t* l4, uint8_t proto) noexcept {
+		return l4 + (proto == IPv4::PROTO_TCP ? offsetof(Tcp::Header, crc) : offsetof(Udp::Header, check));
+	}
+
+	static inline uint16_t load16(const uint8_t* ptr) noexcept {
+		uint16_t value;
+		memcpy(&value, ptr, sizeof(value));
+		return value;
+	}
+
+	static inline void store16(uint8_t* ptr, uint16_t value) noexcept {
+		memcpy(ptr, &value, sizeof(value));
+	}
+
+	static inline void store_l4_check(uint8_t* check, uint8_t proto, uint16_t value) noexcept {
+		// a missing UDP checksum stays missing and the computed zero is sent as all ones
+		if(proto == IPv4::PROTO_UDP) {
+			if(load16(check)) {
+				store16(check, value ? value : 0xFFFF);
+			}
+		} else {
+			store16(check, value);
+		}
+	}
+
+	static bool ipv4_addr(RwMFrame& frame, size_t off, IPv4::Addr addr) noexcept {
+		if(not frame.available(sizeof(IPv4::Header)) || (frame.head()[0] >> 4u) != 4u) {
+			return false;
+		}
+		auto hdr = reinterpret_cast<IPv4::Header*>(frame.head());
+		IPv4::Addr old;
+		memcpy(&old, frame.head() + off, sizeof(old));
+		memcpy(frame.head() + off, &addr, sizeof(addr));
+		hdr->check = Checksum::adjust32(hdr->check, old, addr);
+		uint8_t proto;
+		if(uint8_t* l4 = l4_header(frame, proto)) {
+			uint8_t* check = check_field(l4, proto);
+			store_l4_check(check, proto, Checksum::adjust32(load16(check), old, addr));
+		}
+		return true;
+	}
+
+	static bool ipv6_addr(RwMFrame& frame, size_t off, const IPv6::Addr& addr) noexcept {
+		if(not frame.available(sizeof(IPv6::Header)) || (frame.head()[0] >> 4u) != 6u) {
+			return false;
+		}
+		IPv6::Addr old;
+		memcpy(&old, frame.head() + off, sizeof(old));
+		memcpy(frame.head() + off, &addr, sizeof(addr));
+		uint8_t proto;
+		if(uint8_t* l4 = l4_header(frame, proto)) {
+			uint8_t* check = check_field(l4, proto);
+			store_l4_check(check, proto, Checksum::adjust(load16(check), &old, &addr, sizeof(addr)));
+		}
+		return true;
+	}
+
+	static bool l4_port(RwMFrame& frame, size_t off, uint16_t port) noexcept {
+		uint8_t proto;
+		uint8_t* l4 = l4_header(frame, proto);
+		if(not l4) {
+			return false;
+		}
+		// the ports are the first two words of both TCP and UDP headers
+		const uint16_t old = load16(l4 + off);
+		store16(l4 + off, port);
+		uint8_t* check = check_field(l4, proto);
+		store_l4_check(check, proto, Checksum::adjust(load16(check), old, port));
+		return true;
+	}
+
+};
+
+}; // namespace proto
@@ -0,0 +1,413 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <endian.h>
+#include <vector>
+
+#include "Rewriter.h"
+#include "mframe/MFrame.h"
+#include "procotols/Ethernet.h"
+#include "procotols/Vlan.h"
+#include "procotols/IPv4.h"
+#include "procotols/IPv6.h"
+#include "procotols/Tcp.h"
+#include "procotols/Udp.h"
+#include "procotols/Gre.h"
+#include "../utils/DiceMachine.h"
+
+namespace proto {
+
+/**
+ * The shape of a synthetic trace, every probability is in [0, 1].
+ * The frame sizes always follow the simple IMIX: 64/576/1500 bytes in the 7:4:1 proportion,
+ * a frame grows if its headers don't fit.
+ */
+struct TrafficProfile {
+	const char* name = "imix";
+	double vlan = 0.1;       // a frame is VLAN tagged
+	unsigned vlan_depth = 1; // a tagged frame has from 1 to vlan_depth tags
+	double ipv6 = 0.15;      // a flow is IPv6
+	double gre = 0.0;        // a frame is tunneled: IPv4 / GRE / Ethernet / the inner packet
+	double fragment = 0.0;   // an IPv4 frame is a fragment, a half of them are the first ones
+	double tcp = 0.6;        // a flow is TCP, the rest is UDP
+	unsigned flows = 4096;
+
+	static TrafficProfile imix() noexcept {
+		return TrafficProfile();
+	}
+
+	static TrafficProfile vlan_stacked() noexcept {
+		TrafficProfile result;
+		result.name = "vlan";
+		result.vlan = 1.0;
+		result.vlan_depth = 3;
+		return result;
+	}
+
+	static TrafficProfile ipv6_only() noexcept {
+		TrafficProfile result;
+		result.name = "ipv6";
+		result.ipv6 = 1.0;
+		return result;
+	}
+
+	static TrafficProfile gre_tunneled() noexcept {
+		TrafficProfile result;
+		result.name = "gre";
+		result.gre = 0.8;
+		return result;
+	}
+
+	static TrafficProfile fragmented() noexcept {
+		TrafficProfile result;
+		result.name = "fragment";
+		result.ipv6 = 0.0;
+		result.fragment = 0.5;
+		return result;
+	}
+};
+
+/**
+ * The frames of a trace stored back to back in one buffer with their timestamps.
+ * It can be saved to and loaded from a classic pcap file (nanosecond or microsecond
+ * timestamps, the host byte order) without libpcap.
+ */
+class TrafficTrace {
+	static constexpr uint32_t PCAP_MAGIC_US = 0xA1B2C3D4u;
+	static constexpr uint32_t PCAP_MAGIC_NS = 0xA1B23C4Du;
+	static constexpr uint32_t PCAP_SNAPLEN = 0xFFFFu;
+	static constexpr uint32_t PCAP_LINKTYPE_ETHERNET = 1u;
+
+	struct PcapFileHeader {
+		uint32_t magic;
+		uint16_t version_major;
+		uint16_t version_minor;
+		int32_t thiszone;
+		uint32_t sigfigs;
+		uint32_t snaplen;
+		uint32_t linktype;
+	};
+
+	struct PcapRecordHeader {
+		uint32_t sec;
+		uint32_t subsec;
+		uint32_t caplen;
+		uint32_t len;
+	};
+
+	std::vector<uint8_t> m_data;
+	std::vector<size_t> m_offsets = {0};
+	std::vector<uint64_t> m_stamps;
+
+public:
+
+	inline void clear() noexcept {
+		m_data.clear();
+		m_offsets.assign(1, 0);
+		m_stamps.clear();
+	}
+
+	/**
+	 * @return The number of frames.
+	 */
+	inline size_t size() const noexcept {
+		return m_stamps.size();
+	}
+
+	/**
+	 * @return The total length of the frames in bytes.
+	 */
+	inline size_t bytes() const noexcept {
+		return m_data.size();
+	}
+
+	inline const uint8_t* frame(size_t idx) const noexcept {
+		return m_data.data() + m_offsets[idx];
+	}
+
+	inline size_t length(size_t idx) const noexcept {
+		return m_offsets[idx + 1] - m_offsets[idx];
+	}
+
+	/**
+	 * @return The timestamp in nanoseconds.
+	 */
+	inline uint64_t stamp(size_t idx) const noexcept {
+		return m_stamps[idx];
+	}
+
+	/**
+	 * Append a frame.
+	 * @return The frame buffer of @length bytes, valid until the next append().
+	 */
+	uint8_t* append(size_t length, uint64_t stamp) {
+		m_data.resize(m_data.size() + length);
+		m_offsets.push_back(m_data.size());
+		m_stamps.push_back(stamp);
+		return m_data.data() + m_data.size() - length;
+	}
+
+	/**
+	 * Write the trace to a pcap file with nanosecond timestamps.
+	 * @return false - if the file can't be written.
+	 */
+	bool save_pcap(const char* path) const noexcept {
+		FILE* out = fopen(path, "wb");
+		if(not out) {
+			return false;
+		}
+		const PcapFileHeader file_hdr = {PCAP_MAGIC_NS, 2, 4, 0, 0, PCAP_SNAPLEN, PCAP_LINKTYPE_ETHERNET};
+		bool result = fwrite(&file_hdr, sizeof(file_hdr), 1u, out) == 1u;
+		for(size_t i = 0; result && i < size(); ++i) {
+			const PcapRecordHeader hdr = {uint32_t(m_stamps[i] / 1000000000u), uint32_t(m_stamps[i] % 1000000000u)
+				, uint32_t(length(i)), uint32_t(length(i))};
+			result = fwrite(&hdr, sizeof(hdr), 1u, out) == 1u
+				&& fwrite(frame(i), length(i), 1u, out) == 1u;
+		}
+		return (fclose(out) == 0) && result;
+	}
+
+	/**
+	 * Replace the trace with the frames of a pcap file.
+	 * @return false - if the file can't be read or isn't an Ethernet pcap file in the host byte order.
+	 */
+	bool load_pcap(const char* path) {
+		clear();
+		FILE* in = fopen(path, "rb");
+		if(not in) {
+			return false;
+		}
+		PcapFileHeader file_hdr;
+		bool result = fread(&file_hdr, sizeof(file_hdr), 1u, in) == 1u
+			&& (file_hdr.magic == PCAP_MAGIC_NS || file_hdr.magic == PCAP_MAGIC_US)
+			&& file_hdr.linktype == PCAP_LINKTYPE_ETHERNET;
+		const uint64_t subsec_ns = file_hdr.magic == PCAP_MAGIC_NS ? 1u : 1000u;
+		PcapRecordHeader hdr;
+		while(result && fread(&hdr, sizeof(hdr), 1u, in) == 1u) {
+			uint8_t* buffer = append(hdr.caplen, hdr.sec * uint64_t(1000000000u) + hdr.subsec * subsec_ns);
+			result = fread(buffer, hdr.caplen, 1u, in) == 1u;
+		}
+		fclose(in);
+		return result;
+	}
+
+};
+
+/**
+ * A deterministic generator of the synthetic Ethernet traffic: the same profile and seed
+ * always give the same frames, so the parser changes are measured on the fixed workloads.
+ *
+ * The frames belong to TrafficProfile::flows flows, a flow has its addresses, ports,
+ * IP version and L4 protocol. The IPv4 header, TCP and UDP checksums are valid
+ * (the fragments have no L4 checksum). The timestamps follow a 10 Gbit/s line rate.
+ *
+ * Using sample:
+ * TrafficTrace trace;
+ * TrafficGenerator(TrafficProfile::gre_tunneled(), 42).generate(trace, 1 << 16);
+ * trace.save_pcap("gre.pcap");
+ */
+class TrafficGenerator {
+public:
+	static constexpr size_t FRAME_MAX = 1600;
+
+private:
+	static constexpr uint16_t FRAGMENT_OFFSET_MAX = 180; // in 8-byte units, fits a 1500 bytes packet
+
+	DiceMachine m_dice;
+	TrafficProfile m_profile;
+	uint64_t m_seed;
+	uint64_t m_stamp;
+	uint16_t m_ip_id = 0;
+
+public:
+
+	/**
+	 * @param stamp - the timestamp of the first frame in nanoseconds.
+	 */
+	TrafficGenerator(const TrafficProfile& profile, uint64_t seed, uint64_t stamp = 0) noexcept
+		: m_dice(seed), m_profile(profile), m_seed(seed), m_stamp(stamp) {}
+
+	/**
+	 * Append @frames frames to @trace.
+	 */
+	void generate(TrafficTrace& trace, size_t frames) {
+		uint8_t buffer[FRAME_MAX];
+		for(size_t i = 0; i < frames; ++i) {
+			const size_t length = next(buffer);
+			memcpy(trace.append(length, m_stamp), buffer, length);
+			// the preamble and the inter-frame gap are 20 bytes, a byte takes 0.8 ns at 10 Gbit/s
+			m_stamp += (length + 20u) * 8u / 10u;
+		}
+	}
+
+	/**
+	 * Build the next frame.
+	 * @param buffer - at least FRAME_MAX bytes.
+	 * @return The frame length.
+	 */
+	size_t next(uint8_t* buffer) noexcept {
+		const uint64_t flow = mix(m_seed + m_dice.u32() % m_profile.flows);
+		const bool v6 = unit(flow, 0) < m_profile.ipv6;
+		const bool tcp = unit(flow, 1) < m_profile.tcp;
+		const uint16_t l3_type = v6 ? ETH_P_IPV6 : ETH_P_IP;
+
+		unsigned vlans = 0;
+		if(m_profile.vlan_depth && m_dice.pass(m_profile.vlan)) {
+			vlans = 1u + m_dice.u32() % m_profile.vlan_depth;
+		}
+		const bool gre = m_dice.pass(m_profile.gre);
+		// a fragment is either the first one with the L4 header or a following one without it
+		const bool fragment = not v6 && m_dice.pass(m_profile.fragment);
+		const bool fragment_first = fragment && m_dice.pass(0.5);
+		const bool l4 = not fragment || fragment_first;
+
+		const uint32_t imix = m_dice.u32() % 12u;
+		const size_t target = imix < 7u ? 64u : (imix < 11u ? 576u : 1500u);
+		const size_t l3_size = v6 ? sizeof(IPv6::Header) : sizeof(IPv4::Header);
+		const size_t l4_size = l4 ? (tcp ? sizeof(Tcp::Header) : sizeof(Udp::Header)) : 0u;
+		const size_t tunnel_size = gre ? sizeof(IPv4::Header) + sizeof(Gre::Header) + sizeof(Ethernet::Header) : 0u;
+		const size_t headers = sizeof(Ethernet::Header) + vlans * sizeof(Vlan::Header) + tunnel_size + l3_size + l4_size;
+		const size_t length = target > headers ? target : headers;
+
+		uint8_t* ptr = buffer;
+		put_ethernet(ptr, flow, vlans ? ETH_P_8021Q : (gre ? ETH_P_IP : l3_type));
+		for(unsigned i = 0; i < vlans; ++i) {
+			Vlan::Header hdr;
+			hdr.vlan_tci = htons(uint16_t(1u + (flow >> (12u * i)) % 4094u));
+			hdr.nextProto = htons(i + 1u < vlans ? ETH_P_8021Q : (gre ? ETH_P_IP : l3_type));
+			put(ptr, hdr);
+		}
+		if(gre) {
+			// the tunnel endpoints depend on the seed only
+			put_ipv4(ptr, mix(m_seed), IPv4::PROTO_GRE, buffer + length - ptr, 0);
+			Gre::Header hdr;
+			hdr.flags = 0;
+			hdr.next_proto = htons(ETH_P_TEB); // Transparent Ethernet Bridging
+			put(ptr, hdr);
+			put_ethernet(ptr, flow, l3_type);
+		}
+
+		uint8_t* l3 = ptr;
+		if(v6) {
+			put_ipv6(ptr, flow, tcp ? IPv6::PROTO_TCP : IPv6::PROTO_UDP, buffer + length - ptr - sizeof(IPv6::Header));
+		} else {
+			uint16_t frag = 0;
+			if(fragment) {
+				frag = fragment_first ? IP_MF : uint16_t((1u + m_dice.u32() % FRAGMENT_OFFSET_MAX) | (m_dice.pass(0.5) ? IP_MF : 0));
+			}
+			put_ipv4(ptr, flow, tcp ? IPv4::PROTO_TCP : IPv4::PROTO_UDP, buffer + length - ptr, frag);
+		}
+		if(l4) {
+			const uint16_t port_src = uint16_t(1024u + (flow >> 16u) % 64512u);
+			const uint16_t port_dst = uint16_t(flow >> 48u);
+			if(tcp) {
+				Tcp::Header hdr;
+				memset(&hdr, 0, sizeof(hdr));
+				hdr.src = htons(port_src);
+				hdr.dst = htons(port_dst);
+				hdr.seq_num = htonl(m_dice.u32());
+				hdr.ack_num = htonl(m_dice.u32());
+				hdr.data_offset = sizeof(hdr) >> 2u;
+				hdr.flag_ack = 1;
+				hdr.win_size = htons(0xFFFF);
+				put(ptr, hdr);
+			} else {
+				Udp::Header hdr;
+				memset(&hdr, 0, sizeof(hdr));
+				hdr.source = htons(port_src);
+				hdr.dest = htons(port_dst);
+				hdr.len = htons(uint16_t(buffer + length - ptr));
+				put(ptr, hdr);
+			}
+		}
+		memset(ptr, 0, buffer + length - ptr);
+
+		if(l4) {
+			RwMFrame frame(l3, buffer + length - l3);
+			Rewriter::update_checksums(frame);
+		}
+		return length;
+	}
+
+private:
+
+	/**
+	 * splitmix64 finalizer, the per flow values are derived from its output bits.
+	 */
+	static inline uint64_t mix(uint64_t value) noexcept {
+		value += 0x9E3779B97F4A7C15ull;
+		value = (value ^ (value >> 30u)) * 0xBF58476D1CE4E5B9ull;
+		value = (value ^ (value >> 27u)) * 0x94D049BB133111EBull;
+		return value ^ (value >> 31u);
+	}
+
+	/**
+	 * @return A number in [0, 1) derived from @flow, independent for the different @salt.
+	 */
+	static inline double unit(uint64_t flow, uint64_t salt) noexcept {
+		return double(mix(flow ^ salt) >> 11u) / double(uint64_t(1) << 53u);
+	}
+
+	template <typename T>
+	static inline void put(uint8_t*& ptr, const T& hdr) noexcept {
+		memcpy(ptr, &hdr, sizeof(hdr));
+		ptr += sizeof(hdr);
+	}
+
+	static void put_ethernet(uint8_t*& ptr, uint64_t flow, uint16_t type) noexcept {
+		Ethernet::Header hdr;
+		// the locally administered unicast addresses
+		for(unsigned i = 0; i < ETH_ALEN; ++i) {
+			hdr.h_source[i] = uint8_t(flow >> (8u * i));
+			hdr.h_dest[i] = uint8_t(flow >> (8u * i + 16u));
+		}
+		hdr.h_source[0] = uint8_t((hdr.h_source[0] & 0xFCu) | 0x02u);
+		hdr.h_dest[0] = uint8_t((hdr.h_dest[0] & 0xFCu) | 0x02u);
+		hdr.h_proto = htons(type);
+		put(ptr, hdr);
+	}
+
+	/**
+	 * @param size - the packet length including the header.
+	 */
+	void put_ipv4(uint8_t*& ptr, uint64_t flow, uint8_t protocol, size_t size, uint16_t frag) noexcept {
+		IPv4::Header hdr;
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.version = 4;
+		hdr.ihl = sizeof(hdr) >> 2u;
+		hdr.tot_len = htons(uint16_t(size));
+		hdr.id = htons(m_ip_id++);
+		hdr.frag_off = htons(frag);
+		hdr.ttl = 64;
+		hdr.protocol = protocol;
+		// 10.0.0.0/8 and 172.16.0.0/12
+		hdr.saddr = htonl(0x0A000000u | uint32_t(flow & 0xFFFFFFu));
+		hdr.daddr = htonl(0xAC100000u | uint32_t((flow >> 24u) & 0xFFFFFu));
+		IPv4::update_checksum(&hdr);
+		put(ptr, hdr);
+	}
+
+	/**
+	 * @param payload - the packet length excluding the header.
+	 */
+	static void put_ipv6(uint8_t*& ptr, uint64_t flow, uint8_t protocol, size_t payload) noexcept {
+		IPv6::Header hdr;
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.version = 6;
+		hdr.payload_len = htons(uint16_t(payload));
+		hdr.next_header = protocol;
+		hdr.hop_limit = 64;
+		// fd00::/8 unique local addresses
+		hdr.src.addr64[0] = htobe64(0xFD00000000000000ull | (flow >> 8u));
+		hdr.src.addr64[1] = htobe64(flow);
+		hdr.dst.addr64[0] = htobe64(0xFD00000000000001ull);
+		hdr.dst.addr64[1] = htobe64(~flow);
+		put(ptr, hdr);
+	}
+
+};
+
+}; // namespace proto
@@ -38,7 +38,7 @@ class SafeMFrame : public BasicMFrame<T> {
 	using Base = BasicMFrame<T>;
 
 protected:
-	bool m_in_bounds;
+	mutable bool m_in_bounds; // assign_stay() is const, as in MFrame, and may clear it
 
 public:
 
@@ -179,11 +179,12 @@ public:
 	/**
 	 * Assign a pointer to the head.
 	 * The head moves to the new position.
-	 * @param pointer - a pointer to assign.
+	 * @param pointer - a pointer to assign, nullptr if the packet is out of its bounds.
 	 * @return true - if the packet is in its bounds after assigning.
 	 */
 	template<typename V>
 	inline bool assign(V*& pointer) noexcept {
+		pointer = nullptr;
 		if(m_in_bounds) {
 			if(sizeof(V) > Base::m_available) {
 				m_in_bounds = false;
@@ -199,11 +200,12 @@ public:
 	/**
 	 * Assign a pointer to the head.
 	 * The head doesn't move.
-	 * @param pointer - a pointer to assign.
+	 * @param pointer - a pointer to assign, nullptr if the packet is out of its bounds.
 	 * @return true - if the packet is in its bounds after assigning.
 	 */
 	template<typename V>
-	inline bool assign_stay(V*& pointer) noexcept {
+	inline bool assign_stay(V*& pointer) const noexcept {
+		pointer = nullptr;
 		if(m_in_bounds) {
 			if(sizeof(V) > Base::m_available) {
 				m_in_bounds = false;
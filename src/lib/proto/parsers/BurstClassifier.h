@@ -0,0 +1,318 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <immintrin.h>
+#include <linux/if_ether.h>
+#include <arpa/inet.h>
+
+#include "../procotols/IPv4.h"
+#include "../../utils/Cpu.h"
+
+namespace proto {
+
+/**
+ * Per-packet classification results of a burst in SoA form.
+ * The offsets are in bytes from the beginning of the frame and valid only
+ * if the corresponding class bits are set, otherwise they are zero.
+ */
+template <size_t Burst = 16>
+struct BurstMeta {
+	static_assert(Burst > 0 && Burst % 8 == 0, "proto::BurstMeta::Burst must be a multiple of 8");
+	static constexpr size_t BURST = Burst;
+
+	uint8_t stack[Burst]; // BurstClassifier::CLASS_* bits
+	uint8_t ip_proto[Burst];
+	uint16_t off_l3[Burst];
+	uint16_t off_l4[Burst];
+	uint16_t port_src[Burst]; // host byte order
+	uint16_t port_dst[Burst]; // host byte order
+};
+
+/**
+ * BurstClassifier finds the protocol stack class, L3/L4 offsets and L4 ports of
+ * up to BurstMeta::BURST packets at once.
+ * The AVX2 kernel processes eight packets per iteration, it gathers the headers words
+ * straight from the packet buffers and handles one VLAN tag at most.
+ * Packets with stacked VLAN tags and the tail of the burst go through the scalar path,
+ * which is also used when AVX2 is not supported by the CPU.
+ *
+ * The classification follows MetaParser rules: IPv6 extension headers are not followed,
+ * IPv4 fragments are marked with CLASS_FRAGMENT and have no L4 class.
+ */
+class BurstClassifier {
+public:
+
+	static constexpr uint8_t CLASS_VLAN = 0x01;
+	static constexpr uint8_t CLASS_IPv4 = 0x02;
+	static constexpr uint8_t CLASS_IPv6 = 0x04;
+	static constexpr uint8_t CLASS_TCP = 0x08;
+	static constexpr uint8_t CLASS_UDP = 0x10;
+	static constexpr uint8_t CLASS_GRE = 0x20;
+	static constexpr uint8_t CLASS_FRAGMENT = 0x40;
+	static constexpr uint8_t CLASS_QINQ = 0x80; // more than one VLAN tag
+
+	/**
+	 * Classify a burst of packets.
+	 * @param buffers - an array of @nb packet pointers.
+	 * @param sizes - an array of @nb packet lengths.
+	 * @param nb - the burst size. MUST NOT exceed Burst.
+	 * @param out - the results.
+	 */
+	template <size_t Burst>
+	static void classify(const uint8_t* const* buffers, const size_t* sizes, size_t nb, BurstMeta<Burst>& out) noexcept {
+		size_t i = 0;
+		if(utils::Cpu::avx2()) {
+			for(; i + 8u <= nb; i += 8u) {
+				for(size_t j = i + 8u; j < std::min(i + 16u, nb); ++j) {
+					__builtin_prefetch(buffers[j]);
+				}
+				classify8_avx2(buffers + i, sizes + i, out, i);
+				for(size_t j = i; j < i + 8u; ++j) {
+					if(out.stack[j] & CLASS_QINQ) {
+						classify_one(buffers[j], sizes[j], out, j);
+					}
+				}
+			}
+		}
+		for(; i < nb; ++i) {
+			classify_one(buffers[i], sizes[i], out, i);
+		}
+	}
+
+	/**
+	 * Classify a burst of frames. Frame is expected to have pcapwrap::Frame like layout
+	 * with 'm_data' and 'm_hdr.caplen' members.
+	 */
+	template <typename Frame, size_t Burst>
+	static void classify(const Frame* frames, size_t nb, BurstMeta<Burst>& out) noexcept {
+		const uint8_t* buffers[Burst];
+		size_t sizes[Burst];
+		for(size_t i = 0; i < nb; ++i) {
+			buffers[i] = frames[i].m_data;
+			sizes[i] = frames[i].m_hdr.caplen;
+		}
+		classify(buffers, sizes, nb, out);
+	}
+
+	/**
+	 * The scalar path only. Gives exactly the same results as classify().
+	 */
+	template <size_t Burst>
+	static void classify_scalar(const uint8_t* const* buffers, const size_t* sizes, size_t nb, BurstMeta<Burst>& out) noexcept {
+		for(size_t i = 0; i < nb; ++i) {
+			classify_one(buffers[i], sizes[i], out, i);
+		}
+	}
+
+private:
+
+	static inline uint16_t load_be16(const uint8_t* ptr) noexcept {
+		uint16_t value;
+		memcpy(&value, ptr, sizeof(value));
+		return ntohs(value);
+	}
+
+	template <size_t Burst>
+	static void classify_one(const uint8_t* pkt, size_t len, BurstMeta<Burst>& out, size_t idx) noexcept {
+		uint8_t stack = 0;
+		uint8_t proto = 0;
+		size_t l3 = 0;
+		size_t l4 = 0;
+		uint16_t port_src = 0;
+		uint16_t port_dst = 0;
+
+		if(len >= sizeof(ethhdr)) {
+			uint16_t type = load_be16(pkt + 12u);
+			size_t offset = sizeof(ethhdr);
+			while(type == ETH_P_8021Q && len >= offset + 4u) {
+				stack |= (stack & CLASS_VLAN) ? CLASS_QINQ : CLASS_VLAN;
+				type = load_be16(pkt + offset + 2u);
+				offset += 4u;
+			}
+
+			if(type == ETH_P_IP && len >= offset + sizeof(IPv4::Header)) {
+				const uint8_t vihl = pkt[offset];
+				const size_t ihl = size_t(vihl & 0x0Fu) << 2u;
+				if((vihl >> 4u) == 4u && ihl >= sizeof(IPv4::Header) && len >= offset + ihl) {
+					stack |= CLASS_IPv4;
+					l3 = offset;
+					proto = pkt[offset + 9u];
+					if(load_be16(pkt + offset + 6u) & IPv4::FRAG_MASK) {
+						stack |= CLASS_FRAGMENT;
+					} else {
+						l4 = offset + ihl;
+					}
+				}
+			} else if(type == ETH_P_IPV6 && len >= offset + 40u) {
+				if((pkt[offset] >> 4u) == 6u) {
+					stack |= CLASS_IPv6;
+					l3 = offset;
+					proto = pkt[offset + 6u];
+					l4 = offset + 40u;
+				}
+			}
+
+			if(l4) {
+				if(proto == IPv4::PROTO_TCP && len >= l4 + 20u) {
+					stack |= CLASS_TCP;
+				} else if(proto == IPv4::PROTO_UDP && len >= l4 + 8u) {
+					stack |= CLASS_UDP;
+				} else if(proto == IPv4::PROTO_GRE && len >= l4 + 4u) {
+					stack |= CLASS_GRE;
+				} else {
+					l4 = 0;
+				}
+				if(stack & (CLASS_TCP | CLASS_UDP)) {
+					port_src = load_be16(pkt + l4);
+					port_dst = load_be16(pkt + l4 + 2u);
+				}
+			}
+		}
+
+		out.stack[idx] = stack;
+		out.ip_proto[idx] = proto;
+		out.off_l3[idx] = uint16_t(l3);
+		out.off_l4[idx] = uint16_t(l4);
+		out.port_src[idx] = port_src;
+		out.port_dst[idx] = port_dst;
+	}
+
+	// AVX2 section
+
+	/**
+	 * Gather a 32-bit word at @off offset of each of eight packets.
+	 * The lanes which are not set in @mask are not read and set to zero.
+	 */
+	__attribute__((target("avx2")))
+	static inline __m256i gather32(__m256i addr_lo, __m256i addr_hi, __m256i off, __m256i mask) noexcept {
+		const __m256i idx_lo = _mm256_add_epi64(addr_lo, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(off)));
+		const __m256i idx_hi = _mm256_add_epi64(addr_hi, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(off, 1)));
+		const __m128i lo = _mm256_mask_i64gather_epi32(
+			_mm_setzero_si128(), nullptr, idx_lo, _mm256_castsi256_si128(mask), 1);
+		const __m128i hi = _mm256_mask_i64gather_epi32(
+			_mm_setzero_si128(), nullptr, idx_hi, _mm256_extracti128_si256(mask, 1), 1);
+		return _mm256_set_m128i(hi, lo);
+	}
+
+	// a >= b for non negative 32-bit lanes
+	__attribute__((target("avx2")))
+	static inline __m256i ge32(__m256i a, __m256i b) noexcept {
+		return _mm256_or_si256(_mm256_cmpgt_epi32(a, b), _mm256_cmpeq_epi32(a, b));
+	}
+
+	__attribute__((target("avx2")))
+	static inline __m256i eq32(__m256i a, int b) noexcept {
+		return _mm256_cmpeq_epi32(a, _mm256_set1_epi32(b));
+	}
+
+	__attribute__((target("avx2")))
+	static inline __m256i select32(__m256i mask, int value) noexcept {
+		return _mm256_and_si256(mask, _mm256_set1_epi32(value));
+	}
+
+	__attribute__((target("avx2")))
+	static inline void store_u16(uint16_t* dst, __m256i value) noexcept {
+		const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(value, value), 0x08);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(packed));
+	}
+
+	__attribute__((target("avx2")))
+	static inline void store_u8(uint8_t* dst, __m256i value) noexcept {
+		const __m256i packed16 = _mm256_packus_epi32(value, value);
+		const __m256i packed8 = _mm256_packus_epi16(packed16, packed16);
+		const uint32_t lo = uint32_t(_mm256_extract_epi32(packed8, 0));
+		const uint32_t hi = uint32_t(_mm256_extract_epi32(packed8, 4));
+		memcpy(dst, &lo, sizeof(lo));
+		memcpy(dst + 4u, &hi, sizeof(hi));
+	}
+
+	template <size_t Burst>
+	__attribute__((target("avx2")))
+	static void classify8_avx2(const uint8_t* const* buffers, const size_t* sizes, BurstMeta<Burst>& out, size_t idx) noexcept {
+		alignas(32) uint32_t lens[8];
+		for(size_t i = 0; i < 8u; ++i) {
+			lens[i] = sizes[i] > 0xFFFFu ? 0xFFFFu : uint32_t(sizes[i]);
+		}
+
+		// byte swapping 16-bit words of each 32-bit lane into the low half of the lane
+		const __m256i be16_lo = _mm256_setr_epi8(
+			1, 0, -1, -1, 5, 4, -1, -1, 9, 8, -1, -1, 13, 12, -1, -1,
+			1, 0, -1, -1, 5, 4, -1, -1, 9, 8, -1, -1, 13, 12, -1, -1);
+		const __m256i be16_hi = _mm256_setr_epi8(
+			3, 2, -1, -1, 7, 6, -1, -1, 11, 10, -1, -1, 15, 14, -1, -1,
+			3, 2, -1, -1, 7, 6, -1, -1, 11, 10, -1, -1, 15, 14, -1, -1);
+
+		const __m256i len = _mm256_load_si256(reinterpret_cast<const __m256i*>(lens));
+		const __m256i addr_lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffers));
+		const __m256i addr_hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffers + 4u));
+		__m256i word;
+
+		// L2: the ethertype is the upper half of the word at offset 10
+		const __m256i m_eth = ge32(len, _mm256_set1_epi32(sizeof(ethhdr)));
+		word = gather32(addr_lo, addr_hi, _mm256_set1_epi32(10), m_eth);
+		__m256i type = _mm256_shuffle_epi8(word, be16_hi);
+
+		const __m256i m_vlan = _mm256_and_si256(
+			_mm256_and_si256(m_eth, eq32(type, ETH_P_8021Q)), ge32(len, _mm256_set1_epi32(18)));
+		word = gather32(addr_lo, addr_hi, _mm256_set1_epi32(14), m_vlan);
+		type = _mm256_blendv_epi8(type, _mm256_shuffle_epi8(word, be16_hi), m_vlan);
+		const __m256i m_qinq = _mm256_and_si256(m_vlan, eq32(type, ETH_P_8021Q));
+		const __m256i l3 = _mm256_add_epi32(_mm256_set1_epi32(sizeof(ethhdr)), select32(m_vlan, 4));
+
+		// L3
+		__m256i m_v4 = _mm256_and_si256(
+			eq32(type, ETH_P_IP), ge32(len, _mm256_add_epi32(l3, _mm256_set1_epi32(sizeof(IPv4::Header)))));
+		__m256i m_v6 = _mm256_and_si256(
+			eq32(type, ETH_P_IPV6), ge32(len, _mm256_add_epi32(l3, _mm256_set1_epi32(40))));
+		word = gather32(addr_lo, addr_hi, l3, _mm256_or_si256(m_v4, m_v6));
+		const __m256i version = _mm256_and_si256(_mm256_srli_epi32(word, 4), _mm256_set1_epi32(0x0F));
+		const __m256i ihl = _mm256_slli_epi32(_mm256_and_si256(word, _mm256_set1_epi32(0x0F)), 2);
+		m_v4 = _mm256_and_si256(m_v4, eq32(version, 4));
+		m_v4 = _mm256_and_si256(m_v4, ge32(ihl, _mm256_set1_epi32(sizeof(IPv4::Header))));
+		m_v4 = _mm256_and_si256(m_v4, ge32(len, _mm256_add_epi32(l3, ihl)));
+		m_v6 = _mm256_and_si256(m_v6, eq32(version, 6));
+		const __m256i m_ip = _mm256_or_si256(m_v4, m_v6);
+
+		// IPv4: frag_off, ttl, protocol; IPv6: next header, hop limit, source address
+		word = gather32(addr_lo, addr_hi, _mm256_add_epi32(l3, _mm256_set1_epi32(6)), m_ip);
+		__m256i proto = _mm256_blendv_epi8(
+			_mm256_and_si256(word, _mm256_set1_epi32(0xFF)), _mm256_srli_epi32(word, 24), m_v4);
+		proto = _mm256_and_si256(proto, m_ip);
+		const __m256i frag = _mm256_and_si256(_mm256_shuffle_epi8(word, be16_lo), _mm256_set1_epi32(IPv4::FRAG_MASK));
+		const __m256i m_frag = _mm256_andnot_si256(eq32(frag, 0), m_v4);
+
+		// L4
+		const __m256i l4 = _mm256_add_epi32(l3, _mm256_blendv_epi8(_mm256_set1_epi32(40), ihl, m_v4));
+		const __m256i m_l4 = _mm256_andnot_si256(m_frag, m_ip);
+		const __m256i m_tcp = _mm256_and_si256(
+			_mm256_and_si256(m_l4, eq32(proto, IPv4::PROTO_TCP)), ge32(len, _mm256_add_epi32(l4, _mm256_set1_epi32(20))));
+		const __m256i m_udp = _mm256_and_si256(
+			_mm256_and_si256(m_l4, eq32(proto, IPv4::PROTO_UDP)), ge32(len, _mm256_add_epi32(l4, _mm256_set1_epi32(8))));
+		const __m256i m_gre = _mm256_and_si256(
+			_mm256_and_si256(m_l4, eq32(proto, IPv4::PROTO_GRE)), ge32(len, _mm256_add_epi32(l4, _mm256_set1_epi32(4))));
+		const __m256i m_ports = _mm256_or_si256(m_tcp, m_udp);
+		word = gather32(addr_lo, addr_hi, l4, m_ports);
+
+		__m256i stack = select32(m_vlan, CLASS_VLAN);
+		stack = _mm256_or_si256(stack, select32(m_qinq, CLASS_QINQ));
+		stack = _mm256_or_si256(stack, select32(m_v4, CLASS_IPv4));
+		stack = _mm256_or_si256(stack, select32(m_v6, CLASS_IPv6));
+		stack = _mm256_or_si256(stack, select32(m_tcp, CLASS_TCP));
+		stack = _mm256_or_si256(stack, select32(m_udp, CLASS_UDP));
+		stack = _mm256_or_si256(stack, select32(m_gre, CLASS_GRE));
+		stack = _mm256_or_si256(stack, select32(m_frag, CLASS_FRAGMENT));
+
+		store_u8(out.stack + idx, stack);
+		store_u8(out.ip_proto + idx, proto);
+		store_u16(out.off_l3 + idx, _mm256_and_si256(l3, m_ip));
+		store_u16(out.off_l4 + idx, _mm256_and_si256(l4, _mm256_or_si256(m_ports, m_gre)));
+		store_u16(out.port_src + idx, _mm256_shuffle_epi8(word, be16_lo));
+		store_u16(out.port_dst + idx, _mm256_shuffle_epi8(word, be16_hi));
+	}
+
+};
+
+}; // namespace proto
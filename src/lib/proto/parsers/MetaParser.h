@@ -0,0 +1,348 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+
+#include "../proto.h"
+#include "../PacketMeta.h"
+#include "../mframe/MFrame.h"
+
+#include "../procotols/Ethernet.h"
+#include "../procotols/Vlan.h"
+#include "../procotols/IPv4.h"
+#include "../procotols/IPv6.h"
+#include "../procotols/Tcp.h"
+#include "../procotols/Udp.h"
+#include "../procotols/Gre.h"
+
+namespace proto {
+
+/**
+ * A compile-time set of protocols a parser is allowed to recognize.
+ */
+template <Protocol... Protocols>
+struct ProtocolSet {
+	static constexpr bool contains(Protocol proto) noexcept {
+		return ((proto == Protocols) || ...);
+	}
+};
+
+using ProtocolSetAll = ProtocolSet<
+	Protocol::L2_ETHERNET,
+	Protocol::L2_VLAN,
+	Protocol::L3_IPv4,
+	Protocol::L3_IPv6,
+	Protocol::L4_UDP,
+	Protocol::L4_TCP,
+	Protocol::L4_GRE
+>;
+
+/**
+ * MetaParser walks the protocol stack once and fills a PacketMeta descriptor.
+ * Unlike BasicHeaderParser it doesn't dispatch on the current protocol twice per layer,
+ * the layers are visited in the fixed L2 -> VLAN -> L3 -> L4 order.
+ * Protocols which are not in the Set are treated as an unknown payload,
+ * the code handling them is not compiled at all.
+ *
+ * Using sample:
+ * PacketMeta meta;
+ * if(MetaParser<>::parse_all(frame.m_data, frame.m_hdr.caplen, meta)) {
+ *     flow_table.find(meta.tuple);
+ * }
+ *
+ * A tunneled packet (GRE) is not followed, its payload offset points to the inner frame.
+ * The IPv4 fragments are not followed either, the FLAG_FRAGMENT flag is set instead.
+ */
+template <typename Set = ProtocolSetAll>
+class MetaParser {
+	using Frame_t = RoMFrame;
+
+public:
+	static constexpr size_t PREFETCH_DISTANCE = 4;
+
+	/**
+	 * Parse the whole protocol stack of a packet.
+	 * @param buffer - the first byte of the packet.
+	 * @param size_bytes - the packet length.
+	 * @param meta - a descriptor to fill.
+	 * @param proto_first - the protocol of the first header.
+	 * @return true - if the packet has a valid L3 header, i.e. meta.tuple is a valid flow key.
+	 */
+	template <typename Ptr>
+	static bool parse_all(
+		const Ptr* buffer
+		, size_t size_bytes
+		, PacketMeta& meta
+		, Protocol proto_first = Protocol::L2_ETHERNET
+	                     ) noexcept {
+		Frame_t frame(buffer, size_bytes);
+		meta.clear();
+		Protocol proto = enabled(proto_first);
+
+		if constexpr (Set::contains(Protocol::L2_ETHERNET)) {
+			if(proto == Protocol::L2_ETHERNET) {
+				proto = parse_ethernet(frame, meta);
+			}
+		}
+
+		if constexpr (Set::contains(Protocol::L2_VLAN)) {
+			while(proto == Protocol::L2_VLAN) {
+				proto = parse_vlan(frame, meta);
+			}
+		}
+
+		size_t l3_end = size_bytes;
+		switch(proto) {
+			case Protocol::L3_IPv4:
+				if constexpr (Set::contains(Protocol::L3_IPv4)) {
+					proto = parse_ipv4(frame, meta, l3_end);
+				}
+				break;
+			case Protocol::L3_IPv6:
+				if constexpr (Set::contains(Protocol::L3_IPv6)) {
+					proto = parse_ipv6(frame, meta, l3_end);
+				}
+				break;
+			default:
+				break;
+		}
+
+		switch(proto) {
+			case Protocol::L4_TCP:
+				if constexpr (Set::contains(Protocol::L4_TCP)) {
+					parse_tcp(frame, meta, l3_end);
+				}
+				break;
+			case Protocol::L4_UDP:
+				if constexpr (Set::contains(Protocol::L4_UDP)) {
+					parse_udp(frame, meta, l3_end);
+				}
+				break;
+			case Protocol::L4_GRE:
+				if constexpr (Set::contains(Protocol::L4_GRE)) {
+					parse_gre(frame, meta, l3_end);
+				}
+				break;
+			default:
+				break;
+		}
+
+		return meta.proto_l3 != Protocol::END;
+	}
+
+	/**
+	 * Parse a burst of packets.
+	 * @param buffers - an array of @nb packet pointers.
+	 * @param sizes - an array of @nb packet lengths.
+	 * @param metas - an array of @nb descriptors to fill.
+	 * @param nb - the burst size.
+	 * @return how many packets have a valid L3 header.
+	 */
+	template <typename Ptr>
+	static size_t parse_burst(
+		const Ptr* const* buffers
+		, const size_t* sizes
+		, PacketMeta* metas
+		, size_t nb
+	                         ) noexcept {
+		size_t result = 0;
+		for(size_t i = 0; i < nb; ++i) {
+			if(i + PREFETCH_DISTANCE < nb) {
+				__builtin_prefetch(buffers[i + PREFETCH_DISTANCE]);
+			}
+			result += parse_all(buffers[i], sizes[i], metas[i]);
+		}
+		return result;
+	}
+
+	/**
+	 * Parse a burst of frames. Frame is expected to have pcapwrap::Frame like layout
+	 * with 'm_data' and 'm_hdr.caplen' members.
+	 * @param frames - an array of @nb frames.
+	 * @param metas - an array of @nb descriptors to fill.
+	 * @param nb - the burst size.
+	 * @return how many packets have a valid L3 header.
+	 */
+	template <typename Frame>
+	static size_t parse_burst(const Frame* frames, PacketMeta* metas, size_t nb) noexcept {
+		size_t result = 0;
+		for(size_t i = 0; i < nb; ++i) {
+			if(i + PREFETCH_DISTANCE < nb) {
+				__builtin_prefetch(frames[i + PREFETCH_DISTANCE].m_data);
+			}
+			result += parse_all(frames[i].m_data, frames[i].m_hdr.caplen, metas[i]);
+		}
+		return result;
+	}
+
+private:
+
+	static inline constexpr Protocol enabled(Protocol proto) noexcept {
+		return Set::contains(proto) ? proto : Protocol::END;
+	}
+
+	static inline Protocol ethertype(uint16_t type) noexcept {
+		switch(type) {
+			case ETH_P_IP:
+				return enabled(Protocol::L3_IPv4);
+			case ETH_P_IPV6:
+				return enabled(Protocol::L3_IPv6);
+			case ETH_P_8021Q:
+				return enabled(Protocol::L2_VLAN);
+			default:
+				return Protocol::END;
+		}
+	}
+
+	static inline Protocol ip_protocol(uint8_t proto) noexcept {
+		switch(proto) {
+			case IPv4::PROTO_TCP:
+				return enabled(Protocol::L4_TCP);
+			case IPv4::PROTO_UDP:
+				return enabled(Protocol::L4_UDP);
+			case IPv4::PROTO_GRE:
+				return enabled(Protocol::L4_GRE);
+			default:
+				return Protocol::END;
+		}
+	}
+
+	static inline Protocol truncated(PacketMeta& meta) noexcept {
+		meta.flags |= PacketMeta::FLAG_TRUNCATED;
+		return Protocol::END;
+	}
+
+	static inline Protocol parse_ethernet(Frame_t& frame, PacketMeta& meta) noexcept {
+		if(not Ethernet::validate_header(frame)) {
+			return truncated(meta);
+		}
+		const Ethernet::Header* hdr;
+		meta.off_l2 = uint16_t(frame.offset());
+		meta.proto_l2 = Protocol::L2_ETHERNET;
+		frame.assign(hdr);
+		return ethertype(ntohs(hdr->h_proto));
+	}
+
+	static inline Protocol parse_vlan(Frame_t& frame, PacketMeta& meta) noexcept {
+		if(not Vlan::validate_header(frame)) {
+			return truncated(meta);
+		}
+		const Vlan::Header* hdr;
+		frame.assign_stay(hdr);
+		const auto offset = uint16_t(frame.offset());
+		if(meta.vlan_nb < PacketMeta::VLAN_DEPTH_MAX) {
+			meta.off_vlan[meta.vlan_nb] = offset;
+			meta.vlan_id[meta.vlan_nb] = uint16_t(ntohs(hdr->vlan_tci) & 0x0FFFu);
+			meta.vlan_nb++;
+		} else {
+			meta.flags |= PacketMeta::FLAG_VLAN_OVERFLOW;
+		}
+		if(meta.proto_l2 == Protocol::END) {
+			meta.off_l2 = offset;
+			meta.proto_l2 = Protocol::L2_VLAN;
+		}
+		frame.head_move(sizeof(Vlan::Header));
+		return ethertype(ntohs(hdr->nextProto));
+	}
+
+	static inline Protocol parse_ipv4(Frame_t& frame, PacketMeta& meta, size_t& l3_end) noexcept {
+		if(not IPv4::validate_header(frame)) {
+			return truncated(meta);
+		}
+		const IPv4::Header* hdr;
+		frame.assign_stay(hdr);
+		const size_t header_nb = IPv4::hdr_len(hdr);
+		if(header_nb < sizeof(IPv4::Header) || not frame.available(header_nb)) {
+			return truncated(meta);
+		}
+
+		meta.off_l3 = uint16_t(frame.offset());
+		meta.proto_l3 = Protocol::L3_IPv4;
+		meta.tuple.version = 4;
+		meta.tuple.proto = hdr->protocol;
+		meta.tuple.src.v4 = ntohl(hdr->saddr);
+		meta.tuple.dst.v4 = ntohl(hdr->daddr);
+		l3_end = frame.offset() + std::min(size_t(IPv4::pkt_len(hdr)), frame.available());
+		frame.head_move(header_nb);
+
+		if(IPv4::fragmented(hdr)) {
+			meta.flags |= PacketMeta::FLAG_FRAGMENT;
+			meta.off_payload = uint16_t(frame.offset());
+			meta.len_payload = uint16_t(l3_end > frame.offset() ? l3_end - frame.offset() : 0);
+			return Protocol::END;
+		}
+		return ip_protocol(hdr->protocol);
+	}
+
+	static inline Protocol parse_ipv6(Frame_t& frame, PacketMeta& meta, size_t& l3_end) noexcept {
+		if(not IPv6::validate_header(frame)) {
+			return truncated(meta);
+		}
+		const IPv6::Header* hdr;
+		frame.assign_stay(hdr);
+
+		meta.off_l3 = uint16_t(frame.offset());
+		meta.proto_l3 = Protocol::L3_IPv6;
+		meta.tuple.version = 6;
+		meta.tuple.proto = hdr->next_header;
+		meta.tuple.src.v6 = hdr->src;
+		meta.tuple.dst.v6 = hdr->dst;
+		l3_end = frame.offset() + std::min(ntohs(hdr->payload_len) + sizeof(IPv6::Header), frame.available());
+		frame.head_move(sizeof(IPv6::Header));
+		return ip_protocol(hdr->next_header);
+	}
+
+	static inline void parse_tcp(Frame_t& frame, PacketMeta& meta, size_t l3_end) noexcept {
+		if(not Tcp::validate_header(frame)) {
+			truncated(meta);
+			return;
+		}
+		const Tcp::Header* hdr;
+		frame.assign_stay(hdr);
+		const size_t header_nb = Tcp::hdr_len(hdr);
+		if(header_nb < sizeof(Tcp::Header)) {
+			truncated(meta);
+			return;
+		}
+		meta.off_l4 = uint16_t(frame.offset());
+		meta.proto_l4 = Protocol::L4_TCP;
+		meta.tuple.port_src = ntohs(hdr->src);
+		meta.tuple.port_dst = ntohs(hdr->dst);
+		frame.head_move(header_nb);
+		set_payload(frame, meta, l3_end);
+	}
+
+	static inline void parse_udp(Frame_t& frame, PacketMeta& meta, size_t l3_end) noexcept {
+		if(not Udp::validate_header(frame)) {
+			truncated(meta);
+			return;
+		}
+		const Udp::Header* hdr;
+		meta.off_l4 = uint16_t(frame.offset());
+		meta.proto_l4 = Protocol::L4_UDP;
+		frame.assign(hdr);
+		meta.tuple.port_src = ntohs(hdr->source);
+		meta.tuple.port_dst = ntohs(hdr->dest);
+		set_payload(frame, meta, l3_end);
+	}
+
+	static inline void parse_gre(Frame_t& frame, PacketMeta& meta, size_t l3_end) noexcept {
+		if(not Gre::validate_header(frame)) {
+			truncated(meta);
+			return;
+		}
+		meta.off_l4 = uint16_t(frame.offset());
+		meta.proto_l4 = Protocol::L4_GRE;
+		frame.head_move(Gre::length_header(frame));
+		set_payload(frame, meta, l3_end);
+	}
+
+	static inline void set_payload(const Frame_t& frame, PacketMeta& meta, size_t l3_end) noexcept {
+		meta.off_payload = uint16_t(frame.offset());
+		meta.len_payload = uint16_t(l3_end > frame.offset() ? l3_end - frame.offset() : 0);
+	}
+
+};
+
+}; // namespace proto
@@ -5,6 +5,7 @@
 #include <cstring>
 
 #include "../proto.h"
+#include "../Checksum.h"
 
 namespace proto {
 
@@ -193,45 +194,28 @@ public:
 		return htonl(addr_host(b0, b1, b2, b3));
 	}
 
+	/**
+	 * Compute the header checksum and store it.
+	 * @return The checksum in host byte order.
+	 */
 	static inline uint16_t update_checksum(Header* hdr) noexcept {
-		const auto len_header = u_int16_t(hdr->ihl << 2u);
 		hdr->check = 0;
-		const auto check_summ = calc_checksum(hdr, len_header);
-		hdr->check = htons(check_summ);
-		return check_summ;
+		hdr->check = Checksum::finish(Checksum::sum(hdr, hdr_len(hdr)));
+		return ntohs(hdr->check);
 	}
 
-private:
-
-	static uint16_t calc_checksum(const void* vdata, size_t length) noexcept {
-		// Cast the data pointer to one that can be indexed.
-		auto data = (const char*) vdata;
-
-		// Initialise the accumulator.
-		uint32_t acc = 0xffff;
-
-		// Handle complete 16-bit blocks.
-		for(size_t i = 0; i + 1 < length; i += 2) {
-			uint16_t word;
-			memcpy(&word, data + i, 2);
-			acc += ntohs(word);
-			if(acc > 0xffff) {
-				acc -= 0xffff;
-			}
-		}
-
-		// Handle any partial block at the end of the data.
-		if(length & 1) {
-			uint16_t word = 0;
-			memcpy(&word, data + length - 1, 1);
-			acc += ntohs(word);
-			if(acc > 0xffff) {
-				acc -= 0xffff;
-			}
-		}
+	/**
+	 * @return true - if the header checksum is valid.
+	 */
+	static inline bool verify_checksum(const Header* hdr) noexcept {
+		return Checksum::valid(Checksum::sum(hdr, hdr_len(hdr)));
+	}
 
-		// Return the checksum in addr byte order.
-		return uint16_t(~acc);
+	/**
+	 * @return The pseudo-header partial sum for the L4 checksum.
+	 */
+	static inline uint64_t pseudo_sum(const Header* hdr) noexcept {
+		return Checksum::pseudo_v4(hdr->saddr, hdr->daddr, hdr->protocol, payload_len(hdr));
 	}
 
 };
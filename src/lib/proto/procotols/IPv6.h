@@ -4,6 +4,7 @@
 #include <cstring>
 
 #include "../proto.h"
+#include "../Checksum.h"
 
 namespace proto {
 
@@ -126,6 +127,14 @@ public:
 		return ntohs(hdr->payload_len);
 	}
 
+	/**
+	 * @return The pseudo-header partial sum for the L4 checksum,
+	 * the upper-layer header MUST follow the fixed header.
+	 */
+	static inline uint64_t pseudo_sum(const Header* hdr) noexcept {
+		return Checksum::pseudo_v6(&hdr->src, &hdr->dst, hdr->next_header, ntohs(hdr->payload_len));
+	}
+
 };
 
 }; // namespace proto
@@ -4,6 +4,7 @@
 #include <netinet/udp.h>
 
 #include "../proto.h"
+#include "../Checksum.h"
 
 namespace proto {
 
@@ -87,6 +88,24 @@ public:
 		return uint16_t(hdr->data_offset << 2u);
 	}
 
+	/**
+	 * Compute the checksum and store it.
+	 * @param hdr - the header followed by the payload.
+	 * @param size - the header and the payload length.
+	 * @param pseudo - the pseudo-header partial sum, see IPv4::pseudo_sum() and IPv6::pseudo_sum().
+	 */
+	static inline void update_checksum(Header* hdr, size_t size, uint64_t pseudo) noexcept {
+		hdr->crc = 0;
+		hdr->crc = Checksum::finish(Checksum::sum(hdr, size, pseudo));
+	}
+
+	/**
+	 * @return true - if the checksum is valid.
+	 */
+	static inline bool verify_checksum(const Header* hdr, size_t size, uint64_t pseudo) noexcept {
+		return Checksum::valid(Checksum::sum(hdr, size, pseudo));
+	}
+
 };
 
 }; // namespace proto
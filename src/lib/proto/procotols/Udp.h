@@ -4,6 +4,7 @@
 #include <netinet/udp.h>
 
 #include "../proto.h"
+#include "../Checksum.h"
 
 namespace proto {
 
@@ -55,6 +56,28 @@ public:
 		return ntohs(hdr->len) - sizeof(Header);
 	}
 
+	/**
+	 * Compute the checksum and store it.
+	 * @param hdr - the header followed by the payload.
+	 * @param size - the header and the payload length.
+	 * @param pseudo - the pseudo-header partial sum, see IPv4::pseudo_sum() and IPv6::pseudo_sum().
+	 */
+	static inline void update_checksum(Header* hdr, size_t size, uint64_t pseudo) noexcept {
+		hdr->check = 0;
+		hdr->check = Checksum::finish(Checksum::sum(hdr, size, pseudo));
+		// zero means "no checksum" for UDP, so it is transmitted as all ones
+		if(hdr->check == 0) {
+			hdr->check = 0xFFFF;
+		}
+	}
+
+	/**
+	 * @return true - if the checksum is valid.
+	 */
+	static inline bool verify_checksum(const Header* hdr, size_t size, uint64_t pseudo) noexcept {
+		return Checksum::valid(Checksum::sum(hdr, size, pseudo));
+	}
+
 };
 
 }; // namespace proto
@@ -0,0 +1,424 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "IPv4ReassemblerStat.h"
+#include "../mframe/MFrame.h"
+#include "../procotols/IPv4.h"
+#include "intrusive/HashQueuePool.h"
+
+namespace proto {
+
+/**
+ * IPv4Reassembler collects IPv4 fragments into datagrams.
+ *
+ * All the memory is preallocated by allocate(): a HashQueuePool of datagram contexts
+ * and a buffer slot of datagram_max bytes per context. A fragment payload is copied
+ * once straight to its final position in the slot, so a completed datagram is
+ * a contiguous area with no second copy.
+ * The received data is tracked with a small array of hole descriptors (RFC 815).
+ *
+ * Overload behaviour:
+ * - if there are no free contexts, the oldest datagram is evicted;
+ * - a datagram with more than HOLES_MAX holes or bigger than datagram_max is dropped;
+ * - a fragment partially overlapping the received data drops the whole datagram
+ *   (no guessing which copy is right, see RFC 5722 for the same policy in IPv6);
+ * - a fragment fully covered by the received data is ignored as a duplicate.
+ *
+ * Using sample:
+ * RoMFrame datagram(static_cast<const uint8_t*>(nullptr), 0);
+ * if(reassembler.push(ip_hdr, ip_len, now_ns, datagram) == IPv4Reassembler::COMPLETE) {
+ *     HeaderParser parser(datagram.head(), datagram.available(), Protocol::L3_IPv4);
+ *     ...
+ * }
+ * reassembler.expire(now_ns);
+ */
+class IPv4Reassembler {
+public:
+	static constexpr size_t HOLES_MAX = 16;
+	static constexpr size_t HEADER_MAX = 60;
+
+	struct Key {
+		IPv4::Addr src;
+		IPv4::Addr dst;
+		uint16_t id;
+		uint8_t proto;
+		uint8_t reserved;
+
+		bool operator==(const Key& rv) const noexcept {
+			return src == rv.src && dst == rv.dst && id == rv.id && proto == rv.proto;
+		}
+
+		struct Hash {
+			inline size_t operator()(const Key& key) const noexcept {
+				uint64_t result = (uint64_t(key.src) << 32u) | key.dst;
+				result ^= (uint64_t(key.id) << 8u | key.proto) * 0x9E3779B97F4A7C15ull;
+				result *= 0xFF51AFD7ED558CCDull;
+				result ^= result >> 32u;
+				return size_t(result);
+			}
+		};
+	};
+
+	enum Result {
+		NOT_FRAGMENT, // the packet is not a fragment, nothing has been done
+		IN_PROGRESS, // the fragment has been stored
+		COMPLETE, // the datagram has been reassembled
+		DUPLICATE, // the fragment has been ignored
+		DROPPED // the fragment has been dropped, maybe along with its datagram
+	};
+
+private:
+
+	struct Hole {
+		uint32_t first;
+		uint32_t last; // not included
+	};
+
+	struct Datagram {
+		uint64_t time_first; // the time of the first fragment
+		uint8_t* slot;
+		uint32_t total; // the payload length, 0 until the last fragment has arrived
+		uint32_t end_max;
+		uint16_t ihl;
+		uint16_t holes_nb;
+		Hole holes[HOLES_MAX];
+
+		Datagram() noexcept : time_first(0), slot(nullptr), total(0), end_max(0), ihl(0), holes_nb(0), holes() {}
+	};
+
+	using Node_t = intrusive::HashQueuePoolNode<Key, Datagram>;
+	using Pool_t = intrusive::HashQueuePool<Node_t, Key::Hash>;
+	using Iterator_t = Pool_t::Iterator_t;
+	using Header_t = IPv4::Header;
+
+	static constexpr uint32_t HOLE_INFINITY = 0xFFFFFFFFu;
+
+	Pool_t m_pool;
+	const size_t m_capacity;
+	const size_t m_payload_max;
+	const size_t m_slot_bytes;
+	const uint64_t m_timeout;
+	uint8_t* m_slots;
+	uint8_t** m_slots_freed;
+	size_t m_slots_freed_nb;
+	Iterator_t m_completed;
+	std::allocator<uint8_t> m_allocator;
+	std::allocator<uint8_t*> m_allocator_freed;
+	IPv4ReassemblerStat m_stat;
+
+public:
+
+	/**
+	 * @param capacity - the maximum number of datagrams being reassembled at once.
+	 * @param datagram_max - the maximum size of a reassembled datagram including the IPv4 header.
+	 * @param timeout - the reassembly timeout since the first fragment of a datagram, in the units of 'now'.
+	 * @param load_factor - the load factor of the context hash map.
+	 */
+	IPv4Reassembler(unsigned capacity, size_t datagram_max, uint64_t timeout, float load_factor = 0.7f) noexcept
+		: m_pool(capacity, load_factor)
+		, m_capacity(capacity)
+		, m_payload_max(datagram_max > sizeof(Header_t) ? datagram_max - sizeof(Header_t) : 0)
+		, m_slot_bytes(HEADER_MAX + m_payload_max)
+		, m_timeout(timeout)
+		, m_slots(nullptr)
+		, m_slots_freed(nullptr)
+		, m_slots_freed_nb(0)
+		, m_completed()
+		, m_allocator()
+		, m_allocator_freed()
+		, m_stat() {
+		m_stat.capacity = capacity;
+	}
+
+	IPv4Reassembler(const IPv4Reassembler&) = delete;
+	IPv4Reassembler& operator=(const IPv4Reassembler&) = delete;
+
+	IPv4Reassembler(IPv4Reassembler&&) = delete;
+	IPv4Reassembler& operator=(IPv4Reassembler&&) = delete;
+
+	~IPv4Reassembler() noexcept {
+		destroy();
+	}
+
+	/**
+	 * Allocate the contexts and the datagram buffers.
+	 * @return 0 - if the storage has been allocated successfully.
+	 */
+	int allocate() noexcept {
+		if(m_slots || m_capacity == 0 || m_payload_max == 0)
+			return -1;
+
+		if(m_pool.allocate())
+			return -1;
+
+		m_slots = m_allocator.allocate(m_capacity * m_slot_bytes);
+		m_slots_freed = m_allocator_freed.allocate(m_capacity);
+		if(m_slots == nullptr || m_slots_freed == nullptr) {
+			destroy();
+			return -1;
+		}
+		for(size_t i = 0; i < m_capacity; ++i) {
+			m_slots_freed[i] = m_slots + i * m_slot_bytes;
+		}
+		m_slots_freed_nb = m_capacity;
+		return 0;
+	}
+
+	/**
+	 * Process an IPv4 packet.
+	 * @param ip_packet - the IPv4 header of the packet.
+	 * @param size_bytes - the packet length from the IPv4 header to the end of the frame.
+	 * @param now - the current time.
+	 * @param datagram - the reassembled datagram starting with the IPv4 header if the result is COMPLETE.
+	 * The datagram stays valid until the next call of push(), expire() or reset().
+	 * @return The result of processing.
+	 */
+	template <typename Ptr>
+	Result push(const Ptr* ip_packet, size_t size_bytes, uint64_t now, RoMFrame& datagram) noexcept {
+		release_completed();
+
+		const auto pkt = reinterpret_cast<const uint8_t*>(ip_packet);
+		if(size_bytes < sizeof(Header_t)) {
+			return NOT_FRAGMENT;
+		}
+		const Header_t* hdr = reinterpret_cast<const Header_t*>(pkt);
+		if(not IPv4::fragmented(hdr)) {
+			return NOT_FRAGMENT;
+		}
+
+		const uint32_t hdr_len = IPv4::hdr_len(hdr);
+		const uint32_t pkt_len = IPv4::pkt_len(hdr);
+		const uint32_t first = IPv4::offset(hdr);
+		const bool more = IPv4::flag_mf(hdr);
+		if(hdr_len < sizeof(Header_t) || pkt_len <= hdr_len || pkt_len > size_bytes
+			|| (more && ((pkt_len - hdr_len) & 7u))) {
+			m_stat.drops_malformed++;
+			return DROPPED;
+		}
+		const uint32_t last = first + pkt_len - hdr_len;
+
+		const Key key{ntohl(hdr->saddr), ntohl(hdr->daddr), ntohs(hdr->id), hdr->protocol, 0};
+		Iterator_t it = m_pool.find(key);
+		// checked before create(), a forged fragment must not evict a datagram of the full pool
+		if(last > m_payload_max) {
+			m_stat.drops_too_big++;
+			if(it) {
+				release(it);
+			}
+			return DROPPED;
+		}
+		if(not it) {
+			it = create(key, now);
+		}
+		Datagram& dgram = it->value;
+
+		// the fragment must lie in one hole entirely
+		size_t hole_idx = HOLES_MAX;
+		for(size_t i = 0; i < dgram.holes_nb; ++i) {
+			const Hole& hole = dgram.holes[i];
+			if(hole.first <= first && last <= hole.last) {
+				hole_idx = i;
+				break;
+			} else if(first < hole.last && last > hole.first) {
+				return drop_overlap(it);
+			}
+		}
+
+		if(not more) {
+			if((dgram.total && dgram.total != last) || dgram.end_max > last) {
+				return drop_overlap(it);
+			}
+		} else if(dgram.total && last > dgram.total) {
+			return drop_overlap(it);
+		}
+
+		if(hole_idx == HOLES_MAX) {
+			m_stat.duplicates++;
+			return DUPLICATE;
+		}
+
+		if(not split(dgram, hole_idx, first, last)) {
+			m_stat.drops_holes++;
+			release(it);
+			return DROPPED;
+		}
+		if(not more) {
+			dgram.total = last;
+			trim(dgram, last);
+		}
+		if(last > dgram.end_max) {
+			dgram.end_max = last;
+		}
+
+		memcpy(dgram.slot + HEADER_MAX + first, pkt + hdr_len, last - first);
+		if(first == 0) {
+			dgram.ihl = uint16_t(hdr_len);
+			memcpy(dgram.slot + HEADER_MAX - hdr_len, pkt, hdr_len);
+		}
+		m_stat.fragments++;
+
+		if(dgram.holes_nb == 0) {
+			if(dgram.ihl + dgram.total > 0xFFFFu) {
+				m_stat.drops_too_big++;
+				release(it);
+				return DROPPED;
+			}
+			complete(it, datagram);
+			return COMPLETE;
+		}
+		return IN_PROGRESS;
+	}
+
+	/**
+	 * Drop the datagrams waiting for their fragments longer than the timeout.
+	 * @param now - the current time.
+	 */
+	void expire(uint64_t now) noexcept {
+		release_completed();
+		Iterator_t it = m_pool.peek_front();
+		while(it && it->value.time_first + m_timeout < now) {
+			m_stat.timeouts++;
+			release(it);
+			it = m_pool.peek_front();
+		}
+	}
+
+	/**
+	 * Drop all the datagrams.
+	 */
+	void reset() noexcept {
+		release_completed();
+		Iterator_t it = m_pool.peek_front();
+		while(it) {
+			release(it);
+			it = m_pool.peek_front();
+		}
+	}
+
+	inline size_t size() const noexcept {
+		return m_pool.size();
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_capacity;
+	}
+
+	inline size_t storage_bytes() noexcept {
+		return m_pool.storage_bytes() + m_capacity * (m_slot_bytes + sizeof(uint8_t*));
+	}
+
+	inline const IPv4ReassemblerStat& stat() noexcept {
+		m_stat.size = m_pool.size();
+		return m_stat;
+	}
+
+private:
+
+	Iterator_t create(const Key& key, uint64_t now) noexcept {
+		if(m_pool.available() == 0) {
+			m_stat.evictions++;
+			release(m_pool.peek_front());
+		}
+		Iterator_t it = m_pool.push_back(key);
+		Datagram& dgram = it->value;
+		dgram.time_first = now;
+		dgram.slot = m_slots_freed[--m_slots_freed_nb];
+		dgram.total = 0;
+		dgram.end_max = 0;
+		dgram.ihl = 0;
+		dgram.holes_nb = 1;
+		dgram.holes[0] = Hole{0, HOLE_INFINITY};
+		return it;
+	}
+
+	void release(Iterator_t it) noexcept {
+		m_slots_freed[m_slots_freed_nb++] = it->value.slot;
+		it->value.slot = nullptr;
+		m_pool.remove(it);
+	}
+
+	inline void release_completed() noexcept {
+		if(m_completed) {
+			release(m_completed);
+			m_completed = Iterator_t();
+		}
+	}
+
+	Result drop_overlap(Iterator_t it) noexcept {
+		m_stat.overlaps++;
+		release(it);
+		return DROPPED;
+	}
+
+	/**
+	 * Fill [first, last) range of the hole.
+	 * @return false - if there is no room for a new hole descriptor.
+	 */
+	static bool split(Datagram& dgram, size_t idx, uint32_t first, uint32_t last) noexcept {
+		const Hole hole = dgram.holes[idx];
+		const bool left = hole.first < first;
+		const bool right = last < hole.last;
+		if(left && right) {
+			if(dgram.holes_nb == HOLES_MAX) {
+				return false;
+			}
+			memmove(dgram.holes + idx + 1, dgram.holes + idx, (dgram.holes_nb - idx) * sizeof(Hole));
+			dgram.holes[idx] = Hole{hole.first, first};
+			dgram.holes[idx + 1] = Hole{last, hole.last};
+			dgram.holes_nb++;
+		} else if(left) {
+			dgram.holes[idx].last = first;
+		} else if(right) {
+			dgram.holes[idx].first = last;
+		} else {
+			memmove(dgram.holes + idx, dgram.holes + idx + 1, (dgram.holes_nb - idx - 1) * sizeof(Hole));
+			dgram.holes_nb--;
+		}
+		return true;
+	}
+
+	/**
+	 * Cut the holes at the end of the datagram payload.
+	 */
+	static void trim(Datagram& dgram, uint32_t total) noexcept {
+		while(dgram.holes_nb && dgram.holes[dgram.holes_nb - 1].first >= total) {
+			dgram.holes_nb--;
+		}
+		if(dgram.holes_nb && dgram.holes[dgram.holes_nb - 1].last > total) {
+			dgram.holes[dgram.holes_nb - 1].last = total;
+		}
+	}
+
+	void complete(Iterator_t it, RoMFrame& datagram) noexcept {
+		const Datagram& dgram = it->value;
+		uint8_t* begin = dgram.slot + HEADER_MAX - dgram.ihl;
+		Header_t* hdr = reinterpret_cast<Header_t*>(begin);
+		hdr->tot_len = htons(uint16_t(dgram.ihl + dgram.total));
+		hdr->frag_off &= htons(IP_DF);
+		IPv4::update_checksum(hdr);
+
+		datagram = RoMFrame(begin, dgram.ihl + dgram.total);
+		m_completed = it;
+		m_stat.completed++;
+	}
+
+	void destroy() noexcept {
+		if(m_slots) {
+			m_allocator.deallocate(m_slots, m_capacity * m_slot_bytes);
+			m_slots = nullptr;
+		}
+		if(m_slots_freed) {
+			m_allocator_freed.deallocate(m_slots_freed, m_capacity);
+			m_slots_freed = nullptr;
+		}
+		m_slots_freed_nb = 0;
+		m_completed = Iterator_t();
+	}
+
+};
+
+}; // namespace proto
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+
+namespace proto {
+
+struct IPv4ReassemblerStat {
+	size_t capacity = 0;
+	size_t size = 0;
+	uint64_t fragments = 0; // fragments accepted
+	uint64_t completed = 0; // datagrams reassembled
+	uint64_t duplicates = 0; // fragments fully covered by already received data
+	uint64_t timeouts = 0; // datagrams expired
+	uint64_t overlaps = 0; // datagrams dropped because of partially overlapping or conflicting fragments
+	uint64_t evictions = 0; // datagrams dropped to make room for a new one
+	uint64_t drops_malformed = 0; // fragments with an invalid length or offset
+	uint64_t drops_too_big = 0; // datagrams dropped because of exceeding the datagram size limit
+	uint64_t drops_holes = 0; // datagrams dropped because of too many holes
+
+	static void print_field(FILE* out, const char* name, uint64_t value, uint64_t value_prev) noexcept {
+		fprintf(out, "%s=%zu(%zu) ", name, size_t(value), size_t(value - value_prev));
+	}
+
+	void print(FILE* out, const IPv4ReassemblerStat& prev) const noexcept {
+		float load_factor = (static_cast<float>(size) / capacity) * 100.0f;
+		fprintf(out, "[IP4R] ");
+		fprintf(out, "%zu/%zu (%.2f%%) ", size, capacity, load_factor);
+		print_field(out, "frags", fragments, prev.fragments);
+		print_field(out, "done", completed, prev.completed);
+		print_field(out, "dup", duplicates, prev.duplicates);
+		print_field(out, "tmout", timeouts, prev.timeouts);
+		print_field(out, "ovlp", overlaps, prev.overlaps);
+		print_field(out, "evict", evictions, prev.evictions);
+		print_field(out, "malf", drops_malformed, prev.drops_malformed);
+		print_field(out, "big", drops_too_big, prev.drops_too_big);
+		print_field(out, "holes", drops_holes, prev.drops_holes);
+	}
+};
+
+}; // namespace proto
@@ -0,0 +1,477 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "TcpStreamTableStat.h"
+#include "../PacketMeta.h"
+#include "../procotols/Tcp.h"
+#include "intrusive/HashQueuePool.h"
+
+namespace proto {
+
+/**
+ * TcpStreamTable tracks TCP connections and turns their segments into ordered byte streams.
+ *
+ * A connection is keyed by its canonical FiveTuple, both directions share one flow.
+ * The flows live in a preallocated HashQueuePool queue. A packet doesn't reorder the queue,
+ * it only updates the flow time. expire() gives the active flows at the front of the queue
+ * a second chance by moving them to the back, so a flow is moved at most once per timeout
+ * and the per-packet path touches no other flows.
+ *
+ * In-order payload is delivered straight from the packet buffer without copying.
+ * Out-of-order payload is copied to fixed-size segments taken from a preallocated
+ * segment pool shared by all the flows. The amount of buffered bytes per direction is
+ * limited: when the limit is reached, the missing data is skipped (a gap)
+ * and the buffered data is delivered.
+ * Overlapping data is resolved in favor of the data seen first.
+ *
+ * The Handler is called back with:
+ * void on_data(const FiveTuple& tuple, Flow& flow, const uint8_t* data, size_t size) noexcept;
+ * void on_close(const FiveTuple& key, Flow& flow, Close reason) noexcept;
+ * where 'tuple' is the direction of the data and 'key' is the canonical tuple of the flow.
+ *
+ * Using sample:
+ * PacketMeta meta;
+ * if(MetaParser<>::parse_all(frame.m_data, frame.m_hdr.caplen, meta)) {
+ *     table.push(frame.m_data, meta, now);
+ * }
+ * table.expire(now);
+ */
+template <typename Handler>
+class TcpStreamTable {
+public:
+	static constexpr size_t SEGMENT_DATA = 1520;
+
+	enum Close : uint8_t {
+		FINISHED, // both directions have sent FIN and all the data has been delivered
+		RESET, // RST has been seen
+		TIMEOUT, // the flow has been idle for too long
+		EVICTED, // the flow has been dropped to make room for a new one
+		CLEARED // reset() has been called
+	};
+
+private:
+	struct Segment;
+
+public:
+
+	struct Direction {
+		static constexpr uint8_t FLAG_SEQ = 0x01; // seq_next is valid
+		static constexpr uint8_t FLAG_SYN = 0x02;
+		static constexpr uint8_t FLAG_FIN = 0x04; // FIN has been seen, seq_fin is valid
+		static constexpr uint8_t FLAG_DONE = 0x08; // all the data up to FIN has been delivered
+
+		Segment* ooo; // out-of-order segments sorted by seq
+		uint32_t seq_next; // the next sequence number to deliver
+		uint32_t seq_fin;
+		uint32_t ooo_bytes;
+		uint8_t flags;
+	};
+
+	struct Flow {
+		Direction dir[2]; // [0] - from the canonical tuple source, [1] - the reverse
+		uint64_t time_last;
+		uint64_t time_queued; // the time the flow has been put to the back of the queue
+		uint64_t user; // opaque to the table
+	};
+
+private:
+
+	struct Segment {
+		Segment* next;
+		uint32_t seq;
+		uint32_t size;
+		uint8_t data[SEGMENT_DATA];
+	};
+
+	using Node_t = intrusive::HashQueuePoolNode<FiveTuple, Flow>;
+	using Pool_t = intrusive::HashQueuePool<Node_t, FiveTuple::Hash>;
+	using Iterator_t = typename Pool_t::Iterator_t;
+
+	Handler& m_handler;
+	Pool_t m_pool;
+	const size_t m_segments_capacity;
+	const uint32_t m_ooo_max;
+	const uint64_t m_timeout;
+	Segment* m_segments;
+	Segment* m_segments_freed;
+	size_t m_segments_used;
+	std::allocator<Segment> m_allocator;
+	TcpStreamTableStat m_stat;
+
+public:
+
+	/**
+	 * @param handler - the stream events handler.
+	 * @param capacity - the maximum number of flows.
+	 * @param segments - the number of out-of-order segments shared by all the flows.
+	 * @param ooo_max - the maximum out-of-order bytes buffered per direction of a flow.
+	 * @param timeout - the idle timeout of a flow, in the units of 'now'.
+	 * @param load_factor - the load factor of the flow hash map.
+	 */
+	TcpStreamTable(Handler& handler, unsigned capacity, size_t segments, uint32_t ooo_max, uint64_t timeout, float load_factor = 0.7f) noexcept
+		: m_handler(handler)
+		, m_pool(capacity, load_factor)
+		, m_segments_capacity(segments)
+		, m_ooo_max(ooo_max)
+		, m_timeout(timeout)
+		, m_segments(nullptr)
+		, m_segments_freed(nullptr)
+		, m_segments_used(0)
+		, m_allocator()
+		, m_stat() {
+		m_stat.capacity = capacity;
+		m_stat.segments_capacity = segments;
+	}
+
+	TcpStreamTable(const TcpStreamTable&) = delete;
+	TcpStreamTable& operator=(const TcpStreamTable&) = delete;
+
+	TcpStreamTable(TcpStreamTable&&) = delete;
+	TcpStreamTable& operator=(TcpStreamTable&&) = delete;
+
+	~TcpStreamTable() noexcept {
+		destroy();
+	}
+
+	/**
+	 * Allocate the flows and the segments.
+	 * @return 0 - if the storage has been allocated successfully.
+	 */
+	int allocate() noexcept {
+		if(m_segments)
+			return -1;
+
+		if(m_pool.allocate())
+			return -1;
+
+		if(m_segments_capacity) {
+			m_segments = m_allocator.allocate(m_segments_capacity);
+			if(m_segments == nullptr)
+				return -1;
+			for(size_t i = 0; i < m_segments_capacity; ++i) {
+				m_segments[i].next = (i + 1 < m_segments_capacity) ? m_segments + i + 1 : nullptr;
+			}
+			m_segments_freed = m_segments;
+		}
+		return 0;
+	}
+
+	/**
+	 * Process a packet.
+	 * @param frame - the same buffer the descriptor has been filled with.
+	 * @param meta - the packet descriptor.
+	 * @param now - the current time.
+	 * @return false - if the packet is not a TCP segment or doesn't belong to a flow.
+	 */
+	template <typename Ptr>
+	bool push(const Ptr* frame, const PacketMeta& meta, uint64_t now) noexcept {
+		if(meta.proto_l4 != Protocol::L4_TCP) {
+			return false;
+		}
+		const Tcp::Header* hdr;
+		PacketMeta::assign(frame, meta.off_l4, hdr);
+
+		const bool canonical = meta.tuple.canonical();
+		const FiveTuple key = canonical ? meta.tuple : meta.tuple.reverse();
+		Iterator_t it = m_pool.find(key);
+		if(not it) {
+			if(hdr->flag_rst) {
+				return false;
+			}
+			it = create(key, now);
+		}
+		Flow& flow = it->value;
+		flow.time_last = now;
+
+		if(hdr->flag_rst) {
+			m_stat.resets++;
+			close(it, RESET);
+			return true;
+		}
+
+		Direction& dir = flow.dir[canonical ? 0 : 1];
+		uint32_t seq = ntohl(hdr->seq_num);
+		if(hdr->flag_syn) {
+			if(not (dir.flags & Direction::FLAG_SYN)) {
+				dir.flags |= Direction::FLAG_SYN | Direction::FLAG_SEQ;
+				dir.seq_next = seq + 1u;
+			}
+			seq++;
+		} else if(not (dir.flags & Direction::FLAG_SEQ)) {
+			// the connection is picked up in the middle
+			dir.flags |= Direction::FLAG_SEQ;
+			dir.seq_next = seq;
+		}
+
+		if(hdr->flag_fin && not (dir.flags & Direction::FLAG_FIN)) {
+			dir.flags |= Direction::FLAG_FIN;
+			dir.seq_fin = seq + meta.len_payload;
+		}
+
+		const uint8_t* data = reinterpret_cast<const uint8_t*>(frame) + meta.off_payload;
+		if(meta.len_payload) {
+			push_data(meta.tuple, flow, dir, seq, data, meta.len_payload);
+		}
+
+		if((dir.flags & (Direction::FLAG_FIN | Direction::FLAG_DONE)) == Direction::FLAG_FIN && dir.seq_next == dir.seq_fin) {
+			dir.flags |= Direction::FLAG_DONE;
+			dir.seq_next++;
+		}
+		if((flow.dir[0].flags & flow.dir[1].flags & Direction::FLAG_DONE)) {
+			m_stat.finished++;
+			close(it, FINISHED);
+		}
+		return true;
+	}
+
+	/**
+	 * Close the flows idle longer than the timeout.
+	 * @param now - the current time.
+	 */
+	void expire(uint64_t now) noexcept {
+		Iterator_t it = m_pool.peek_front();
+		while(it && it->value.time_queued + m_timeout < now) {
+			if(it->value.time_last + m_timeout < now) {
+				m_stat.timeouts++;
+				close(it, TIMEOUT);
+			} else {
+				it->value.time_queued = now;
+				m_pool.move_back(it);
+			}
+			it = m_pool.peek_front();
+		}
+	}
+
+	/**
+	 * Close all the flows.
+	 */
+	void reset() noexcept {
+		Iterator_t it = m_pool.peek_front();
+		while(it) {
+			close(it, CLEARED);
+			it = m_pool.peek_front();
+		}
+	}
+
+	/**
+	 * @param tuple - a flow tuple of any direction.
+	 * @return A flow or nullptr.
+	 */
+	Flow* find(const FiveTuple& tuple) noexcept {
+		Iterator_t it = m_pool.find(tuple.canonical() ? tuple : tuple.reverse());
+		return it ? &it->value : nullptr;
+	}
+
+	inline size_t size() const noexcept {
+		return m_pool.size();
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_pool.capacity();
+	}
+
+	inline size_t storage_bytes() noexcept {
+		return m_pool.storage_bytes() + m_segments_capacity * sizeof(Segment);
+	}
+
+	inline const TcpStreamTableStat& stat() noexcept {
+		m_stat.size = m_pool.size();
+		m_stat.segments_used = m_segments_used;
+		return m_stat;
+	}
+
+private:
+
+	static inline int32_t seq_diff(uint32_t lv, uint32_t rv) noexcept {
+		return int32_t(lv - rv);
+	}
+
+	Iterator_t create(const FiveTuple& key, uint64_t now) noexcept {
+		if(m_pool.available() == 0) {
+			m_stat.evictions++;
+			close(m_pool.peek_front(), EVICTED);
+		}
+		Iterator_t it = m_pool.push_back(key);
+		it->value = Flow();
+		it->value.time_queued = now;
+		m_stat.created++;
+		return it;
+	}
+
+	void close(Iterator_t it, Close reason) noexcept {
+		Flow& flow = it->value;
+		m_handler.on_close(it.key(), flow, reason);
+		release_segments(flow.dir[0]);
+		release_segments(flow.dir[1]);
+		m_pool.remove(it);
+	}
+
+	void release_segments(Direction& dir) noexcept {
+		Segment* seg = dir.ooo;
+		while(seg) {
+			Segment* next = seg->next;
+			segment_free(seg);
+			seg = next;
+		}
+		dir.ooo = nullptr;
+		dir.ooo_bytes = 0;
+	}
+
+	inline Segment* segment_alloc() noexcept {
+		Segment* seg = m_segments_freed;
+		if(seg) {
+			m_segments_freed = seg->next;
+			m_segments_used++;
+		}
+		return seg;
+	}
+
+	inline void segment_free(Segment* seg) noexcept {
+		seg->next = m_segments_freed;
+		m_segments_freed = seg;
+		m_segments_used--;
+	}
+
+	void push_data(const FiveTuple& tuple, Flow& flow, Direction& dir, uint32_t seq, const uint8_t* data, size_t size) noexcept {
+		const int32_t diff = seq_diff(seq, dir.seq_next);
+		if(diff > 0) {
+			buffer(tuple, flow, dir, seq, data, size);
+			return;
+		}
+		const size_t skip = size_t(-int64_t(diff));
+		m_stat.duplicate_bytes += skip < size ? skip : size;
+		if(skip >= size) {
+			m_stat.duplicates++;
+			return;
+		}
+		deliver(tuple, flow, dir, data + skip, size - skip);
+		drain(tuple, flow, dir);
+	}
+
+	inline void deliver(const FiveTuple& tuple, Flow& flow, Direction& dir, const uint8_t* data, size_t size) noexcept {
+		dir.seq_next += uint32_t(size);
+		m_stat.bytes += size;
+		m_handler.on_data(tuple, flow, data, size);
+	}
+
+	/**
+	 * Deliver the buffered segments which became in-order.
+	 */
+	void drain(const FiveTuple& tuple, Flow& flow, Direction& dir) noexcept {
+		Segment* seg = dir.ooo;
+		while(seg && seq_diff(seg->seq, dir.seq_next) <= 0) {
+			const uint32_t skip = uint32_t(-seq_diff(seg->seq, dir.seq_next));
+			if(skip < seg->size) {
+				deliver(tuple, flow, dir, seg->data + skip, seg->size - skip);
+			}
+			Segment* next = seg->next;
+			dir.ooo_bytes -= seg->size;
+			segment_free(seg);
+			seg = next;
+		}
+		dir.ooo = seg;
+	}
+
+	/**
+	 * Buffer an out-of-order segment. The bytes buffered before are skipped,
+	 * the rest is split into SEGMENT_DATA chunks.
+	 */
+	void buffer(const FiveTuple& tuple, Flow& flow, Direction& dir, uint32_t seq, const uint8_t* data, size_t size) noexcept {
+		size_t fresh = uncovered(dir, seq, size);
+		while(fresh && dir.ooo_bytes + fresh > m_ooo_max) {
+			// skip the hole in front of the buffered data
+			if(dir.ooo == nullptr) {
+				dir.seq_next = seq;
+				m_stat.gaps++;
+				push_data(tuple, flow, dir, seq, data, size);
+				return;
+			}
+			dir.seq_next = dir.ooo->seq;
+			m_stat.gaps++;
+			drain(tuple, flow, dir);
+			if(seq_diff(seq, dir.seq_next) <= 0) {
+				push_data(tuple, flow, dir, seq, data, size);
+				return;
+			}
+			fresh = uncovered(dir, seq, size);
+		}
+		m_stat.duplicate_bytes += size - fresh;
+		if(fresh == 0) {
+			m_stat.duplicates++;
+			return;
+		}
+		m_stat.segments_ooo++;
+
+		// the segments are sorted and don't overlap, the first one which ends after seq
+		const Segment* next = dir.ooo;
+		while(size) {
+			while(next && seq_diff(next->seq + next->size, seq) <= 0) {
+				next = next->next;
+			}
+			if(next && seq_diff(next->seq, seq) <= 0) {
+				const size_t covered = std::min(size, size_t(seq_diff(next->seq + next->size, seq)));
+				seq += uint32_t(covered);
+				data += covered;
+				size -= covered;
+				continue;
+			}
+			size_t chunk = std::min(size, SEGMENT_DATA);
+			if(next) {
+				chunk = std::min(chunk, size_t(seq_diff(next->seq, seq)));
+			}
+			Segment* seg = segment_alloc();
+			if(seg == nullptr) {
+				m_stat.drops_memory++;
+				return;
+			}
+			seg->seq = seq;
+			seg->size = uint32_t(chunk);
+			memcpy(seg->data, data, chunk);
+			insert(dir, seg);
+			seq += uint32_t(chunk);
+			data += chunk;
+			size -= chunk;
+		}
+	}
+
+	/**
+	 * @return The bytes of [seq, seq + size) not buffered yet.
+	 */
+	static size_t uncovered(const Direction& dir, uint32_t seq, size_t size) noexcept {
+		size_t result = size;
+		for(const Segment* seg = dir.ooo; seg && seq_diff(seg->seq, seq + uint32_t(size)) < 0; seg = seg->next) {
+			const int32_t begin = std::max<int32_t>(seq_diff(seg->seq, seq), 0);
+			const int32_t end = std::min<int32_t>(seq_diff(seg->seq + seg->size, seq), int32_t(size));
+			if(end > begin) {
+				result -= size_t(end - begin);
+			}
+		}
+		return result;
+	}
+
+	void insert(Direction& dir, Segment* seg) noexcept {
+		Segment** pos = &dir.ooo;
+		while(*pos && seq_diff((*pos)->seq, seg->seq) <= 0) {
+			pos = &(*pos)->next;
+		}
+		seg->next = *pos;
+		*pos = seg;
+		dir.ooo_bytes += seg->size;
+	}
+
+	void destroy() noexcept {
+		if(m_segments) {
+			m_allocator.deallocate(m_segments, m_segments_capacity);
+			m_segments = nullptr;
+			m_segments_freed = nullptr;
+		}
+	}
+
+};
+
+}; // namespace proto
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+
+namespace proto {
+
+struct TcpStreamTableStat {
+	size_t capacity = 0;
+	size_t size = 0;
+	size_t segments_capacity = 0;
+	size_t segments_used = 0;
+	uint64_t created = 0; // flows created
+	uint64_t finished = 0; // flows closed with FIN in both directions
+	uint64_t resets = 0; // flows closed with RST
+	uint64_t timeouts = 0; // flows expired
+	uint64_t evictions = 0; // flows dropped to make room for a new one
+	uint64_t segments_ooo = 0; // out-of-order segments buffered
+	uint64_t duplicates = 0; // segments with already delivered or buffered data only
+	uint64_t duplicate_bytes = 0; // bytes already delivered or buffered, of all the segments
+	uint64_t bytes = 0; // bytes delivered
+	uint64_t gaps = 0; // holes skipped because of the per-flow memory cap
+	uint64_t drops_memory = 0; // segments dropped because of the segment pool exhaustion
+
+	static void print_field(FILE* out, const char* name, uint64_t value, uint64_t value_prev) noexcept {
+		fprintf(out, "%s=%zu(%zu) ", name, size_t(value), size_t(value - value_prev));
+	}
+
+	void print(FILE* out, const TcpStreamTableStat& prev) const noexcept {
+		float load_factor = (static_cast<float>(size) / capacity) * 100.0f;
+		float segments_load = (static_cast<float>(segments_used) / segments_capacity) * 100.0f;
+		fprintf(out, "[TCP] ");
+		fprintf(out, "%zu/%zu (%.2f%%) ", size, capacity, load_factor);
+		fprintf(out, "seg %zu/%zu (%.2f%%) ", segments_used, segments_capacity, segments_load);
+		print_field(out, "new", created, prev.created);
+		print_field(out, "fin", finished, prev.finished);
+		print_field(out, "rst", resets, prev.resets);
+		print_field(out, "tmout", timeouts, prev.timeouts);
+		print_field(out, "evict", evictions, prev.evictions);
+		print_field(out, "ooo", segments_ooo, prev.segments_ooo);
+		print_field(out, "dup", duplicates, prev.duplicates);
+		print_field(out, "dupb", duplicate_bytes, prev.duplicate_bytes);
+		print_field(out, "bytes", bytes, prev.bytes);
+		print_field(out, "gaps", gaps, prev.gaps);
+		print_field(out, "nomem", drops_memory, prev.drops_memory);
+	}
+};
+
+}; // namespace proto
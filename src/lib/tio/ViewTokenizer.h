@@ -0,0 +1,258 @@
+#pragma once
+
+#include "../utils/Cpu.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#include <immintrin.h>
+
+namespace tio {
+
+/**
+ * A set of delimiter bytes classifying 32 bytes at a time to a bit mask, bit i is set if the byte i
+ * is a delimiter. The kernel is selected at the construction (see utils::Cpu):
+ * - AVX2: the nibble lookup, each byte is checked with two shuffles against the tables of the low
+ * and the high nibbles of the set. It is exact for the sets with up to 8 distinct high nibbles
+ * (any set of ASCII punctuation and spaces).
+ * - SSE4.2: pcmpestrm with the "equal any" aggregation of up to 16 delimiters, 16 bytes per instruction.
+ * - Scalar: a lookup table.
+ */
+class DelimiterSet {
+public:
+	static constexpr size_t BLOCK = 32;
+
+	enum Kernel : uint8_t {
+		KERNEL_SCALAR,
+		KERNEL_SSE42,
+		KERNEL_AVX2
+	};
+
+private:
+	bool m_table[256];
+	alignas(16) uint8_t m_lo[16]; // the high nibble groups of the set members with this low nibble
+	alignas(16) uint8_t m_hi[16]; // the group of the high nibble
+	alignas(16) char m_chars[16];
+	int m_count;
+	bool m_nibble_exact;
+	Kernel m_kernel;
+
+public:
+
+	/**
+	 * @param chars - the delimiters, the repeats are ignored.
+	 * @param kernel - the best kernel to select, a lower one is taken if the CPU or the set does not fit it.
+	 */
+	explicit DelimiterSet(std::string_view chars, Kernel kernel = KERNEL_AVX2) noexcept
+		: m_table(), m_lo(), m_hi(), m_chars(), m_count(0), m_nibble_exact(true), m_kernel(KERNEL_SCALAR) {
+		uint8_t groups = 0;
+		for(const char ch : chars) {
+			const uint8_t byte = uint8_t(ch);
+			if(m_table[byte]) {
+				continue;
+			}
+			m_table[byte] = true;
+			if(m_count < int(sizeof(m_chars))) {
+				m_chars[m_count] = ch;
+			}
+			m_count++;
+			const uint8_t hi = byte >> 4u;
+			if(m_hi[hi] == 0) {
+				if(groups == 8) {
+					m_nibble_exact = false;
+					continue;
+				}
+				m_hi[hi] = uint8_t(1u << groups++);
+			}
+			m_lo[byte & 0x0Fu] |= m_hi[hi];
+		}
+		if(kernel >= KERNEL_AVX2 && m_nibble_exact && utils::Cpu::avx2()) {
+			m_kernel = KERNEL_AVX2;
+		} else if(kernel >= KERNEL_SSE42 && m_count <= int(sizeof(m_chars)) && utils::Cpu::sse42()) {
+			m_kernel = KERNEL_SSE42;
+		}
+	}
+
+	inline bool contains(char ch) const noexcept {
+		return m_table[uint8_t(ch)];
+	}
+
+	inline Kernel kernel() const noexcept {
+		return m_kernel;
+	}
+
+	/**
+	 * Classify up to BLOCK bytes, the bits of the bytes past @size are zero.
+	 * A short block is copied, nothing past @data + @size is read.
+	 */
+	inline uint32_t classify(const char* data, size_t size) const noexcept {
+		if(size >= BLOCK) {
+			return classify(data);
+		}
+		alignas(32) char block[BLOCK] = {};
+		memcpy(block, data, size);
+		return classify(block) & ((uint32_t(1) << size) - 1u);
+	}
+
+	/**
+	 * Classify BLOCK bytes with the selected kernel.
+	 */
+	inline uint32_t classify(const char* data) const noexcept {
+		switch(m_kernel) {
+		case KERNEL_AVX2:
+			return classify_avx2(data);
+		case KERNEL_SSE42:
+			return classify_sse42(data);
+		default:
+			return classify_scalar(data);
+		}
+	}
+
+	uint32_t classify_scalar(const char* data) const noexcept {
+		uint32_t result = 0;
+		for(size_t i = 0; i < BLOCK; ++i) {
+			result |= uint32_t(m_table[uint8_t(data[i])]) << i;
+		}
+		return result;
+	}
+
+	/**
+	 * The set must have up to 16 delimiters.
+	 */
+	__attribute__((target("sse4.2")))
+	uint32_t classify_sse42(const char* data) const noexcept {
+		constexpr int mode = _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK;
+		const __m128i set = _mm_load_si128(reinterpret_cast<const __m128i*>(m_chars));
+		const int count = std::min(m_count, int(sizeof(m_chars)));
+		const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+		const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+		const uint32_t mask_lo = uint32_t(_mm_cvtsi128_si32(_mm_cmpestrm(set, count, lo, 16, mode)));
+		const uint32_t mask_hi = uint32_t(_mm_cvtsi128_si32(_mm_cmpestrm(set, count, hi, 16, mode)));
+		return (mask_lo & 0xFFFFu) | (mask_hi << 16u);
+	}
+
+	/**
+	 * The set must have up to 8 distinct high nibbles.
+	 */
+	__attribute__((target("avx2")))
+	uint32_t classify_avx2(const char* data) const noexcept {
+		const __m256i lo_table = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(m_lo)));
+		const __m256i hi_table = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(m_hi)));
+		const __m256i nibble = _mm256_set1_epi8(0x0F);
+		const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+		const __m256i lo = _mm256_shuffle_epi8(lo_table, _mm256_and_si256(bytes, nibble));
+		const __m256i hi = _mm256_shuffle_epi8(hi_table, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble));
+		const __m256i miss = _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256());
+		return ~uint32_t(_mm256_movemask_epi8(miss));
+	}
+
+};
+
+/**
+ * Split a buffer to std::string_view tokens over it, nothing is copied nor allocated.
+ * The delimiters are found with the bit masks of DelimiterSet, one classification per 32 bytes,
+ * a token boundary is a count of the trailing zeros of the mask.
+ * The buffer and the delimiter set must outlive the tokenizer, reset() takes the next buffer.
+ * @tparam SkipEmpty - the delimiter runs separate the tokens as tio::StringTokenizer does,
+ * false - each delimiter ends a token as utils::Tokenizer does: "a,,b," gives "a", "", "b", "".
+ */
+template<bool SkipEmpty = true>
+class ViewTokenizer {
+	const DelimiterSet& m_delimiters;
+	const char* m_data;
+	size_t m_size;
+	size_t m_pos;
+	size_t m_block; // the offset of the classified block
+	uint32_t m_mask;
+	std::string_view m_token;
+
+public:
+
+	ViewTokenizer(std::string_view input, const DelimiterSet& delimiters) noexcept
+		: m_delimiters(delimiters), m_data(nullptr), m_size(0), m_pos(0), m_block(0), m_mask(0), m_token() {
+		reset(input);
+	}
+
+	ViewTokenizer(const ViewTokenizer&) = delete;
+	ViewTokenizer& operator=(const ViewTokenizer&) = delete;
+
+	ViewTokenizer(ViewTokenizer&&) = delete;
+	ViewTokenizer& operator=(ViewTokenizer&&) = delete;
+
+	void reset(std::string_view input) noexcept {
+		m_data = input.data();
+		m_size = input.size();
+		m_pos = 0;
+		m_block = SIZE_MAX;
+		m_mask = 0;
+		m_token = std::string_view();
+	}
+
+	/**
+	 * Find the next token.
+	 * @return false - if the input is over.
+	 */
+	bool next() noexcept {
+		if constexpr (SkipEmpty) {
+			const size_t begin = find<false>(m_pos);
+			if(begin == m_size) {
+				m_pos = m_size;
+				m_token = std::string_view();
+				return false;
+			}
+			const size_t end = find<true>(begin);
+			m_token = std::string_view(m_data + begin, end - begin);
+			m_pos = end;
+		} else {
+			if(m_pos > m_size) {
+				m_token = std::string_view();
+				return false;
+			}
+			const size_t end = find<true>(m_pos);
+			m_token = std::string_view(m_data + m_pos, end - m_pos);
+			m_pos = end + 1;
+		}
+		return true;
+	}
+
+	inline std::string_view token() const noexcept {
+		return m_token;
+	}
+
+	/**
+	 * @return The input after the current token.
+	 */
+	inline std::string_view rest() const noexcept {
+		const size_t pos = std::min(m_pos, m_size);
+		return std::string_view(m_data + pos, m_size - pos);
+	}
+
+private:
+
+	/**
+	 * @return The offset of the first delimiter (Delimiter = true) or non delimiter byte from @from,
+	 * the input size if there is none.
+	 */
+	template<bool Delimiter>
+	inline size_t find(size_t from) noexcept {
+		while(from < m_size) {
+			const size_t block = from & ~(DelimiterSet::BLOCK - 1u);
+			if(block != m_block) {
+				m_block = block;
+				m_mask = m_delimiters.classify(m_data + block, m_size - block);
+			}
+			const uint32_t bits = (Delimiter ? m_mask : ~m_mask) >> (from - block);
+			if(bits) {
+				return std::min(from + size_t(__builtin_ctz(bits)), m_size);
+			}
+			from = block + DelimiterSet::BLOCK;
+		}
+		return m_size;
+	}
+
+};
+
+}; // namespace tio
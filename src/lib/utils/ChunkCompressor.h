@@ -0,0 +1,365 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * The codecs are compiled in on request, the application links the library:
+ * -DUTILS_WITH_ZLIB -lz, -DUTILS_WITH_ZSTD -lzstd, -DUTILS_WITH_LZ4 -llz4
+ */
+#ifdef UTILS_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef UTILS_WITH_ZSTD
+#include <zstd.h>
+#endif
+#ifdef UTILS_WITH_LZ4
+#include <lz4frame.h>
+#endif
+
+namespace utils {
+
+struct ChunkCompressorStat {
+	uint64_t compressed = 0; // the files
+	uint64_t failed = 0; // the files left uncompressed
+	uint64_t bytes_in = 0;
+	uint64_t bytes_out = 0;
+};
+
+/**
+ * A background thread compressing the closed chunks of utils::ChunkedFile: push() queues a file,
+ * the thread writes <file><suffix> and removes the file. So the writers never wait for the compression.
+ * A file which can't be compressed is left as it is and counted as failed.
+ *
+ * Using sample:
+ * utils::ChunkCompressor compressor(utils::ChunkCompressor::CODEC_ZSTD);
+ * utils::ChunkedFile file("/var/log/app", "app_", "log");
+ * file.set_compressor(&compressor);
+ */
+class ChunkCompressor {
+public:
+	enum Codec {
+		CODEC_GZIP,
+		CODEC_ZSTD,
+		CODEC_LZ4,
+	};
+
+	/**
+	 * bool(const std::string& src, const std::string& dst, ChunkCompressorStat& stat), it adds the bytes to @stat.
+	 */
+	using Function_t = std::function<bool(const std::string&, const std::string&, ChunkCompressorStat&)>;
+
+private:
+	static constexpr size_t BUFFER_SIZE = 1u << 17u;
+
+	const std::string m_suffix;
+	Function_t m_function;
+
+	std::mutex m_lock;
+	std::condition_variable m_cond;
+	std::deque<std::string> m_queue;
+	bool m_busy = false;
+	bool m_stop = false;
+	ChunkCompressorStat m_stat;
+	std::thread m_thread;
+
+public:
+
+	/**
+	 * @param level - the codec compression level, 0 is the codec default.
+	 */
+	explicit ChunkCompressor(Codec codec, int level = 0)
+		: ChunkCompressor(suffix(codec), function(codec, level)) {}
+
+	/**
+	 * A custom codec, @function writes @suffix files.
+	 */
+	ChunkCompressor(const char* file_suffix, Function_t function)
+		: m_suffix(file_suffix), m_function(std::move(function)) {
+		m_thread = std::thread([this]() {
+			run();
+		});
+	}
+
+	ChunkCompressor(const ChunkCompressor&) = delete;
+	ChunkCompressor& operator=(const ChunkCompressor&) = delete;
+
+	ChunkCompressor(ChunkCompressor&&) = delete;
+	ChunkCompressor& operator=(ChunkCompressor&&) = delete;
+
+	/**
+	 * Compress the queued files and stop the thread.
+	 */
+	~ChunkCompressor() {
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			m_stop = true;
+		}
+		m_cond.notify_all();
+		m_thread.join();
+	}
+
+	/**
+	 * @return true - if @codec is compiled in.
+	 */
+	static constexpr bool available(Codec codec) noexcept {
+		switch(codec) {
+			case CODEC_GZIP:
+#ifdef UTILS_WITH_ZLIB
+				return true;
+#else
+				return false;
+#endif
+			case CODEC_ZSTD:
+#ifdef UTILS_WITH_ZSTD
+				return true;
+#else
+				return false;
+#endif
+			case CODEC_LZ4:
+#ifdef UTILS_WITH_LZ4
+				return true;
+#else
+				return false;
+#endif
+		}
+		return false;
+	}
+
+	static constexpr const char* suffix(Codec codec) noexcept {
+		switch(codec) {
+			case CODEC_GZIP:
+				return ".gz";
+			case CODEC_ZSTD:
+				return ".zst";
+			case CODEC_LZ4:
+				return ".lz4";
+		}
+		return "";
+	}
+
+	const std::string& suffix() const noexcept {
+		return m_suffix;
+	}
+
+	/**
+	 * Queue the closed file @path.
+	 */
+	void push(std::string path) {
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			m_queue.push_back(std::move(path));
+		}
+		m_cond.notify_all();
+	}
+
+	/**
+	 * Wait until the queued files are compressed.
+	 */
+	void wait() {
+		std::unique_lock<std::mutex> guard(m_lock);
+		m_cond.wait(guard, [this]() {
+			return m_queue.empty() && not m_busy;
+		});
+	}
+
+	ChunkCompressorStat stat() {
+		std::lock_guard<std::mutex> guard(m_lock);
+		return m_stat;
+	}
+
+private:
+
+	void run() {
+		std::unique_lock<std::mutex> guard(m_lock);
+		while(true) {
+			m_cond.wait(guard, [this]() {
+				return m_stop || not m_queue.empty();
+			});
+			if(m_queue.empty()) {
+				return; // stopped
+			}
+			const std::string src = std::move(m_queue.front());
+			m_queue.pop_front();
+			m_busy = true;
+			guard.unlock();
+
+			ChunkCompressorStat stat;
+			const std::string dst = src + m_suffix;
+			bool result = m_function && m_function(src, dst, stat);
+			if(result) {
+				result = unlink(src.c_str()) == 0;
+			} else {
+				unlink(dst.c_str());
+			}
+
+			guard.lock();
+			m_busy = false;
+			m_stat.compressed += result;
+			m_stat.failed += not result;
+			m_stat.bytes_in += stat.bytes_in;
+			m_stat.bytes_out += stat.bytes_out;
+			m_cond.notify_all();
+		}
+	}
+
+	static Function_t function(Codec codec, int level) {
+		switch(codec) {
+			case CODEC_GZIP:
+				return [level](const std::string& src, const std::string& dst, ChunkCompressorStat& stat) {
+					return compress_gzip(src, dst, level, stat);
+				};
+			case CODEC_ZSTD:
+				return [level](const std::string& src, const std::string& dst, ChunkCompressorStat& stat) {
+					return compress_zstd(src, dst, level, stat);
+				};
+			case CODEC_LZ4:
+				return [level](const std::string& src, const std::string& dst, ChunkCompressorStat& stat) {
+					return compress_lz4(src, dst, level, stat);
+				};
+		}
+		return nullptr;
+	}
+
+	struct FileCloser {
+		void operator()(FILE* file) const noexcept {
+			fclose(file);
+		}
+	};
+
+	using File_t = std::unique_ptr<FILE, FileCloser>;
+
+	static bool compress_gzip(const std::string& src, const std::string& dst, int level, ChunkCompressorStat& stat) {
+#ifdef UTILS_WITH_ZLIB
+		File_t in(fopen(src.c_str(), "rb"));
+		if(not in) {
+			return false;
+		}
+		const std::string mode = "wb" + std::to_string(level > 0 ? level : 6);
+		gzFile out = gzopen(dst.c_str(), mode.c_str());
+		if(not out) {
+			return false;
+		}
+		std::unique_ptr<char[]> buffer(new char[BUFFER_SIZE]);
+		bool result = true;
+		size_t len;
+		while(result && (len = fread(buffer.get(), 1u, BUFFER_SIZE, in.get())) > 0) {
+			result = gzwrite(out, buffer.get(), unsigned(len)) == int(len);
+			stat.bytes_in += len;
+		}
+		result &= not ferror(in.get());
+		result &= gzclose(out) == Z_OK;
+		if(result) {
+			stat.bytes_out += file_size(dst);
+		}
+		return result;
+#else
+		static_cast<void>(src), static_cast<void>(dst), static_cast<void>(level), static_cast<void>(stat);
+		return false;
+#endif
+	}
+
+	static bool compress_zstd(const std::string& src, const std::string& dst, int level, ChunkCompressorStat& stat) {
+#ifdef UTILS_WITH_ZSTD
+		File_t in(fopen(src.c_str(), "rb"));
+		File_t out(fopen(dst.c_str(), "wb"));
+		if(not in || not out) {
+			return false;
+		}
+		std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx*)> ctx(ZSTD_createCCtx(), ZSTD_freeCCtx);
+		if(not ctx || ZSTD_isError(ZSTD_CCtx_setParameter(ctx.get(), ZSTD_c_compressionLevel, level))) {
+			return false;
+		}
+		const size_t in_size = ZSTD_CStreamInSize();
+		const size_t out_size = ZSTD_CStreamOutSize();
+		std::unique_ptr<char[]> in_buffer(new char[in_size]);
+		std::unique_ptr<char[]> out_buffer(new char[out_size]);
+		bool last = false;
+		while(not last) {
+			const size_t len = fread(in_buffer.get(), 1u, in_size, in.get());
+			if(ferror(in.get())) {
+				return false;
+			}
+			last = len < in_size;
+			stat.bytes_in += len;
+			ZSTD_inBuffer input = {in_buffer.get(), len, 0};
+			bool finished = false;
+			while(not finished) {
+				ZSTD_outBuffer output = {out_buffer.get(), out_size, 0};
+				const size_t remaining = ZSTD_compressStream2(ctx.get(), &output, &input, last ? ZSTD_e_end : ZSTD_e_continue);
+				if(ZSTD_isError(remaining) || fwrite(out_buffer.get(), 1u, output.pos, out.get()) != output.pos) {
+					return false;
+				}
+				stat.bytes_out += output.pos;
+				finished = last ? remaining == 0 : input.pos == input.size;
+			}
+		}
+		return fflush(out.get()) == 0;
+#else
+		static_cast<void>(src), static_cast<void>(dst), static_cast<void>(level), static_cast<void>(stat);
+		return false;
+#endif
+	}
+
+	static bool compress_lz4(const std::string& src, const std::string& dst, int level, ChunkCompressorStat& stat) {
+#ifdef UTILS_WITH_LZ4
+		File_t in(fopen(src.c_str(), "rb"));
+		File_t out(fopen(dst.c_str(), "wb"));
+		if(not in || not out) {
+			return false;
+		}
+		LZ4F_cctx* raw_ctx = nullptr;
+		if(LZ4F_isError(LZ4F_createCompressionContext(&raw_ctx, LZ4F_VERSION))) {
+			return false;
+		}
+		std::unique_ptr<LZ4F_cctx, LZ4F_errorCode_t (*)(LZ4F_cctx*)> ctx(raw_ctx, LZ4F_freeCompressionContext);
+		LZ4F_preferences_t prefs;
+		memset(&prefs, 0, sizeof(prefs));
+		prefs.compressionLevel = level;
+		const size_t out_size = LZ4F_compressBound(BUFFER_SIZE, &prefs);
+		std::unique_ptr<char[]> in_buffer(new char[BUFFER_SIZE]);
+		std::unique_ptr<char[]> out_buffer(new char[out_size]);
+		auto put = [&](size_t len) {
+			if(LZ4F_isError(len) || fwrite(out_buffer.get(), 1u, len, out.get()) != len) {
+				return false;
+			}
+			stat.bytes_out += len;
+			return true;
+		};
+		if(not put(LZ4F_compressBegin(ctx.get(), out_buffer.get(), out_size, &prefs))) {
+			return false;
+		}
+		size_t len;
+		while((len = fread(in_buffer.get(), 1u, BUFFER_SIZE, in.get())) > 0) {
+			stat.bytes_in += len;
+			if(not put(LZ4F_compressUpdate(ctx.get(), out_buffer.get(), out_size, in_buffer.get(), len, nullptr))) {
+				return false;
+			}
+		}
+		return not ferror(in.get()) && put(LZ4F_compressEnd(ctx.get(), out_buffer.get(), out_size, nullptr))
+			&& fflush(out.get()) == 0;
+#else
+		static_cast<void>(src), static_cast<void>(dst), static_cast<void>(level), static_cast<void>(stat);
+		return false;
+#endif
+	}
+
+	static uint64_t file_size(const std::string& path) noexcept {
+		struct stat info;
+		return ::stat(path.c_str(), &info) == 0 ? uint64_t(info.st_size) : 0;
+	}
+
+};
+
+}; // namespace utils
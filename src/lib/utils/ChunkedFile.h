@@ -1,12 +1,28 @@
 #pragma once
 
+#include "ChunkCompressor.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
 #include <ctime>
 #include <unistd.h>
 #include <string>
 #include <cstring>
+#include <sys/stat.h>
+#include <sys/types.h>
 
 namespace utils {
 
+/**
+ * A file split to the chunks <root>/<date>/<prefix><date_time>.<ext> by the time, by the size and
+ * at the midnight. update() is cheap enough to be called for each write: it compares the coarse clock
+ * with the precomputed split time, the chunk size (ftello() is a system call for an appended file)
+ * is checked once per a coarse clock tick of a few milliseconds. The rest (localtime_r(),
+ * the directory creation, opening the next chunk) happens only at a split.
+ * The closed chunks are handed to the optional ChunkCompressor, it compresses them in the background.
+ */
 class ChunkedFile {
 	static const char FILE_SEP = '/';
 	static constexpr long DEFAULT_SPLIT_TIME = 60; // 1 min
@@ -16,13 +32,20 @@ class ChunkedFile {
 	const std::string m_file_ext;
 	FILE* m_file;
 	long m_time_split_sec;
-	time_t m_time_last_update;
+	time_t m_time_next_split;
+	uint64_t m_size_split;
+	uint64_t m_size_checked_ms;
+	std::string m_path;
+	std::string m_dir; // the last created one
+	ChunkCompressor* m_compressor;
+	uint64_t m_chunks;
 
 public:
 
 	ChunkedFile(const char* root_dir, const char* file_pref, const char* file_ext) :
 		m_root(root_dir), m_file_pref(file_pref), m_file_ext(file_ext), m_file(nullptr), m_time_split_sec(
-		DEFAULT_SPLIT_TIME), m_time_last_update(0) {}
+		DEFAULT_SPLIT_TIME), m_time_next_split(0), m_size_split(0), m_size_checked_ms(0), m_compressor(nullptr)
+		, m_chunks(0) {}
 
 	ChunkedFile(const ChunkedFile&) = delete;
 	ChunkedFile& operator=(const ChunkedFile&) = delete;
@@ -34,25 +57,47 @@ public:
 		close();
 	}
 
+	/**
+	 * Applies to the chunks opened after the call.
+	 */
 	void set_split_time(long time_split_sec) noexcept {
 		m_time_split_sec = time_split_sec;
 	}
 
+	/**
+	 * Split when the chunk reaches @size_split bytes, 0 - no size limit.
+	 */
+	void set_split_size(uint64_t size_split) noexcept {
+		m_size_split = size_split;
+	}
+
+	/**
+	 * Hand the closed chunks to @compressor, nullptr - keep them as they are.
+	 */
+	void set_compressor(ChunkCompressor* compressor) noexcept {
+		m_compressor = compressor;
+	}
+
+	/**
+	 * @return 0 - if the chunk is opened.
+	 */
 	int open() {
 		if(m_file)
 			return -1;
 
-		time_t cur_time = time(nullptr);
+		time_t cur_time = time_t(now_ms() / 1000u);
 		struct tm local_time;
 		localtime_r(&cur_time, &local_time);
 
 		std::string current_dir = dir_name(local_time);
-		std::string current_file = file_name(local_time);
 
-		if(create_dir(current_dir) == 0) {
-			m_file = open_file(current_file);
+		if(current_dir == m_dir || create_dir(current_dir) == 0) {
+			m_dir = current_dir;
+			m_path = unused_name(local_time);
+			m_file = open_file(m_path);
 			if(m_file) {
-				m_time_last_update = cur_time;
+				m_time_next_split = next_split(cur_time, local_time);
+				m_chunks++;
 			}
 		}
 
@@ -60,14 +105,27 @@ public:
 	}
 
 	void close() {
-		if(m_file)
+		if(m_file) {
 			fclose(m_file);
+			if(m_compressor) {
+				m_compressor->push(m_path);
+			}
+		}
 		m_file = nullptr;
 	}
 
+	/**
+	 * Start the next chunk if the current one is over by the time or by the size.
+	 * @return true - if the next chunk is opened.
+	 */
 	bool update() {
-		time_t time_current = time(NULL);
-		if(time_current - m_time_last_update >= m_time_split_sec || not same_day(time_current, m_time_last_update)) {
+		const uint64_t ms = now_ms();
+		bool split = time_t(ms / 1000u) >= m_time_next_split;
+		if(not split && m_size_split && m_file && ms != m_size_checked_ms) {
+			m_size_checked_ms = ms;
+			split = uint64_t(ftello(m_file)) >= m_size_split;
+		}
+		if(split) {
 			close();
 			return open() == 0;
 		}
@@ -82,19 +140,87 @@ public:
 		return m_file;
 	}
 
+	/**
+	 * @return The path of the current chunk.
+	 */
+	const std::string& path() const noexcept {
+		return m_path;
+	}
+
+	/**
+	 * @return The number of the opened chunks.
+	 */
+	uint64_t chunks() const noexcept {
+		return m_chunks;
+	}
+
+	/**
+	 * Create @dir_name and its parents as "mkdir -p" does.
+	 * @return 0 - on success.
+	 */
+	static int create_dir(const std::string& dir_name) noexcept {
+		std::string path;
+		path.reserve(dir_name.size());
+		size_t pos = 0;
+		while(pos < dir_name.size()) {
+			size_t next = dir_name.find(FILE_SEP, pos + 1);
+			if(next == std::string::npos) {
+				next = dir_name.size();
+			}
+			path.assign(dir_name, 0, next);
+			pos = next;
+			if(path.size() == 1 && path[0] == FILE_SEP) {
+				continue;
+			}
+			if(mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+				return -1;
+			}
+		}
+		struct stat info;
+		return (stat(dir_name.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) ? 0 : -1;
+	}
+
 private:
 
-	std::string file_name(struct tm time) const noexcept {
-		return dir_name(time) + FILE_SEP + m_file_pref + format_data_time(time) + "." + m_file_ext;
+	/**
+	 * CLOCK_REALTIME_COARSE is read from the vDSO without a system call.
+	 */
+	static uint64_t now_ms() noexcept {
+		timespec now;
+		clock_gettime(CLOCK_REALTIME_COARSE, &now);
+		return uint64_t(now.tv_sec) * 1000u + uint64_t(now.tv_nsec) / 1000000u;
 	}
 
-	std::string dir_name(struct tm time) const noexcept {
-		return m_root + FILE_SEP + format_data(time);
+	/**
+	 * @return The earliest of the time split and the next local midnight.
+	 */
+	time_t next_split(time_t cur_time, struct tm local_time) const noexcept {
+		local_time.tm_mday += 1;
+		local_time.tm_hour = local_time.tm_min = local_time.tm_sec = 0;
+		local_time.tm_isdst = -1;
+		const time_t midnight = mktime(&local_time);
+		return std::min(cur_time + time_t(m_time_split_sec), midnight);
 	}
 
-	static int create_dir(std::string dir_name) noexcept {
-		std::string cmd = "mkdir -p " + dir_name;
-		return system(cmd.c_str());
+	/**
+	 * A size split may happen within the same second, the following chunks of the second get "_<n>".
+	 */
+	std::string unused_name(struct tm time) const noexcept {
+		const std::string base = dir_name(time) + FILE_SEP + m_file_pref + format_data_time(time);
+		std::string result = base + "." + m_file_ext;
+		for(unsigned i = 1; exists(result); ++i) {
+			result = base + "_" + std::to_string(i) + "." + m_file_ext;
+		}
+		return result;
+	}
+
+	bool exists(const std::string& path) const noexcept {
+		return access(path.c_str(), F_OK) == 0
+			|| (m_compressor && access((path + m_compressor->suffix()).c_str(), F_OK) == 0);
+	}
+
+	std::string dir_name(struct tm time) const noexcept {
+		return m_root + FILE_SEP + format_data(time);
 	}
 
 	static FILE* open_file(std::string file_name) noexcept {
@@ -120,19 +246,6 @@ private:
 		return std::string(buffer);
 	}
 
-	static bool same_day(time_t first, time_t second) {
-		struct tm fr;
-		struct tm sc;
-
-		localtime_r(&first, &fr);
-		localtime_r(&second, &sc);
-
-		return fr.tm_year == sc.tm_year && fr.tm_yday == sc.tm_yday;
-	}
-
 };
 
 }; // namespace utils
-
-#endif /* CHUNKED_FILE_H */
-
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+
+#include "Cpu.h"
+
+namespace utils {
+
+/**
+ * A log-linear (HDR-style) histogram of the operation latencies in the TSC cycles:
+ * the values below 16 are exact, above that every power of two is split into 8 buckets,
+ * so a percentile is within 12.5% of the real value. The values above 2^48 are clamped.
+ */
+struct LatencyHistogram {
+	static constexpr unsigned SUB_BITS = 3;
+	static constexpr unsigned SUB = 1u << SUB_BITS;
+	static constexpr unsigned VALUE_BITS = 48;
+	static constexpr unsigned BUCKETS = (VALUE_BITS - SUB_BITS + 1u) * SUB;
+
+	uint64_t counts[BUCKETS] = {};
+	uint64_t count = 0;
+	uint64_t sum = 0;
+	uint64_t max = 0;
+
+	static inline unsigned index(uint64_t value) noexcept {
+		if(value < 2u * SUB) {
+			return unsigned(value);
+		}
+		if(value >> VALUE_BITS) {
+			return BUCKETS - 1u;
+		}
+		const unsigned shift = 63u - unsigned(__builtin_clzll(value)) - SUB_BITS;
+		return (shift + 1u) * SUB + unsigned(value >> shift) - SUB;
+	}
+
+	/**
+	 * @return The greatest value falling into the bucket @idx.
+	 */
+	static inline uint64_t highest(unsigned idx) noexcept {
+		if(idx < 2u * SUB) {
+			return idx;
+		}
+		const unsigned shift = idx / SUB - 1u;
+		return ((uint64_t(idx % SUB + SUB + 1u)) << shift) - 1u;
+	}
+
+	inline void record(uint64_t value) noexcept {
+		counts[index(value)]++;
+		count++;
+		sum += value;
+		max = value > max ? value : max;
+	}
+
+	/**
+	 * @param quantile - in [0:1].
+	 * @return The value not exceeded by the @quantile of the recorded values, 0 if there are none.
+	 */
+	uint64_t percentile(double quantile) const noexcept {
+		if(not count) {
+			return 0;
+		}
+		uint64_t rank = uint64_t(quantile * double(count));
+		rank = rank < 1u ? 1u : (rank > count ? count : rank);
+		uint64_t seen = 0;
+		for(unsigned i = 0; i < BUCKETS; ++i) {
+			seen += counts[i];
+			if(seen >= rank) {
+				return highest(i);
+			}
+		}
+		return highest(BUCKETS - 1u);
+	}
+
+	void add(const LatencyHistogram& other) noexcept {
+		for(unsigned i = 0; i < BUCKETS; ++i) {
+			counts[i] += other.counts[i];
+		}
+		count += other.count;
+		sum += other.sum;
+		max = other.max > max ? other.max : max;
+	}
+
+	/**
+	 * @return The values recorded since the @prev snapshot, the maximum is the overall one.
+	 */
+	LatencyHistogram since(const LatencyHistogram& prev) const noexcept {
+		LatencyHistogram result(*this);
+		for(unsigned i = 0; i < BUCKETS; ++i) {
+			result.counts[i] -= prev.counts[i];
+		}
+		result.count -= prev.count;
+		result.sum -= prev.sum;
+		return result;
+	}
+
+	void print(FILE* out, const char* name) const noexcept {
+		fprintf(out, "%s n=%zu avg=%zu p50=%zu p99=%zu p999=%zu max=%zu ", name, size_t(count)
+			, size_t(count ? sum / count : 0), size_t(percentile(0.5)), size_t(percentile(0.99))
+			, size_t(percentile(0.999)), size_t(max));
+	}
+};
+
+/**
+ * The operation statistics of a container, filled when the container is instantiated with Stats = true.
+ * A snapshot is a copy, print(out, prev) shows the totals and the changes since the @prev snapshot.
+ */
+struct ContainerStat {
+	size_t capacity = 0;
+	size_t size = 0;
+	uint64_t lookups = 0;
+	uint64_t hits = 0;
+	uint64_t probes = 0; // the chain nodes (HashMap) or the buckets (CuckooQueuePool) visited by the lookups
+	uint64_t probe_max = 0; // the longest lookup
+	uint64_t inserts = 0;
+	uint64_t removes = 0;
+	uint64_t evictions = 0; // the items dropped to make room for a new one
+	uint64_t expiries = 0; // the items dropped by the age
+	uint64_t failures = 0; // the inserts refused because of no room
+	LatencyHistogram latency; // the sampled lookup latency in the TSC cycles
+
+	static void print_field(FILE* out, const char* name, uint64_t value, uint64_t value_prev) noexcept {
+		fprintf(out, "%s=%zu(%zu) ", name, size_t(value), size_t(value - value_prev));
+	}
+
+	void add(const ContainerStat& other) noexcept {
+		lookups += other.lookups;
+		hits += other.hits;
+		probes += other.probes;
+		probe_max = other.probe_max > probe_max ? other.probe_max : probe_max;
+		inserts += other.inserts;
+		removes += other.removes;
+		evictions += other.evictions;
+		expiries += other.expiries;
+		failures += other.failures;
+		latency.add(other.latency);
+	}
+
+	void print(FILE* out, const ContainerStat& prev) const noexcept {
+		const uint64_t lookups_delta = lookups - prev.lookups;
+		const float load_factor = capacity ? (static_cast<float>(size) / capacity) * 100.0f : 0.0f;
+		const float hit_ratio = lookups_delta ? (static_cast<float>(hits - prev.hits) / lookups_delta) * 100.0f : 0.0f;
+		const float probe_avg = lookups_delta ? static_cast<float>(probes - prev.probes) / lookups_delta : 0.0f;
+		fprintf(out, "%zu/%zu (%.2f%%) ", size, capacity, load_factor);
+		print_field(out, "find", lookups, prev.lookups);
+		fprintf(out, "hit=%.2f%% probe=%.2f/%zu ", hit_ratio, probe_avg, size_t(probe_max));
+		print_field(out, "ins", inserts, prev.inserts);
+		print_field(out, "rm", removes, prev.removes);
+		print_field(out, "evict", evictions, prev.evictions);
+		print_field(out, "exp", expiries, prev.expiries);
+		print_field(out, "fail", failures, prev.failures);
+		latency.since(prev.latency).print(out, "lat");
+	}
+};
+
+/**
+ * The counting side of ContainerStat, a container holds StatCounter<Stats>.
+ * StatCounter<false> is empty and all its methods are no-ops, so a container without
+ * the statistics compiles to the same code as before.
+ * The latency is sampled every SAMPLE-th lookup to keep rdtsc off the most of the operations.
+ */
+template <bool Enabled>
+class StatCounter {
+public:
+
+	inline uint64_t sample_start() noexcept {
+		return 0;
+	}
+
+	inline void sample_stop(uint64_t) noexcept {}
+
+	inline void lookup(bool, uint64_t) noexcept {}
+
+	inline void insert() noexcept {}
+
+	inline void remove() noexcept {}
+
+	inline void evict() noexcept {}
+
+	inline void expire() noexcept {}
+
+	inline void fail() noexcept {}
+
+	inline void reset() noexcept {}
+
+	inline ContainerStat stat() const noexcept {
+		return ContainerStat();
+	}
+};
+
+template <>
+class StatCounter<true> {
+	ContainerStat m_stat;
+	uint32_t m_tick = 0;
+
+public:
+
+	static constexpr uint32_t SAMPLE = 64;
+
+	/**
+	 * @return The start time if the operation is sampled, 0 otherwise.
+	 */
+	inline uint64_t sample_start() noexcept {
+		return (++m_tick % SAMPLE) ? 0 : Cpu::rdtsc();
+	}
+
+	inline void sample_stop(uint64_t start) noexcept {
+		if(start) {
+			m_stat.latency.record(Cpu::rdtsc() - start);
+		}
+	}
+
+	inline void lookup(bool hit, uint64_t probes) noexcept {
+		m_stat.lookups++;
+		m_stat.hits += hit;
+		m_stat.probes += probes;
+		m_stat.probe_max = probes > m_stat.probe_max ? probes : m_stat.probe_max;
+	}
+
+	inline void insert() noexcept {
+		m_stat.inserts++;
+	}
+
+	inline void remove() noexcept {
+		m_stat.removes++;
+	}
+
+	inline void evict() noexcept {
+		m_stat.evictions++;
+	}
+
+	inline void expire() noexcept {
+		m_stat.expiries++;
+	}
+
+	inline void fail() noexcept {
+		m_stat.failures++;
+	}
+
+	inline void reset() noexcept {
+		m_stat = ContainerStat();
+	}
+
+	inline const ContainerStat& stat() const noexcept {
+		return m_stat;
+	}
+};
+
+}; // namespace utils
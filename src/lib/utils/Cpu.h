@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <x86intrin.h>
+
+namespace utils {
+
+/**
+ * Run-time CPU feature detection and a cycle counter.
+ * SIMD kernels are compiled with '__attribute__((target(...)))' and selected
+ * at run time, so the library doesn't require any architecture specific build flags.
+ */
+class Cpu {
+public:
+
+	static inline bool sse42() noexcept {
+		static const bool result = __builtin_cpu_supports("sse4.2");
+		return result;
+	}
+
+	static inline bool popcnt() noexcept {
+		static const bool result = __builtin_cpu_supports("popcnt");
+		return result;
+	}
+
+	static inline bool avx2() noexcept {
+		static const bool result = __builtin_cpu_supports("avx2");
+		return result;
+	}
+
+	static inline bool bmi2() noexcept {
+		static const bool result = __builtin_cpu_supports("bmi2");
+		return result;
+	}
+
+	/**
+	 * @return The time stamp counter value.
+	 */
+	static inline uint64_t rdtsc() noexcept {
+		return __rdtsc();
+	}
+
+};
+
+}; // namespace utils
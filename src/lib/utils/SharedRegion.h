@@ -0,0 +1,251 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+namespace utils {
+
+/**
+ * A file mapped with MAP_SHARED at a fixed address: a tmpfs file (/dev/shm/<name>) for a table
+ * which survives the process restarts, a file on a DAX file system for the one which survives the reboots.
+ * The region is always mapped at the base address of its creation, so the raw pointers between
+ * the objects in it stay valid in every process attached to it, the containers keep their
+ * intrusive links as they are. An attach fails if the address range is taken in the process.
+ *
+ * The memory is handed out by allocate() sequentially. An attached process repeats the allocations of
+ * the creator in the same order and gets the same addresses, the objects validate themselves then,
+ * see intrusive::HashQueuePool::allocate(SharedRegion&).
+ */
+class SharedRegion {
+public:
+	static constexpr uintptr_t BASE_DEFAULT = uintptr_t(0x600000000000ull);
+
+	struct Header {
+		static constexpr uint64_t MAGIC = 0x4E4F494745524853ull; // "SHREGION"
+		static constexpr uint32_t VERSION = 1;
+
+		uint64_t magic;
+		uint32_t version;
+		uint32_t header_size;
+		uint64_t base;
+		uint64_t size;
+		uint64_t used; // by the allocations of the creator
+	};
+
+private:
+	const std::string m_path;
+	const size_t m_size;
+	const uintptr_t m_base;
+	uint8_t* m_data;
+	size_t m_mapped;
+	size_t m_cursor;
+	bool m_created;
+	bool m_writable;
+
+public:
+
+	/**
+	 * @param size - the bytes of a created region, an attached one has the size of its creation.
+	 * @param base - the address of a created region, page aligned.
+	 */
+	SharedRegion(std::string path, size_t size, uintptr_t base = BASE_DEFAULT) noexcept
+		: m_path(std::move(path)), m_size(size), m_base(base), m_data(nullptr), m_mapped(0), m_cursor(0)
+		, m_created(false), m_writable(false) {}
+
+	SharedRegion(const SharedRegion&) = delete;
+	SharedRegion& operator=(const SharedRegion&) = delete;
+
+	SharedRegion(SharedRegion&&) = delete;
+	SharedRegion& operator=(SharedRegion&&) = delete;
+
+	~SharedRegion() noexcept {
+		close();
+	}
+
+	/**
+	 * Create an empty region in a temporary file and rename it to the path once it is mapped,
+	 * an existing file is replaced then and stays as it is on a failure.
+	 * @return 0 - on success.
+	 */
+	int create() noexcept {
+		close();
+		if(m_size < sizeof(Header)) {
+			return -1;
+		}
+		std::string tmp = m_path + ".XXXXXX";
+		const int fd = mkostemp(&tmp[0], O_CLOEXEC);
+		if(fd < 0) {
+			return -1;
+		}
+		int result = (fchmod(fd, 0644) == 0 && ftruncate(fd, off_t(m_size)) == 0) ? map(fd, m_base, m_size, true) : -1;
+		::close(fd);
+		if(result == 0) {
+			Header& head = header();
+			head.magic = Header::MAGIC;
+			head.version = Header::VERSION;
+			head.header_size = sizeof(Header);
+			head.base = m_base;
+			head.size = m_size;
+			head.used = m_cursor = sizeof(Header);
+			if(rename(tmp.c_str(), m_path.c_str()) != 0) {
+				close();
+				result = -1;
+			}
+		}
+		if(result == 0) {
+			m_created = true;
+		} else {
+			unlink(tmp.c_str());
+		}
+		return result;
+	}
+
+	/**
+	 * Attach to a region created before, at its base address.
+	 * @param writable - false for a reader, the mapping is read only then.
+	 * @return 0 - on success, -1 - no region or a foreign file, -2 - the file can't be opened
+	 * or the address range is taken.
+	 */
+	int attach(bool writable = true) noexcept {
+		close();
+		const int fd = ::open(m_path.c_str(), (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+		if(fd < 0) {
+			return errno == ENOENT ? -1 : -2;
+		}
+		Header head;
+		struct stat info;
+		int result = -1;
+		if(pread(fd, &head, sizeof(head), 0) == ssize_t(sizeof(head)) && fstat(fd, &info) == 0
+			&& head.magic == Header::MAGIC && head.version == Header::VERSION && head.header_size == sizeof(Header)
+			&& head.size == uint64_t(info.st_size) && head.used <= head.size) {
+			result = map(fd, uintptr_t(head.base), size_t(head.size), writable) == 0 ? 0 : -2;
+		}
+		::close(fd);
+		if(result == 0) {
+			m_cursor = sizeof(Header);
+			m_created = false;
+		}
+		return result;
+	}
+
+	/**
+	 * Attach to the region or create it if there is no valid one, a valid region is never replaced.
+	 * @return 0 - on success, the error of attach() or create() otherwise.
+	 */
+	int open() noexcept {
+		const int result = attach();
+		return (result == -1) ? create() : result;
+	}
+
+	void close() noexcept {
+		if(m_data) {
+			munmap(m_data, m_mapped);
+			m_data = nullptr;
+		}
+		m_mapped = m_cursor = 0;
+		m_created = m_writable = false;
+	}
+
+	/**
+	 * Remove the file, the mappings stay valid until close().
+	 */
+	int remove() const noexcept {
+		return unlink(m_path.c_str());
+	}
+
+	/**
+	 * @return The next @bytes aligned to @alignment: new memory of a created region,
+	 * the memory of the same allocation of the creator in an attached one, nullptr - if it is over.
+	 */
+	void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) noexcept {
+		if(m_data == nullptr) {
+			return nullptr;
+		}
+		const size_t begin = (m_cursor + alignment - 1) / alignment * alignment;
+		const size_t limit = m_created ? m_mapped : size_t(header().used);
+		if(begin > limit || bytes > limit - begin) {
+			return nullptr;
+		}
+		m_cursor = begin + bytes;
+		if(m_created) {
+			header().used = m_cursor;
+		}
+		return m_data + begin;
+	}
+
+	/**
+	 * Write the dirty pages to the file, for a DAX or a regular file which outlives a reboot.
+	 * @return 0 - on success.
+	 */
+	int flush() noexcept {
+		return m_data ? msync(m_data, m_mapped, MS_SYNC) : -1;
+	}
+
+	/**
+	 * @return true - if the region has been created by create(), the allocations are new then.
+	 */
+	bool created() const noexcept {
+		return m_created;
+	}
+
+	bool writable() const noexcept {
+		return m_writable;
+	}
+
+	bool is_open() const noexcept {
+		return m_data != nullptr;
+	}
+
+	size_t size() const noexcept {
+		return m_mapped;
+	}
+
+	/**
+	 * @return The bytes taken by the allocations of the creator.
+	 */
+	size_t used() const noexcept {
+		return m_data ? size_t(header().used) : 0;
+	}
+
+	const std::string& path() const noexcept {
+		return m_path;
+	}
+
+private:
+
+	Header& header() const noexcept {
+		return *reinterpret_cast<Header*>(m_data);
+	}
+
+	int map(int fd, uintptr_t base, size_t size, bool writable) noexcept {
+		const int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+		void* data = mmap(reinterpret_cast<void*>(base), size, prot, MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0);
+		if(data == MAP_FAILED) {
+			return -1;
+		}
+		// an old kernel takes the address as a hint
+		if(data != reinterpret_cast<void*>(base)) {
+			munmap(data, size);
+			return -1;
+		}
+		m_data = static_cast<uint8_t*>(data);
+		m_mapped = size;
+		m_writable = writable;
+		return 0;
+	}
+
+};
+
+}; // namespace utils
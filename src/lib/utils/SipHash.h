@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace utils {
+
+/**
+ * Header-only. No dependencies.
+ *
+ * SipHash is a keyed pseudo-random function: without the 128-bit key the outputs can't be predicted,
+ * so an attacker can't pick the keys colliding in a hash table (the hash flooding).
+ * SipHash<2, 4> is the reference SipHash-2-4, SipHash<1, 3> is the faster variant used for the hash tables.
+ */
+template <unsigned C, unsigned D>
+class SipHash {
+
+	static inline uint64_t rotl(uint64_t x, unsigned bits) noexcept {
+		return (x << bits) | (x >> (64u - bits));
+	}
+
+	static inline void round(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3) noexcept {
+		v0 += v1;
+		v1 = rotl(v1, 13);
+		v1 ^= v0;
+		v0 = rotl(v0, 32);
+		v2 += v3;
+		v3 = rotl(v3, 16);
+		v3 ^= v2;
+		v0 += v3;
+		v3 = rotl(v3, 21);
+		v3 ^= v0;
+		v2 += v1;
+		v1 = rotl(v1, 17);
+		v1 ^= v2;
+		v2 = rotl(v2, 32);
+	}
+
+public:
+
+	/**
+	 * @param k0, k1 - the key, the little endian halves of the reference 16-byte key.
+	 * @param data - the message.
+	 * @param bytes - the message size.
+	 * @return The 64-bit hash.
+	 */
+	__attribute__((always_inline))
+	static inline uint64_t hash(uint64_t k0, uint64_t k1, const void* data, size_t bytes) noexcept {
+		uint64_t v0 = k0 ^ 0x736F6D6570736575ull;
+		uint64_t v1 = k1 ^ 0x646F72616E646F6Dull;
+		uint64_t v2 = k0 ^ 0x6C7967656E657261ull;
+		uint64_t v3 = k1 ^ 0x7465646279746573ull;
+
+		const uint8_t* ptr = static_cast<const uint8_t*>(data);
+		const uint8_t* const end = ptr + (bytes & ~size_t(7));
+		for(; ptr != end; ptr += 8) {
+			uint64_t m;
+			memcpy(&m, ptr, sizeof(m));
+			v3 ^= m;
+			for(unsigned i = 0; i < C; ++i) {
+				round(v0, v1, v2, v3);
+			}
+			v0 ^= m;
+		}
+		uint64_t last = uint64_t(bytes) << 56u;
+		for(unsigned i = 0; i < (bytes & 7u); ++i) {
+			last |= uint64_t(ptr[i]) << (i * 8u);
+		}
+		v3 ^= last;
+		for(unsigned i = 0; i < C; ++i) {
+			round(v0, v1, v2, v3);
+		}
+		v0 ^= last;
+
+		v2 ^= 0xFFu;
+		for(unsigned i = 0; i < D; ++i) {
+			round(v0, v1, v2, v3);
+		}
+		return v0 ^ v1 ^ v2 ^ v3;
+	}
+
+};
+
+/**
+ * The keyed hasher of the trivially copyable keys without the padding: SipHash-1-3 over the key bytes.
+ * Usable as the H parameter of the hash tables constructed with the key (see intrusive::CuckooQueuePool).
+ */
+template <typename K>
+class SipHasher {
+	static_assert(std::has_unique_object_representations<K>::value
+		, "The key bytes are hashed, so the equal keys MUST have the equal bytes.");
+
+	uint64_t m_k0;
+	uint64_t m_k1;
+
+public:
+
+	SipHasher(uint64_t k0, uint64_t k1) noexcept : m_k0(k0), m_k1(k1) {}
+
+	inline uint64_t operator()(const K& key) const noexcept {
+		return SipHash<1, 3>::hash(m_k0, m_k1, &key, sizeof(key));
+	}
+
+};
+
+}; // namespace utils
@@ -4,6 +4,9 @@
 
 namespace utils {
 
+/**
+ * Copies the input and allocates each token, see tio::ViewTokenizer for the views over the input.
+ */
 class Tokenizer {
 	std::string m_string;
 	std::string m_splitter;
@@ -29,12 +32,10 @@ public:
 			result = m_string.substr(m_current, new_position - m_current);
 			m_current = new_position + 1;
 		}
-		return std::move(result);
+		return result;
 	}
 
 };
 
 }; // namespace utils
 
-#endif /* UTILS_TOKENIZER_H */
-
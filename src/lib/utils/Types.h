@@ -1,73 +1,184 @@
 #pragma once
 
-#include <string>
+#include <charconv>
+#include <cstdint>
 #include <cstring>
 #include <limits>
+#include <string_view>
+#include <type_traits>
 
 namespace utils {
 
+/**
+ * The parsers of std::string_view, they take no locale, set no errno and allocate nothing.
+ * The whole string must be a number, the const char* overloads take a zero terminated one.
+ * The integers are [+|-][0x<hex>|0<oct>|<dec>] as strtoll() with the base 0 takes them, without the leading spaces.
+ */
 class Types {
 public:
 
 	template<typename T>
-	inline static bool parse_signed(const char* str, T& value) noexcept {
-		using SLLI = signed long long int;
+	inline static bool parse_signed(std::string_view str, T& value) noexcept {
 		static_assert(std::is_integral<T>::value);
 		static_assert(std::is_signed<T>::value);
-		static_assert(sizeof(SLLI) >= sizeof(value));
-		constexpr SLLI VMin = std::numeric_limits<T>::lowest();
-		constexpr SLLI VMax = std::numeric_limits<T>::max();
-
-		char* end;
-		errno = EXIT_SUCCESS;
-		const SLLI slli = strtoll(str, &end, 0);
-		bool result = (str != end) && (errno == EXIT_SUCCESS) && (*end == '\0') && (slli >= VMin) && (slli <= VMax);
-		if(result) {
-			value = T(slli);
+		using Unsigned_t = std::make_unsigned_t<T>;
+		constexpr uint64_t VMax = uint64_t(std::numeric_limits<T>::max());
+
+		bool negative;
+		uint64_t magnitude;
+		if(not parse_magnitude(str, negative, magnitude) || magnitude > VMax + (negative ? 1u : 0u)) {
+			return false;
 		}
-		return result;
+		value = T(negative ? Unsigned_t(0u - magnitude) : Unsigned_t(magnitude));
+		return true;
 	}
 
 	template<typename T>
-	inline static bool parse_unsigned(const char* str, T& value) noexcept {
-		using ULLI = unsigned long long int;
+	inline static bool parse_signed(const char* str, T& value) noexcept {
+		return parse_signed(std::string_view(str), value);
+	}
+
+	template<typename T>
+	inline static bool parse_unsigned(std::string_view str, T& value) noexcept {
 		static_assert(std::is_integral<T>::value);
 		static_assert(std::is_unsigned<T>::value);
-		static_assert(sizeof(ULLI) >= sizeof(value));
-		constexpr ULLI VMax = std::numeric_limits<T>::max();
+		static_assert(sizeof(uint64_t) >= sizeof(value));
 
-		// 'strtoull()' does accept negative value
-		if(strchr(str, '-')) {
+		bool negative;
+		uint64_t magnitude;
+		if(not parse_magnitude(str, negative, magnitude) || negative || magnitude > std::numeric_limits<T>::max()) {
 			return false;
 		}
+		value = T(magnitude);
+		return true;
+	}
+
+	template<typename T>
+	inline static bool parse_unsigned(const char* str, T& value) noexcept {
+		return parse_unsigned(std::string_view(str), value);
+	}
+
+	template<typename T>
+	inline static bool parse_float(std::string_view str, T& value) noexcept {
+		static_assert(std::is_floating_point<T>::value);
 
-		char* end;
-		errno = EXIT_SUCCESS;
-		const ULLI ulli = strtoull(str, &end, 0);
-		bool result = (str != end) && (errno == EXIT_SUCCESS) && (*end == '\0') && (ulli <= VMax);
-		if(result) {
-			value = T(ulli);
+		if(str.size() > 1 && str[0] == '+' && str[1] != '-') {
+			str.remove_prefix(1);
+		}
+		const char* end = str.data() + str.size();
+		T result;
+		const auto [ptr, ec] = std::from_chars(str.data(), end, result);
+		if(ec != std::errc() || ptr != end) {
+			return false;
 		}
-		return result;
+		value = result;
+		return true;
 	}
 
 	template<typename T>
 	inline static bool parse_float(const char* str, T& value) noexcept {
-		using LD = long double;
-		static_assert(std::is_floating_point<T>::value);
-		static_assert(sizeof(LD) >= sizeof(value));
-
-		char* end;
-		errno = EXIT_SUCCESS;
-		const LD ld = strtold(str, &end);
-		bool result = (str != end) && (errno == EXIT_SUCCESS) && (*end == '\0');
-		if(result) {
-			value = T(ld);
+		return parse_float(std::string_view(str), value);
+	}
+
+	/**
+	 * Parse the decimal digits at the beginning of @str, 8 digits per step.
+	 * @return The number of the digits, 0 - there are no digits or the value does not fit @T.
+	 */
+	template<typename T>
+	static size_t parse_digits(std::string_view str, T& value) noexcept {
+		static_assert(std::is_integral<T>::value);
+		static_assert(std::is_unsigned<T>::value);
+		static_assert(sizeof(uint64_t) >= sizeof(value));
+
+		const char* const begin = str.data();
+		const char* const end = begin + str.size();
+		const char* ptr = begin;
+		uint64_t acc = 0;
+		if constexpr (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) {
+			while(end - ptr >= 8) {
+				uint64_t chunk;
+				memcpy(&chunk, ptr, sizeof(chunk));
+				const unsigned digits = leading_digits(chunk);
+				if(digits == 0) {
+					break;
+				}
+				if(digits < 8) {
+					// the digits to the high bytes, '0' to the low ones
+					chunk = (chunk << (64u - 8u * digits)) | (0x3030303030303030ull >> (8u * digits));
+				}
+				if(__builtin_mul_overflow(acc, pow10(digits), &acc)
+					|| __builtin_add_overflow(acc, uint64_t(parse_eight_digits(chunk)), &acc)) {
+					return 0;
+				}
+				ptr += digits;
+				if(digits < 8) {
+					break;
+				}
+			}
 		}
-		return result;
+		for(; ptr < end && unsigned(*ptr - '0') < 10u; ++ptr) {
+			if(__builtin_mul_overflow(acc, uint64_t(10), &acc) || __builtin_add_overflow(acc, uint64_t(*ptr - '0'), &acc)) {
+				return 0;
+			}
+		}
+		if(ptr == begin || acc > std::numeric_limits<T>::max()) {
+			return 0;
+		}
+		value = T(acc);
+		return size_t(ptr - begin);
+	}
+
+	/**
+	 * @param chunk - 8 chars loaded as a little endian word.
+	 * @return The number of the decimal digits at the beginning of @chunk.
+	 */
+	inline static unsigned leading_digits(uint64_t chunk) noexcept {
+		// a byte is a digit if its high nibble is 3 and the high nibble of byte + 6 is 3 too,
+		// a carry goes to the next bytes only from a non digit one
+		const uint64_t other = ((chunk & 0xF0F0F0F0F0F0F0F0ull) | (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4u))
+			^ 0x3333333333333333ull;
+		return other ? unsigned(__builtin_ctzll(other)) / 8u : 8u;
+	}
+
+	/**
+	 * @param chunk - 8 decimal digits loaded as a little endian word.
+	 * @return The value of the digits, the first one is the most significant.
+	 */
+	inline static uint32_t parse_eight_digits(uint64_t chunk) noexcept {
+		chunk -= 0x3030303030303030ull;
+		// the pairs, the quads, then the whole
+		chunk = (chunk * 10u) + (chunk >> 8u);
+		chunk = (((chunk & 0x000000FF000000FFull) * (100u + (1000000ull << 32u)))
+			+ (((chunk >> 16u) & 0x000000FF000000FFull) * (1u + (10000ull << 32u)))) >> 32u;
+		return uint32_t(chunk);
+	}
+
+private:
+
+	inline static uint64_t pow10(unsigned digits) noexcept {
+		static constexpr uint64_t powers[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+		return powers[digits];
+	}
+
+	/**
+	 * Parse the whole @str as strtoull() with the base 0 does.
+	 */
+	static bool parse_magnitude(std::string_view str, bool& negative, uint64_t& magnitude) noexcept {
+		negative = false;
+		if(not str.empty() && (str[0] == '-' || str[0] == '+')) {
+			negative = str[0] == '-';
+			str.remove_prefix(1);
+		}
+		if(str.size() > 1 && str[0] == '0') {
+			const bool hex = str[1] == 'x' || str[1] == 'X';
+			str.remove_prefix(hex ? 2 : 1);
+			const char* end = str.data() + str.size();
+			const auto [ptr, ec] = std::from_chars(str.data(), end, magnitude, hex ? 16 : 8);
+			return ec == std::errc() && ptr == end;
+		}
+		return not str.empty() && parse_digits(str, magnitude) == str.size();
 	}
 
 };
 
 }; // namespace utils
-
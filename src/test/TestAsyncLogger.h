@@ -0,0 +1,294 @@
+#pragma once
+
+#include "test_environment.h"
+#include <logger/Logger.h>
+
+#include <csignal>
+#include <cstring>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+class TestAsyncLogger {
+
+	static constexpr unsigned THREADS = 4;
+	static constexpr unsigned RECORDS = 1000;
+
+public:
+
+	TestAsyncLogger() noexcept {
+		test_format();
+		test_ring();
+		test_ring_short_tail();
+		test_fallback();
+		test_levels();
+		test_limited();
+		test_async();
+		test_chunked();
+		test_crash();
+	}
+
+private:
+
+	template <typename... Args>
+	static std::string format(const char* fmt, const Args&... args) noexcept {
+		const uint8_t types[] = {uint8_t(logger::LogArgs::type<Args>())..., 0};
+		uint8_t buffer[1024] = {};
+		uint8_t* ptr = buffer;
+		((ptr = logger::LogArgs::put(ptr, args)), ...);
+		static_cast<void>(ptr);
+		char out[1024];
+		const size_t len = logger::LogArgs::format(out, sizeof(out), fmt, types, sizeof...(Args), buffer);
+		assert(len == strlen(out));
+		return out;
+	}
+
+	static std::vector<std::string> read_lines(FILE* file) noexcept {
+		std::vector<std::string> result;
+		fflush(file);
+		rewind(file);
+		char line[4096];
+		while(fgets(line, sizeof(line), file)) {
+			result.emplace_back(line);
+		}
+		return result;
+	}
+
+	void test_format() noexcept {
+		TEST_TRACE;
+		assert(format("plain 100%%") == "plain 100%");
+		assert(format("%d %u %x", -5, 7u, 255) == "-5 7 ff");
+		assert(format("%zu|%5lld|%-4d|", size_t(1) << 40, -3ll, 9) == "1099511627776|   -3|9   |");
+		assert(format("%.2f %e", 3.14159, 1.5f) == "3.14 1.500000e+00");
+		const std::string str = "string";
+		assert(format("%s %s %.3s", "literal", str, std::string_view("view")) == "literal string vie");
+		assert(format("%c%c", 'o', 'k') == "ok");
+		assert(format("%d %d %u", INT32_MIN, INT64_MIN, UINT64_MAX) == "-2147483648 -9223372036854775808 18446744073709551615");
+		// a mismatching conversion prints the argument with its own type
+		assert(format("%s %d", 42, 2.5) == "42 2.5");
+		// the missing arguments and the unsupported conversions are printed as they are
+		assert(format("%d and %d", 1) == "1 and %d");
+		assert(format("%*d", 1, 2) == "%*d");
+		const std::string long_str(1000, 'a');
+		assert(format("%s", long_str).size() == logger::LogArgs::STRING_MAX);
+	}
+
+	void test_ring() noexcept {
+		TEST_TRACE;
+		logger::LogRing ring(100);
+		assert(ring.capacity() == 4096);
+		DiceMachine dice(42);
+		uint64_t pushed = 0, popped = 0, expected = 0;
+		// the payload of the record N is N % 100 bytes of N & 0xFF
+		for(unsigned round = 0; round < 1000; ++round) {
+			const unsigned burst = dice.u32() % 200;
+			for(unsigned i = 0; i < burst; ++i) {
+				const uint64_t value = pushed;
+				const size_t payload = value % 100;
+				if(not ring.push(1, value, payload, [&](uint8_t* ptr) { memset(ptr, int(value & 0xFF), payload); })) {
+					break;
+				}
+				pushed++;
+			}
+			popped += ring.pop_all([&](const logger::LogRing::Header& hdr, const uint8_t* payload) {
+				assert(hdr.site == 1 && hdr.tsc == expected);
+				assert(hdr.size % 8 == 0 && hdr.size >= sizeof(hdr) + expected % 100);
+				for(size_t i = 0; i < expected % 100; ++i) {
+					assert(payload[i] == (expected & 0xFF));
+				}
+				expected++;
+			});
+		}
+		assert(popped == pushed && ring.empty());
+		assert(ring.dropped() > 0);
+		// a record larger than a half of the ring never fits
+		assert(not ring.push(1, 0, ring.capacity() / 2, [](uint8_t*) {}));
+	}
+
+	/**
+	 * A push at capacity - 8, the tail is too short for a padding header.
+	 */
+	void test_ring_short_tail() noexcept {
+		TEST_TRACE;
+		logger::LogRing ring(4096);
+		size_t popped = 0;
+		const auto pop = [&]() {
+			popped += ring.pop_all([&](const logger::LogRing::Header& hdr, const uint8_t*) {
+				assert(hdr.site == 1 && hdr.size >= sizeof(hdr));
+			});
+		};
+		// 24 + 254 * 16 = capacity - 8
+		assert(ring.push(1, 0, 8, [](uint8_t* ptr) { memset(ptr, 0, 8); }));
+		pop();
+		for(unsigned i = 0; i < 254; ++i) {
+			assert(ring.push(1, i, 0, [](uint8_t*) {}));
+			pop();
+		}
+		assert(popped == 255);
+		assert(ring.push(2, 7, 40, [](uint8_t* ptr) { memset(ptr, 0x5A, 40); }));
+		const size_t read = ring.pop_all([&](const logger::LogRing::Header& hdr, const uint8_t* payload) {
+			assert(hdr.site == 2 && hdr.tsc == 7 && hdr.size == sizeof(hdr) + 40);
+			for(size_t i = 0; i < 40; ++i) {
+				assert(payload[i] == 0x5A);
+			}
+		});
+		assert(read == 1 && ring.empty());
+	}
+
+	void test_fallback() noexcept {
+		TEST_TRACE;
+		FILE* prev = Logger::log_file;
+		Logger::log_file = tmpfile();
+		assert(not logger::AsyncLogger::instance().running());
+		LOG_INFO("synchronous %d", 1);
+		LOG_CRITICAL("no arguments");
+		const auto lines = read_lines(Logger::log_file);
+		assert(lines.size() == 2);
+		assert(lines[0].find("[info] test_fallback() ") != std::string::npos);
+		assert(lines[0].find(" synchronous 1\n") != std::string::npos);
+		assert(lines[1].find("[critical] test_fallback() ") != std::string::npos);
+		fclose(Logger::log_file);
+		Logger::log_file = prev;
+	}
+
+	void test_levels() noexcept {
+		TEST_TRACE;
+		FILE* prev = Logger::log_file;
+		Logger::log_file = tmpfile();
+		assert(logger::LogLevel::get() == logger::LEVEL_INFO);
+		unsigned evaluated = 0;
+		LOG_TRACE("trace %u", ++evaluated);
+		LOG_DEBUG("debug %u", ++evaluated);
+		LOG_WARN("warn %u", ++evaluated);
+		logger::LogLevel::set(logger::LEVEL_CRITICAL);
+		LOG_INFO("info %u", ++evaluated);
+		LOG_CRITICAL("critical %u", ++evaluated);
+		logger::LogLevel::set(logger::LEVEL_TRACE);
+		LOG_TRACE("trace %u", ++evaluated);
+		logger::LogLevel::set(logger::LEVEL_INFO);
+		// the arguments of the skipped records are not evaluated
+		assert(evaluated == 3);
+		const auto lines = read_lines(Logger::log_file);
+		assert(lines.size() == 3);
+		assert(lines[0].find("[warn] test_levels() ") != std::string::npos && lines[0].find(" warn 1\n") != std::string::npos);
+		assert(lines[1].find("[critical] ") != std::string::npos && lines[1].find(" critical 2\n") != std::string::npos);
+		assert(lines[2].find("[trace] ") != std::string::npos && lines[2].find(" trace 3\n") != std::string::npos);
+		fclose(Logger::log_file);
+		Logger::log_file = prev;
+	}
+
+	void test_limited() noexcept {
+		TEST_TRACE;
+		auto& log = logger::AsyncLogger::instance();
+		FILE* out = tmpfile();
+		const auto before = log.stat();
+		assert(log.start(out));
+		for(unsigned i = 0; i < 1000; ++i) {
+			LOG_WARN_LIMITED(10, 60000, "link flap %u", i);
+		}
+		log.stop();
+		assert(log.stat().suppressed - before.suppressed == 990);
+		const auto lines = read_lines(out);
+		// the passed records and the summary of the rest written by stop()
+		assert(lines.size() == 11);
+		for(unsigned i = 0; i < 10; ++i) {
+			assert(lines[i].find("link flap " + std::to_string(i) + "\n") != std::string::npos);
+		}
+		assert(lines[10].find("[warn] test_limited() ") != std::string::npos);
+		assert(lines[10].find(" 990 similar records suppressed\n") != std::string::npos);
+		fclose(out);
+	}
+
+	void test_async() noexcept {
+		TEST_TRACE;
+		auto& log = logger::AsyncLogger::instance();
+		FILE* out = tmpfile();
+		assert(log.start(out));
+		assert(log.running() && not log.start(out));
+		const auto before = log.stat();
+
+		std::vector<std::thread> threads;
+		for(unsigned t = 0; t < THREADS; ++t) {
+			threads.emplace_back([t]() {
+				for(unsigned i = 0; i < RECORDS; ++i) {
+					LOG_INFO("thread %u record %u %s", t, i, "payload");
+				}
+			});
+		}
+		for(auto& thread : threads) {
+			thread.join();
+		}
+		log.stop();
+		assert(not log.running());
+
+		const auto stat = log.stat();
+		const auto lines = read_lines(out);
+		std::vector<unsigned> next(THREADS, 0);
+		size_t records = 0;
+		for(const auto& line : lines) {
+			const size_t pos = line.find("thread ");
+			if(pos == std::string::npos) {
+				assert(line.find("[logger]") == 0);
+				continue;
+			}
+			unsigned t = 0, i = 0;
+			assert(sscanf(line.c_str() + pos, "thread %u record %u payload", &t, &i) == 2);
+			// the records of a thread keep their order
+			assert(t < THREADS && i >= next[t]);
+			next[t] = i + 1;
+			records++;
+		}
+		assert(records == stat.records - before.records);
+		assert(records + stat.dropped - before.dropped == THREADS * RECORDS);
+		fclose(out);
+	}
+
+	/**
+	 * The crash handler writes the pending records of a child killed by SIGABRT.
+	 */
+	void test_crash() noexcept {
+		TEST_TRACE;
+		FILE* out = tmpfile();
+		assert(out);
+		const pid_t pid = fork();
+		assert(pid >= 0);
+		if(pid == 0) {
+			auto& log = logger::AsyncLogger::instance();
+			if(log.start(out)) {
+				logger::AsyncLogger::install_crash_handler();
+				LOG_CRITICAL("crashing %d", 6);
+				abort();
+			}
+			_exit(1);
+		}
+		int status = 0;
+		waitpid(pid, &status, 0);
+		assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+		const auto lines = read_lines(out);
+		assert(lines.size() == 1);
+		assert(lines[0].find("[critical] test_crash() ") != std::string::npos);
+		assert(lines[0].find(" crashing 6\n") != std::string::npos);
+		fclose(out);
+	}
+
+	void test_chunked() noexcept {
+		TEST_TRACE;
+		char root[] = "/tmp/test_logger_XXXXXX";
+		assert(mkdtemp(root));
+		{
+			utils::ChunkedFile file(root, "log_", "txt");
+			auto& log = logger::AsyncLogger::instance();
+			assert(log.start(file));
+			LOG_INFO("chunked %s", "record");
+			log.flush();
+			log.stop();
+			const long size = ftell(file.get());
+			assert(size > 0);
+		}
+		const std::string cmd = std::string("rm -rf ") + root;
+		assert(system(cmd.c_str()) == 0);
+	}
+
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "test_environment.h"
+#include <containers/ordered/BPlusTree.h>
+
+#include <map>
+
+class TestBPlusTree {
+
+public:
+
+	TestBPlusTree() noexcept {
+		test_random<uint32_t, 256>(100000);
+		test_random<uint64_t, 128>(20000);
+		test_sequential();
+		test_exhaustion();
+	}
+
+private:
+
+	template <typename Tree, typename Map>
+	static void check_equal(const Tree& tree, const Map& map) noexcept {
+		assert(tree.size() == map.size());
+		auto it = tree.begin();
+		for(const auto& kv : map) {
+			assert(it.valid() && it.key() == kv.first && it.value() == kv.second);
+			it.next();
+		}
+		assert(not it.valid());
+	}
+
+	template <typename Key, size_t NodeBytes>
+	void test_random(size_t ops) noexcept {
+		TEST_TRACE;
+		using Tree_t = BPlusTree<Key, uint32_t, NodeBytes>;
+		Tree_t tree(ops / 4);
+		assert(tree.allocate() == 0);
+		std::map<Key, uint32_t> map;
+		DiceMachine dice(NodeBytes);
+		const Key range = Key(ops / 2);
+
+		for(size_t i = 0; i < ops; ++i) {
+			const Key key = Key(dice.u64() % range);
+			// the inserts prevail, then the erases empty the tree
+			if(i < ops * 3 / 4 ? dice.pass(0.7) : false) {
+				assert(tree.insert(key, uint32_t(i)));
+				map[key] = uint32_t(i);
+			} else {
+				assert(tree.erase(key) == (map.erase(key) != 0));
+			}
+			if(i % 5000 == 0) {
+				check_equal(tree, map);
+			}
+			const Key probe = Key(dice.u64() % range);
+			const uint32_t* value = tree.find(probe);
+			const auto found = map.find(probe);
+			assert((value != nullptr) == (found != map.end()));
+			assert(not value || *value == found->second);
+			auto it = tree.lower_bound(probe);
+			const auto lower = map.lower_bound(probe);
+			assert(it.valid() == (lower != map.end()));
+			assert(not it.valid() || it.key() == lower->first);
+		}
+		check_equal(tree, map);
+		for(const auto& kv : std::map<Key, uint32_t>(map)) {
+			assert(tree.erase(kv.first));
+		}
+		assert(tree.size() == 0 && tree.height() == 0 && not tree.begin().valid());
+		// all the nodes are back but the root leaf
+		assert(tree.used_bytes() <= 256);
+	}
+
+	void test_sequential() noexcept {
+		TEST_TRACE;
+		BPlusTree<uint32_t, uint32_t> tree(10000);
+		assert(tree.allocate() == 0);
+		for(uint32_t key = 0; key < 100000; ++key) {
+			assert(tree.insert(key, key * 2));
+		}
+		assert(tree.height() >= 2);
+		uint32_t expected = 500;
+		for(auto it = tree.lower_bound(500); it.valid() && it.key() < 1500; it.next()) {
+			assert(it.key() == expected && it.value() == expected * 2);
+			++expected;
+		}
+		assert(expected == 1500);
+		for(uint32_t key = 0; key < 100000; key += 2) {
+			assert(tree.erase(key));
+		}
+		assert(tree.size() == 50000);
+		assert(*tree.find(99999) == 199998 && tree.find(99998) == nullptr);
+		tree.clear();
+		assert(tree.size() == 0 && tree.find(1) == nullptr);
+	}
+
+	void test_exhaustion() noexcept {
+		TEST_TRACE;
+		using Tree_t = BPlusTree<uint32_t, uint32_t>;
+		Tree_t tree(4, 4);
+		assert(tree.allocate() == 0);
+		uint32_t key = 0;
+		while(tree.insert(key, key)) {
+			++key;
+		}
+		// the failed insert changes nothing
+		assert(tree.size() == key && tree.find(key) == nullptr);
+		for(uint32_t i = 0; i < key; ++i) {
+			assert(*tree.find(i) == i);
+		}
+		assert(key >= 4 * Tree_t::LEAF_KEYS / 2);
+		assert(tree.erase(0));
+		// the freed slot is usable again
+		assert(tree.insert(0, 0));
+	}
+
+};
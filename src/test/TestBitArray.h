@@ -3,6 +3,8 @@
 #include "test_environment.h"
 #include <containers/bits/BitArray.h>
 
+#include <vector>
+
 template <uint8_t Width, typename Chunk>
 class TestBitArrayInternal {
 	BitArray<Width, Chunk> m_bat;
@@ -21,6 +23,8 @@ public:
 		m_bat.allocate(capacity);
 		store_load_seq(step++);
 		store_load_rnd(step++);
+		load_store_range(step++);
+		fill_value();
 	}
 
 private:
@@ -86,6 +90,50 @@ private:
 		assert(sum_in == sum_out);
 	}
 
+	void load_store_range(unsigned step) {
+		const auto range = m_bat.range();
+		const auto item_nb = m_bat.capacity();
+		DiceMachine dice(step);
+		std::vector<Chunk> shadow(item_nb);
+		for(size_t i = 0; i < item_nb; ++i) {
+			shadow[i] = Chunk(dice.u64() % range);
+			m_bat.store(i, shadow[i]);
+		}
+
+		std::vector<Chunk> values(item_nb);
+		for(size_t round = 0; round < 1000; ++round) {
+			const size_t first = dice.u32() % item_nb;
+			const size_t count = (round % 2 ? dice.u32() % 20 : dice.u32() % (item_nb - first + 1));
+			const size_t last = std::min(first + count, item_nb);
+			m_bat.load_range(first, last - first, values.data());
+			for(size_t i = first; i < last; ++i) {
+				assert(values[i - first] == shadow[i]);
+			}
+
+			for(size_t i = first; i < last; ++i) {
+				shadow[i] = Chunk(dice.u64() % range);
+				values[i - first] = shadow[i];
+			}
+			m_bat.store_range(first, last - first, values.data());
+			// the neighbours stay untouched
+			for(size_t i = (first > 2 ? first - 2 : 0); i < std::min(last + 2, item_nb); ++i) {
+				assert(m_bat.load(i) == shadow[i]);
+			}
+		}
+		m_bat.load_range(0, item_nb, values.data());
+		assert(values == shadow);
+	}
+
+	void fill_value() {
+		const auto item_nb = m_bat.capacity();
+		for(const Chunk value : {Chunk(0), m_bat.value_max(), Chunk(m_bat.value_max() / 3)}) {
+			m_bat.fill(value);
+			for(size_t i = 0; i < item_nb; ++i) {
+				assert(m_bat.load(i) == value);
+			}
+		}
+	}
+
 //	void perf(size_t rounds) {
 //		TRACE_CALL;
 //		char buffer[999];
@@ -116,11 +164,15 @@ class TestBitArray {
 public:
 	explicit TestBitArray(size_t capacity) noexcept {
 		TEST_TRACE;
+		chunk_type_iteration<1>(capacity);
 		chunk_type_iteration<2>(capacity);
 		chunk_type_iteration<3>(capacity);
+		chunk_type_iteration<4>(capacity);
+		chunk_type_iteration<5>(capacity);
 		chunk_type_iteration<7>(capacity);
 		chunk_type_iteration<8>(capacity);
 		chunk_type_iteration<9>(capacity);
+		chunk_type_iteration<12>(capacity);
 		chunk_type_iteration<15>(capacity);
 		chunk_type_iteration<16>(capacity);
 		chunk_type_iteration<17>(capacity);
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "test_environment.h"
+#include <containers/bits/BitArray.h>
+#include <containers/bits/BitArrayT.h>
+#include <containers/bits/BitArrayAtomic.h>
+
+#include <thread>
+#include <vector>
+
+class TestBitArrayAtomic {
+
+	static constexpr size_t THREADS = 4;
+
+public:
+
+	TestBitArrayAtomic() noexcept {
+		test_operations<3, uint8_t>();
+		test_operations<12, uint16_t>();
+		test_operations<13, uint64_t>();
+		test_operations<16, uint64_t>();
+		test_layout();
+		test_concurrent_add<5>();
+		test_concurrent_add<16>();
+		test_concurrent_add<29>();
+		test_concurrent_store<7>();
+	}
+
+private:
+
+	template <uint8_t Width, typename Chunk>
+	void test_operations() noexcept {
+		TEST_TRACE;
+		BitArrayAtomic<Width, Chunk> array;
+		array.allocate(1000);
+		DiceMachine dice(Width);
+		std::vector<Chunk> shadow(array.capacity(), 0);
+		const Chunk max = array.value_max();
+
+		for(size_t round = 0; round < 20000; ++round) {
+			const size_t idx = dice.u32() % shadow.size();
+			const Chunk value = Chunk(dice.u64() & max);
+			switch(round % 3) {
+				case 0:
+					array.store(idx, value);
+					shadow[idx] = value;
+					break;
+				case 1: {
+					const Chunk delta = Chunk(dice.pass(0.5) ? 1 : value);
+					assert(array.fetch_add(idx, delta) == shadow[idx]);
+					shadow[idx] = delta >= max - shadow[idx] ? max : Chunk(shadow[idx] + delta);
+					break;
+				}
+				default: {
+					Chunk expected = dice.pass(0.5) ? shadow[idx] : value;
+					const bool equal = (expected == shadow[idx]);
+					assert(array.compare_exchange(idx, expected, Chunk(~value & max)) == equal);
+					assert(expected == shadow[idx]);
+					if(equal) {
+						shadow[idx] = Chunk(~value & max);
+					}
+				}
+			}
+			assert(array.load(idx) == shadow[idx]);
+		}
+		for(size_t i = 0; i < shadow.size(); ++i) {
+			assert(array.load(i) == shadow[i]);
+		}
+	}
+
+	void test_layout() noexcept {
+		TEST_TRACE;
+		// the same memory seen through the plain arrays
+		uint64_t buffer_msb[16] = {};
+		BitArray<11, uint64_t> plain_msb;
+		BitArrayAtomic<11> atomic_msb;
+		plain_msb.allocate(buffer_msb, sizeof(buffer_msb));
+		atomic_msb.allocate(buffer_msb, sizeof(buffer_msb));
+		assert(plain_msb.capacity() == atomic_msb.capacity());
+
+		uint64_t buffer_lsb[16] = {};
+		BitArrayT<11> plain_lsb;
+		BitArrayAtomic<11, uint64_t, BitArrayLayout::LSB_FIRST> atomic_lsb;
+		plain_lsb.allocate(buffer_lsb, sizeof(buffer_lsb));
+		atomic_lsb.allocate(buffer_lsb, sizeof(buffer_lsb));
+
+		for(size_t i = 0; i < atomic_msb.capacity(); ++i) {
+			atomic_msb.store(i, (i * 37) & 0x7FF);
+			atomic_lsb.store(i, (i * 37) & 0x7FF);
+		}
+		for(size_t i = 0; i < atomic_msb.capacity(); ++i) {
+			assert(plain_msb.load(i) == ((i * 37) & 0x7FF));
+			assert(plain_lsb.load(i) == ((i * 37) & 0x7FF));
+			plain_msb.store(i, i & 0x7FF);
+			plain_lsb.store(i, i & 0x7FF);
+		}
+		for(size_t i = 0; i < atomic_msb.capacity(); ++i) {
+			assert(atomic_msb.load(i) == (i & 0x7FF));
+			assert(atomic_lsb.load(i) == (i & 0x7FF));
+		}
+	}
+
+	/**
+	 * All the threads increment all the items, the neighbours share chunks.
+	 */
+	template <uint8_t Width>
+	void test_concurrent_add() noexcept {
+		TEST_TRACE;
+		constexpr size_t ITEMS = 512;
+		constexpr size_t ROUNDS = 200;
+		BitArrayAtomic<Width> array;
+		array.allocate(ITEMS);
+		array.fill(0);
+
+		std::vector<std::thread> threads;
+		for(size_t t = 0; t < THREADS; ++t) {
+			threads.emplace_back([&array, t]() {
+				for(size_t round = 0; round < ROUNDS; ++round) {
+					for(size_t i = 0; i < ITEMS; ++i) {
+						array.fetch_add((i + t) % ITEMS, 1);
+					}
+				}
+			});
+		}
+		for(auto& thread : threads) {
+			thread.join();
+		}
+		const uint64_t expected = std::min<uint64_t>(THREADS * ROUNDS, array.value_max());
+		for(size_t i = 0; i < ITEMS; ++i) {
+			assert(array.load(i) == expected);
+		}
+	}
+
+	/**
+	 * Every thread owns every THREADS'th item and checks its own items are never corrupted.
+	 */
+	template <uint8_t Width>
+	void test_concurrent_store() noexcept {
+		TEST_TRACE;
+		constexpr size_t ITEMS = 1000;
+		BitArrayAtomic<Width, uint32_t> array;
+		array.allocate(ITEMS);
+		array.fill(0);
+
+		std::vector<std::thread> threads;
+		for(size_t t = 0; t < THREADS; ++t) {
+			threads.emplace_back([&array, t]() {
+				DiceMachine dice(t);
+				std::vector<uint32_t> mine(ITEMS, 0);
+				for(size_t round = 0; round < 100000; ++round) {
+					const size_t idx = (dice.u32() % (ITEMS / THREADS)) * THREADS + t;
+					const uint32_t value = dice.u32() & array.value_max();
+					uint32_t expected = mine[idx];
+					assert(array.compare_exchange(idx, expected, value));
+					mine[idx] = value;
+					assert(array.load(idx) == value);
+				}
+			});
+		}
+		for(auto& thread : threads) {
+			thread.join();
+		}
+	}
+
+};
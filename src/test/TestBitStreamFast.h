@@ -0,0 +1,191 @@
+#pragma once
+
+#include "test_environment.h"
+#include <containers/bits/BitStream.h>
+#include <containers/bits/BitStreamFast.h>
+
+#include <vector>
+
+class TestBitStreamFast {
+
+	struct Field {
+		uint64_t value;
+		unsigned bits;
+	};
+
+public:
+
+	TestBitStreamFast() noexcept {
+		test_fields();
+		test_compatibility();
+		test_gamma();
+		test_varint();
+		test_bounds();
+	}
+
+private:
+
+	static std::vector<Field> random_fields(uint64_t seed, size_t count) noexcept {
+		DiceMachine dice(seed);
+		std::vector<Field> fields(count);
+		for(auto& field : fields) {
+			field.bits = dice.u32() % 65u;
+			field.value = field.bits < 64u ? dice.u64() & ~(~0ull << field.bits) : dice.u64();
+		}
+		return fields;
+	}
+
+	void test_fields() noexcept {
+		TEST_TRACE;
+		// every size checks another tail: the last 8 bytes are handled byte by byte
+		for(size_t count : {1, 2, 3, 10, 100, 5000}) {
+			const auto fields = random_fields(count, count);
+			std::vector<uint8_t> buffer(count * 8 + 8, 0xAA);
+			BitStreamWriter writer(buffer.data(), buffer.size());
+			size_t bits = 0;
+			for(const auto& field : fields) {
+				writer.write(field.value, field.bits);
+				bits += field.bits;
+				assert(writer.offset() == bits);
+			}
+			const size_t bytes = writer.finish();
+			assert(writer.good());
+			assert(bytes == (bits + 7) / 8);
+
+			BitStreamReader reader(buffer.data(), bytes);
+			for(const auto& field : fields) {
+				if(field.bits <= BitStreamReader::PEEK_MAX && field.bits % 3 == 0) {
+					assert(reader.peek(field.bits) == field.value);
+					reader.skip(field.bits);
+				} else {
+					assert(reader.read(field.bits) == field.value);
+				}
+			}
+			assert(reader.offset() == bits);
+			assert(reader.available() == bytes * 8 - bits);
+			assert(reader.read(reader.available()) == 0);
+			assert(reader.good());
+		}
+	}
+
+	/**
+	 * The streams are interchangeable with BitStream in both directions.
+	 */
+	void test_compatibility() noexcept {
+		TEST_TRACE;
+		const auto fields = random_fields(17, 1000);
+		std::vector<uint8_t> fast(1000 * 8, 0);
+		std::vector<uint8_t> plain(1000 * 8, 0);
+
+		BitStreamWriter writer(fast.data(), fast.size());
+		BitStream bs(plain.data(), plain.size());
+		for(const auto& field : fields) {
+			writer.write(field.value, field.bits);
+			assert(bs.write(field.value, BitStream::Width_t(field.bits)));
+		}
+		writer.finish();
+		assert(fast == plain);
+
+		BitStreamReader reader(plain.data(), plain.size());
+		bs.reset();
+		BitStream::Chunk_t value;
+		for(const auto& field : fields) {
+			assert(bs.read(value, BitStream::Width_t(field.bits)));
+			assert(reader.read(field.bits) == value);
+		}
+	}
+
+	void test_gamma() noexcept {
+		TEST_TRACE;
+		DiceMachine dice(3);
+		std::vector<uint64_t> values = {1, 2, 3, 4, 7, 8, 1ull << 27, (1ull << 28) - 1, 1ull << 28, ~0ull, 1ull << 63};
+		for(size_t i = 0; i < 3000; ++i) {
+			// the geometric distribution over the widths
+			values.push_back((dice.u64() >> (dice.u32() % 64)) | 1u);
+		}
+		std::vector<uint8_t> buffer(values.size() * 16);
+		BitStreamWriter writer(buffer.data(), buffer.size());
+		for(auto value : values) {
+			const size_t offset = writer.offset();
+			writer.write_gamma(value);
+			assert(writer.offset() - offset == size_t(127 - 2 * __builtin_clzll(value)));
+		}
+		const size_t bytes = writer.finish();
+
+		BitStreamReader reader(buffer.data(), bytes);
+		for(auto value : values) {
+			assert(reader.read_gamma() == value);
+		}
+		assert(reader.good());
+
+		// a stream of zeros is not a code
+		const uint8_t zeros[16] = {};
+		BitStreamReader broken(zeros, sizeof(zeros));
+		broken.read_gamma();
+		assert(not broken.good());
+	}
+
+	void test_varint() noexcept {
+		TEST_TRACE;
+		assert(BitStreamWriter::zigzag(0) == 0);
+		assert(BitStreamWriter::zigzag(-1) == 1);
+		assert(BitStreamWriter::zigzag(1) == 2);
+		assert(BitStreamWriter::zigzag(INT64_MIN) == ~0ull);
+		assert(BitStreamReader::unzigzag(~0ull) == INT64_MIN);
+		assert(BitStreamReader::unzigzag(BitStreamWriter::zigzag(INT64_MAX)) == INT64_MAX);
+
+		// the byte aligned varints are the usual LEB128
+		uint8_t buffer[32];
+		BitStreamWriter leb(buffer, sizeof(buffer));
+		leb.write_varint(300);
+		assert(leb.finish() == 2);
+		assert(buffer[0] == 0xAC && buffer[1] == 0x02);
+
+		DiceMachine dice(9);
+		std::vector<int64_t> values = {0, 1, -1, 63, -64, 64, INT64_MAX, INT64_MIN};
+		for(size_t i = 0; i < 3000; ++i) {
+			values.push_back(int64_t(dice.u64()) >> (dice.u32() % 64));
+		}
+		std::vector<uint8_t> stream(values.size() * 24);
+		BitStreamWriter writer(stream.data(), stream.size());
+		for(size_t i = 0; i < values.size(); ++i) {
+			// the odd bit fields misalign the varints
+			writer.write(i, i % 5);
+			writer.write_svarint(values[i]);
+			writer.write_varint(uint64_t(values[i]));
+		}
+		const size_t bytes = writer.finish();
+		assert(writer.good());
+
+		BitStreamReader reader(stream.data(), bytes);
+		for(size_t i = 0; i < values.size(); ++i) {
+			assert(reader.read(i % 5) == (i & ~(~0ull << (i % 5))));
+			assert(reader.read_svarint() == values[i]);
+			assert(reader.read_varint() == uint64_t(values[i]));
+		}
+		assert(reader.good());
+	}
+
+	void test_bounds() noexcept {
+		TEST_TRACE;
+		uint8_t buffer[5] = {};
+		BitStreamWriter writer(buffer, sizeof(buffer));
+		writer.write(0x123456789ull, 36);
+		assert(writer.good());
+		writer.write(0xF, 4);
+		assert(writer.good());
+		assert(writer.finish() == 5);
+		writer.write(1, 1);
+		writer.finish();
+		assert(not writer.good());
+		assert(buffer[0] == 0x12 && buffer[4] == 0x9F);
+
+		BitStreamReader reader(buffer, sizeof(buffer));
+		assert(reader.read(40) == 0x123456789Full);
+		assert(reader.available() == 0);
+		assert(reader.good());
+		assert(reader.read(3) == 0);
+		assert(not reader.good());
+	}
+
+};
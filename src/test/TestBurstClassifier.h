@@ -0,0 +1,212 @@
+#pragma once
+
+#include "test_environment.h"
+#include "TestMetaParser.h"
+#include <proto/parsers/BurstClassifier.h>
+#include <proto/parsers/MetaParser.h>
+
+#include <vector>
+
+class TestBurstClassifier {
+
+	using Packet_t = std::vector<uint8_t>;
+	using Meta_t = proto::BurstMeta<16>;
+	using Classifier_t = proto::BurstClassifier;
+
+public:
+
+	TestBurstClassifier() noexcept {
+		test_classes();
+		test_truncated();
+		test_random();
+	}
+
+private:
+
+	/**
+	 * Build a packet of the @kind kind. There are 8 kinds in total.
+	 */
+	static void make_packet(Packet_t& pkt, size_t kind, uint16_t port) noexcept {
+		pkt.clear();
+		switch(kind % 8u) {
+			case 0:
+				TestMetaParser::put_ethernet(pkt, ETH_P_IP);
+				TestMetaParser::put_ipv4(pkt, 1, 2, proto::IPv4::PROTO_TCP, 20 + 10);
+				TestMetaParser::put_tcp(pkt, port, 80);
+				break;
+			case 1:
+				TestMetaParser::put_ethernet(pkt, ETH_P_IP);
+				TestMetaParser::put_ipv4(pkt, 1, 2, proto::IPv4::PROTO_UDP, 8 + 10);
+				TestMetaParser::put_udp(pkt, port, 53, 10);
+				break;
+			case 2:
+				TestMetaParser::put_ethernet(pkt, ETH_P_8021Q);
+				TestMetaParser::put_vlan(pkt, 10, ETH_P_IP);
+				TestMetaParser::put_ipv4(pkt, 1, 2, proto::IPv4::PROTO_UDP, 8 + 10);
+				TestMetaParser::put_udp(pkt, port, 53, 10);
+				break;
+			case 3:
+				TestMetaParser::put_ethernet(pkt, ETH_P_IPV6);
+				TestMetaParser::put_ipv6(pkt, 1, 2, proto::IPv6::PROTO_TCP, 20 + 10);
+				TestMetaParser::put_tcp(pkt, port, 443);
+				break;
+			case 4:
+				TestMetaParser::put_ethernet(pkt, ETH_P_8021Q);
+				TestMetaParser::put_vlan(pkt, 10, ETH_P_8021Q);
+				TestMetaParser::put_vlan(pkt, 20, ETH_P_IPV6);
+				TestMetaParser::put_ipv6(pkt, 1, 2, proto::IPv6::PROTO_UDP, 8 + 10);
+				TestMetaParser::put_udp(pkt, port, 53, 10);
+				break;
+			case 5:
+				TestMetaParser::put_ethernet(pkt, ETH_P_IP);
+				TestMetaParser::put_ipv4(pkt, 1, 2, proto::IPv4::PROTO_UDP, 64, IP_MF);
+				break;
+			case 6:
+				TestMetaParser::put_ethernet(pkt, ETH_P_IP);
+				TestMetaParser::put_ipv4(pkt, 1, 2, proto::IPv4::PROTO_GRE, 4);
+				TestMetaParser::put(pkt, uint32_t(0));
+				break;
+			default:
+				TestMetaParser::put_ethernet(pkt, ETH_P_ARP);
+				break;
+		}
+		TestMetaParser::put_payload(pkt, 10);
+	}
+
+	static void compare(const Meta_t& lv, const Meta_t& rv, size_t nb) noexcept {
+		for(size_t i = 0; i < nb; ++i) {
+			assert(lv.stack[i] == rv.stack[i]);
+			assert(lv.ip_proto[i] == rv.ip_proto[i]);
+			assert(lv.off_l3[i] == rv.off_l3[i]);
+			assert(lv.off_l4[i] == rv.off_l4[i]);
+			assert(lv.port_src[i] == rv.port_src[i]);
+			assert(lv.port_dst[i] == rv.port_dst[i]);
+		}
+	}
+
+	/**
+	 * Cross-check a classified packet with MetaParser.
+	 */
+	static void validate(const Meta_t& out, size_t idx, const Packet_t& pkt, size_t size) noexcept {
+		proto::PacketMeta meta;
+		proto::MetaParser<>::parse_all(pkt.data(), size, meta);
+		const uint8_t stack = out.stack[idx];
+		if(stack & Classifier_t::CLASS_IPv4) {
+			assert(meta.proto_l3 == proto::L3_IPv4);
+		}
+		if(stack & Classifier_t::CLASS_IPv6) {
+			assert(meta.proto_l3 == proto::L3_IPv6);
+		}
+		if(stack & (Classifier_t::CLASS_IPv4 | Classifier_t::CLASS_IPv6)) {
+			assert(out.off_l3[idx] == meta.off_l3);
+			assert(out.ip_proto[idx] == meta.tuple.proto);
+		}
+		if(stack & Classifier_t::CLASS_FRAGMENT) {
+			assert(meta.fragment());
+		}
+		if(stack & Classifier_t::CLASS_TCP) {
+			assert(meta.proto_l4 == proto::L4_TCP);
+		}
+		if(stack & Classifier_t::CLASS_UDP) {
+			assert(meta.proto_l4 == proto::L4_UDP);
+		}
+		if(stack & (Classifier_t::CLASS_TCP | Classifier_t::CLASS_UDP)) {
+			assert(out.off_l4[idx] == meta.off_l4);
+			assert(out.port_src[idx] == meta.tuple.port_src);
+			assert(out.port_dst[idx] == meta.tuple.port_dst);
+		}
+	}
+
+	void test_classes() noexcept {
+		TEST_TRACE;
+		Packet_t pkts[Meta_t::BURST];
+		const uint8_t* buffers[Meta_t::BURST];
+		size_t sizes[Meta_t::BURST];
+		for(size_t i = 0; i < Meta_t::BURST; ++i) {
+			make_packet(pkts[i], i, uint16_t(1000 + i));
+			buffers[i] = pkts[i].data();
+			sizes[i] = pkts[i].size();
+		}
+
+		Meta_t out;
+		Classifier_t::classify(buffers, sizes, Meta_t::BURST, out);
+		for(size_t i = 0; i < Meta_t::BURST; i += 8) {
+			assert(out.stack[i + 0] == (Classifier_t::CLASS_IPv4 | Classifier_t::CLASS_TCP));
+			assert(out.off_l3[i + 0] == 14 && out.off_l4[i + 0] == 34);
+			assert(out.port_src[i + 0] == 1000 + i && out.port_dst[i + 0] == 80);
+			assert(out.stack[i + 1] == (Classifier_t::CLASS_IPv4 | Classifier_t::CLASS_UDP));
+			assert(out.stack[i + 2] == (Classifier_t::CLASS_VLAN | Classifier_t::CLASS_IPv4 | Classifier_t::CLASS_UDP));
+			assert(out.off_l3[i + 2] == 18 && out.off_l4[i + 2] == 38);
+			assert(out.stack[i + 3] == (Classifier_t::CLASS_IPv6 | Classifier_t::CLASS_TCP));
+			assert(out.off_l4[i + 3] == 54 && out.port_dst[i + 3] == 443);
+			assert(out.stack[i + 4] == (Classifier_t::CLASS_VLAN | Classifier_t::CLASS_QINQ
+				| Classifier_t::CLASS_IPv6 | Classifier_t::CLASS_UDP));
+			assert(out.off_l3[i + 4] == 22 && out.off_l4[i + 4] == 62);
+			assert(out.stack[i + 5] == (Classifier_t::CLASS_IPv4 | Classifier_t::CLASS_FRAGMENT));
+			assert(out.off_l4[i + 5] == 0 && out.port_src[i + 5] == 0);
+			assert(out.stack[i + 6] == (Classifier_t::CLASS_IPv4 | Classifier_t::CLASS_GRE));
+			assert(out.off_l4[i + 6] == 34 && out.ip_proto[i + 6] == proto::IPv4::PROTO_GRE);
+			assert(out.stack[i + 7] == 0 && out.off_l3[i + 7] == 0);
+		}
+
+		Meta_t out_scalar;
+		Classifier_t::classify_scalar(buffers, sizes, Meta_t::BURST, out_scalar);
+		compare(out, out_scalar, Meta_t::BURST);
+		for(size_t i = 0; i < Meta_t::BURST; ++i) {
+			validate(out, i, pkts[i], sizes[i]);
+		}
+	}
+
+	void test_truncated() noexcept {
+		TEST_TRACE;
+		Packet_t pkts[8];
+		size_t max_size = 0;
+		for(size_t kind = 0; kind < 8u; ++kind) {
+			make_packet(pkts[kind], kind, 1);
+			max_size = std::max(max_size, pkts[kind].size());
+		}
+
+		// every lane of the burst is cut at a different size
+		const uint8_t* buffers[Meta_t::BURST];
+		size_t sizes[Meta_t::BURST];
+		for(size_t size = 0; size <= max_size; ++size) {
+			for(size_t i = 0; i < Meta_t::BURST; ++i) {
+				const auto& pkt = pkts[i % 8u];
+				buffers[i] = pkt.data();
+				sizes[i] = std::min(pkt.size(), size + i / 8u);
+			}
+			Meta_t out, out_scalar;
+			Classifier_t::classify(buffers, sizes, Meta_t::BURST, out);
+			Classifier_t::classify_scalar(buffers, sizes, Meta_t::BURST, out_scalar);
+			compare(out, out_scalar, Meta_t::BURST);
+			for(size_t i = 0; i < Meta_t::BURST; ++i) {
+				validate(out, i, pkts[i % 8u], sizes[i]);
+			}
+		}
+	}
+
+	void test_random() noexcept {
+		TEST_TRACE;
+		DiceMachine dice(123456);
+		Packet_t pkts[Meta_t::BURST];
+		const uint8_t* buffers[Meta_t::BURST];
+		size_t sizes[Meta_t::BURST];
+		for(size_t round = 0; round < 1000; ++round) {
+			const size_t nb = 1 + dice.u32() % Meta_t::BURST;
+			for(size_t i = 0; i < nb; ++i) {
+				make_packet(pkts[i], dice.u32(), uint16_t(dice.u32()));
+				// random header corruption
+				if(dice.pass(0.2)) {
+					pkts[i][dice.u32() % pkts[i].size()] = uint8_t(dice.u32());
+				}
+				buffers[i] = pkts[i].data();
+				sizes[i] = dice.pass(0.7) ? pkts[i].size() : dice.u32() % (pkts[i].size() + 1);
+			}
+			Meta_t out, out_scalar;
+			Classifier_t::classify(buffers, sizes, nb, out);
+			Classifier_t::classify_scalar(buffers, sizes, nb, out_scalar);
+			compare(out, out_scalar, nb);
+		}
+	}
+
+};
@@ -0,0 +1,254 @@
+#pragma once
+
+#include "test_environment.h"
+#include "TestMetaParser.h"
+#include <proto/Checksum.h>
+#include <proto/Rewriter.h>
+#include <utils/Cpu.h>
+
+#include <vector>
+
+class TestChecksum {
+
+	using Packet_t = std::vector<uint8_t>;
+	using Checksum_t = proto::Checksum;
+	using Rewriter_t = proto::Rewriter;
+
+public:
+
+	TestChecksum() noexcept {
+		test_kernels();
+		test_ipv4_header();
+		test_ipv4_tcp();
+		test_ipv6_udp();
+		test_incremental();
+		test_random_rewrite();
+	}
+
+private:
+
+	/**
+	 * RFC 1071 reference: big endian words, the end-around carry on every step.
+	 * @return The one's complement sum in host byte order.
+	 */
+	static uint16_t reference(const uint8_t* data, size_t size, uint32_t acc = 0) noexcept {
+		for(size_t i = 0; i < size; i += 2) {
+			acc += uint32_t(data[i]) << 8u;
+			if(i + 1 < size) {
+				acc += data[i + 1];
+			}
+			acc = (acc & 0xFFFFu) + (acc >> 16u);
+		}
+		return uint16_t(acc);
+	}
+
+	static Packet_t make_ipv4(uint8_t proto, size_t payload, uint16_t frag = 0) noexcept {
+		Packet_t pkt;
+		const size_t l4 = (proto == proto::IPv4::PROTO_TCP ? sizeof(proto::Tcp::Header) : sizeof(proto::Udp::Header));
+		TestMetaParser::put_ipv4(pkt, 0xC0A80001, 0x0A0000C7, proto, uint16_t(l4 + payload), frag);
+		if(proto == proto::IPv4::PROTO_TCP) {
+			TestMetaParser::put_tcp(pkt, 40000, 443);
+		} else {
+			TestMetaParser::put_udp(pkt, 5353, 53, uint16_t(payload));
+		}
+		for(size_t i = 0; i < payload; ++i) {
+			pkt.push_back(uint8_t(i * 7 + 1));
+		}
+		return pkt;
+	}
+
+	static Packet_t make_ipv6(uint8_t proto, size_t payload) noexcept {
+		Packet_t pkt;
+		const size_t l4 = (proto == proto::IPv6::PROTO_TCP ? sizeof(proto::Tcp::Header) : sizeof(proto::Udp::Header));
+		TestMetaParser::put_ipv6(pkt, 1, 2, proto, uint16_t(l4 + payload));
+		if(proto == proto::IPv6::PROTO_TCP) {
+			TestMetaParser::put_tcp(pkt, 40000, 443);
+		} else {
+			TestMetaParser::put_udp(pkt, 5353, 53, uint16_t(payload));
+		}
+		for(size_t i = 0; i < payload; ++i) {
+			pkt.push_back(uint8_t(i * 3 + 5));
+		}
+		return pkt;
+	}
+
+	static bool verify(Packet_t& pkt) noexcept {
+		proto::RwMFrame frame(pkt.data(), pkt.size());
+		return Rewriter_t::verify_checksums(frame);
+	}
+
+	static bool update(Packet_t& pkt) noexcept {
+		proto::RwMFrame frame(pkt.data(), pkt.size());
+		return Rewriter_t::update_checksums(frame);
+	}
+
+	void test_kernels() noexcept {
+		TEST_TRACE;
+		DiceMachine dice(5);
+		Packet_t data(10000);
+		for(auto& byte : data) {
+			byte = uint8_t(dice.u32());
+		}
+		// the worst case for the carries
+		memset(data.data() + 8000, 0xFF, 2000);
+
+		for(size_t i = 0; i < 2000; ++i) {
+			const size_t off = dice.u32() % 64;
+			const size_t size = (i < 200 ? i : dice.u32() % (data.size() - off));
+			const uint8_t* ptr = (i % 10 ? data.data() + off : data.data() + data.size() - size);
+			const uint16_t expected = reference(ptr, size);
+			assert(ntohs(Checksum_t::fold(Checksum_t::sum_scalar(ptr, size, 0))) == expected);
+			assert(ntohs(Checksum_t::fold(Checksum_t::sum_sse2(ptr, size, 0))) == expected);
+			if(utils::Cpu::avx2()) {
+				assert(ntohs(Checksum_t::fold(Checksum_t::sum_avx2(ptr, size, 0))) == expected);
+			}
+			assert(ntohs(Checksum_t::fold(Checksum_t::sum(ptr, size))) == expected);
+
+			// the partial sums are chained on even boundaries
+			const size_t half = (size / 2) & ~size_t(1);
+			const uint64_t acc = Checksum_t::sum(ptr, half);
+			assert(ntohs(Checksum_t::fold(Checksum_t::sum(ptr + half, size - half, acc))) == expected);
+		}
+	}
+
+	void test_ipv4_header() noexcept {
+		TEST_TRACE;
+		// the well known sample header: the checksum is 0xB861
+		const uint8_t sample[] = {
+			0x45, 0x00, 0x00, 0x73, 0x00, 0x00, 0x40, 0x00, 0x40, 0x11,
+			0x00, 0x00, 0xC0, 0xA8, 0x00, 0x01, 0xC0, 0xA8, 0x00, 0xC7
+		};
+		Packet_t hdr(sample, sample + sizeof(sample));
+		auto ip = reinterpret_cast<proto::IPv4::Header*>(hdr.data());
+		assert(not proto::IPv4::verify_checksum(ip));
+		assert(proto::IPv4::update_checksum(ip) == 0xB861);
+		assert(hdr[10] == 0xB8 && hdr[11] == 0x61);
+		assert(proto::IPv4::verify_checksum(ip));
+		ip->ttl--;
+		assert(not proto::IPv4::verify_checksum(ip));
+	}
+
+	void test_ipv4_tcp() noexcept {
+		TEST_TRACE;
+		for(size_t payload : {0, 1, 2, 63, 64, 127, 128, 1460}) {
+			auto pkt = make_ipv4(proto::IPv4::PROTO_TCP, payload);
+			assert(not verify(pkt));
+			assert(update(pkt));
+			assert(verify(pkt));
+
+			// the pseudo-header is summed up byte by byte
+			auto ip = reinterpret_cast<const proto::IPv4::Header*>(pkt.data());
+			const size_t l4 = pkt.size() - sizeof(*ip);
+			const uint8_t pseudo[] = {
+				pkt[12], pkt[13], pkt[14], pkt[15], pkt[16], pkt[17], pkt[18], pkt[19]
+				, 0, proto::IPv4::PROTO_TCP, uint8_t(l4 >> 8u), uint8_t(l4)
+			};
+			assert(reference(pkt.data() + sizeof(*ip), l4, reference(pseudo, sizeof(pseudo))) == 0xFFFF);
+
+			pkt.back() ^= 0x10;
+			assert(not verify(pkt));
+		}
+
+		// a truncated frame
+		auto pkt = make_ipv4(proto::IPv4::PROTO_TCP, 100);
+		proto::RwMFrame frame(pkt.data(), pkt.size() - 1);
+		assert(not Rewriter_t::update_checksums(frame));
+	}
+
+	void test_ipv6_udp() noexcept {
+		TEST_TRACE;
+		for(size_t payload : {0, 1, 33, 512, 1400}) {
+			auto pkt = make_ipv6(proto::IPv6::PROTO_UDP, payload);
+			assert(not verify(pkt));
+			assert(update(pkt));
+			assert(verify(pkt));
+			pkt[sizeof(proto::IPv6::Header) - 1] ^= 0x01;
+			assert(not verify(pkt));
+		}
+
+		// the zero UDP checksum is valid over IPv4 only
+		auto v4 = make_ipv4(proto::IPv4::PROTO_UDP, 10);
+		proto::IPv4::update_checksum(reinterpret_cast<proto::IPv4::Header*>(v4.data()));
+		assert(verify(v4));
+		auto v6 = make_ipv6(proto::IPv6::PROTO_UDP, 10);
+		assert(not verify(v6));
+	}
+
+	void test_incremental() noexcept {
+		TEST_TRACE;
+		assert(Checksum_t::adjust(htons(0xDD2F), htons(0x5555), htons(0x3285)) == htons(0x0000));
+
+		auto pkt = make_ipv4(proto::IPv4::PROTO_UDP, 100);
+		assert(update(pkt));
+		proto::RwMFrame frame(pkt.data(), pkt.size());
+		assert(Rewriter_t::ipv4_src(frame, htonl(0x01020304)));
+		assert(Rewriter_t::ipv4_dst(frame, htonl(0xFFFFFFFF)));
+		assert(Rewriter_t::port_src(frame, htons(1)));
+		assert(Rewriter_t::port_dst(frame, htons(65535)));
+		assert(verify(pkt));
+		auto copy = pkt;
+		assert(update(copy));
+		assert(copy == pkt);
+
+		// the missing UDP checksum stays missing
+		auto zero = make_ipv4(proto::IPv4::PROTO_UDP, 100);
+		proto::IPv4::update_checksum(reinterpret_cast<proto::IPv4::Header*>(zero.data()));
+		proto::RwMFrame frame_zero(zero.data(), zero.size());
+		assert(Rewriter_t::ipv4_src(frame_zero, htonl(0x01020304)));
+		assert(Rewriter_t::port_dst(frame_zero, htons(7)));
+		assert(reinterpret_cast<const proto::Udp::Header*>(zero.data() + sizeof(proto::IPv4::Header))->check == 0);
+		assert(verify(zero));
+
+		// a non-first fragment has no L4 header, only the IP checksum changes
+		auto frag = make_ipv4(proto::IPv4::PROTO_TCP, 100, 10);
+		proto::IPv4::update_checksum(reinterpret_cast<proto::IPv4::Header*>(frag.data()));
+		auto frag_copy = frag;
+		proto::RwMFrame frame_frag(frag.data(), frag.size());
+		assert(Rewriter_t::ipv4_dst(frame_frag, htonl(0x0B000001)));
+		assert(not Rewriter_t::port_dst(frame_frag, htons(7)));
+		assert(verify(frag));
+		assert(memcmp(frag.data() + sizeof(proto::IPv4::Header), frag_copy.data() + sizeof(proto::IPv4::Header)
+			, frag.size() - sizeof(proto::IPv4::Header)) == 0);
+	}
+
+	void test_random_rewrite() noexcept {
+		TEST_TRACE;
+		DiceMachine dice(11);
+		for(size_t i = 0; i < 1000; ++i) {
+			const bool v4 = dice.pass(0.5);
+			const uint8_t proto = dice.pass(0.5) ? proto::IPv4::PROTO_TCP : proto::IPv4::PROTO_UDP;
+			const size_t payload = dice.u32() % 1500;
+			auto pkt = v4 ? make_ipv4(proto, payload) : make_ipv6(proto, payload);
+			assert(update(pkt));
+
+			proto::RwMFrame frame(pkt.data(), pkt.size());
+			if(v4) {
+				assert(Rewriter_t::ipv4_src(frame, dice.u32()));
+				assert(Rewriter_t::ipv4_dst(frame, dice.u32()));
+			} else {
+				proto::IPv6::Addr addr;
+				for(size_t k = 0; k < 4; ++k) {
+					addr.addr32[k] = dice.u32();
+				}
+				assert(Rewriter_t::ipv6_src(frame, addr));
+				addr.addr32[dice.u32() % 4] = 0;
+				assert(Rewriter_t::ipv6_dst(frame, addr));
+			}
+			assert(Rewriter_t::port_src(frame, uint16_t(dice.u32())));
+			assert(Rewriter_t::port_dst(frame, uint16_t(dice.u32())));
+			assert(verify(pkt));
+
+			// the incremental update may end up with 0xFFFF where the full one gives 0x0000 and vice versa
+			auto copy = pkt;
+			assert(update(copy));
+			const size_t off_check = (v4 ? sizeof(proto::IPv4::Header) : sizeof(proto::IPv6::Header))
+				+ (proto == proto::IPv4::PROTO_TCP ? offsetof(proto::Tcp::Header, crc) : offsetof(proto::Udp::Header, check));
+			for(size_t k = 0; k < pkt.size(); ++k) {
+				if(k != off_check && k != off_check + 1) {
+					assert(pkt[k] == copy[k]);
+				}
+			}
+		}
+	}
+
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "test_environment.h"
+#include <utils/ChunkedFile.h>
+
+#include <dirent.h>
+#include <string>
+#include <vector>
+
+class TestChunkedFile {
+	std::string m_root;
+
+public:
+
+	TestChunkedFile() noexcept {
+		char root[] = "/tmp/test_chunked_XXXXXX";
+		assert(mkdtemp(root));
+		m_root = root;
+		test_create_dir();
+		test_size_split();
+		test_compress();
+		const std::string cmd = "rm -rf " + m_root;
+		assert(system(cmd.c_str()) == 0);
+	}
+
+private:
+
+	/**
+	 * @return The names of the files in @dir.
+	 */
+	static std::vector<std::string> list(const std::string& dir) noexcept {
+		std::vector<std::string> result;
+		DIR* handle = opendir(dir.c_str());
+		assert(handle);
+		while(const dirent* entry = readdir(handle)) {
+			if(entry->d_name[0] != '.') {
+				result.emplace_back(entry->d_name);
+			}
+		}
+		closedir(handle);
+		return result;
+	}
+
+	static std::string dir_of(const std::string& path) noexcept {
+		return path.substr(0, path.rfind('/'));
+	}
+
+	void test_create_dir() noexcept {
+		TEST_TRACE;
+		const std::string dir = m_root + "/a/b//c/";
+		assert(utils::ChunkedFile::create_dir(dir) == 0);
+		assert(utils::ChunkedFile::create_dir(dir) == 0);
+		assert(access((m_root + "/a/b/c").c_str(), W_OK) == 0);
+		// a file on the way
+		FILE* file = fopen((m_root + "/a/file").c_str(), "w");
+		assert(file);
+		fclose(file);
+		assert(utils::ChunkedFile::create_dir(m_root + "/a/file/d") != 0);
+	}
+
+	void test_size_split() noexcept {
+		TEST_TRACE;
+		const std::string root = m_root + "/size/nested";
+		utils::ChunkedFile file(root.c_str(), "chunk_", "txt");
+		file.set_split_size(1000);
+		assert(file.open() == 0 && file.chunks() == 1);
+		const std::string dir = dir_of(file.path());
+		assert(dir_of(dir) == root);
+		std::vector<std::string> paths = {file.path()};
+		for(unsigned i = 0; i < 5; ++i) {
+			fprintf(file, "%01000u\n", i);
+			// the size is checked once per a clock tick
+			const timespec pause = {0, 20000000};
+			nanosleep(&pause, nullptr);
+			assert(file.update());
+			assert(file.path() != paths.back());
+			paths.push_back(file.path());
+		}
+		assert(not file.update());
+		file.close();
+		assert(file.chunks() == 6 && list(dir).size() == 6);
+	}
+
+	void test_compress() noexcept {
+		TEST_TRACE;
+		if(not utils::ChunkCompressor::available(utils::ChunkCompressor::CODEC_GZIP)) {
+			return;
+		}
+		const std::string root = m_root + "/compress";
+		utils::ChunkCompressor compressor(utils::ChunkCompressor::CODEC_GZIP);
+		std::vector<std::string> paths;
+		{
+			utils::ChunkedFile file(root.c_str(), "chunk_", "txt");
+			file.set_compressor(&compressor);
+			file.set_split_size(1);
+			assert(file.open() == 0);
+			for(unsigned i = 0; i < 3; ++i) {
+				paths.push_back(file.path());
+				for(unsigned line = 0; line < 1000; ++line) {
+					fprintf(file, "chunk %u line %u\n", i, line);
+				}
+				const timespec pause = {0, 20000000};
+				nanosleep(&pause, nullptr);
+				assert(file.update());
+			}
+			paths.push_back(file.path());
+		}
+		compressor.wait();
+		const auto stat = compressor.stat();
+		assert(stat.compressed == 4 && stat.failed == 0);
+		assert(stat.bytes_in > 0 && stat.bytes_out < stat.bytes_in);
+#ifdef UTILS_WITH_ZLIB
+		for(unsigned i = 0; i < 3; ++i) {
+			assert(access(paths[i].c_str(), F_OK) != 0);
+			gzFile in = gzopen((paths[i] + ".gz").c_str(), "rb");
+			assert(in);
+			char line[64];
+			for(unsigned n = 0; n < 1000; ++n) {
+				assert(gzgets(in, line, sizeof(line)));
+				assert(line == "chunk " + std::to_string(i) + " line " + std::to_string(n) + "\n");
+			}
+			assert(not gzgets(in, line, sizeof(line)));
+			gzclose(in);
+		}
+#endif
+	}
+
+};
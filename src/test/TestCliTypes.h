@@ -0,0 +1,188 @@
+#pragma once
+
+#include "test_environment.h"
+#include <cli/types/Float.h>
+#include <cli/types/Integer.h>
+#include <cli/types/IpAddress.h>
+#include <cli/types/MacAddress.h>
+
+#include <arpa/inet.h>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+class TestCliTypes {
+
+	using Ip_t = cli::IpAddress;
+
+public:
+
+	TestCliTypes() noexcept {
+		test_integer();
+		test_float();
+		test_mac_address();
+		test_ipv4();
+		test_ipv6();
+		test_networks();
+	}
+
+private:
+
+	void test_integer() noexcept {
+		TEST_TRACE;
+		int8_t i8 = 0;
+		uint16_t u16 = 0;
+		uint64_t u64 = 0;
+		assert(cli::Integer::parse("-128", i8) && i8 == -128);
+		assert(not cli::Integer::parse("-129", i8));
+		assert(cli::Integer::parse("+127", i8) && i8 == 127);
+		assert(not cli::Integer::parse("-1", u16));
+		assert(not cli::Integer::parse("65536", u16));
+		assert(not cli::Integer::parse("", u16));
+		assert(cli::Integer::parse("18446744073709551615", u64) && u64 == UINT64_MAX);
+		assert(cli::Integer::parse("0xFFff", u16, 16) && u16 == 0xFFFF);
+		assert(cli::Integer::parse("ffff", u16, 16) && u16 == 0xFFFF);
+		assert(cli::Integer::parse("-0x80", i8, 16) && i8 == -128);
+		assert(cli::Integer::parse("777", u16, 8) && u16 == 0777);
+		assert(not cli::Integer::parse("8", u16, 8));
+		assert(not cli::Integer::parse("1", u16, 0));
+
+		// a number in the middle of an argument
+		assert(cli::Integer::parse_offset("12-34", u16) == 2 && u16 == 12);
+		assert(cli::Integer::parse_offset("0x", u16, 16) == 1 && u16 == 0);
+		assert(cli::Integer::parse_offset(std::string_view("123456789", 4), u64) == 4 && u64 == 1234);
+		assert(cli::Integer::parse_offset(static_cast<const char*>(nullptr), u16) == 0);
+
+		// the leading spaces as for strtoll()
+		assert(cli::Integer::parse(" 42", u16) && u16 == 42);
+		assert(cli::Integer::parse_offset("\t-5,", i8) == 3 && i8 == -5);
+		assert(cli::Integer::parse(" 0x10", u16, 16) && u16 == 16);
+		assert(not cli::Integer::parse("- 5", i8));
+	}
+
+	void test_float() noexcept {
+		TEST_TRACE;
+		double value = 0;
+		assert(cli::Float::parse("1.5", value) && value == 1.5);
+		assert(cli::Float::parse("+1e3", value) && value == 1000.0);
+		assert(cli::Float::parse("-.25", value) && value == -0.25);
+		assert(not cli::Float::parse("1e999", value));
+		assert(not cli::Float::parse("1.5x", value));
+		assert(not cli::Float::parse("", value));
+		assert(cli::Float::parse_offset("2.5k", value) == 3 && value == 2.5);
+
+		// the forms of strtod(): the leading spaces and the hex floats
+		for(const char* str : {" 1.5", "\t-2e1", "0x1p3", "-0x1.8p1", "0X.8", "0xg", "0x", "+inf", "-Infinity", "1e-5e"}) {
+			char* end;
+			const double expected = strtod(str, &end);
+			assert(cli::Float::parse_offset(str, value) == size_t(end - str) && value == expected);
+		}
+		assert(cli::Float::parse("0x1p3", value) && value == 8.0);
+		assert(not cli::Float::parse("0x-1p3", value));
+		assert(not cli::Float::parse("+-1", value));
+		assert(not cli::Float::parse(" ", value));
+	}
+
+	void test_mac_address() noexcept {
+		TEST_TRACE;
+		const uint8_t expected[] = {0x00, 0x1B, 0x2c, 0xd0, 0xEe, 0xff};
+		for(const char* str : {"00:1b:2C:D0:ee:FF", "00-1B-2C-D0-EE-FF", "00.1b.2c.d0.ee.ff", "001b2cd0eeff"}) {
+			cli::MacAddress mac;
+			assert(mac.parse(str) == ssize_t(strlen(str)));
+			assert(mac == cli::MacAddress(expected, 6));
+		}
+		cli::MacAddress mac;
+		assert(mac.parse("0:1b:2c:d0:ee:f") == 15);
+		assert(mac.addr[0] == 0 && mac.addr[5] == 0x0F);
+		assert(mac.parse("00:1b:2c:d0:ee") < 0);
+		assert(mac.parse("00:1b:2c:d0:ee:fg") == 16);
+		assert(mac.parse(std::string_view("00:1b:2c:d0:ee:ff", 16)) == 16 && mac.addr[5] == 0x0F);
+	}
+
+	void test_ipv4() noexcept {
+		TEST_TRACE;
+		Ip_t::IPv4Addr_t addr = 0;
+		assert(Ip_t::parse("10.1.2.3", addr) && addr == proto::IPv4::addr_host(10, 1, 2, 3));
+		assert(Ip_t::parse("255.255.255.255", addr) && addr == 0xFFFFFFFFu);
+		assert(Ip_t::parse_offset("0.0.0.0:80", addr) == 7 && addr == 0);
+		for(const char* str : {"", "1.2.3", "1.2.3.4.", "256.1.1.1", "1.2.3.1000", "01.2.3.4", "1..2.3", "1.2.3.-4", " 1.2.3.4"}) {
+			assert(not Ip_t::parse(str, addr));
+		}
+		// against inet_pton()
+		DiceMachine dice(4);
+		char str[32];
+		for(int round = 0; round < 100000; ++round) {
+			const unsigned octets[] = {dice.u32() % 300u, dice.u32() % 256u, dice.u32() % 10u, dice.u32() % 256u};
+			snprintf(str, sizeof(str), (round & 1) ? "%u.%u.%u.%u" : "%u.%u.%u.%03u", octets[0], octets[1], octets[2], octets[3]);
+			in_addr expected;
+			const bool valid = inet_pton(AF_INET, str, &expected) == 1;
+			assert(Ip_t::parse(str, addr) == valid);
+			if(valid) {
+				assert(htonl(addr) == expected.s_addr);
+			}
+		}
+	}
+
+	void test_ipv6() noexcept {
+		TEST_TRACE;
+		const char* valid[] = {
+			"::", "::1", "1::", "1:2:3:4:5:6:7:8", "1:2:3:4:5:6:7::", "::2:3:4:5:6:7:8", "fe80::1:2", "FE80:0:0:0:0:0:0:1",
+			"::ffff:10.1.2.3", "1:2:3:4:5:6:10.1.2.3", "::10.1.2.3", "2001:db8::ff00:42:8329", "1:0:0:2::3",
+		};
+		const char* broken[] = {
+			"", ":", ":::", "1:", ":1", "1::2::3", "12345::", "1:2:3:4:5:6:7", "1:2:3:4:5:6:7:8:9", "::1:2:3:4:5:6:7:8",
+			"1:2:3:4:5:6:7:10.1.2.3", "::10.1.2", "::ffff:1.2.3.256", "g::", "1:2:3:4:5:6:7:8::", "::1.2.3.4:5",
+		};
+		Ip_t::IPv6Addr_t addr;
+		in6_addr expected;
+		for(const char* str : valid) {
+			assert(inet_pton(AF_INET6, str, &expected) == 1);
+			assert(Ip_t::parse(str, addr));
+			assert(memcmp(addr.addr8, expected.s6_addr, 16) == 0);
+		}
+		for(const char* str : broken) {
+			assert(inet_pton(AF_INET6, str, &expected) != 1);
+			assert(not Ip_t::parse(str, addr));
+		}
+		assert(Ip_t::parse_offset("[::1]:80", addr) == 0);
+		assert(Ip_t::parse_offset("::1]:80", addr) == 3);
+		// the text forms of inet_ntop() of the random addresses with the zero groups
+		DiceMachine dice(6);
+		char str[INET6_ADDRSTRLEN];
+		for(int round = 0; round < 100000; ++round) {
+			in6_addr random;
+			for(unsigned i = 0; i < 8; ++i) {
+				const uint16_t group = dice.pass(0.5) ? 0 : uint16_t(dice.u32() >> (dice.u32() % 16u));
+				random.s6_addr[i * 2] = uint8_t(group >> 8u);
+				random.s6_addr[i * 2 + 1] = uint8_t(group);
+			}
+			assert(inet_ntop(AF_INET6, &random, str, sizeof(str)));
+			assert(Ip_t::parse(str, addr));
+			assert(memcmp(addr.addr8, random.s6_addr, 16) == 0);
+		}
+	}
+
+	void test_networks() noexcept {
+		TEST_TRACE;
+		Ip_t::IPv4Net_t net;
+		assert(Ip_t::parse("10.1.2.3/8", net));
+		assert(net.addr == proto::IPv4::addr_host(10, 0, 0, 0) && net.mask == 0xFF000000u);
+		assert(Ip_t::parse("10.1.2.3", net) && net.addr == proto::IPv4::addr_host(10, 1, 2, 3) && net.mask == ~0u);
+		assert(Ip_t::parse("10.1.2.3/0", net) && net.addr == 0 && net.mask == 0);
+		assert(Ip_t::parse_offset("192.168.0.0/16 443", net) == 14 && net.mask == 0xFFFF0000u);
+		for(const char* str : {"10.0.0.0/", "10.0.0.0/33", "10.0.0.0/x", "10.0.0.0/0032", "/8"}) {
+			assert(not Ip_t::parse(str, net));
+		}
+
+		Ip_t::IPv6Net_t net6;
+		in6_addr expected;
+		assert(Ip_t::parse("2001:db8:ffff::1/35", net6) && net6.prefix == 35);
+		assert(inet_pton(AF_INET6, "2001:db8:e000::", &expected) == 1);
+		assert(memcmp(net6.addr.addr8, expected.s6_addr, 16) == 0);
+		assert(Ip_t::parse("::1", net6) && net6.prefix == 128 && net6.addr.addr8[15] == 1);
+		assert(Ip_t::parse("ffff::ffff/0", net6) && net6.prefix == 0);
+		assert(not Ip_t::parse("::/129", net6));
+	}
+
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "test_environment.h"
+#include <containers/LruPool.h>
+#include <intrusive/CuckooQueuePool.h>
+#include <intrusive/DequePool.h>
+#include <intrusive/HashQueuePool.h>
+#include <utils/ContainerStat.h>
+
+class TestContainerStat {
+
+	using Key_t = uint32_t;
+	using Node_t = intrusive::HashQueuePoolNode<Key_t, uint32_t>;
+	using Hasher_t = std::hash<Key_t>;
+	using Pool_t = intrusive::HashQueuePool<Node_t, Hasher_t, std::allocator<Node_t>
+		, std::allocator<intrusive::HashMapBucket<Node_t> >, true>;
+	using PlainPool_t = intrusive::HashQueuePool<Node_t>;
+	using DequeNode_t = intrusive::DequePoolNode<uint32_t>;
+	using Deque_t = intrusive::DequePool<DequeNode_t, std::allocator<DequeNode_t>, true>;
+	using CuckooNode_t = intrusive::CuckooQueuePoolNode<Key_t, uint32_t>;
+	using Cuckoo_t = intrusive::CuckooQueuePool<CuckooNode_t, utils::SipHasher<Key_t>
+		, std::allocator<CuckooNode_t>, std::allocator<intrusive::CuckooBucket>, true>;
+	using Lru_t = utils::LruPool<Key_t, uint32_t, Hasher_t, true>;
+
+public:
+
+	TestContainerStat() noexcept {
+		test_histogram();
+		test_hash_queue_pool();
+		test_deque_pool();
+		test_cuckoo_queue_pool();
+		test_lru_pool();
+	}
+
+private:
+
+	void test_histogram() noexcept {
+		TEST_TRACE;
+		using Histogram_t = utils::LatencyHistogram;
+		for(uint64_t value = 0; value < 100000; value += 1 + value / 64) {
+			const unsigned idx = Histogram_t::index(value);
+			assert(idx < Histogram_t::BUCKETS);
+			assert(value <= Histogram_t::highest(idx));
+			// the relative error is within 1 / SUB
+			assert(Histogram_t::highest(idx) - value <= value / Histogram_t::SUB);
+			assert(idx == 0 || Histogram_t::highest(idx - 1) < value);
+		}
+		assert(Histogram_t::index(~uint64_t(0)) == Histogram_t::BUCKETS - 1);
+
+		Histogram_t histogram;
+		assert(histogram.percentile(0.5) == 0);
+		for(uint64_t value = 1; value <= 1000; ++value) {
+			histogram.record(value);
+		}
+		assert(histogram.count == 1000 && histogram.max == 1000);
+		const uint64_t median = histogram.percentile(0.5);
+		assert(median >= 500 && median <= 500 + 500 / Histogram_t::SUB);
+		assert(histogram.percentile(1.0) >= 1000);
+
+		Histogram_t prev(histogram);
+		for(unsigned i = 0; i < 100; ++i) {
+			histogram.record(5);
+		}
+		const Histogram_t delta = histogram.since(prev);
+		assert(delta.count == 100 && delta.sum == 500);
+		assert(delta.percentile(0.99) == 5);
+	}
+
+	void test_hash_queue_pool() noexcept {
+		TEST_TRACE;
+		Pool_t pool(64, 0.5f);
+		assert(pool.allocate() == 0);
+		// the keys modulo the bucket number collide, so the chains grow
+		const Key_t stride = Key_t(64 / 0.5f + 1);
+		for(Key_t i = 0; i < 64; ++i) {
+			assert(pool.push_back(i % 8 * stride + i / 8));
+		}
+		assert(not pool.push_back(1000));
+		const utils::ContainerStat first = pool.stat();
+		assert(first.capacity == 64 && first.size == 64);
+		assert(first.inserts == 64 && first.failures == 1);
+
+		for(Key_t i = 0; i < 256; ++i) {
+			pool.find(i);
+		}
+		pool.remove(pool.find(0));
+		pool.pop_front();
+		const utils::ContainerStat second = pool.stat();
+		assert(second.lookups == 257 && second.hits == 17);
+		assert(second.probe_max == 8);
+		assert(second.removes == 2 && second.size == 62);
+		assert(second.latency.count == second.lookups / utils::StatCounter<true>::SAMPLE);
+		second.print(stdout, first);
+		printf("\n");
+
+		pool.reset_stat();
+		assert(pool.stat().lookups == 0);
+
+		PlainPool_t plain(64, 0.5f);
+		assert(plain.allocate() == 0);
+		plain.push_back(1);
+		plain.find(1);
+		const utils::ContainerStat disabled = plain.stat();
+		assert(disabled.size == 1 && disabled.lookups == 0 && disabled.inserts == 0);
+	}
+
+	void test_deque_pool() noexcept {
+		TEST_TRACE;
+		Deque_t pool(4);
+		assert(pool.allocate() == 0);
+		for(unsigned i = 0; i < 5; ++i) {
+			pool.push_back();
+		}
+		pool.pop_front();
+		pool.remove(pool.begin());
+		const utils::ContainerStat stat = pool.stat();
+		assert(stat.inserts == 4 && stat.failures == 1 && stat.removes == 2 && stat.size == 2);
+	}
+
+	void test_lru_pool() noexcept {
+		TEST_TRACE;
+		Lru_t pool(4, 1.0f);
+		for(Key_t i = 0; i < 6; ++i) {
+			pool.acquire(i);
+		}
+		pool.acquire(5);
+		pool.release(pool.find(5).get());
+		const utils::ContainerStat stat = pool.stat();
+		assert(stat.lookups == 8 && stat.hits == 2 && stat.evictions == 2);
+		assert(stat.inserts == 6 && stat.removes == 3 && stat.size == 3 && stat.capacity == 4);
+	}
+
+	void test_cuckoo_queue_pool() noexcept {
+		TEST_TRACE;
+		Cuckoo_t pool(1000, 0.9f, 1);
+		assert(pool.allocate() == 0);
+		for(Key_t i = 0; i < 1000; ++i) {
+			pool.push_back(i);
+		}
+		for(Key_t i = 0; i < 2000; ++i) {
+			pool.find(i);
+		}
+		const utils::ContainerStat stat = pool.stat();
+		assert(stat.inserts == 1000 && stat.lookups == 2000 && stat.hits == 1000);
+		assert(stat.probe_max <= 2 && stat.probes >= 2000 + 1000);
+		assert(stat.evictions == pool.evictions());
+	}
+
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "test_environment.h"
+#include <containers/sketch/CountMinSketch.h>
+
+#include <vector>
+
+class TestCountMinSketch {
+
+	using Sketch_t = sketch::CountMinSketch<8>;
+
+public:
+
+	TestCountMinSketch() noexcept {
+		test_accuracy();
+		test_saturation();
+		test_merge();
+		test_serialize();
+	}
+
+private:
+
+	/**
+	 * A skewed stream: the key k appears about KEYS / (k + 1) / 8 times.
+	 */
+	static std::vector<uint64_t> make_counts(size_t keys) noexcept {
+		std::vector<uint64_t> counts(keys);
+		for(size_t k = 0; k < keys; ++k) {
+			counts[k] = 1 + keys / (k + 1) / 8;
+		}
+		return counts;
+	}
+
+	void test_accuracy() noexcept {
+		TEST_TRACE;
+		constexpr size_t KEYS = 2000;
+		const auto counts = make_counts(KEYS);
+		Sketch_t plain(4, 1024);
+		Sketch_t conservative(4, 1024);
+		assert(plain.allocate() == 0);
+		assert(conservative.allocate() == 0);
+
+		uint64_t total = 0;
+		for(size_t k = 0; k < KEYS; ++k) {
+			for(uint64_t c = 0; c < counts[k]; ++c) {
+				plain.add(k);
+				conservative.add_conservative(k);
+			}
+			total += counts[k];
+		}
+		assert(plain.total() == total && conservative.total() == total);
+
+		uint64_t error_plain = 0;
+		uint64_t error_conservative = 0;
+		for(size_t k = 0; k < KEYS; ++k) {
+			const uint64_t expected = std::min(counts[k], Sketch_t::value_max());
+			const uint64_t est_plain = plain.estimate(k);
+			const uint64_t est_conservative = conservative.estimate(k);
+			assert(est_plain >= expected);
+			assert(est_conservative >= expected);
+			assert(est_conservative <= est_plain);
+			error_plain += est_plain - expected;
+			error_conservative += est_conservative - expected;
+		}
+		// the bound is total * e / columns per key
+		assert(error_plain < KEYS * total * 3 / 1024);
+		assert(error_conservative < error_plain);
+	}
+
+	void test_saturation() noexcept {
+		TEST_TRACE;
+		sketch::CountMinSketch<4> cms(2, 64);
+		assert(cms.allocate() == 0);
+		cms.add(1, 10);
+		cms.add(1, 10);
+		assert(cms.estimate(1) == 15);
+		cms.add_conservative(1, 100);
+		assert(cms.estimate(1) == 15);
+		cms.clear();
+		assert(cms.estimate(1) == 0 && cms.total() == 0);
+	}
+
+	void test_merge() noexcept {
+		TEST_TRACE;
+		Sketch_t all(3, 256, 7);
+		Sketch_t left(3, 256, 7);
+		Sketch_t right(3, 256, 7);
+		Sketch_t other_seed(3, 256, 8);
+		Sketch_t other_shape(3, 512, 7);
+		assert(all.allocate() == 0 && left.allocate() == 0 && right.allocate() == 0);
+		assert(other_seed.allocate() == 0 && other_shape.allocate() == 0);
+
+		DiceMachine dice(3);
+		for(size_t i = 0; i < 5000; ++i) {
+			const uint64_t key = dice.u32() % 300;
+			all.add(key);
+			(i % 2 ? left : right).add(key);
+		}
+		assert(left.merge(right));
+		assert(left.total() == all.total());
+		for(uint64_t key = 0; key < 300; ++key) {
+			assert(left.estimate(key) == all.estimate(key));
+		}
+		assert(not left.merge(other_seed));
+		assert(not left.merge(other_shape));
+	}
+
+	void test_serialize() noexcept {
+		TEST_TRACE;
+		Sketch_t source(4, 128, 1);
+		Sketch_t target(4, 128, 1);
+		Sketch_t other(4, 128, 2);
+		assert(source.allocate() == 0 && target.allocate() == 0 && other.allocate() == 0);
+		for(uint64_t key = 0; key < 500; ++key) {
+			source.add(key, key % 7);
+		}
+
+		std::vector<uint8_t> buffer(source.serialized_bytes());
+		assert(source.serialize(buffer.data(), buffer.size() - 1) == 0);
+		assert(source.serialize(buffer.data(), buffer.size()) == buffer.size());
+		assert(not target.deserialize(buffer.data(), buffer.size() - 1));
+		assert(not other.deserialize(buffer.data(), buffer.size()));
+		assert(target.deserialize(buffer.data(), buffer.size()));
+		assert(target.total() == source.total());
+		for(uint64_t key = 0; key < 500; ++key) {
+			assert(target.estimate(key) == source.estimate(key));
+		}
+		buffer[0] ^= 1;
+		assert(not target.deserialize(buffer.data(), buffer.size()));
+	}
+
+};
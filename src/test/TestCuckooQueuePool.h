@@ -0,0 +1,147 @@
+#pragma once
+
+#include "test_environment.h"
+#include <intrusive/CuckooQueuePool.h>
+#include <utils/SipHash.h>
+
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+
+class TestCuckooQueuePool {
+
+	using Node_t = intrusive::CuckooQueuePoolNode<uint32_t, uint32_t>;
+	using Pool_t = intrusive::CuckooQueuePool<Node_t>;
+	using PlainPool_t = intrusive::CuckooQueuePool<Node_t, std::hash<uint32_t> >;
+
+public:
+
+	TestCuckooQueuePool() noexcept {
+		test_sip_hash();
+		test_queue<Pool_t>(4096, 0.9f);
+		test_queue<PlainPool_t>(1000, 0.5f);
+		test_flood();
+		test_overload();
+	}
+
+private:
+
+	void test_sip_hash() noexcept {
+		TEST_TRACE;
+		// the reference vectors: the key 00..0f, the message 00..(n - 1)
+		const uint64_t k0 = 0x0706050403020100ull;
+		const uint64_t k1 = 0x0F0E0D0C0B0A0908ull;
+		uint8_t message[16];
+		for(uint8_t i = 0; i < sizeof(message); ++i) {
+			message[i] = i;
+		}
+		using Sip_t = utils::SipHash<2, 4>;
+		assert(Sip_t::hash(k0, k1, message, 0) == 0x726FDB47DD0E0E31ull);
+		assert(Sip_t::hash(k0, k1, message, 1) == 0x74F839C593DC67FDull);
+		assert(Sip_t::hash(k0, k1, message, 8) == 0x93F5F5799A932462ull);
+		assert(Sip_t::hash(k0, k1, message, 15) == 0xA129CA6149BE45E5ull);
+
+		utils::SipHasher<uint32_t> first(1, 2);
+		utils::SipHasher<uint32_t> second(1, 3);
+		assert(first(42) == first(42));
+		assert(first(42) != second(42));
+	}
+
+	template <typename Pool>
+	void test_queue(unsigned capacity, float load_factor) noexcept {
+		TEST_TRACE;
+		Pool pool(capacity, load_factor, 12345);
+		assert(pool.allocate() == 0);
+		std::unordered_map<uint32_t, uint32_t> map;
+		std::deque<uint32_t> queue;
+		DiceMachine dice(capacity);
+
+		for(size_t i = 0; i < capacity * 50u; ++i) {
+			const uint32_t key = dice.u32() % (capacity * 2u);
+			auto it = pool.find(key);
+			assert(bool(it) == (map.count(key) != 0));
+			if(it) {
+				assert(it->ic_key == key && it->value == map[key]);
+				if(dice.pass(0.3)) {
+					pool.remove(it);
+					map.erase(key);
+					queue.erase(std::find(queue.begin(), queue.end(), key));
+				} else {
+					pool.move_back(it);
+					queue.erase(std::find(queue.begin(), queue.end(), key));
+					queue.push_back(key);
+				}
+				continue;
+			}
+			if(not pool.available()) {
+				auto front = pool.pop_front();
+				assert(front && front->ic_key == queue.front());
+				map.erase(queue.front());
+				queue.pop_front();
+			}
+			it = pool.push_back(key);
+			assert(it);
+			it->value = uint32_t(i);
+			map[key] = uint32_t(i);
+			queue.push_back(key);
+			assert(pool.size() == map.size() && pool.size() + pool.available() == pool.capacity());
+		}
+		// all the nodes fit without evictions at this load
+		assert(pool.evictions() == 0);
+		assert(pool.peek_front()->ic_key == queue.front());
+
+		pool.reset();
+		assert(pool.size() == 0 && pool.available() == capacity);
+		for(const auto& kv : map) {
+			assert(not pool.find(kv.first));
+		}
+	}
+
+	/**
+	 * The keys colliding in a table indexed by the key modulo the size don't collide in the keyed table.
+	 */
+	void test_flood() noexcept {
+		TEST_TRACE;
+		Pool_t pool(1 << 14, 0.9f);
+		assert(pool.allocate() == 0);
+		const uint32_t stride = uint32_t(pool.buckets());
+		for(uint32_t i = 0; i < pool.capacity(); ++i) {
+			assert(pool.push_back(i * stride));
+		}
+		assert(pool.evictions() == 0);
+		for(uint32_t i = 0; i < pool.capacity(); ++i) {
+			assert(pool.find(i * stride));
+		}
+		assert(not pool.find(uint32_t(pool.capacity()) * stride));
+	}
+
+	/**
+	 * More nodes than the table ways: the evicted nodes go back to the free list,
+	 * the pool stays consistent.
+	 */
+	void test_overload() noexcept {
+		TEST_TRACE;
+		Pool_t pool(1000, 2.0f, 7);
+		assert(pool.allocate() == 0);
+		assert(pool.buckets() * 4u < pool.capacity());
+		DiceMachine dice(7);
+		for(size_t i = 0; i < 20000; ++i) {
+			const uint32_t key = dice.u32();
+			if(pool.find(key)) {
+				continue;
+			}
+			if(not pool.available()) {
+				pool.pop_front();
+			}
+			assert(pool.push_back(key));
+			assert(pool.find(key));
+		}
+		assert(pool.evictions() > 0);
+		assert(pool.size() <= pool.buckets() * 4u);
+		assert(pool.size() + pool.available() == pool.capacity());
+		for(auto it = pool.peek_front(); it; ++it) {
+			assert(pool.find(it->ic_key).get() == it.get());
+		}
+	}
+
+};
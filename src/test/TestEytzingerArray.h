@@ -0,0 +1,82 @@
+#pragma once
+
+#include "test_environment.h"
+#include <containers/ordered/EytzingerArray.h>
+
+#include <algorithm>
+#include <vector>
+
+class TestEytzingerArray {
+
+public:
+
+	TestEytzingerArray() noexcept {
+		for(size_t size : {0, 1, 2, 3, 7, 8, 9, 100, 1000, 4097}) {
+			test_search(size);
+		}
+		test_ranges();
+	}
+
+private:
+
+	void test_search(size_t size) noexcept {
+		TEST_TRACE;
+		DiceMachine dice(size);
+		// the duplicates check the bounds too
+		std::vector<uint32_t> keys(size);
+		for(auto& key : keys) {
+			key = dice.u32() % (size * 2 + 1);
+		}
+		std::sort(keys.begin(), keys.end());
+		std::vector<uint32_t> values(size);
+		for(size_t i = 0; i < size; ++i) {
+			values[i] = uint32_t(i);
+		}
+		EytzingerArray<uint32_t, uint32_t> array;
+		assert(array.build(keys.data(), values.data(), size) == 0);
+		assert(array.size() == size);
+
+		// the walk in both directions visits the sorted keys
+		size_t pos = array.first();
+		for(size_t i = 0; i < size; ++i) {
+			assert(pos && array.key(pos) == keys[i] && array.value(pos) == i);
+			pos = array.next(pos);
+		}
+		assert(pos == 0);
+		pos = array.prev(0);
+		for(size_t i = size; i-- > 0;) {
+			assert(pos && array.value(pos) == i);
+			pos = array.prev(pos);
+		}
+		assert(pos == 0);
+
+		for(uint32_t key = 0; key < size * 2 + 3; ++key) {
+			const size_t lower = size_t(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+			const size_t upper = size_t(std::upper_bound(keys.begin(), keys.end(), key) - keys.begin());
+			pos = array.lower_bound(key);
+			assert(lower == size ? pos == 0 : array.value(pos) == lower);
+			pos = array.upper_bound(key);
+			assert(upper == size ? pos == 0 : array.value(pos) == upper);
+			pos = array.floor(key);
+			assert(upper == 0 ? pos == 0 : array.value(pos) == upper - 1);
+			const uint32_t* found = array.find(key);
+			assert((found != nullptr) == (lower != upper));
+			assert(not found || *found == lower);
+		}
+	}
+
+	void test_ranges() noexcept {
+		TEST_TRACE;
+		const uint16_t firsts[] = {22, 80, 1024, 8000};
+		const uint16_t lasts[] = {23, 80, 2047, 8080};
+		EytzingerArray<uint16_t, uint16_t> ranges;
+		assert(ranges.build(firsts, lasts, 4) == 0);
+		auto in_range = [&ranges](uint16_t port) {
+			const size_t pos = ranges.floor(port);
+			return pos && port <= ranges.value(pos);
+		};
+		assert(in_range(22) && in_range(23) && in_range(80) && in_range(1500) && in_range(8080));
+		assert(not in_range(21) && not in_range(24) && not in_range(81) && not in_range(2048) && not in_range(9000));
+	}
+
+};
@@ -3,8 +3,14 @@
 #include "test_environment.h"
 #include <fio/Reader.h>
 #include <fio/Writer.h>
+#include <fio/BufferedReader.h>
+#include <fio/BufferedWriter.h>
+#include <fio/IoBackend.h>
+#include <fio/MappedReader.h>
 
 #include <cstring>
+#include <string_view>
+#include <vector>
 
 class TestFio {
 
@@ -12,10 +18,301 @@ public:
 
 	TestFio() noexcept {
 		test_empty_input();
+		test_buffered(fio::BufferedWriter::BUFFER_SIZE_DEFAULT);
+		// the values and the strings don't fit the buffer, the writes go with writev()
+		test_buffered(16);
+		test_mapped();
+		test_same_format();
+		test_io_backend(true);
+		test_io_backend(false);
+		test_pipelined(4096, 4);
+		test_pipelined(16, 1);
 	}
 
 private:
 
+	struct Record {
+		uint32_t id;
+		uint16_t port;
+		uint8_t proto;
+
+		bool operator==(const Record& rv) const {
+			return id == rv.id && port == rv.port && proto == rv.proto;
+		}
+	};
+
+	static std::string temp_name() noexcept {
+		char name[] = "/tmp/test_fio_XXXXXX";
+		const int fd = mkstemp(name);
+		assert(fd >= 0);
+		close(fd);
+		return name;
+	}
+
+	/**
+	 * The records N: Record{N, N % 65536, N % 256}, 'c', "name N" and "semicolon" up to ';'.
+	 */
+	static void write_records(fio::BufferedWriter& writer, unsigned count) noexcept {
+		for(unsigned i = 0; i < count; ++i) {
+			const Record record{i, uint16_t(i), uint8_t(i)};
+			const std::string name = "name " + std::to_string(i);
+			// the last string is terminated by the last char
+			assert(writer.write(record, 'c', name, std::string_view("semicolon"), ';'));
+		}
+	}
+
+	void test_buffered(size_t buffer_size) noexcept {
+		TEST_TRACE;
+		constexpr unsigned COUNT = 10000;
+		const std::string name = temp_name();
+		fio::BufferedWriter writer(name, buffer_size);
+		assert(writer.open());
+		write_records(writer, COUNT);
+		const std::vector<uint64_t> span(1000, 0x1122334455667788ull);
+		assert(writer.write_span(span.data(), span.size()));
+		const uint64_t size = writer.offset();
+		assert(writer.close());
+
+		// the stdio reader reads the same format
+		fio::Reader reader(name);
+		assert(reader.open());
+		Record record;
+		std::string str;
+		char ch;
+		assert(reader.read(record, ch, str));
+		assert(record == (Record{0, 0, 0}) && str == "name 0" && ch == 'c');
+		reader.close();
+
+		fio::BufferedReader buffered(name, buffer_size);
+		assert(buffered.open());
+		for(unsigned i = 0; i < COUNT; ++i) {
+			assert(buffered.read(record, ch, str));
+			assert(record == (Record{i, uint16_t(i), uint8_t(i)}));
+			assert(str == "name " + std::to_string(i) && ch == 'c');
+			assert(buffered.read(str, ';') && str == "semicolon");
+		}
+		std::vector<uint64_t> span_read(span.size());
+		assert(not buffered.read_span(span_read.data(), SIZE_MAX / sizeof(uint64_t) + 2));
+		assert(buffered.read_span(span_read.data(), span_read.size()));
+		assert(span_read == span);
+		assert(not buffered.read(ch) && not buffered.failed());
+		buffered.close();
+		fio::BufferedReader dir("/tmp", buffer_size);
+		assert(dir.open() && not dir.read(ch) && dir.failed());
+
+		fio::MappedReader mapped(name);
+		assert(mapped.open() && mapped.size() == size);
+		remove(name.c_str());
+	}
+
+	static std::string load(const std::string& name) noexcept {
+		fio::MappedReader reader(name);
+		assert(reader.open());
+		std::string_view all;
+		assert(not reader.read(all, '\xff'));
+		return std::string(all);
+	}
+
+	/**
+	 * Write the blocks N of N bytes at random depths, then read them back.
+	 */
+	void test_io_backend(bool uring) noexcept {
+		TEST_TRACE;
+		constexpr unsigned DEPTH = 8;
+		constexpr unsigned BLOCKS = 64;
+		constexpr unsigned BLOCK_BYTES = 4096;
+		auto io = fio::IoBackend::create(DEPTH, uring);
+		assert(io->depth() == DEPTH);
+		assert(uring || not strcmp(io->name(), "thread pool"));
+		const std::string name = temp_name();
+		const int fd = open(name.c_str(), O_RDWR | O_TRUNC);
+		assert(fd >= 0);
+		std::vector<uint8_t> data(BLOCKS * BLOCK_BYTES);
+		for(size_t i = 0; i < data.size(); ++i) {
+			data[i] = uint8_t(i / BLOCK_BYTES);
+		}
+		const iovec buffer = {data.data(), data.size()};
+		const bool registered = io->register_buffers(&buffer, 1u);
+
+		fio::IoCompletion completions[DEPTH];
+		std::vector<uint8_t> done(BLOCKS, 0);
+		DiceMachine dice(7);
+		for(bool write : {true, false}) {
+			if(not write) {
+				std::fill(data.begin(), data.end(), 0);
+			}
+			unsigned next = 0, completed = 0;
+			while(completed < BLOCKS) {
+				// a batch of random size
+				const unsigned batch = 1 + dice.u32() % DEPTH;
+				for(unsigned i = 0; i < batch && next < BLOCKS; ++i) {
+					fio::IoRequest request;
+					request.fd = fd;
+					request.write = write;
+					request.buf = data.data() + next * BLOCK_BYTES;
+					request.len = BLOCK_BYTES;
+					// in the reverse order
+					request.offset = uint64_t(BLOCKS - 1 - next) * BLOCK_BYTES;
+					request.buf_index = registered ? 0 : -1;
+					request.user_data = next;
+					if(not io->queue(request)) {
+						assert(io->inflight() == DEPTH);
+						break;
+					}
+					next++;
+				}
+				const size_t count = io->wait(completions, DEPTH, 1);
+				assert(count > 0);
+				for(size_t i = 0; i < count; ++i) {
+					assert(completions[i].result == BLOCK_BYTES);
+					done[completions[i].user_data] += 1;
+				}
+				completed += unsigned(count);
+			}
+			assert(io->inflight() == 0);
+		}
+		for(unsigned i = 0; i < BLOCKS; ++i) {
+			assert(done[i] == 2);
+			assert(data[i * BLOCK_BYTES] == i && data[(i + 1) * BLOCK_BYTES - 1] == i);
+		}
+		// the file has the blocks reversed
+		uint8_t first = 0xFF;
+		assert(pread(fd, &first, 1, 0) == 1 && first == BLOCKS - 1);
+		// an error is a completion
+		fio::IoRequest request;
+		request.fd = fd;
+		request.buf = data.data();
+		request.len = BLOCK_BYTES;
+		request.user_data = 42;
+		close(fd);
+		assert(io->queue(request) && io->wait(completions, DEPTH, 1) == 1);
+		assert(completions[0].user_data == 42 && completions[0].result == -EBADF);
+		remove(name.c_str());
+	}
+
+	void test_pipelined(size_t buffer_size, unsigned depth) noexcept {
+		TEST_TRACE;
+		constexpr unsigned COUNT = 10000;
+		const std::string name = temp_name();
+		fio::BufferedWriter writer(name, buffer_size);
+		writer.set_queue_depth(depth);
+		assert(writer.open());
+		write_records(writer, COUNT);
+		const std::vector<uint64_t> span(3000, 0x1122334455667788ull);
+		assert(writer.write_span(span.data(), span.size()));
+		assert(writer.flush());
+		assert(writer.write(std::string_view("tail")));
+		const uint64_t size = writer.offset();
+		assert(writer.close());
+
+		fio::MappedReader mapped(name);
+		assert(mapped.open() && mapped.size() == size);
+		mapped.close();
+
+		fio::BufferedReader reader(name, buffer_size);
+		reader.set_queue_depth(depth);
+		assert(reader.open());
+		Record record;
+		std::string str;
+		char ch;
+		for(unsigned i = 0; i < COUNT; ++i) {
+			assert(reader.read(record, ch, str));
+			assert(record == (Record{i, uint16_t(i), uint8_t(i)}));
+			assert(str == "name " + std::to_string(i) && ch == 'c');
+			assert(reader.read(str, ';') && str == "semicolon");
+		}
+		std::vector<uint64_t> span_read(span.size());
+		assert(reader.read_span(span_read.data(), span_read.size()));
+		assert(span_read == span);
+		assert(reader.read(str) && str == "tail");
+		assert(not reader.read(ch) && not reader.failed());
+		// the reopened file is read again from the start
+		assert(reader.open() && reader.read(record) && record == (Record{0, 0, 0}));
+		reader.close();
+		remove(name.c_str());
+
+		// a read error is not the end of the input
+		fio::BufferedReader dir("/tmp", buffer_size);
+		dir.set_queue_depth(depth);
+		assert(dir.open() && not dir.read(ch) && dir.failed());
+	}
+
+	void test_same_format() noexcept {
+		TEST_TRACE;
+		const Record record{1, 2, 3};
+		const char ch = 'c';
+		const std::string str = "string";
+		const std::string_view view = "view";
+		const std::string stdio_name = temp_name(), buffered_name = temp_name();
+		{
+			fio::Writer writer(stdio_name);
+			assert(writer.open());
+			assert(writer.write(record, str, ch, view, record, str));
+			assert(writer.write(record, str, ch));
+		}
+		for(size_t buffer_size : {size_t(4), fio::BufferedWriter::BUFFER_SIZE_DEFAULT}) {
+			fio::BufferedWriter writer(buffered_name, buffer_size);
+			assert(writer.open());
+			assert(writer.write(record, str, ch, view, record, str));
+			assert(writer.write(record, str, ch));
+			assert(writer.close());
+			assert(load(stdio_name) == load(buffered_name));
+		}
+		remove(stdio_name.c_str());
+		remove(buffered_name.c_str());
+	}
+
+	void test_mapped() noexcept {
+		TEST_TRACE;
+		constexpr unsigned COUNT = 1000;
+		const std::string name = temp_name();
+		fio::BufferedWriter writer(name);
+		assert(writer.open());
+		write_records(writer, COUNT);
+		const std::vector<uint32_t> span = {1, 2, 3, 4, 5};
+		const uint64_t unaligned = writer.offset();
+		assert(writer.align(alignof(uint32_t)));
+		const uint64_t aligned = writer.offset();
+		assert(aligned % alignof(uint32_t) == 0 && aligned - unaligned < alignof(uint32_t));
+		assert(writer.write_span(span.data(), span.size()));
+		assert(writer.write(std::string_view("tail"), '\n'));
+		assert(writer.close());
+
+		fio::MappedReader reader(name);
+		assert(reader.open());
+		Record record;
+		std::string_view view;
+		char ch;
+		for(unsigned i = 0; i < COUNT; ++i) {
+			assert(reader.read(record));
+			assert(record == (Record{i, uint16_t(i), uint8_t(i)}));
+			assert(reader.read(ch) && ch == 'c');
+			assert(reader.read(view) && view == "name " + std::to_string(i));
+			assert(reader.read(view, ';') && view == "semicolon");
+		}
+		assert(reader.offset() == unaligned);
+		const uint32_t* values = nullptr;
+		if(unaligned != aligned) {
+			assert(not reader.read_span(values, span.size()));
+		}
+		assert(reader.skip(aligned - unaligned));
+		// a count which wraps the size in bytes
+		assert(not reader.read_span(values, SIZE_MAX / sizeof(uint32_t) + 2));
+		assert(reader.offset() == aligned);
+		assert(reader.read_span(values, span.size()));
+		assert(std::vector<uint32_t>(values, values + span.size()) == span);
+		std::string str;
+		assert(reader.read(str, '\n') && str == "tail");
+		assert(not reader.read(view) && view.empty());
+		assert(not reader.read(ch));
+		reader.close();
+
+		// an empty file
+		assert(writer.open() && writer.close());
+		assert(reader.open() && reader.size() == 0 && not reader.read(ch));
+		remove(name.c_str());
+	}
+
 	void test_empty_input() noexcept {
 		TEST_TRACE;
 
@@ -34,8 +331,9 @@ private:
 		const int i_ref = 0x0abbccdd;
 		const Dummy st_ref {false, 22, 3333333};
 		const std::string hello_dick_ref = "hello.dick";
+		const std::string path = temp_name();
 
-		fio::Writer writer(hello_dick_ref);
+		fio::Writer writer(path);
 		assert(writer.open());
 		assert(writer.write(ch_ref, s_ref, i_ref, st_ref, hello_dick_ref));
 		writer.close();
@@ -46,10 +344,11 @@ private:
 		Dummy st;
 		std::string hello_dick;
 
-		fio::Reader reader(hello_dick_ref);
+		fio::Reader reader(path);
 		assert(reader.open());
 		assert(reader.read(ch, s, i, st, hello_dick));
 		reader.close();
+		remove(path.c_str());
 
 		assert(ch_ref == ch);
 		assert(s_ref == s);
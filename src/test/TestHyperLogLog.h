@@ -0,0 +1,87 @@
+#pragma once
+
+#include "test_environment.h"
+#include <containers/sketch/HyperLogLog.h>
+
+#include <cmath>
+#include <vector>
+
+class TestHyperLogLog {
+
+	using Hll_t = sketch::HyperLogLog<12>;
+
+public:
+
+	TestHyperLogLog() noexcept {
+		test_accuracy();
+		test_merge();
+		test_serialize();
+	}
+
+private:
+
+	static bool near(double estimate, double expected, double tolerance) noexcept {
+		return std::fabs(estimate - expected) <= expected * tolerance + 1.0;
+	}
+
+	void test_accuracy() noexcept {
+		TEST_TRACE;
+		// the standard error is 1.04 / 64 = 1.6%
+		const double tolerance = 4 * 1.04 / std::sqrt(double(Hll_t::registers()));
+		Hll_t hll;
+		assert(hll.allocate() == 0);
+		assert(hll.estimate() == 0);
+		assert(Hll_t::storage_bytes() == 4096 * 6 / 8);
+
+		uint64_t added = 0;
+		for(uint64_t target : {10, 100, 1000, 10000, 100000, 1000000}) {
+			for(; added < target; ++added) {
+				hll.add(added);
+				// the duplicates don't count
+				hll.add(added);
+			}
+			const double estimate = hll.estimate();
+			assert(estimate == hll.estimate_scalar());
+			assert(near(estimate, double(target), tolerance));
+		}
+	}
+
+	void test_merge() noexcept {
+		TEST_TRACE;
+		Hll_t left(5);
+		Hll_t right(5);
+		Hll_t all(5);
+		Hll_t other(6);
+		assert(left.allocate() == 0 && right.allocate() == 0 && all.allocate() == 0 && other.allocate() == 0);
+		for(uint64_t key = 0; key < 60000; ++key) {
+			(key < 40000 ? left : right).add(key);
+			all.add(key);
+		}
+		assert(left.merge(right));
+		assert(left.estimate() == all.estimate());
+		// merging is idempotent
+		assert(left.merge(right));
+		assert(left.estimate() == all.estimate());
+		assert(not left.merge(other));
+	}
+
+	void test_serialize() noexcept {
+		TEST_TRACE;
+		Hll_t source;
+		Hll_t target;
+		assert(source.allocate() == 0 && target.allocate() == 0);
+		for(uint64_t key = 0; key < 5000; ++key) {
+			source.add(key * 31);
+		}
+		std::vector<uint8_t> buffer(Hll_t::serialized_bytes());
+		assert(source.serialize(buffer.data(), buffer.size()) == buffer.size());
+		assert(not target.deserialize(buffer.data(), buffer.size() - 1));
+		assert(target.deserialize(buffer.data(), buffer.size()));
+		assert(target.estimate() == source.estimate());
+
+		sketch::HyperLogLog<13> wrong;
+		assert(wrong.allocate() == 0);
+		assert(not wrong.deserialize(buffer.data(), buffer.size()));
+	}
+
+};
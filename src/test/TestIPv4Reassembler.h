@@ -0,0 +1,280 @@
+#pragma once
+
+#include "test_environment.h"
+#include "TestMetaParser.h"
+#include <proto/reassembly/IPv4Reassembler.h>
+#include <proto/parsers/MetaParser.h>
+
+#include <algorithm>
+#include <vector>
+
+class TestIPv4Reassembler {
+
+	using Packet_t = std::vector<uint8_t>;
+	using Reassembler_t = proto::IPv4Reassembler;
+	using Header_t = proto::IPv4::Header;
+
+	static constexpr size_t DATAGRAM_MAX = 9000;
+	static constexpr uint64_t TIMEOUT = 1000;
+
+public:
+
+	TestIPv4Reassembler() noexcept {
+		test_in_order();
+		test_out_of_order();
+		test_overlap();
+		test_timeout();
+		test_eviction();
+		test_limits();
+		test_random();
+	}
+
+private:
+
+	/**
+	 * Build an IPv4 datagram without the Ethernet header: UDP header and a payload.
+	 */
+	static Packet_t make_datagram(uint16_t id, size_t payload, uint8_t seed) noexcept {
+		Packet_t dgram;
+		TestMetaParser::put_ipv4(dgram, 0x0A000001, 0x0A000002, proto::IPv4::PROTO_UDP, uint16_t(8 + payload));
+		TestMetaParser::put_udp(dgram, 1000, 2000, uint16_t(payload));
+		for(size_t i = 0; i < payload; ++i) {
+			dgram.push_back(uint8_t(seed + i));
+		}
+		reinterpret_cast<Header_t*>(dgram.data())->id = htons(id);
+		return dgram;
+	}
+
+	/**
+	 * Cut a fragment of [first, last) payload range of the datagram.
+	 */
+	static Packet_t make_fragment(const Packet_t& dgram, size_t first, size_t last) noexcept {
+		const size_t payload = dgram.size() - sizeof(Header_t);
+		Packet_t frag(dgram.begin(), dgram.begin() + sizeof(Header_t));
+		frag.insert(frag.end(), dgram.begin() + sizeof(Header_t) + first, dgram.begin() + sizeof(Header_t) + last);
+		Header_t* hdr = reinterpret_cast<Header_t*>(frag.data());
+		hdr->tot_len = htons(uint16_t(frag.size()));
+		hdr->frag_off = htons(uint16_t((first >> 3u) | (last < payload ? IP_MF : 0)));
+		return frag;
+	}
+
+	/**
+	 * Cut the datagram into fragments with @step bytes of payload.
+	 */
+	static std::vector<Packet_t> make_fragments(const Packet_t& dgram, size_t step) noexcept {
+		std::vector<Packet_t> result;
+		const size_t payload = dgram.size() - sizeof(Header_t);
+		for(size_t first = 0; first < payload; first += step) {
+			result.push_back(make_fragment(dgram, first, std::min(first + step, payload)));
+		}
+		return result;
+	}
+
+	static Reassembler_t::Result push(Reassembler_t& reasm, const Packet_t& frag, uint64_t now, proto::RoMFrame& out) noexcept {
+		return reasm.push(frag.data(), frag.size(), now, out);
+	}
+
+	static void validate(const proto::RoMFrame& out, const Packet_t& dgram) noexcept {
+		assert(out.available() == dgram.size());
+		Packet_t copy(out.head(), out.head() + out.available());
+		Header_t* hdr = reinterpret_cast<Header_t*>(copy.data());
+		const uint16_t check = hdr->check;
+		proto::IPv4::update_checksum(hdr);
+		assert(check == hdr->check);
+		assert(not proto::IPv4::fragmented(hdr));
+		assert(memcmp(copy.data() + sizeof(Header_t), dgram.data() + sizeof(Header_t), dgram.size() - sizeof(Header_t)) == 0);
+
+		proto::PacketMeta meta;
+		assert(proto::MetaParser<>::parse_all(out.head(), out.available(), meta, proto::L3_IPv4));
+		assert(meta.proto_l4 == proto::L4_UDP);
+		assert(meta.tuple.port_src == 1000 && meta.tuple.port_dst == 2000);
+	}
+
+	void test_in_order() noexcept {
+		TEST_TRACE;
+		Reassembler_t reasm(4, DATAGRAM_MAX, TIMEOUT);
+		assert(reasm.allocate() == 0);
+		proto::RoMFrame out(static_cast<const uint8_t*>(nullptr), 0);
+
+		const auto dgram = make_datagram(1, 3000, 7);
+		assert(push(reasm, dgram, 0, out) == Reassembler_t::NOT_FRAGMENT);
+
+		const auto frags = make_fragments(dgram, 1480);
+		assert(frags.size() == 3);
+		assert(push(reasm, frags[0], 0, out) == Reassembler_t::IN_PROGRESS);
+		assert(push(reasm, frags[1], 0, out) == Reassembler_t::IN_PROGRESS);
+		assert(reasm.size() == 1);
+		assert(push(reasm, frags[2], 0, out) == Reassembler_t::COMPLETE);
+		validate(out, dgram);
+		assert(reasm.stat().completed == 1);
+		assert(reasm.stat().fragments == 3);
+
+		// the completed datagram is released by the next call
+		reasm.expire(0);
+		assert(reasm.size() == 0);
+	}
+
+	void test_out_of_order() noexcept {
+		TEST_TRACE;
+		Reassembler_t reasm(4, DATAGRAM_MAX, TIMEOUT);
+		assert(reasm.allocate() == 0);
+		proto::RoMFrame out(static_cast<const uint8_t*>(nullptr), 0);
+
+		const auto dgram = make_datagram(2, 4000, 3);
+		const auto frags = make_fragments(dgram, 1000);
+		const size_t order[] = {4, 2, 0, 2, 3, 4};
+		for(auto idx : order) {
+			const auto result = push(reasm, frags[idx], 0, out);
+			assert(result == Reassembler_t::IN_PROGRESS || result == Reassembler_t::DUPLICATE);
+		}
+		assert(reasm.stat().duplicates == 2);
+		assert(push(reasm, frags[1], 0, out) == Reassembler_t::COMPLETE);
+		validate(out, dgram);
+	}
+
+	void test_overlap() noexcept {
+		TEST_TRACE;
+		Reassembler_t reasm(4, DATAGRAM_MAX, TIMEOUT);
+		assert(reasm.allocate() == 0);
+		proto::RoMFrame out(static_cast<const uint8_t*>(nullptr), 0);
+
+		const auto dgram = make_datagram(3, 1600, 0);
+		assert(push(reasm, make_fragment(dgram, 0, 800), 0, out) == Reassembler_t::IN_PROGRESS);
+		assert(push(reasm, make_fragment(dgram, 400, 1200), 0, out) == Reassembler_t::DROPPED);
+		assert(reasm.stat().overlaps == 1);
+		assert(reasm.size() == 0);
+
+		// conflicting last fragments
+		assert(push(reasm, make_fragment(dgram, 800, 1608), 0, out) == Reassembler_t::IN_PROGRESS);
+		auto frag = make_fragment(dgram, 1000, 1608);
+		reinterpret_cast<Header_t*>(frag.data())->tot_len = htons(uint16_t(sizeof(Header_t) + 600));
+		assert(push(reasm, frag, 0, out) == Reassembler_t::DROPPED);
+		assert(reasm.stat().overlaps == 2);
+		assert(reasm.size() == 0);
+	}
+
+	void test_timeout() noexcept {
+		TEST_TRACE;
+		Reassembler_t reasm(4, DATAGRAM_MAX, TIMEOUT);
+		assert(reasm.allocate() == 0);
+		proto::RoMFrame out(static_cast<const uint8_t*>(nullptr), 0);
+
+		for(uint16_t id = 0; id < 4; ++id) {
+			const auto dgram = make_datagram(id, 1600, 0);
+			assert(push(reasm, make_fragment(dgram, 0, 800), id * 100, out) == Reassembler_t::IN_PROGRESS);
+		}
+		reasm.expire(TIMEOUT);
+		assert(reasm.size() == 4);
+		reasm.expire(TIMEOUT + 150);
+		assert(reasm.size() == 2);
+		assert(reasm.stat().timeouts == 2);
+		reasm.expire(TIMEOUT * 10);
+		assert(reasm.size() == 0);
+		assert(reasm.stat().timeouts == 4);
+	}
+
+	void test_eviction() noexcept {
+		TEST_TRACE;
+		Reassembler_t reasm(4, DATAGRAM_MAX, TIMEOUT);
+		assert(reasm.allocate() == 0);
+		proto::RoMFrame out(static_cast<const uint8_t*>(nullptr), 0);
+
+		std::vector<Packet_t> dgrams;
+		for(uint16_t id = 0; id < 8; ++id) {
+			dgrams.push_back(make_datagram(id, 1600, uint8_t(id)));
+			assert(push(reasm, make_fragment(dgrams.back(), 0, 800), 0, out) == Reassembler_t::IN_PROGRESS);
+			assert(reasm.size() <= reasm.capacity());
+		}
+		assert(reasm.stat().evictions == 4);
+
+		// the newest datagrams survive
+		for(uint16_t id = 4; id < 8; ++id) {
+			assert(push(reasm, make_fragment(dgrams[id], 800, 1608), 0, out) == Reassembler_t::COMPLETE);
+			validate(out, dgrams[id]);
+		}
+		assert(push(reasm, make_fragment(dgrams[0], 800, 1608), 0, out) == Reassembler_t::IN_PROGRESS);
+
+		// an oversize fragment of a new datagram doesn't evict one of the full pool
+		for(uint16_t id = 4; id < 7; ++id) {
+			assert(push(reasm, make_fragment(dgrams[id], 0, 800), 0, out) == Reassembler_t::IN_PROGRESS);
+		}
+		assert(reasm.size() == reasm.capacity());
+		const size_t evictions = reasm.stat().evictions;
+		const auto big = make_datagram(100, DATAGRAM_MAX, 0);
+		assert(push(reasm, make_fragment(big, 8976, 9008), 0, out) == Reassembler_t::DROPPED);
+		assert(reasm.stat().evictions == evictions && reasm.size() == reasm.capacity());
+		assert(push(reasm, make_fragment(dgrams[0], 0, 800), 0, out) == Reassembler_t::COMPLETE);
+		validate(out, dgrams[0]);
+	}
+
+	void test_limits() noexcept {
+		TEST_TRACE;
+		Reassembler_t reasm(4, 2000, TIMEOUT);
+		assert(reasm.allocate() == 0);
+		proto::RoMFrame out(static_cast<const uint8_t*>(nullptr), 0);
+
+		const auto big = make_datagram(1, 3000, 0);
+		assert(push(reasm, make_fragment(big, 0, 1480), 0, out) == Reassembler_t::IN_PROGRESS);
+		assert(push(reasm, make_fragment(big, 1480, 2960), 0, out) == Reassembler_t::DROPPED);
+		assert(reasm.stat().drops_too_big == 1);
+		assert(reasm.size() == 0);
+
+		// every second 8 bytes block makes a new hole
+		const auto dgram = make_datagram(2, 1600, 0);
+		Reassembler_t::Result result = Reassembler_t::IN_PROGRESS;
+		for(size_t first = 0; first < 1600 && result == Reassembler_t::IN_PROGRESS; first += 16) {
+			result = push(reasm, make_fragment(dgram, first, first + 8), 0, out);
+		}
+		assert(result == Reassembler_t::DROPPED);
+		assert(reasm.stat().drops_holes == 1);
+		assert(reasm.size() == 0);
+
+		// not a multiple of 8 bytes and truncated fragments
+		assert(push(reasm, make_fragment(dgram, 0, 100), 0, out) == Reassembler_t::DROPPED);
+		const auto frag = make_fragment(dgram, 0, 96);
+		assert(reasm.push(frag.data(), frag.size() - 1, 0, out) == Reassembler_t::DROPPED);
+		assert(reasm.stat().drops_malformed == 2);
+	}
+
+	void test_random() noexcept {
+		TEST_TRACE;
+		constexpr size_t DGRAMS = 64;
+		Reassembler_t reasm(DGRAMS, DATAGRAM_MAX, TIMEOUT);
+		assert(reasm.allocate() == 0);
+		proto::RoMFrame out(static_cast<const uint8_t*>(nullptr), 0);
+		DiceMachine dice(42);
+
+		std::vector<Packet_t> dgrams;
+		std::vector<std::pair<size_t, Packet_t> > frags;
+		for(size_t i = 0; i < DGRAMS; ++i) {
+			dgrams.push_back(make_datagram(uint16_t(i), 1600 + dice.u32() % 6400, uint8_t(i)));
+			const size_t step = 8 * (10 + dice.u32() % 190);
+			for(auto& frag : make_fragments(dgrams.back(), step)) {
+				frags.emplace_back(i, std::move(frag));
+				if(dice.pass(0.1)) {
+					frags.push_back(frags.back());
+				}
+			}
+		}
+		// shuffle inside a window
+		for(size_t i = 0; i < frags.size(); ++i) {
+			std::swap(frags[i], frags[i + dice.u32() % std::min<size_t>(8, frags.size() - i)]);
+		}
+
+		size_t completed = 0;
+		for(const auto& frag : frags) {
+			const auto result = push(reasm, frag.second, 0, out);
+			// a late duplicate starts a new datagram which never completes
+			assert(result != Reassembler_t::DROPPED);
+			if(result == Reassembler_t::COMPLETE) {
+				validate(out, dgrams[frag.first]);
+				completed++;
+			}
+		}
+		reasm.expire(0);
+		assert(completed == DGRAMS);
+		assert(reasm.stat().completed == DGRAMS);
+		assert(reasm.stat().evictions == 0);
+	}
+
+};
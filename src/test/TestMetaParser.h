@@ -0,0 +1,272 @@
+#pragma once
+
+#include "test_environment.h"
+#include <proto/parsers/MetaParser.h>
+#include <proto/parsers/HeaderParser.h>
+
+#include <cstring>
+#include <vector>
+
+class TestMetaParser {
+
+	using Packet_t = std::vector<uint8_t>;
+
+public:
+
+	TestMetaParser() noexcept {
+		test_ipv4_tcp();
+		test_vlan_ipv6_udp();
+		test_fragment();
+		test_truncated();
+		test_protocol_set();
+		test_burst();
+	}
+
+	static void put_ethernet(Packet_t& pkt, uint16_t type) noexcept {
+		proto::Ethernet::Header hdr;
+		memset(&hdr, 0xAB, sizeof(hdr));
+		hdr.h_proto = htons(type);
+		put(pkt, hdr);
+	}
+
+	static void put_vlan(Packet_t& pkt, uint16_t vid, uint16_t type) noexcept {
+		proto::Vlan::Header hdr;
+		hdr.vlan_tci = htons(vid);
+		hdr.nextProto = htons(type);
+		put(pkt, hdr);
+	}
+
+	static void put_ipv4(Packet_t& pkt, uint32_t src, uint32_t dst, uint8_t proto, uint16_t payload, uint16_t frag = 0) noexcept {
+		proto::IPv4::Header hdr;
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.version = 4;
+		hdr.ihl = 5;
+		hdr.tot_len = htons(uint16_t(sizeof(hdr) + payload));
+		hdr.frag_off = htons(frag);
+		hdr.protocol = proto;
+		hdr.saddr = htonl(src);
+		hdr.daddr = htonl(dst);
+		put(pkt, hdr);
+	}
+
+	static void put_ipv6(Packet_t& pkt, uint8_t src_lsb, uint8_t dst_lsb, uint8_t proto, uint16_t payload) noexcept {
+		proto::IPv6::Header hdr;
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.version = 6;
+		hdr.payload_len = htons(payload);
+		hdr.next_header = proto;
+		hdr.src.addr8[15] = src_lsb;
+		hdr.dst.addr8[15] = dst_lsb;
+		put(pkt, hdr);
+	}
+
+	static void put_tcp(Packet_t& pkt, uint16_t src, uint16_t dst) noexcept {
+		proto::Tcp::Header hdr;
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.src = htons(src);
+		hdr.dst = htons(dst);
+		hdr.data_offset = sizeof(hdr) >> 2u;
+		put(pkt, hdr);
+	}
+
+	static void put_udp(Packet_t& pkt, uint16_t src, uint16_t dst, uint16_t payload) noexcept {
+		proto::Udp::Header hdr;
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.source = htons(src);
+		hdr.dest = htons(dst);
+		hdr.len = htons(uint16_t(sizeof(hdr) + payload));
+		put(pkt, hdr);
+	}
+
+	static void put_payload(Packet_t& pkt, size_t nb) noexcept {
+		pkt.insert(pkt.end(), nb, 0x55);
+	}
+
+	template <typename T>
+	static void put(Packet_t& pkt, const T& value) noexcept {
+		const auto ptr = reinterpret_cast<const uint8_t*>(&value);
+		pkt.insert(pkt.end(), ptr, ptr + sizeof(value));
+	}
+
+private:
+
+	void test_ipv4_tcp() noexcept {
+		TEST_TRACE;
+		Packet_t pkt;
+		put_ethernet(pkt, ETH_P_IP);
+		put_ipv4(pkt, 0x0A000001, 0x0A000002, proto::IPv4::PROTO_TCP, 20 + 100);
+		put_tcp(pkt, 1234, 80);
+		put_payload(pkt, 100);
+		put_payload(pkt, 6); // ethernet padding
+
+		proto::PacketMeta meta;
+		assert(proto::MetaParser<>::parse_all(pkt.data(), pkt.size(), meta));
+		assert(meta.proto_l2 == proto::L2_ETHERNET);
+		assert(meta.proto_l3 == proto::L3_IPv4);
+		assert(meta.proto_l4 == proto::L4_TCP);
+		assert(meta.off_l2 == 0);
+		assert(meta.off_l3 == 14);
+		assert(meta.off_l4 == 34);
+		assert(meta.off_payload == 54);
+		assert(meta.len_payload == 100);
+		assert(meta.vlan_nb == 0);
+		assert(meta.flags == 0);
+		assert(meta.tuple.version == 4);
+		assert(meta.tuple.proto == proto::IPv4::PROTO_TCP);
+		assert(meta.tuple.src.v4 == 0x0A000001);
+		assert(meta.tuple.dst.v4 == 0x0A000002);
+		assert(meta.tuple.port_src == 1234);
+		assert(meta.tuple.port_dst == 80);
+		assert(meta.tuple.reverse().reverse() == meta.tuple);
+		assert(meta.tuple.canonical() != meta.tuple.reverse().canonical());
+		validate_offsets(pkt, meta);
+	}
+
+	void test_vlan_ipv6_udp() noexcept {
+		TEST_TRACE;
+		Packet_t pkt;
+		put_ethernet(pkt, ETH_P_8021Q);
+		put_vlan(pkt, 100, ETH_P_8021Q);
+		put_vlan(pkt, 200, ETH_P_8021Q);
+		put_vlan(pkt, 300, ETH_P_IPV6);
+		put_ipv6(pkt, 1, 2, proto::IPv6::PROTO_UDP, 8 + 32);
+		put_udp(pkt, 53, 5353, 32);
+		put_payload(pkt, 32);
+
+		proto::PacketMeta meta;
+		assert(proto::MetaParser<>::parse_all(pkt.data(), pkt.size(), meta));
+		assert(meta.vlan_nb == proto::PacketMeta::VLAN_DEPTH_MAX);
+		assert(meta.flags == proto::PacketMeta::FLAG_VLAN_OVERFLOW);
+		assert(meta.off_vlan[0] == 14);
+		assert(meta.off_vlan[1] == 18);
+		assert(meta.vlan_id[0] == 100);
+		assert(meta.vlan_id[1] == 200);
+		assert(meta.off_l3 == 26);
+		assert(meta.off_l4 == 66);
+		assert(meta.off_payload == 74);
+		assert(meta.len_payload == 32);
+		assert(meta.proto_l4 == proto::L4_UDP);
+		assert(meta.tuple.version == 6);
+		assert(meta.tuple.src.v6.addr8[15] == 1);
+		assert(meta.tuple.dst.v6.addr8[15] == 2);
+		assert(meta.tuple.port_src == 53);
+		assert(meta.tuple.port_dst == 5353);
+		validate_offsets(pkt, meta);
+	}
+
+	void test_fragment() noexcept {
+		TEST_TRACE;
+		Packet_t pkt;
+		put_ethernet(pkt, ETH_P_IP);
+		put_ipv4(pkt, 1, 2, proto::IPv4::PROTO_UDP, 64, IP_MF);
+		put_payload(pkt, 64);
+
+		proto::PacketMeta meta;
+		assert(proto::MetaParser<>::parse_all(pkt.data(), pkt.size(), meta));
+		assert(meta.fragment());
+		assert(meta.proto_l4 == proto::END);
+		assert(meta.tuple.port_src == 0 && meta.tuple.port_dst == 0);
+		assert(meta.off_payload == 34);
+		assert(meta.len_payload == 64);
+	}
+
+	void test_truncated() noexcept {
+		TEST_TRACE;
+		Packet_t pkt;
+		put_ethernet(pkt, ETH_P_IP);
+		put_ipv4(pkt, 1, 2, proto::IPv4::PROTO_TCP, 20);
+		put_tcp(pkt, 1, 2);
+
+		proto::PacketMeta meta;
+		for(size_t size = 0; size < pkt.size(); ++size) {
+			proto::MetaParser<>::parse_all(pkt.data(), size, meta);
+			assert(meta.truncated());
+			assert(meta.proto_l4 == proto::END);
+		}
+		assert(not proto::MetaParser<>::parse_all(pkt.data(), 14 + 19, meta));
+		assert(proto::MetaParser<>::parse_all(pkt.data(), 14 + 20, meta));
+	}
+
+	void test_protocol_set() noexcept {
+		TEST_TRACE;
+		using Set_t = proto::ProtocolSet<proto::L2_ETHERNET, proto::L3_IPv4, proto::L4_UDP>;
+		static_assert(Set_t::contains(proto::L3_IPv4));
+		static_assert(not Set_t::contains(proto::L3_IPv6));
+
+		Packet_t pkt_vlan;
+		put_ethernet(pkt_vlan, ETH_P_8021Q);
+		put_vlan(pkt_vlan, 1, ETH_P_IP);
+		put_ipv4(pkt_vlan, 1, 2, proto::IPv4::PROTO_UDP, 8);
+		put_udp(pkt_vlan, 1, 2, 0);
+
+		proto::PacketMeta meta;
+		assert(not proto::MetaParser<Set_t>::parse_all(pkt_vlan.data(), pkt_vlan.size(), meta));
+		assert(meta.proto_l2 == proto::L2_ETHERNET);
+		assert(meta.vlan_nb == 0);
+
+		Packet_t pkt_tcp;
+		put_ethernet(pkt_tcp, ETH_P_IP);
+		put_ipv4(pkt_tcp, 1, 2, proto::IPv4::PROTO_TCP, 20);
+		put_tcp(pkt_tcp, 1, 2);
+		assert(proto::MetaParser<Set_t>::parse_all(pkt_tcp.data(), pkt_tcp.size(), meta));
+		assert(meta.proto_l4 == proto::END);
+		assert(meta.tuple.proto == proto::IPv4::PROTO_TCP);
+	}
+
+	void test_burst() noexcept {
+		TEST_TRACE;
+		constexpr size_t BURST = 16;
+		Packet_t pkts[BURST];
+		const uint8_t* buffers[BURST];
+		size_t sizes[BURST];
+		proto::PacketMeta metas[BURST];
+		for(size_t i = 0; i < BURST; ++i) {
+			put_ethernet(pkts[i], ETH_P_IP);
+			put_ipv4(pkts[i], i, i + 1, proto::IPv4::PROTO_UDP, 8);
+			put_udp(pkts[i], uint16_t(i), uint16_t(i + 1), 0);
+			buffers[i] = pkts[i].data();
+			sizes[i] = (i % 2) ? pkts[i].size() : 10;
+		}
+		assert(proto::MetaParser<>::parse_burst(buffers, sizes, metas, BURST) == BURST / 2);
+		for(size_t i = 1; i < BURST; i += 2) {
+			assert(metas[i].tuple.src.v4 == i);
+			assert(metas[i].tuple.port_dst == i + 1);
+		}
+	}
+
+	/**
+	 * Compare the descriptor with the HeaderParser stack walking.
+	 */
+	static void validate_offsets(const Packet_t& pkt, const proto::PacketMeta& meta) noexcept {
+		proto::HeaderParser hp(pkt.data(), pkt.size());
+		size_t vlan_idx = 0;
+		while(hp.protocol() != proto::END) {
+			const uint8_t* hdr;
+			hp.assign(hdr);
+			const auto offset = size_t(hdr - pkt.data());
+			switch(hp.protocol()) {
+				case proto::L2_ETHERNET:
+					assert(offset == meta.off_l2);
+					break;
+				case proto::L2_VLAN:
+					if(vlan_idx < meta.vlan_nb) {
+						assert(offset == meta.off_vlan[vlan_idx]);
+					}
+					vlan_idx++;
+					break;
+				case proto::L3_IPv4:
+				case proto::L3_IPv6:
+					assert(offset == meta.off_l3);
+					break;
+				case proto::L4_TCP:
+				case proto::L4_UDP:
+					assert(offset == meta.off_l4);
+					break;
+				default:
+					break;
+			}
+			hp.next();
+		}
+	}
+
+};
@@ -0,0 +1,270 @@
+#pragma once
+
+#include "test_environment.h"
+#include <fio/MappedReader.h>
+#include <fio/Reader.h>
+#include <fio/Writer.h>
+#include <intrusive/DequePool.h>
+#include <intrusive/HashQueuePool.h>
+
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+class TestPoolSnapshot {
+
+	using Node_t = intrusive::HashQueuePoolNode<uint32_t, uint64_t>;
+	using Pool_t = intrusive::HashQueuePool<Node_t>;
+	using EmptyNode_t = intrusive::HashQueuePoolEmptyNode<uint32_t>;
+	using DequeNode_t = intrusive::DequePoolNode<uint64_t>;
+
+	/**
+	 * Another function of the same key type, the saved buckets are wrong for it.
+	 */
+	struct OtherHash {
+		size_t operator()(uint32_t key) const noexcept {
+			return size_t(key) * 0x9E3779B97F4A7C15ull >> 7u;
+		}
+	};
+
+	std::string m_name;
+
+public:
+
+	TestPoolSnapshot() noexcept {
+		char name[] = "/tmp/test_pool_snapshot_XXXXXX";
+		const int fd = mkstemp(name);
+		assert(fd >= 0);
+		close(fd);
+		m_name = name;
+		test_hash_queue_pool();
+		test_duplicates();
+		test_empty_node();
+		test_broken();
+		test_deque_pool();
+		unlink(m_name.c_str());
+	}
+
+private:
+
+	/**
+	 * Pop all the nodes of @pool.
+	 * @return The keys and the values in the LRU order.
+	 */
+	template<typename Pool>
+	static std::vector<std::pair<uint32_t, uint64_t> > drain(Pool& pool) noexcept {
+		std::vector<std::pair<uint32_t, uint64_t> > result;
+		while(auto it = pool.peek_front()) {
+			result.emplace_back(it->im_key, it->value);
+			pool.pop_front();
+		}
+		assert(pool.available() == pool.capacity());
+		return result;
+	}
+
+	template<typename Pool>
+	void save(const Pool& pool) noexcept {
+		fio::Writer writer(m_name);
+		assert(writer.open());
+		assert(pool.save(writer));
+	}
+
+	void test_hash_queue_pool() noexcept {
+		TEST_TRACE;
+		const unsigned capacity = 1000;
+		DiceMachine dice(capacity);
+		Pool_t pool(capacity, 0.7f);
+		assert(pool.allocate() == 0);
+		for(uint32_t i = 0; i < capacity * 3u; ++i) {
+			const uint32_t key = dice.u32();
+			if(pool.find(key)) {
+				continue;
+			}
+			if(not pool.available()) {
+				pool.pop_front();
+			}
+			pool.push_back(key)->value = uint64_t(key) * 3u;
+			if(i % 7u == 0) {
+				pool.move_back(pool.peek_front());
+			}
+			if(i % 11u == 0) {
+				pool.remove(pool.peek_front());
+			}
+		}
+		const size_t size = pool.size();
+		save(pool);
+		const auto expected = drain(pool);
+		assert(expected.size() == size);
+
+		// the same geometry, the buckets are linked as saved
+		{
+			Pool_t restored(capacity, 0.7f);
+			assert(restored.allocate() == 0);
+			fio::Reader reader(m_name);
+			assert(reader.open());
+			assert(restored.restore(reader));
+			assert(restored.size() == size);
+			assert(restored.available() == capacity - size);
+			for(const auto& item : expected) {
+				auto it = restored.find(item.first);
+				assert(it && it->value == item.second);
+			}
+			assert(drain(restored) == expected);
+		}
+		// another bucket number, the keys are hashed again
+		{
+			Pool_t restored(capacity, 2.0f);
+			assert(restored.allocate() == 0);
+			fio::MappedReader reader(m_name);
+			assert(reader.open());
+			assert(restored.restore(reader));
+			for(const auto& item : expected) {
+				assert(restored.find(item.first)->value == item.second);
+			}
+			assert(drain(restored) == expected);
+		}
+		// the same bucket number of another hasher
+		{
+			intrusive::HashQueuePool<Node_t, OtherHash> restored(capacity, 0.7f);
+			assert(restored.allocate() == 0);
+			fio::MappedReader reader(m_name);
+			assert(reader.open());
+			assert(restored.restore(reader));
+			for(const auto& item : expected) {
+				assert(restored.find(item.first)->value == item.second);
+			}
+			assert(drain(restored) == expected);
+		}
+	}
+
+	void test_duplicates() noexcept {
+		TEST_TRACE;
+		Pool_t pool(16, 1.0f);
+		assert(pool.allocate() == 0);
+		pool.push_back(7)->value = 1;
+		pool.push_back(8)->value = 2;
+		pool.push_back(7)->value = 3;
+		save(pool);
+
+		Pool_t restored(16, 1.0f);
+		assert(restored.allocate() == 0);
+		fio::MappedReader reader(m_name);
+		assert(reader.open());
+		assert(restored.restore(reader));
+		auto it = restored.find(7);
+		assert(it->value == 3);
+		assert(it.next(7)->value == 1);
+		assert(restored.find(8)->value == 2);
+		// a restore replaces the content
+		fio::MappedReader again(m_name);
+		assert(again.open());
+		assert(restored.restore(again));
+		assert(restored.size() == 3);
+		assert(drain(restored) == drain(pool));
+	}
+
+	void test_empty_node() noexcept {
+		TEST_TRACE;
+		intrusive::HashQueuePool<EmptyNode_t> pool(64, 0.5f);
+		assert(pool.allocate() == 0);
+		for(uint32_t i = 0; i < 40; ++i) {
+			pool.push_back(i * 13u);
+		}
+		save(pool);
+		// the header and 8 bytes of the key and the bucket per record
+		fio::MappedReader reader(m_name);
+		assert(reader.open());
+		assert(reader.size() == sizeof(intrusive::PoolSnapshotHeader) + 40 * 8);
+
+		intrusive::HashQueuePool<EmptyNode_t> restored(64, 0.5f);
+		assert(restored.allocate() == 0);
+		assert(restored.restore(reader));
+		for(uint32_t i = 0; i < 40; ++i) {
+			assert(restored.peek_front()->im_key == i * 13u);
+			assert(restored.find(i * 13u));
+			restored.pop_front();
+		}
+	}
+
+	void test_broken() noexcept {
+		TEST_TRACE;
+		Pool_t pool(100, 1.0f);
+		assert(pool.allocate() == 0);
+		for(uint32_t i = 0; i < 100; ++i) {
+			pool.push_back(i)->value = i;
+		}
+		save(pool);
+
+		// not enough capacity
+		{
+			Pool_t restored(50, 1.0f);
+			assert(restored.allocate() == 0);
+			restored.push_back(1);
+			fio::MappedReader reader(m_name);
+			assert(reader.open());
+			assert(not restored.restore(reader));
+			assert(restored.size() == 0 && restored.available() == 50);
+		}
+		// another node type
+		{
+			intrusive::HashQueuePool<EmptyNode_t> restored(100, 1.0f);
+			assert(restored.allocate() == 0);
+			fio::MappedReader reader(m_name);
+			assert(reader.open());
+			assert(not restored.restore(reader));
+		}
+		// a truncated snapshot, the pool is usable after it
+		assert(truncate(m_name.c_str(), sizeof(intrusive::PoolSnapshotHeader) + 50 * 16 + 5) == 0);
+		{
+			Pool_t restored(100, 1.0f);
+			assert(restored.allocate() == 0);
+			fio::MappedReader reader(m_name);
+			assert(reader.open());
+			assert(not restored.restore(reader));
+			assert(restored.size() == 0 && restored.available() == 100);
+			assert(not restored.find(1));
+			for(uint32_t i = 0; i < 100; ++i) {
+				restored.push_back(i)->value = i;
+			}
+			assert(restored.find(99)->value == 99);
+			assert(drain(restored) == drain(pool));
+		}
+	}
+
+	void test_deque_pool() noexcept {
+		TEST_TRACE;
+		intrusive::DequePool<DequeNode_t> pool(32);
+		assert(pool.allocate() == 0);
+		for(uint64_t i = 0; i < 20; ++i) {
+			pool.push_front()->value = i;
+		}
+		pool.pop_back();
+		pool.push_back()->value = 100;
+		save(pool);
+
+		intrusive::DequePool<DequeNode_t> restored(32);
+		assert(restored.allocate() == 0);
+		restored.push_back()->value = 1;
+		fio::MappedReader reader(m_name);
+		assert(reader.open());
+		assert(restored.restore(reader));
+		assert(restored.size() == pool.size());
+		assert(restored.available() == 32 - pool.size());
+		auto it = pool.cbegin();
+		for(auto other = restored.cbegin(); other != restored.cend(); ++other, ++it) {
+			assert(it->value == other->value);
+		}
+		assert(it == pool.cend());
+		assert(restored.pop_back()->value == 100);
+		assert(restored.pop_front()->value == 19);
+
+		intrusive::DequePool<DequeNode_t> small(8);
+		assert(small.allocate() == 0);
+		fio::MappedReader again(m_name);
+		assert(again.open());
+		assert(not small.restore(again));
+		assert(small.size() == 0 && small.available() == 8);
+	}
+
+};
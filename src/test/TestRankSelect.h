@@ -0,0 +1,90 @@
+#pragma once
+
+#include "test_environment.h"
+#include <containers/bits/RankSelect.h>
+#include <utils/Cpu.h>
+
+#include <vector>
+
+class TestRankSelect {
+
+public:
+
+	TestRankSelect() noexcept {
+		test_select_word();
+		for(size_t size : {0, 1, 63, 64, 65, 511, 512, 513, 1024 * 3 + 7, 200000}) {
+			for(double density : {0.0, 0.001, 0.1, 0.5, 0.97, 1.0}) {
+				test_queries(size, density);
+			}
+		}
+		test_overhead();
+	}
+
+private:
+
+	void test_select_word() noexcept {
+		TEST_TRACE;
+		DiceMachine dice(9);
+		for(size_t i = 0; i < 10000; ++i) {
+			const uint64_t word = dice.u64() >> (dice.u32() % 64) | 1u;
+			uint64_t rest = word;
+			for(size_t k = 0; rest; ++k, rest &= rest - 1u) {
+				const unsigned expected = unsigned(__builtin_ctzll(rest));
+				assert(RankSelect::select_word(word, k) == expected);
+				if(utils::Cpu::bmi2()) {
+					assert(RankSelect::select_word_bmi2(word, k) == expected);
+				}
+			}
+		}
+	}
+
+	void test_queries(size_t size, double density) noexcept {
+		TEST_TRACE;
+		DiceMachine dice(size);
+		RankSelect rs;
+		assert(rs.allocate(size) == 0);
+		std::vector<size_t> ones;
+		std::vector<size_t> zeros;
+		for(size_t i = 0; i < size; ++i) {
+			const bool bit = dice.pass(density);
+			rs.set(i, bit);
+			(bit ? ones : zeros).push_back(i);
+		}
+		// the bits past the end are ignored
+		rs.data()[size / 64] |= ~0ull << (size % 64);
+		assert(rs.build() == 0);
+		assert(rs.size() == size);
+		assert(rs.count() == ones.size());
+
+		size_t rank = 0;
+		for(size_t i = 0; i <= size; ++i) {
+			assert(rs.rank1(i) == rank);
+			assert(rs.rank0(i) == i - rank);
+			if(i < size) {
+				assert(rs.get(i) == (rank < ones.size() && ones[rank] == i));
+				rank += rs.get(i);
+			}
+		}
+		for(size_t k = 0; k < ones.size(); ++k) {
+			assert(rs.select1(k) == ones[k]);
+		}
+		for(size_t k = 0; k < zeros.size(); ++k) {
+			assert(rs.select0(k) == zeros[k]);
+		}
+		assert(rs.select1(ones.size()) == size);
+		assert(rs.select0(zeros.size()) == size);
+	}
+
+	void test_overhead() noexcept {
+		TEST_TRACE;
+		RankSelect rs;
+		assert(rs.allocate(1 << 20) == 0);
+		for(size_t i = 0; i < rs.size(); i += 2) {
+			rs.set(i);
+		}
+		assert(rs.build() == 0);
+		assert(rs.directory_bytes() * 4 < rs.storage_bytes());
+		assert(rs.select1(1000) == 2000 && rs.select0(1000) == 2001);
+	}
+
+};
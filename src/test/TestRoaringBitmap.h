@@ -0,0 +1,243 @@
+#pragma once
+
+#include "test_environment.h"
+#include <containers/bits/RoaringBitmap.h>
+#include <cli/types/RangeSet.h>
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+class TestRoaringBitmap {
+
+	using Set_t = std::set<uint32_t>;
+
+public:
+
+	TestRoaringBitmap() noexcept {
+		test_intersect_arrays();
+		test_random(100, 1 << 12);
+		test_random(20000, 1 << 17);
+		test_random(200000, 1 << 20);
+		test_ranges();
+		test_serialize();
+		test_range_set();
+	}
+
+private:
+
+	static std::vector<uint32_t> values(const RoaringBitmap& bitmap) noexcept {
+		std::vector<uint32_t> result;
+		bitmap.for_each([&result](uint32_t value) {
+			result.push_back(value);
+		});
+		return result;
+	}
+
+	static bool equal(const RoaringBitmap& bitmap, const Set_t& set) noexcept {
+		const auto result = values(bitmap);
+		return bitmap.cardinality() == set.size() && std::equal(result.begin(), result.end(), set.begin(), set.end());
+	}
+
+	void test_intersect_arrays() noexcept {
+		TEST_TRACE;
+		DiceMachine dice(4);
+		for(size_t round = 0; round < 500; ++round) {
+			Set_t sa, sb;
+			const size_t na = dice.u32() % 300;
+			const size_t nb = (round % 5 ? dice.u32() % 300 : dice.u32() % 4000);
+			const uint32_t range = (round % 3 ? 65536 : 700);
+			while(sa.size() < std::min<size_t>(na, range)) {
+				sa.insert(dice.u32() % range);
+			}
+			while(sb.size() < std::min<size_t>(nb, range)) {
+				sb.insert(dice.u32() % range);
+			}
+			// the zero value is a string terminator for pcmpistrm, pcmpestrm has to match it
+			if(round % 7 == 0) {
+				sa.insert(0);
+				sb.insert(0);
+			}
+			std::vector<uint16_t> a(sa.begin(), sa.end()), b(sb.begin(), sb.end()), expected;
+			std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+
+			std::vector<uint16_t> out(std::min(a.size(), b.size()) + 8);
+			auto check = [&](size_t count) {
+				assert(count == expected.size());
+				assert(std::equal(expected.begin(), expected.end(), out.begin()));
+			};
+			check(RoaringBitmap::intersect_scalar(a.data(), a.size(), b.data(), b.size(), out.data()));
+			check(RoaringBitmap::intersect_arrays(a.data(), a.size(), b.data(), b.size(), out.data()));
+			if(utils::Cpu::sse42()) {
+				check(RoaringBitmap::intersect_sse42(a.data(), a.size(), b.data(), b.size(), out.data()));
+			}
+			if(a.size() <= b.size()) {
+				check(RoaringBitmap::intersect_galloping(a.data(), a.size(), b.data(), b.size(), out.data()));
+			}
+		}
+	}
+
+	/**
+	 * @param count - the values in [0:range) per set, from the sparse arrays to the bitmaps.
+	 */
+	void test_random(size_t count, uint32_t range) noexcept {
+		TEST_TRACE;
+		DiceMachine dice(count);
+		RoaringBitmap a, b;
+		Set_t sa, sb;
+		for(size_t i = 0; i < count; ++i) {
+			const uint32_t x = dice.u32() % range;
+			const uint32_t y = dice.u32() % range;
+			a.add(x);
+			sa.insert(x);
+			b.add(y);
+			sb.insert(y);
+		}
+		// a few ranges and removals
+		for(size_t i = 0; i < 10; ++i) {
+			const uint32_t first = dice.u32() % range;
+			const uint32_t last = first + dice.u32() % 3000;
+			b.add_range(first, last);
+			for(uint32_t v = first; v <= last; ++v) {
+				sb.insert(v);
+			}
+			const uint32_t x = *sa.lower_bound(dice.u32() % (*sa.rbegin() + 1));
+			a.remove(x);
+			sa.erase(x);
+		}
+		assert(equal(a, sa));
+		assert(equal(b, sb));
+		for(size_t i = 0; i < 1000; ++i) {
+			const uint32_t x = dice.u32() % (range * 2);
+			assert(a.contains(x) == (sa.count(x) != 0));
+			assert(b.contains(x) == (sb.count(x) != 0));
+		}
+
+		for(bool optimized : {false, true}) {
+			if(optimized) {
+				a.run_optimize();
+				b.run_optimize();
+				assert(equal(a, sa));
+				assert(equal(b, sb));
+			}
+			Set_t expected;
+			RoaringBitmap out;
+			RoaringBitmap::intersect(a, b, out);
+			std::set_intersection(sa.begin(), sa.end(), sb.begin(), sb.end(), std::inserter(expected, expected.end()));
+			assert(equal(out, expected));
+
+			expected.clear();
+			RoaringBitmap::unite(a, b, out);
+			std::set_union(sa.begin(), sa.end(), sb.begin(), sb.end(), std::inserter(expected, expected.end()));
+			assert(equal(out, expected));
+		}
+	}
+
+	void test_ranges() noexcept {
+		TEST_TRACE;
+		RoaringBitmap a;
+		a.add_range(10, 20);
+		a.add_range(30, 40);
+		a.add_range(21, 29);
+		a.add(41);
+		a.add(9);
+		assert(a.cardinality() == 33);
+		assert(values(a).front() == 9 && values(a).back() == 41);
+		a.remove(25);
+		assert(a.cardinality() == 32 && not a.contains(25) && a.contains(26));
+
+		// the ranges crossing the containers and the full containers
+		RoaringBitmap b;
+		b.add_range(0xFFF0, 0x3000F);
+		b.add_range(0xFFFFFFF0, 0xFFFFFFFF);
+		assert(b.cardinality() == 0x20020 + 16);
+		assert(b.contains(0x20000) && b.contains(0xFFFFFFFF) && not b.contains(0xFFEF) && not b.contains(0x30010));
+		assert(b.storage_bytes() < 1024);
+
+		RoaringBitmap c, out;
+		c.add_range(0x1FFFF, 0x20001);
+		c.add(0xFFFFFFFF);
+		RoaringBitmap::intersect(b, c, out);
+		assert(out.cardinality() == 4);
+		RoaringBitmap::unite(b, c, out);
+		assert(out.cardinality() == b.cardinality());
+
+		// the scattered values turn the runs into an array and a bitmap
+		RoaringBitmap d;
+		d.add_range(0, 9);
+		for(uint32_t v = 100; v < 20000; v += 2) {
+			d.add(v);
+		}
+		assert(d.cardinality() == 10 + 9950);
+		for(uint32_t v = 100; v < 20000; v += 2) {
+			d.remove(v);
+		}
+		assert(d.cardinality() == 10);
+		d.run_optimize();
+		assert(values(d).back() == 9);
+	}
+
+	void test_serialize() noexcept {
+		TEST_TRACE;
+		DiceMachine dice(8);
+		RoaringBitmap a;
+		Set_t sa;
+		for(size_t i = 0; i < 10000; ++i) {
+			const uint32_t x = dice.u32() % (1u << 20);
+			a.add(x);
+			sa.insert(x);
+		}
+		for(uint32_t v = 1u << 21; v < (1u << 21) + 70000; v += 3) {
+			a.add(v);
+			sa.insert(v);
+		}
+		a.add_range(5u << 20, (5u << 20) + 100000);
+		for(uint32_t v = 5u << 20; v <= (5u << 20) + 100000; ++v) {
+			sa.insert(v);
+		}
+		a.run_optimize();
+
+		std::vector<uint64_t> image(a.serialized_bytes() / 8);
+		assert(a.serialize(image.data(), image.size() * 8 - 1) == 0);
+		assert(a.serialize(image.data(), image.size() * 8) == image.size() * 8);
+
+		RoaringView view;
+		assert(view.attach(image.data(), image.size() * 8) == 0);
+		assert(view.cardinality() == sa.size());
+		for(size_t i = 0; i < 10000; ++i) {
+			const uint32_t x = dice.u32() % (6u << 20);
+			assert(view.contains(x) == (sa.count(x) != 0));
+		}
+		std::vector<uint32_t> seen;
+		view.for_each([&seen](uint32_t value) {
+			seen.push_back(value);
+		});
+		assert(std::equal(seen.begin(), seen.end(), sa.begin(), sa.end()));
+
+		RoaringBitmap b;
+		assert(b.deserialize(image.data(), image.size() * 8));
+		assert(equal(b, sa));
+
+		// the broken images
+		assert(view.attach(image.data(), 8) != 0);
+		assert(view.attach(image.data(), image.size() * 8 - 8) != 0);
+		reinterpret_cast<uint8_t*>(image.data())[0] ^= 1;
+		assert(view.attach(image.data(), image.size() * 8) != 0);
+		assert(not b.deserialize(image.data(), image.size() * 8));
+	}
+
+	void test_range_set() noexcept {
+		TEST_TRACE;
+		const char* arg = "1-100,200,300-4000,70000-70010";
+		cli::RangeSet set;
+		assert(set.parse(arg) == ssize_t(strlen(arg) + 1));
+		RoaringBitmap parsed, built;
+		assert(cli::RangeSet::parse(arg, parsed) == ssize_t(strlen(arg) + 1));
+		set.to_bitmap(built);
+		assert(equal(parsed, set.items));
+		assert(equal(built, set.items));
+		assert(parsed.storage_bytes() < 512);
+		assert(cli::RangeSet::parse("5-1", parsed) < 0);
+	}
+
+};
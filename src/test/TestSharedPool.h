@@ -0,0 +1,369 @@
+#pragma once
+
+#include "test_environment.h"
+#include <intrusive/DequePool.h>
+#include <intrusive/HashQueuePool.h>
+#include <utils/SharedRegion.h>
+
+#include <array>
+#include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+class TestSharedPool {
+
+	using Node_t = intrusive::HashQueuePoolNode<uint32_t, uint64_t>;
+	using Pool_t = intrusive::HashQueuePool<Node_t>;
+	using DequeNode_t = intrusive::DequePoolNode<uint64_t>;
+	using Deque_t = intrusive::DequePool<DequeNode_t>;
+
+	static constexpr unsigned CAPACITY = 1000;
+	static constexpr size_t REGION_SIZE = size_t(1) << 20u;
+
+	std::string m_path;
+
+public:
+
+	TestSharedPool() noexcept {
+		char path[] = "/dev/shm/test_shared_pool_XXXXXX";
+		char path_tmp[] = "/tmp/test_shared_pool_XXXXXX";
+		int fd = mkstemp(path);
+		m_path = path;
+		if(fd < 0) {
+			fd = mkstemp(path_tmp);
+			m_path = path_tmp;
+		}
+		assert(fd >= 0);
+		close(fd);
+		test_region();
+		test_open();
+		test_restart();
+		test_crash();
+		test_reader();
+		test_live_reader();
+		unlink(m_path.c_str());
+	}
+
+private:
+
+	/**
+	 * Pop all the nodes of @pool.
+	 * @return The keys and the values in the LRU order.
+	 */
+	static std::vector<std::pair<uint32_t, uint64_t> > drain(Pool_t& pool) noexcept {
+		std::vector<std::pair<uint32_t, uint64_t> > result;
+		while(auto it = pool.peek_front()) {
+			result.emplace_back(it->im_key, it->value);
+			pool.pop_front();
+		}
+		return result;
+	}
+
+	static void fill(Pool_t& pool) noexcept {
+		for(uint32_t i = 0; i < CAPACITY; ++i) {
+			pool.push_back(i * 7u)->value = i;
+		}
+		pool.move_back(pool.find(0));
+		pool.remove(pool.find(7));
+		pool.pop_front();
+	}
+
+	/**
+	 * Run @check in a child process.
+	 * @return true - if it has returned true.
+	 */
+	template<typename F>
+	static bool in_child(F&& check) noexcept {
+		const pid_t pid = fork();
+		assert(pid >= 0);
+		if(pid == 0) {
+			_exit(check() ? 0 : 1);
+		}
+		int status = 0;
+		waitpid(pid, &status, 0);
+		return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+
+	void test_region() noexcept {
+		TEST_TRACE;
+		utils::SharedRegion region(m_path, REGION_SIZE);
+		assert(region.attach() != 0); // an empty file
+		assert(region.create() == 0);
+		assert(region.created() && region.writable());
+		uint64_t* first = static_cast<uint64_t*>(region.allocate(sizeof(uint64_t)));
+		assert(reinterpret_cast<uintptr_t>(first) > utils::SharedRegion::BASE_DEFAULT);
+		*first = 42;
+		assert(region.allocate(REGION_SIZE) == nullptr);
+		const size_t used = region.used();
+
+		// the address range is taken by the first mapping
+		utils::SharedRegion other(m_path, 0);
+		assert(other.attach() != 0);
+
+		region.close();
+		assert(other.attach() == 0);
+		assert(not other.created());
+		assert(other.size() == REGION_SIZE && other.used() == used);
+		assert(other.allocate(sizeof(uint64_t)) == first);
+		assert(*first == 42);
+		// the allocations of the creator only
+		assert(other.allocate(1) == nullptr);
+	}
+
+	/**
+	 * A region which can't be mapped is not replaced by open() or by a failed create().
+	 */
+	void test_open() noexcept {
+		TEST_TRACE;
+		{
+			utils::SharedRegion region(m_path, REGION_SIZE);
+			region.remove();
+			assert(region.open() == 0 && region.created());
+			*static_cast<uint64_t*>(region.allocate(sizeof(uint64_t))) = 42;
+		}
+		void* taken = mmap(reinterpret_cast<void*>(utils::SharedRegion::BASE_DEFAULT), REGION_SIZE, PROT_READ
+			, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+		assert(taken == reinterpret_cast<void*>(utils::SharedRegion::BASE_DEFAULT));
+		{
+			utils::SharedRegion region(m_path, REGION_SIZE);
+			assert(region.attach() == -2);
+			assert(region.open() == -2 && not region.is_open());
+			assert(region.create() != 0);
+		}
+		munmap(taken, REGION_SIZE);
+		{
+			utils::SharedRegion region(m_path, REGION_SIZE);
+			assert(region.open() == 0 && not region.created());
+			assert(*static_cast<uint64_t*>(region.allocate(sizeof(uint64_t))) == 42);
+		}
+	}
+
+	void test_restart() noexcept {
+		TEST_TRACE;
+		std::vector<std::pair<uint32_t, uint64_t> > expected;
+		std::vector<uint64_t> expected_deque;
+		{
+			utils::SharedRegion region(m_path, REGION_SIZE);
+			assert(region.create() == 0);
+			Pool_t pool(CAPACITY, 0.7f);
+			assert(pool.allocate(region) == 0);
+			assert(pool.generation() == 2);
+			Deque_t deque(16);
+			assert(deque.allocate(region) == 0);
+			fill(pool);
+			for(uint64_t i = 0; i < 10; ++i) {
+				deque.push_front()->value = i;
+			}
+			assert(pool.generation() == 3);
+			pool.commit();
+			deque.commit();
+			assert(pool.generation() == 4);
+			pool.commit();
+			assert(pool.generation() == 4);
+
+			Pool_t copy(CAPACITY, 0.7f);
+			assert(copy.allocate() == 0);
+			fill(copy);
+			expected = drain(copy);
+			for(auto it = deque.cbegin(); it != deque.cend(); ++it) {
+				expected_deque.push_back(it->value);
+			}
+		}
+		{
+			// another geometry
+			utils::SharedRegion region(m_path, 0);
+			assert(region.attach() == 0);
+			Pool_t pool(CAPACITY, 2.0f);
+			assert(pool.allocate(region) != 0);
+		}
+		{
+			utils::SharedRegion region(m_path, 0);
+			assert(region.attach() == 0);
+			Pool_t pool(CAPACITY, 0.7f);
+			assert(pool.allocate(region) == 0);
+			Deque_t deque(16);
+			assert(deque.allocate(region) == 0);
+			assert(pool.size() == expected.size());
+			assert(pool.available() == CAPACITY - expected.size());
+			for(const auto& item : expected) {
+				assert(pool.find(item.first)->value == item.second);
+			}
+			assert(not pool.find(7));
+			std::vector<uint64_t> values;
+			for(auto it = deque.cbegin(); it != deque.cend(); ++it) {
+				values.push_back(it->value);
+			}
+			assert(values == expected_deque);
+			assert(drain(pool) == expected);
+			// the destruction commits the changes
+		}
+		{
+			utils::SharedRegion region(m_path, 0);
+			assert(region.attach() == 0);
+			Pool_t pool(CAPACITY, 0.7f);
+			assert(pool.allocate(region) == 0);
+			assert(pool.size() == 0 && pool.available() == CAPACITY);
+			pool.push_back(1)->value = 2;
+			assert(pool.find(1)->value == 2);
+		}
+	}
+
+	void test_crash() noexcept {
+		TEST_TRACE;
+		{
+			utils::SharedRegion region(m_path, REGION_SIZE);
+			assert(region.create() == 0);
+			Pool_t pool(CAPACITY, 0.7f);
+			assert(pool.allocate(region) == 0);
+			fill(pool);
+		}
+		// a writer dies in the middle of a change
+		assert(in_child([this]() {
+			utils::SharedRegion region(m_path, 0);
+			Pool_t* pool = new Pool_t(CAPACITY, 0.7f);
+			if(region.attach() != 0 || pool->allocate(region) != 0) {
+				return false;
+			}
+			pool->pop_front();
+			_exit(0);
+			return true;
+		}));
+		utils::SharedRegion region(m_path, REGION_SIZE);
+		assert(region.attach() == 0);
+		Pool_t pool(CAPACITY, 0.7f);
+		assert(pool.allocate(region) != 0);
+		// the region is created again
+		assert(region.create() == 0);
+		Pool_t fresh(CAPACITY, 0.7f);
+		assert(fresh.allocate(region) == 0);
+		assert(fresh.size() == 0);
+	}
+
+	void test_reader() noexcept {
+		TEST_TRACE;
+		utils::SharedRegion region(m_path, REGION_SIZE);
+		assert(region.create() == 0);
+		Pool_t pool(CAPACITY, 0.7f);
+		assert(pool.allocate(region) == 0);
+		for(uint32_t i = 0; i < 100; ++i) {
+			pool.push_back(i)->value = i * 2u;
+		}
+		pool.commit();
+		pool.push_back(1000)->value = 1; // not committed
+		assert(pool.generation() % 2 == 1);
+		// the region is mapped at the same address in a forked child, it is closed there first
+		assert(in_child([this, &region]() {
+			region.close();
+			utils::SharedRegion reader_region(m_path, 0);
+			if(reader_region.attach(false) != 0 || reader_region.writable()) {
+				return false;
+			}
+			Pool_t reader(CAPACITY, 0.7f);
+			// the writer is in the middle of a change
+			return reader.allocate(reader_region) != 0;
+		}));
+		pool.commit();
+		assert(in_child([this, &region]() {
+			region.close();
+			utils::SharedRegion reader_region(m_path, 0);
+			Pool_t reader(CAPACITY, 0.7f);
+			if(reader_region.attach(false) != 0 || reader.allocate(reader_region) != 0) {
+				return false;
+			}
+			bool result = reader.size() == 101 && reader.peek_front()->im_key == 0;
+			for(uint32_t i = 0; i < 100; ++i) {
+				result &= reader.find(i) && reader.find(i)->value == i * 2u;
+			}
+			result &= reader.find(1000) && reader.refresh();
+			return result;
+		}));
+	}
+
+	/**
+	 * A reader copies the values while the writer reuses the nodes for other keys,
+	 * all the words of a value are its key.
+	 */
+	void test_live_reader() noexcept {
+		TEST_TRACE;
+		using Value_t = std::array<uint64_t, 32>;
+		using WideNode_t = intrusive::HashQueuePoolNode<uint32_t, Value_t>;
+		using WidePool_t = intrusive::HashQueuePool<WideNode_t>;
+		const auto fill_value = [](Value_t& value, uint64_t key) {
+			for(auto& word : value) {
+				word = key;
+			}
+		};
+		utils::SharedRegion region(m_path, REGION_SIZE);
+		assert(region.create() == 0);
+		WidePool_t pool(CAPACITY, 0.7f);
+		assert(pool.allocate(region) == 0);
+		Deque_t deque(16);
+		assert(deque.allocate(region) == 0);
+		for(uint32_t i = 0; i < CAPACITY / 2; ++i) {
+			fill_value(pool.push_back(i)->value, i);
+		}
+		while(deque.available()) {
+			deque.push_back()->value = 0;
+		}
+		pool.commit();
+		deque.commit();
+		int ready[2];
+		assert(pipe(ready) == 0);
+		const pid_t pid = fork();
+		assert(pid >= 0);
+		if(pid == 0) {
+			region.close();
+			utils::SharedRegion reader_region(m_path, 0);
+			WidePool_t reader(CAPACITY, 0.7f);
+			Deque_t reader_deque(16);
+			if(reader_region.attach(false) != 0 || reader.allocate(reader_region) != 0
+				|| reader_deque.allocate(reader_region) != 0) {
+				_exit(1);
+			}
+			const char byte = 1;
+			if(write(ready[1], &byte, 1) != 1) {
+				_exit(1);
+			}
+			unsigned found = 0;
+			for(unsigned round = 0; round < 1000000; ++round) {
+				const uint32_t key = round % CAPACITY;
+				Value_t value;
+				const int result = reader.read(key, value);
+				for(size_t i = 0; result == 1 && i < value.size(); ++i) {
+					if(value[i] != key) {
+						_exit(2);
+					}
+				}
+				found += result == 1;
+				uint64_t front = 0;
+				if(reader_deque.read_front(front) == 1 && front % 3u) {
+					_exit(3);
+				}
+			}
+			_exit(found ? 0 : 4);
+		}
+		char byte = 0;
+		assert(read(ready[0], &byte, 1) == 1);
+		close(ready[0]);
+		close(ready[1]);
+		// the oldest key is popped and its node is taken by the next one
+		uint32_t next = CAPACITY / 2;
+		int status = 0;
+		while(waitpid(pid, &status, WNOHANG) == 0) {
+			for(unsigned i = 0; i < 16; ++i, ++next) {
+				pool.pop_front();
+				const uint32_t key = next % CAPACITY;
+				fill_value(pool.push_back(key)->value, key);
+				deque.pop_front();
+				deque.push_back()->value = next * 3u;
+			}
+			pool.commit();
+			deque.commit();
+		}
+		assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	}
+
+};
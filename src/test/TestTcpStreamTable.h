@@ -0,0 +1,268 @@
+#pragma once
+
+#include "test_environment.h"
+#include "TestMetaParser.h"
+#include <proto/reassembly/TcpStreamTable.h>
+#include <proto/parsers/MetaParser.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+class TestTcpStreamTable {
+
+	using Packet_t = std::vector<uint8_t>;
+
+	struct Handler;
+	using Table_t = proto::TcpStreamTable<Handler>;
+
+	struct Handler {
+		std::string stream[2]; // [0] - client to server
+		std::vector<Table_t::Close> closed;
+
+		void on_data(const proto::FiveTuple& tuple, Table_t::Flow&, const uint8_t* data, size_t size) noexcept {
+			stream[tuple.port_src == PORT_SERVER ? 1 : 0].append(reinterpret_cast<const char*>(data), size);
+		}
+
+		void on_close(const proto::FiveTuple&, Table_t::Flow&, Table_t::Close reason) noexcept {
+			closed.push_back(reason);
+		}
+	};
+
+	static constexpr uint16_t PORT_SERVER = 80;
+	static constexpr uint8_t FIN = 0x01;
+	static constexpr uint8_t SYN = 0x02;
+	static constexpr uint8_t RST = 0x04;
+	static constexpr uint8_t ACK = 0x10;
+	static constexpr uint64_t TIMEOUT = 1000;
+
+public:
+
+	TestTcpStreamTable() noexcept {
+		test_session();
+		test_out_of_order();
+		test_reset();
+		test_timeout();
+		test_gap();
+		test_retransmit_ooo();
+		test_random();
+	}
+
+private:
+
+	/**
+	 * A segment from the client (@to_server) or from the server.
+	 */
+	static Packet_t make_segment(uint16_t port_client, bool to_server, uint32_t seq, uint8_t flags, const std::string& data) noexcept {
+		Packet_t pkt;
+		const uint32_t client = 0x0A000001;
+		const uint32_t server = 0x0A000002;
+		TestMetaParser::put_ethernet(pkt, ETH_P_IP);
+		TestMetaParser::put_ipv4(pkt, to_server ? client : server, to_server ? server : client
+			, proto::IPv4::PROTO_TCP, uint16_t(sizeof(proto::Tcp::Header) + data.size()));
+		const size_t off_tcp = pkt.size();
+		TestMetaParser::put_tcp(pkt, to_server ? port_client : PORT_SERVER, to_server ? PORT_SERVER : port_client);
+		auto hdr = reinterpret_cast<proto::Tcp::Header*>(pkt.data() + off_tcp);
+		hdr->seq_num = htonl(seq);
+		hdr->flags = flags;
+		pkt.insert(pkt.end(), data.begin(), data.end());
+		return pkt;
+	}
+
+	static bool push(Table_t& table, const Packet_t& pkt, uint64_t now) noexcept {
+		proto::PacketMeta meta;
+		assert(proto::MetaParser<>::parse_all(pkt.data(), pkt.size(), meta));
+		return table.push(pkt.data(), meta, now);
+	}
+
+	static std::string make_text(size_t size, char seed) noexcept {
+		std::string result;
+		for(size_t i = 0; i < size; ++i) {
+			result.push_back(char('a' + (seed + i) % 26));
+		}
+		return result;
+	}
+
+	void test_session() noexcept {
+		TEST_TRACE;
+		Handler handler;
+		Table_t table(handler, 16, 16, 8192, TIMEOUT);
+		assert(table.allocate() == 0);
+
+		assert(push(table, make_segment(1000, true, 100, SYN, ""), 0));
+		assert(push(table, make_segment(1000, false, 5000, SYN | ACK, ""), 0));
+		assert(push(table, make_segment(1000, true, 101, ACK, "GET / "), 0));
+		assert(push(table, make_segment(1000, true, 107, ACK, "HTTP/1.1\r\n"), 0));
+		assert(push(table, make_segment(1000, false, 5001, ACK, "HTTP/1.1 200 OK\r\n"), 0));
+		assert(table.size() == 1);
+		assert(push(table, make_segment(1000, true, 117, FIN | ACK, ""), 0));
+		assert(push(table, make_segment(1000, false, 5018, FIN | ACK, "bye"), 0));
+		assert(table.size() == 0);
+
+		assert(handler.stream[0] == "GET / HTTP/1.1\r\n");
+		assert(handler.stream[1] == "HTTP/1.1 200 OK\r\nbye");
+		assert(handler.closed.size() == 1 && handler.closed[0] == Table_t::FINISHED);
+		assert(table.stat().finished == 1);
+		assert(table.stat().bytes == handler.stream[0].size() + handler.stream[1].size());
+	}
+
+	void test_out_of_order() noexcept {
+		TEST_TRACE;
+		Handler handler;
+		Table_t table(handler, 16, 16, 8192, TIMEOUT);
+		assert(table.allocate() == 0);
+
+		// the connection is picked up in the middle
+		assert(push(table, make_segment(1000, true, 1000, ACK, "0123"), 0));
+		assert(push(table, make_segment(1000, true, 1008, ACK, "89"), 0));
+		assert(push(table, make_segment(1000, true, 1006, ACK, "6789ab"), 0));
+		assert(handler.stream[0] == "0123");
+		// "67" and "ab" around the buffered "89"
+		assert(table.stat().segments_used == 3);
+		assert(push(table, make_segment(1000, true, 1002, ACK, "23456"), 0));
+		assert(handler.stream[0] == "0123456789ab");
+		assert(table.stat().segments_used == 0);
+		assert(push(table, make_segment(1000, true, 1000, ACK, "0123"), 0));
+		assert(table.stat().duplicates == 1);
+		assert(handler.stream[0] == "0123456789ab");
+	}
+
+	void test_reset() noexcept {
+		TEST_TRACE;
+		Handler handler;
+		Table_t table(handler, 16, 16, 8192, TIMEOUT);
+		assert(table.allocate() == 0);
+
+		assert(not push(table, make_segment(1000, true, 1, RST, ""), 0));
+		assert(table.size() == 0);
+		assert(push(table, make_segment(1000, true, 1, SYN, ""), 0));
+		assert(push(table, make_segment(1000, true, 10, ACK, "later"), 0));
+		assert(push(table, make_segment(1000, false, 1, RST, ""), 0));
+		assert(table.size() == 0);
+		assert(handler.closed.size() == 1 && handler.closed[0] == Table_t::RESET);
+		assert(table.stat().segments_used == 0);
+	}
+
+	void test_timeout() noexcept {
+		TEST_TRACE;
+		Handler handler;
+		Table_t table(handler, 4, 16, 8192, TIMEOUT);
+		assert(table.allocate() == 0);
+
+		for(uint16_t port = 0; port < 4; ++port) {
+			assert(push(table, make_segment(port, true, 1, SYN, ""), port * 100));
+		}
+		// the first flow is active again
+		assert(push(table, make_segment(0, false, 1, SYN | ACK, ""), 500));
+		table.expire(TIMEOUT + 150);
+		assert(table.size() == 3);
+		assert(table.stat().timeouts == 1);
+
+		// the flow at the front of the queue is evicted
+		assert(push(table, make_segment(10, true, 1, SYN, ""), 1200));
+		assert(push(table, make_segment(11, true, 1, SYN, ""), 1200));
+		assert(table.size() == 4);
+		assert(table.stat().evictions == 1);
+		assert(table.find(make_tuple(0)) != nullptr);
+		assert(table.find(make_tuple(1)) == nullptr);
+		assert(table.find(make_tuple(2)) == nullptr);
+		assert(table.find(make_tuple(3)) != nullptr);
+
+		table.reset();
+		assert(table.size() == 0);
+		assert(handler.closed.size() == 6);
+		assert(handler.closed.back() == Table_t::CLEARED);
+	}
+
+	static proto::FiveTuple make_tuple(uint16_t port_client) noexcept {
+		proto::PacketMeta meta;
+		const auto pkt = make_segment(port_client, false, 0, ACK, "");
+		proto::MetaParser<>::parse_all(pkt.data(), pkt.size(), meta);
+		return meta.tuple;
+	}
+
+	void test_gap() noexcept {
+		TEST_TRACE;
+		Handler handler;
+		Table_t table(handler, 4, 4, 2500, TIMEOUT);
+		assert(table.allocate() == 0);
+
+		assert(push(table, make_segment(1000, true, 0, ACK, "a"), 0));
+		// 1..1000 is lost
+		const auto text = make_text(1000, 0);
+		assert(push(table, make_segment(1000, true, 1000, ACK, text), 0));
+		assert(push(table, make_segment(1000, true, 2000, ACK, text), 0));
+		assert(handler.stream[0] == "a");
+		assert(push(table, make_segment(1000, true, 3000, ACK, text), 0));
+		assert(table.stat().gaps == 1);
+		assert(handler.stream[0] == "a" + text + text + text);
+
+		// the segment pool is exhausted
+		handler.stream[0].clear();
+		for(uint32_t i = 0; i < 6; ++i) {
+			push(table, make_segment(2000, true, 0, ACK, "a"), 0);
+			push(table, make_segment(2000, true, 10 + i * 10, ACK, "b"), 0);
+		}
+		assert(table.stat().drops_memory == 2);
+		assert(table.stat().segments_used == 4);
+	}
+
+	/**
+	 * The retransmissions of the buffered data take no segments and cause no gap.
+	 */
+	void test_retransmit_ooo() noexcept {
+		TEST_TRACE;
+		Handler handler;
+		Table_t table(handler, 4, 8, 2500, TIMEOUT);
+		assert(table.allocate() == 0);
+
+		const auto text = make_text(3000, 5);
+		assert(push(table, make_segment(1000, true, 0, ACK, text.substr(0, 1)), 0));
+		for(unsigned i = 0; i < 10; ++i) {
+			assert(push(table, make_segment(1000, true, 1000, ACK, text.substr(1000, 1000)), 0));
+		}
+		assert(table.stat().segments_used == 1);
+		assert(table.stat().duplicates == 9 && table.stat().duplicate_bytes == 9000);
+		// an overlap on both sides of the buffered data
+		assert(push(table, make_segment(1000, true, 500, ACK, text.substr(500, 2000)), 0));
+		assert(table.stat().segments_used == 3);
+		assert(table.stat().duplicate_bytes == 10000);
+		assert(handler.stream[0] == text.substr(0, 1));
+		assert(push(table, make_segment(1000, true, 1, ACK, text.substr(1, 999)), 0));
+		assert(handler.stream[0] == text.substr(0, 2500));
+		assert(table.stat().gaps == 0 && table.stat().segments_used == 0);
+	}
+
+	void test_random() noexcept {
+		TEST_TRACE;
+		Handler handler;
+		Table_t table(handler, 4, 1024, 1 << 20, TIMEOUT);
+		assert(table.allocate() == 0);
+		DiceMachine dice(7);
+
+		// one client stream split into the segments of random size, sent with retransmissions
+		const auto text = make_text(100000, 3);
+		std::vector<Packet_t> segments;
+		segments.push_back(make_segment(1000, true, 0xFFFF0000u, SYN, ""));
+		size_t pos = 0;
+		while(pos < text.size()) {
+			const size_t size = std::min<size_t>(1 + dice.u32() % 1400, text.size() - pos);
+			const uint32_t seq = 0xFFFF0001u + uint32_t(pos);
+			segments.push_back(make_segment(1000, true, seq, ACK, text.substr(pos, size)));
+			if(dice.pass(0.1)) {
+				segments.push_back(segments.back());
+			}
+			pos += size;
+		}
+		for(size_t i = 1; i < segments.size(); ++i) {
+			std::swap(segments[i], segments[i + dice.u32() % std::min<size_t>(16, segments.size() - i)]);
+		}
+		for(const auto& seg : segments) {
+			assert(push(table, seg, 0));
+		}
+		assert(handler.stream[0] == text);
+		assert(table.stat().gaps == 0);
+		assert(table.stat().segments_used == 0);
+	}
+
+};
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "test_environment.h"
+#include <proto/TrafficGenerator.h>
+#include <proto/Rewriter.h>
+#include <proto/parsers/HeaderParser.h>
+#include <proto/parsers/MetaParser.h>
+
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+class TestTrafficGenerator {
+
+	static constexpr size_t FRAMES = 2000;
+
+public:
+
+	TestTrafficGenerator() noexcept {
+		test_deterministic();
+		test_imix();
+		test_vlan_stacked();
+		test_ipv6();
+		test_gre();
+		test_fragmented();
+		test_pcap();
+	}
+
+private:
+
+	static bool same(const proto::TrafficTrace& a, const proto::TrafficTrace& b) noexcept {
+		if(a.size() != b.size() || a.bytes() != b.bytes()) {
+			return false;
+		}
+		for(size_t i = 0; i < a.size(); ++i) {
+			if(a.length(i) != b.length(i) || a.stamp(i) != b.stamp(i)
+				|| memcmp(a.frame(i), b.frame(i), a.length(i)) != 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static proto::TrafficTrace make(const proto::TrafficProfile& profile, uint64_t seed = 1) noexcept {
+		proto::TrafficTrace trace;
+		proto::TrafficGenerator(profile, seed).generate(trace, FRAMES);
+		assert(trace.size() == FRAMES);
+		return trace;
+	}
+
+	/**
+	 * @return true - if the checksums of the packet from the L3 header of @meta on are valid.
+	 */
+	static bool checksums_valid(const proto::TrafficTrace& trace, size_t idx, const proto::PacketMeta& meta) noexcept {
+		proto::RoMFrame frame(trace.frame(idx) + meta.off_l3, trace.length(idx) - meta.off_l3);
+		return proto::Rewriter::verify_checksums(frame);
+	}
+
+	void test_deterministic() noexcept {
+		TEST_TRACE;
+		const auto profile = proto::TrafficProfile::imix();
+		assert(same(make(profile, 7), make(profile, 7)));
+		assert(not same(make(profile, 7), make(profile, 8)));
+
+		const auto trace = make(profile);
+		for(size_t i = 1; i < trace.size(); ++i) {
+			assert(trace.stamp(i) > trace.stamp(i - 1));
+		}
+	}
+
+	void test_imix() noexcept {
+		TEST_TRACE;
+		const auto trace = make(proto::TrafficProfile::imix());
+		size_t small = 0, v6 = 0, tcp = 0;
+		for(size_t i = 0; i < trace.size(); ++i) {
+			const size_t length = trace.length(i);
+			assert(length >= 64 && length <= 1500);
+			small += length < 100;
+			proto::PacketMeta meta;
+			assert(proto::MetaParser<>::parse_all(trace.frame(i), length, meta));
+			assert(not meta.truncated() && not meta.fragment());
+			assert(meta.proto_l4 == proto::L4_TCP || meta.proto_l4 == proto::L4_UDP);
+			assert(size_t(meta.off_payload) + meta.len_payload == length);
+			assert(checksums_valid(trace, i, meta));
+			v6 += meta.tuple.version == 6;
+			tcp += meta.proto_l4 == proto::L4_TCP;
+		}
+		// 7 of 12 frames are small, 15% of the flows are IPv6, 60% are TCP
+		assert(small > FRAMES / 2 && small < FRAMES * 2 / 3);
+		assert(v6 > FRAMES / 20 && v6 < FRAMES / 4);
+		assert(tcp > FRAMES / 2 && tcp < FRAMES * 7 / 10);
+	}
+
+	void test_vlan_stacked() noexcept {
+		TEST_TRACE;
+		const auto trace = make(proto::TrafficProfile::vlan_stacked());
+		size_t overflow = 0;
+		for(size_t i = 0; i < trace.size(); ++i) {
+			proto::PacketMeta meta;
+			assert(proto::MetaParser<>::parse_all(trace.frame(i), trace.length(i), meta));
+			assert(meta.vlan_nb >= 1);
+			assert(meta.vlan_id[0] != 0);
+			assert(meta.proto_l4 != proto::END);
+			overflow += bool(meta.flags & proto::PacketMeta::FLAG_VLAN_OVERFLOW);
+		}
+		// a third of the frames have three tags
+		assert(overflow > FRAMES / 4 && overflow < FRAMES / 2);
+	}
+
+	void test_ipv6() noexcept {
+		TEST_TRACE;
+		const auto trace = make(proto::TrafficProfile::ipv6_only());
+		for(size_t i = 0; i < trace.size(); ++i) {
+			proto::PacketMeta meta;
+			assert(proto::MetaParser<>::parse_all(trace.frame(i), trace.length(i), meta));
+			assert(meta.proto_l3 == proto::L3_IPv6 && meta.tuple.version == 6);
+			assert(checksums_valid(trace, i, meta));
+		}
+	}
+
+	void test_gre() noexcept {
+		TEST_TRACE;
+		const auto trace = make(proto::TrafficProfile::gre_tunneled());
+		size_t tunneled = 0;
+		for(size_t i = 0; i < trace.size(); ++i) {
+			proto::PacketMeta meta;
+			assert(proto::MetaParser<>::parse_all(trace.frame(i), trace.length(i), meta));
+			if(meta.proto_l4 != proto::L4_GRE) {
+				continue;
+			}
+			tunneled++;
+			// the header parser follows the tunnel down to the inner L4 header
+			proto::HeaderParser parser(trace.frame(i), trace.length(i));
+			unsigned l3 = 0;
+			proto::Protocol last = proto::END;
+			for(auto p = parser.protocol(); p != proto::END; p = parser.next()) {
+				l3 += p == proto::L3_IPv4 || p == proto::L3_IPv6;
+				last = p;
+			}
+			assert(l3 == 2);
+			assert(last == proto::L4_TCP || last == proto::L4_UDP);
+		}
+		assert(tunneled > FRAMES * 7 / 10 && tunneled < FRAMES * 9 / 10);
+	}
+
+	void test_fragmented() noexcept {
+		TEST_TRACE;
+		const auto trace = make(proto::TrafficProfile::fragmented());
+		size_t fragments = 0;
+		for(size_t i = 0; i < trace.size(); ++i) {
+			proto::PacketMeta meta;
+			assert(proto::MetaParser<>::parse_all(trace.frame(i), trace.length(i), meta));
+			assert(meta.proto_l3 == proto::L3_IPv4);
+			auto hdr = reinterpret_cast<const proto::IPv4::Header*>(trace.frame(i) + meta.off_l3);
+			assert(proto::IPv4::verify_checksum(hdr));
+			fragments += meta.fragment();
+		}
+		assert(fragments > FRAMES * 2 / 5 && fragments < FRAMES * 3 / 5);
+	}
+
+	void test_pcap() noexcept {
+		TEST_TRACE;
+		const auto trace = make(proto::TrafficProfile::gre_tunneled());
+		char path[] = "/tmp/test_traffic_XXXXXX";
+		const int fd = mkstemp(path);
+		assert(fd >= 0);
+		close(fd);
+		assert(trace.save_pcap(path));
+		proto::TrafficTrace loaded;
+		assert(loaded.load_pcap(path));
+		assert(same(trace, loaded));
+		remove(path);
+		assert(not loaded.load_pcap(path));
+		assert(loaded.size() == 0);
+	}
+
+};
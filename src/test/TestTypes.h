@@ -3,6 +3,11 @@
 #include "test_environment.h"
 #include <utils/Types.h>
 
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <string_view>
+
 class TestTypes {
 
 	template<typename T>
@@ -170,11 +175,75 @@ class TestTypes {
 		test_parse_float<long double>();
 	}
 
+	void test_string_view() noexcept {
+		TEST_TRACE;
+		// the numbers in the middle of a buffer, not zero terminated
+		const std::string_view line = "-1280x7F 0377 255.5";
+		int8_t i8;
+		int16_t i16;
+		uint8_t u8;
+		double d;
+		assert(utils::Types::parse_signed(line.substr(0, 4), i8) && i8 == -128);
+		assert(not utils::Types::parse_signed(line.substr(0, 5), i8));
+		assert(utils::Types::parse_signed(line.substr(0, 5), i16) && i16 == -1280);
+		assert(utils::Types::parse_unsigned(line.substr(4, 4), u8) && u8 == 127);
+		assert(utils::Types::parse_unsigned(line.substr(9, 4), u8) && u8 == 255);
+		assert(utils::Types::parse_unsigned(line.substr(14, 3), u8) && u8 == 255);
+		assert(utils::Types::parse_float(line.substr(14), d) && d == 255.5);
+		assert(utils::Types::parse_signed("+5", i16) && i16 == 5);
+		assert(not utils::Types::parse_signed("+-5", i16));
+		assert(not utils::Types::parse_unsigned("0x", u8));
+		assert(not utils::Types::parse_unsigned("08", u8));
+		assert(not utils::Types::parse_unsigned(" 1", u8));
+		assert(not utils::Types::parse_unsigned(std::string_view(), u8));
+	}
+
+	void test_digits() noexcept {
+		TEST_TRACE;
+		uint64_t value = 0;
+		assert(utils::Types::parse_digits("18446744073709551615", value) == 20 && value == UINT64_MAX);
+		assert(utils::Types::parse_digits("18446744073709551616", value) == 0);
+		assert(utils::Types::parse_digits("000000000000000000000000000042,", value) == 30 && value == 42);
+		assert(utils::Types::parse_digits("x1", value) == 0);
+		uint16_t u16 = 0;
+		assert(utils::Types::parse_digits("65535", u16) == 5 && u16 == 65535);
+		assert(utils::Types::parse_digits("65536", u16) == 0);
+
+		for(uint64_t chunk = 0; chunk < 256; ++chunk) {
+			const unsigned expected = (chunk >= '0' && chunk <= '9') ? 8 : 0;
+			assert(utils::Types::leading_digits(chunk | 0x3030303030303000ull) == expected);
+		}
+		// all the lengths and the positions of the end against strtoull()
+		DiceMachine dice(50);
+		char buffer[40];
+		for(int round = 0; round < 100000; ++round) {
+			const size_t digits = 1 + dice.u32() % 20u;
+			for(size_t i = 0; i < digits; ++i) {
+				buffer[i] = char('0' + dice.u32() % 10u);
+			}
+			buffer[digits] = "\0 ,.:/a\x80"[dice.u32() % 8u];
+			for(size_t i = digits + 1; i < sizeof(buffer); ++i) {
+				buffer[i] = char('0' + dice.u32() % 10u);
+			}
+			const std::string number(buffer, digits);
+			errno = 0;
+			const uint64_t expected = strtoull(number.c_str(), nullptr, 10);
+			const size_t read = utils::Types::parse_digits(std::string_view(buffer, sizeof(buffer)).substr(0, digits + 1), value);
+			if(errno == ERANGE) {
+				assert(read == 0);
+			} else {
+				assert(read == digits && value == expected);
+			}
+		}
+	}
+
 public:
 
 	explicit TestTypes() noexcept {
 		test_signed();
 		test_unsigned();
 		test_float();
+		test_string_view();
+		test_digits();
 	}
 };
@@ -2,7 +2,7 @@
 
 #include "test_environment.h"
 
-#include <lib/utils/LruPool.h>
+#include <containers/LruPool.h>
 
 #include <iostream>
 
@@ -38,48 +38,48 @@ public:
 
 	void test_acquire_find_release_single(unsigned step) {
 		TEST_TRACE;
-		ASSERT(_pool.size() == 0);
+		assert(_pool.size() == 0);
 
 		for(size_t i = 0; i < _capacity * 2; i++) {
 			const Key_t k = i + step;
 			const Value_t v = k + 1000u;
 
 			auto item = _pool.acquire(k);
-			ASSERT(item != nullptr);
+			assert(item != nullptr);
 			item->value() = v;
 
-			ASSERT(item->is_acquired());
-			ASSERT(item->key() == k);
-			ASSERT(item->value() == v);
+			assert(item->is_acquired());
+			assert(item->key() == k);
+			assert(item->value() == v);
 
 			auto it = _pool.find(k);
-			ASSERT(it != _pool.end());
-			ASSERT(item == &(*it));
+			assert(it != _pool.end());
+			assert(item == &(*it));
 
 			_pool.release(item);
-			ASSERT(_pool.size() == 0);
+			assert(_pool.size() == 0);
 		}
 		
 	}
 
 	void test_acquire_find_release_bulk(unsigned step) {
 		TEST_TRACE;
-		ASSERT(_pool.size() == 0);
+		assert(_pool.size() == 0);
 
 		for(size_t i = 0; i < _capacity * 2; i++) {
 			const Key_t k = i + step;
 			const Value_t v = k + 1000u;
 
 			auto item = _pool.acquire(k);
-			ASSERT(item != nullptr);
+			assert(item != nullptr);
 			item->value() = v;
 
-			ASSERT(item->is_acquired());
-			ASSERT(item->key() == k);
-			ASSERT(item->value() == v);
+			assert(item->is_acquired());
+			assert(item->key() == k);
+			assert(item->value() == v);
 		}
 
-		ASSERT(_pool.size() == _pool.capacity());
+		assert(_pool.size() == _pool.capacity());
 
 		for(size_t i = 0; i < _capacity * 2; i++) {
 			const Key_t k = i + step;
@@ -87,16 +87,16 @@ public:
 
 			auto it = _pool.find(k);
 			if(i < _capacity) {
-				ASSERT(it == _pool.end());
+				assert(it == _pool.end());
 			} else {
-				ASSERT(it != _pool.end());
-				ASSERT(it->is_acquired());
-				ASSERT(it->key() == k);
-				ASSERT(it->value() == v);
+				assert(it != _pool.end());
+				assert(it->is_acquired());
+				assert(it->key() == k);
+				assert(it->value() == v);
 			}
 		}
 
-		ASSERT(_pool.size() == _pool.capacity());
+		assert(_pool.size() == _pool.capacity());
 
 		for(size_t i = 0; i < _capacity * 2; i++) {
 			const Key_t k = i + step;
@@ -104,34 +104,34 @@ public:
 
 			auto it = _pool.find(k);
 			if(i < _capacity) {
-				ASSERT(it == _pool.end());
+				assert(it == _pool.end());
 			} else {
-				ASSERT(it != _pool.end());
-				ASSERT(it->is_acquired());
-				ASSERT(it->key() == k);
-				ASSERT(it->value() == v);
+				assert(it != _pool.end());
+				assert(it->is_acquired());
+				assert(it->key() == k);
+				assert(it->value() == v);
 				_pool.release(it.get());
 			}
 		}
 
-		ASSERT(_pool.size() == 0);
+		assert(_pool.size() == 0);
 	}
 
 	void test_clear(unsigned step) {
 		TEST_TRACE;
-		ASSERT(_pool.size() == 0);
+		assert(_pool.size() == 0);
 
 		for(size_t i = 0; i < _capacity * 2; i++) {
 			const Key_t k = i + step;
 			const Value_t v = k + 1000u;
 
 			auto item = _pool.acquire(k);
-			ASSERT(item != nullptr);
+			assert(item != nullptr);
 			item->value() = v;
 
-			ASSERT(item->is_acquired());
-			ASSERT(item->key() == k);
-			ASSERT(item->value() == v);
+			assert(item->is_acquired());
+			assert(item->key() == k);
+			assert(item->value() == v);
 		}
 
 		_pool.reset();
@@ -139,10 +139,10 @@ public:
 		for(size_t i = 0; i < _capacity * 2; i++) {
 			const Key_t k = i + step;
 			auto it = _pool.find(k);
-			ASSERT(it == _pool.end());
+			assert(it == _pool.end());
 		}
 
-		ASSERT(_pool.size() == 0);
+		assert(_pool.size() == 0);
 	}
 
 	void dump() {
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "test_environment.h"
+#include <tio/StringTokenizer.h>
+#include <tio/ViewTokenizer.h>
+#include <utils/Tokenizer.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+class TestViewTokenizer {
+
+	using Set_t = tio::DelimiterSet;
+
+public:
+
+	TestViewTokenizer() noexcept {
+		test_simple();
+		test_kernels();
+		test_kernel_selection();
+		test_keep_empty();
+		test_skip_empty();
+	}
+
+private:
+
+	template<bool SkipEmpty>
+	static std::vector<std::string> split(std::string_view input, const Set_t& set) noexcept {
+		std::vector<std::string> result;
+		tio::ViewTokenizer<SkipEmpty> tokenizer(input, set);
+		while(tokenizer.next()) {
+			const std::string_view token = tokenizer.token();
+			// a view over the input
+			assert(token.data() >= input.data() && token.data() + token.size() <= input.data() + input.size());
+			result.emplace_back(token);
+		}
+		assert(tokenizer.rest().empty());
+		return result;
+	}
+
+	/**
+	 * A random input of the letters and the delimiters of @chars, the runs and the tokens of 1 to 80 bytes.
+	 */
+	static std::string make_input(DiceMachine& dice, std::string_view chars, size_t size) noexcept {
+		std::string result;
+		while(result.size() < size) {
+			const bool delimiter = dice.pass(0.3);
+			const size_t run = delimiter ? 1 + dice.u32() % 3u : 1 + dice.u32() % 80u;
+			for(size_t i = 0; i < run; ++i) {
+				result.push_back(delimiter ? chars[dice.u32() % chars.size()] : char('a' + dice.u32() % 26u));
+			}
+		}
+		result.resize(size);
+		return result;
+	}
+
+	static const std::vector<std::string_view>& delimiter_sets() noexcept {
+		static const std::vector<std::string_view> sets = {
+			" ",
+			" \t\r\n",
+			" \t=#;,:[]\"'",
+			"/.:-_@",
+			std::string_view("\x01\x11\x21\x31\x41\x51\x61\x71\x81", 9), // 9 high nibbles
+			" !\"#$%&'()*+,-./:;<=>?", // 22 chars
+			std::string_view("\x00\x80\xFF\x7F", 4),
+		};
+		return sets;
+	}
+
+	void test_simple() noexcept {
+		TEST_TRACE;
+		const Set_t set(" =,");
+		assert(split<true>("", set).empty());
+		assert(split<true>("  ,, ", set).empty());
+		assert((split<true>("  key = a,b  ,c", set) == std::vector<std::string>{"key", "a", "b", "c"}));
+		assert((split<false>("", set) == std::vector<std::string>{""}));
+		assert((split<false>("a,,b,", set) == std::vector<std::string>{"a", "", "b", ""}));
+
+		// the tokens over the block boundaries
+		const std::string line = std::string(40, 'x') + " " + std::string(70, 'y') + "=" + std::string(31, 'z');
+		assert((split<true>(line, set) == std::vector<std::string>{
+			std::string(40, 'x'), std::string(70, 'y'), std::string(31, 'z')}));
+
+		tio::ViewTokenizer<> tokenizer("key = value # comment", set);
+		assert(tokenizer.next() && tokenizer.token() == "key");
+		assert(tokenizer.rest() == " = value # comment");
+		assert(tokenizer.next() && tokenizer.token() == "value");
+		tokenizer.reset("next line");
+		assert(tokenizer.next() && tokenizer.token() == "next");
+		assert(tokenizer.next() && tokenizer.token() == "line");
+		assert(not tokenizer.next() && tokenizer.token().empty());
+	}
+
+	void test_kernels() noexcept {
+		TEST_TRACE;
+		DiceMachine dice(49);
+		char block[Set_t::BLOCK];
+		for(const std::string_view chars : delimiter_sets()) {
+			const Set_t set(chars);
+			const bool sse42 = utils::Cpu::sse42() && chars.size() <= 16;
+			const bool avx2 = set.kernel() == Set_t::KERNEL_AVX2;
+			for(int round = 0; round < 10000; ++round) {
+				for(auto& byte : block) {
+					byte = dice.pass(0.3) ? chars[dice.u32() % chars.size()] : char(dice.u32());
+				}
+				const uint32_t expected = set.classify_scalar(block);
+				for(size_t i = 0; i < Set_t::BLOCK; ++i) {
+					assert(bool(expected >> i & 1u) == set.contains(block[i]));
+				}
+				assert(set.classify(block) == expected);
+				if(sse42) {
+					assert(set.classify_sse42(block) == expected);
+				}
+				if(avx2) {
+					assert(set.classify_avx2(block) == expected);
+				}
+				const size_t size = dice.u32() % Set_t::BLOCK;
+				assert(set.classify(block, size) == (expected & ((uint32_t(1) << size) - 1u)));
+			}
+		}
+	}
+
+	void test_kernel_selection() noexcept {
+		TEST_TRACE;
+		assert(Set_t(" \t", Set_t::KERNEL_SCALAR).kernel() == Set_t::KERNEL_SCALAR);
+		// 22 chars of 3 high nibbles
+		const Set_t wide(delimiter_sets()[5]);
+		assert(wide.kernel() == (utils::Cpu::avx2() ? Set_t::KERNEL_AVX2 : Set_t::KERNEL_SCALAR));
+		// 9 chars of 9 high nibbles
+		const Set_t scattered(delimiter_sets()[4]);
+		assert(scattered.kernel() == (utils::Cpu::sse42() ? Set_t::KERNEL_SSE42 : Set_t::KERNEL_SCALAR));
+		if(utils::Cpu::sse42()) {
+			assert(Set_t(" \t", Set_t::KERNEL_SSE42).kernel() == Set_t::KERNEL_SSE42);
+		}
+		if(utils::Cpu::avx2()) {
+			assert(Set_t(" \t").kernel() == Set_t::KERNEL_AVX2);
+		}
+	}
+
+	/**
+	 * Each delimiter ends a token as utils::Tokenizer does.
+	 */
+	void test_keep_empty() noexcept {
+		TEST_TRACE;
+		DiceMachine dice(50);
+		for(const std::string_view chars : delimiter_sets()) {
+			for(const auto kernel : {Set_t::KERNEL_SCALAR, Set_t::KERNEL_SSE42, Set_t::KERNEL_AVX2}) {
+				const Set_t set(chars, kernel);
+				for(int round = 0; round < 200; ++round) {
+					const std::string input = make_input(dice, chars, dice.u32() % 300u);
+					std::vector<std::string> expected;
+					utils::Tokenizer tokenizer(input, std::string(chars));
+					while(tokenizer.has_next()) {
+						expected.push_back(tokenizer.next());
+					}
+					assert(split<false>(input, set) == expected);
+				}
+			}
+		}
+	}
+
+	/**
+	 * The delimiter runs separate the tokens as tio::StringTokenizer does.
+	 */
+	void test_skip_empty() noexcept {
+		TEST_TRACE;
+		DiceMachine dice(51);
+		for(const std::string_view chars : delimiter_sets()) {
+			if(chars.find('\0') != std::string_view::npos) {
+				continue;
+			}
+			const std::string separators(chars);
+			for(const auto kernel : {Set_t::KERNEL_SCALAR, Set_t::KERNEL_SSE42, Set_t::KERNEL_AVX2}) {
+				const Set_t set(chars, kernel);
+				for(int round = 0; round < 200; ++round) {
+					const std::string input = make_input(dice, chars, dice.u32() % 300u);
+					std::vector<std::string> expected;
+					tio::StringTokenizer<512> tokenizer(input.c_str(), separators.c_str());
+					while(tokenizer.next()) {
+						expected.emplace_back(tokenizer.token());
+					}
+					assert(split<true>(input, set) == expected);
+				}
+			}
+		}
+	}
+
+};
@@ -2,10 +2,33 @@
 #include "TestTypes.h"
 #include "TestBitArrayT.h"
 #include "TestBitArray.h"
+#include "TestBitArrayAtomic.h"
+#include "TestCountMinSketch.h"
+#include "TestHyperLogLog.h"
+#include "TestBitStreamFast.h"
+#include "TestRankSelect.h"
+#include "TestRoaringBitmap.h"
+#include "TestEytzingerArray.h"
+#include "TestBPlusTree.h"
+#include "TestCuckooQueuePool.h"
+#include "TestContainerStat.h"
+#include "TestUtilsLruPool.h"
 #include "TestBitStream.h"
 #include "TestRangeBuffer.h"
 #include "TestRingArrayBuffer.h"
 #include "TestFio.h"
+#include "TestMetaParser.h"
+#include "TestBurstClassifier.h"
+#include "TestIPv4Reassembler.h"
+#include "TestTcpStreamTable.h"
+#include "TestChecksum.h"
+#include "TestTrafficGenerator.h"
+#include "TestAsyncLogger.h"
+#include "TestChunkedFile.h"
+#include "TestPoolSnapshot.h"
+#include "TestSharedPool.h"
+#include "TestViewTokenizer.h"
+#include "TestCliTypes.h"
 
 #include "TestIntrusiveLinkedList.h"
 #include "TestHashMap.h"
@@ -13,6 +36,8 @@
 #include <cstdio>
 #include <cstdlib>
 
+FILE* Logger::log_file = stdout;
+
 int main(int argc, char** argv) {
 
 //	constexpr size_t capacity = 8;// * 1024;
@@ -20,7 +45,6 @@ int main(int argc, char** argv) {
 //	TestCharClassifier test_char_classifier;
 //	TestStreamTokenizer test_stream_tokenizer;
 //	TestStringTokenizer test_string_tokenizer;
-//	TestTypes test_types;
 //	TestBitArrayT test_bit_arrayt(capacity);
 //	TestBitArray test_bit_array(capacity);
 //	TestBitStream test_bit_stream(capacity);
@@ -29,6 +53,31 @@ int main(int argc, char** argv) {
 //	TestIntrusiveLinkedList test_list(capacity);
 
 	TestFio test_fio;
+	TestMetaParser test_meta_parser;
+	TestBurstClassifier test_burst_classifier;
+	TestIPv4Reassembler test_ipv4_reassembler;
+	TestTcpStreamTable test_tcp_stream_table;
+	TestChecksum test_checksum;
+	TestTrafficGenerator test_traffic_generator;
+	TestAsyncLogger test_async_logger;
+	TestChunkedFile test_chunked_file;
+	TestPoolSnapshot test_pool_snapshot;
+	TestSharedPool test_shared_pool;
+	TestViewTokenizer test_view_tokenizer;
+	TestTypes test_types;
+	TestCliTypes test_cli_types;
+	TestBitArray test_bit_array(1000);
+	TestBitArrayAtomic test_bit_array_atomic;
+	TestCountMinSketch test_count_min_sketch;
+	TestHyperLogLog test_hyper_log_log;
+	TestBitStreamFast test_bit_stream_fast;
+	TestRankSelect test_rank_select;
+	TestRoaringBitmap test_roaring_bitmap;
+	TestEytzingerArray test_eytzinger_array;
+	TestBPlusTree test_b_plus_tree;
+	TestCuckooQueuePool test_cuckoo_queue_pool;
+	TestContainerStat test_container_stat;
+	TestUtilsLruPool test_utils_lru_pool(16, 0.7f);
 
 	printf("<---- the end of main() ---->\n");
 	return EXIT_SUCCESS;